@@ -0,0 +1,139 @@
+// Convert an on-disk rule table created by CreateOnDiskPt to the memory-mapped
+// format (OnDiskWrapper::MAPPED_VERSION_NUM).
+//
+// Only Source.dat changes: every node is rewritten with its children as
+// aligned, sorted arrays of vocab ids and child offsets. Vocab.dat,
+// TargetInd.dat and TargetColl.dat are copied unchanged, so the offsets of
+// the target phrase collections stay valid.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "OnDiskWrapper.h"
+#include "PhraseNode.h"
+#include "Word.h"
+#include "util/exception.hh"
+
+using namespace std;
+using namespace OnDiskPt;
+
+namespace
+{
+
+void CopyFile(const string &inPath, const string &outPath, const string &name)
+{
+  ifstream in((inPath + name).c_str(), ios::in | ios::binary);
+  UTIL_THROW_IF(!in.is_open(), util::FileOpenException, "Couldn't open file " << inPath << name);
+  ofstream out((outPath + name).c_str(), ios::out | ios::binary | ios::trunc);
+  UTIL_THROW_IF(!out.is_open(), util::FileOpenException, "Couldn't open file " << outPath << name);
+  out << in.rdbuf();
+  UTIL_THROW_IF2(!out, "Couldn't write to " << outPath << name);
+}
+
+class SourceWriter
+{
+public:
+  SourceWriter(OnDiskWrapper &wrapper, const string &path)
+    : m_wrapper(wrapper)
+    , m_file(path.c_str(), ios::out | ios::binary | ios::trunc)
+    , m_filePos(0)
+    , m_numNodes(0) {
+    UTIL_THROW_IF(!m_file.is_open(), util::FileOpenException, "Couldn't open file " << path);
+    // offset 0 is reserved, and nodes are aligned
+    const char reserved[sizeof(uint64_t)] = {-1, -1, -1, -1, -1, -1, -1, -1};
+    Write(reserved, sizeof(uint64_t));
+  }
+
+  // children first, so that their offsets are known when the node is written
+  uint64_t Convert(const PhraseNode &node) {
+    vector<pair<Word, uint64_t> > children(node.GetNumChildrenLoaded());
+    for (size_t ind = 0; ind < children.size(); ++ind) {
+      uint64_t childFilePos;
+      node.GetChild(children[ind].first, childFilePos, ind, m_wrapper);
+      PhraseNode child(childFilePos, m_wrapper);
+      children[ind].second = Convert(child);
+    }
+
+    vector<float> counts(m_wrapper.GetNumCounts());
+    for (size_t ind = 0; ind < counts.size(); ++ind) {
+      counts[ind] = node.GetCount(ind);
+    }
+
+    m_mem.resize(PhraseNode::GetMappedNodeSize(children.size(), counts.size()));
+    PhraseNode::WriteMappedNode(&m_mem[0], node.GetValue(), counts, children);
+
+    uint64_t ret = m_filePos;
+    Write(&m_mem[0], m_mem.size());
+    ++m_numNodes;
+    return ret;
+  }
+
+  size_t GetNumNodes() const {
+    return m_numNodes;
+  }
+
+private:
+  void Write(const char *mem, size_t size) {
+    m_file.write(mem, size);
+    UTIL_THROW_IF2(!m_file, "Couldn't write to Source.dat");
+    m_filePos += size;
+  }
+
+  OnDiskWrapper &m_wrapper;
+  ofstream m_file;
+  uint64_t m_filePos;
+  size_t m_numNodes;
+  vector<char> m_mem;
+};
+
+void usage()
+{
+  cerr << "Usage: ConvertOnDiskPt <on-disk table> <output directory>\n"
+       "Convert a table created by CreateOnDiskPt (version " << OnDiskWrapper::VERSION_NUM
+       << ") to the memory-mapped format (version " << OnDiskWrapper::MAPPED_VERSION_NUM << ")\n";
+  exit(1);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if (argc != 3)
+    usage();
+
+  const string inPath = argv[1], outPath = argv[2];
+
+  OnDiskWrapper wrapper;
+  wrapper.BeginLoad(inPath);
+  UTIL_THROW_IF2(wrapper.GetMisc("Version") != (uint64_t) OnDiskWrapper::VERSION_NUM,
+                 "On-disk phrase table is version " << wrapper.GetMisc("Version")
+                 << ". Can only convert version " << OnDiskWrapper::VERSION_NUM);
+
+  boost::filesystem::create_directories(outPath);
+
+  cerr << "Converting source tree..." << endl;
+  SourceWriter writer(wrapper, outPath + "/Source.dat");
+  uint64_t rootFilePos = writer.Convert(wrapper.GetRootSourceNode());
+  cerr << writer.GetNumNodes() << " nodes" << endl;
+
+  CopyFile(inPath, outPath, "/Vocab.dat");
+  CopyFile(inPath, outPath, "/TargetInd.dat");
+  CopyFile(inPath, outPath, "/TargetColl.dat");
+
+  ofstream misc((outPath + "/Misc.dat").c_str(), ios::out | ios::trunc);
+  UTIL_THROW_IF(!misc.is_open(), util::FileOpenException, "Couldn't open file " << outPath << "/Misc.dat");
+  misc << "Version " << OnDiskWrapper::MAPPED_VERSION_NUM << endl;
+  misc << "NumSourceFactors " << wrapper.GetMisc("NumSourceFactors") << endl;
+  misc << "NumTargetFactors " << wrapper.GetMisc("NumTargetFactors") << endl;
+  misc << "NumScores " << wrapper.GetMisc("NumScores") << endl;
+  misc << "RootNodeOffset " << rootFilePos << endl;
+
+  cerr << "Finished." << endl;
+  return 0;
+}
@@ -26,6 +26,7 @@
 #include "moses/Factor.h"
 #include "util/exception.hh"
 #include "util/string_stream.hh"
+#include "util/file.hh"
 
 using namespace std;
 
@@ -33,8 +34,10 @@ namespace OnDiskPt
 {
 
 int OnDiskWrapper::VERSION_NUM = 7;
+int OnDiskWrapper::MAPPED_VERSION_NUM = 8;
 
 OnDiskWrapper::OnDiskWrapper()
+  :m_rootSourceNode(NULL)
 {
 }
 
@@ -58,6 +61,28 @@ void OnDiskWrapper::BeginLoad(const std::string &filePath)
 
 bool OnDiskWrapper::OpenForLoad(const std::string &filePath)
 {
+  m_filePath = filePath;
+
+  m_fileMisc.open((filePath + "/Misc.dat").c_str(), ios::in);
+  UTIL_THROW_IF(!m_fileMisc.is_open(),
+                util::FileOpenException,
+                "Couldn't open file " << filePath << "/Misc.dat");
+
+  LoadMisc();
+  m_numSourceFactors = GetMisc("NumSourceFactors");
+  m_numTargetFactors = GetMisc("NumTargetFactors");
+  m_numScores = GetMisc("NumScores");
+
+  m_fileVocab.open((filePath + "/Vocab.dat").c_str(), ios::in);
+  UTIL_THROW_IF(!m_fileVocab.is_open(),
+                util::FileOpenException,
+                "Couldn't open file " << filePath << "/Vocab.dat");
+
+  if (GetMisc("Version") == (uint64_t) MAPPED_VERSION_NUM) {
+    MapForLoad(filePath);
+    return true;
+  }
+
   m_fileSource.open((filePath + "/Source.dat").c_str(), ios::in | ios::binary);
   UTIL_THROW_IF(!m_fileSource.is_open(),
                 util::FileOpenException,
@@ -73,23 +98,29 @@ bool OnDiskWrapper::OpenForLoad(const std::string &filePath)
                 util::FileOpenException,
                 "Couldn't open file " << filePath << "/TargetColl.dat");
 
-  m_fileVocab.open((filePath + "/Vocab.dat").c_str(), ios::in);
-  UTIL_THROW_IF(!m_fileVocab.is_open(),
-                util::FileOpenException,
-                "Couldn't open file " << filePath << "/Vocab.dat");
+  return true;
+}
 
-  m_fileMisc.open((filePath + "/Misc.dat").c_str(), ios::in);
-  UTIL_THROW_IF(!m_fileMisc.is_open(),
+void OnDiskWrapper::MapForLoad(const std::string &filePath)
+{
+  // pages are faulted in on first use, as the stream version would read them
+  const char *names[] = {"/Source.dat", "/TargetInd.dat", "/TargetColl.dat"};
+  util::scoped_memory *mems[] = {&m_memSource, &m_memTargetInd, &m_memTargetColl};
+  for (size_t i = 0; i < 3; ++i) {
+    util::scoped_fd file(util::OpenReadOrThrow((filePath + names[i]).c_str()));
+    util::MapRead(util::LAZY, file.get(), 0, util::SizeOrThrow(file.get()), *mems[i]);
+  }
+}
+
+uint64_t OnDiskWrapper::GetVersion(const std::string &filePath)
+{
+  OnDiskWrapper wrapper;
+  wrapper.m_fileMisc.open((filePath + "/Misc.dat").c_str(), ios::in);
+  UTIL_THROW_IF(!wrapper.m_fileMisc.is_open(),
                 util::FileOpenException,
                 "Couldn't open file " << filePath << "/Misc.dat");
-
-  // set up root node
-  LoadMisc();
-  m_numSourceFactors = GetMisc("NumSourceFactors");
-  m_numTargetFactors = GetMisc("NumTargetFactors");
-  m_numScores = GetMisc("NumScores");
-
-  return true;
+  wrapper.LoadMisc();
+  return wrapper.GetMisc("Version");
 }
 
 bool OnDiskWrapper::LoadMisc()
@@ -23,6 +23,7 @@
 #include "Vocab.h"
 #include "PhraseNode.h"
 #include "moses/Word.h"
+#include "util/mmap.hh"
 
 namespace OnDiskPt
 {
@@ -45,12 +46,24 @@ protected:
 
   std::map<std::string, uint64_t> m_miscInfo;
 
+  // mapped format only
+  util::scoped_memory m_memSource, m_memTargetInd, m_memTargetColl;
+
   void SaveMisc();
   bool OpenForLoad(const std::string &filePath);
   bool LoadMisc();
+  void MapForLoad(const std::string &filePath);
 
 public:
   static int VERSION_NUM;
+  /** Version of tables converted by ConvertOnDiskPt. The files are memory
+   *  mapped instead of read through streams, so once loaded, one object can
+   *  be used by any number of threads without locking.
+   */
+  static int MAPPED_VERSION_NUM;
+
+  //! Version of the table in filePath, from its Misc.dat
+  static uint64_t GetVersion(const std::string &filePath);
 
   OnDiskWrapper();
   ~OnDiskWrapper();
@@ -84,6 +97,25 @@ public:
     return m_fileVocab;
   }
 
+  bool IsMapped() const {
+    return m_memSource.get() != NULL;
+  }
+  const char *GetSourceMemory() const {
+    return (const char*) m_memSource.get();
+  }
+  size_t GetSourceMemorySize() const {
+    return m_memSource.size();
+  }
+  const char *GetTargetIndMemory() const {
+    return (const char*) m_memTargetInd.get();
+  }
+  const char *GetTargetCollMemory() const {
+    return (const char*) m_memTargetColl.get();
+  }
+  size_t GetTargetCollMemorySize() const {
+    return m_memTargetColl.size();
+  }
+
   size_t GetNumSourceFactors() const {
     return m_numSourceFactors;
   }
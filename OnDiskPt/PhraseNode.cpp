@@ -23,6 +23,8 @@
 #include "SourcePhrase.h"
 #include "moses/Util.h"
 #include "util/exception.hh"
+#include "util/sorted_uniform.hh"
+#include <cstring>
 
 using namespace std;
 
@@ -37,20 +39,67 @@ size_t PhraseNode::GetNodeSize(size_t numChildren, size_t wordSize, size_t count
   return ret;
 }
 
+size_t PhraseNode::GetMappedHeaderSize(size_t countSize)
+{
+  size_t ret = sizeof(uint64_t) * 2 // num children, value
+               + sizeof(float) * countSize // count info
+               + sizeof(uint32_t); // num non-term children
+  return (ret + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+}
+
+size_t PhraseNode::GetMappedNodeSize(size_t numChildren, size_t countSize)
+{
+  return GetMappedHeaderSize(countSize)
+         + sizeof(uint64_t) * 2 * numChildren; // vocab id + ptr to next source node
+}
+
+void PhraseNode::WriteMappedNode(char *mem, uint64_t value, const std::vector<float> &counts
+                                 , const std::vector<std::pair<Word, uint64_t> > &children)
+{
+  size_t headerSize = GetMappedHeaderSize(counts.size());
+  memset(mem, 0, headerSize);
+
+  uint64_t numChildren = children.size();
+  memcpy(mem, &numChildren, sizeof(uint64_t));
+  memcpy(mem + sizeof(uint64_t), &value, sizeof(uint64_t));
+  memcpy(mem + sizeof(uint64_t) * 2, &counts[0], sizeof(float) * counts.size());
+
+  uint64_t *vocabIds = (uint64_t*) (mem + headerSize);
+  uint64_t *childFilePos = vocabIds + numChildren;
+  uint32_t numNonTerms = 0;
+  for (size_t ind = 0; ind < children.size(); ++ind) {
+    const Word &word = children[ind].first;
+    UTIL_THROW_IF2(ind && !(children[ind - 1].first < word), "Children of a node must be sorted");
+    if (word.IsNonTerminal())
+      ++numNonTerms;
+    vocabIds[ind] = word.GetVocabId();
+    childFilePos[ind] = children[ind].second;
+  }
+  memcpy(mem + sizeof(uint64_t) * 2 + sizeof(float) * counts.size(), &numNonTerms, sizeof(uint32_t));
+}
+
 PhraseNode::PhraseNode()
   : m_value(0)
   ,m_currChild(NULL)
   ,m_saved(false)
   ,m_memLoad(NULL)
+  ,m_memMapped(NULL)
 {
 }
 
 PhraseNode::PhraseNode(uint64_t filePos, OnDiskWrapper &onDiskWrapper)
   :m_counts(onDiskWrapper.GetNumCounts())
+  ,m_memLoad(NULL)
+  ,m_memMapped(NULL)
 {
   // load saved node
   m_filePos = filePos;
 
+  if (onDiskWrapper.IsMapped()) {
+    LoadMapped(filePos, onDiskWrapper);
+    return;
+  }
+
   size_t countSize = onDiskWrapper.GetNumCounts();
 
   std::fstream &file = onDiskWrapper.GetFileSource();
@@ -82,6 +131,25 @@ PhraseNode::PhraseNode(uint64_t filePos, OnDiskWrapper &onDiskWrapper)
   m_memLoadLast = m_memLoad + memAlloc;
 }
 
+void PhraseNode::LoadMapped(uint64_t filePos, const OnDiskWrapper &onDiskWrapper)
+{
+  // nothing is copied. The node is read in place from the mapped file
+  size_t countSize = onDiskWrapper.GetNumCounts();
+  UTIL_THROW_IF2(filePos % sizeof(uint64_t) || filePos >= onDiskWrapper.GetSourceMemorySize(),
+                 "Bad node offset " << filePos << " in mapped phrase table");
+  m_memMapped = onDiskWrapper.GetSourceMemory() + filePos;
+
+  const uint64_t *memArray = (const uint64_t*) m_memMapped;
+  m_numChildrenLoad = memArray[0];
+  m_value = memArray[1];
+
+  const float *memFloat = (const float*) (m_memMapped + sizeof(uint64_t) * 2);
+  std::copy(memFloat, memFloat + countSize, m_counts.begin());
+  m_numNonTermChildren = *(const uint32_t*) (memFloat + countSize);
+
+  m_childVocabIds = (const uint64_t*) (m_memMapped + GetMappedHeaderSize(countSize));
+}
+
 PhraseNode::~PhraseNode()
 {
   free(m_memLoad);
@@ -196,6 +264,9 @@ void PhraseNode::AddTargetPhrase(size_t pos, const SourcePhrase &sourcePhrase
 
 const PhraseNode *PhraseNode::GetChild(const Word &wordSought, OnDiskWrapper &onDiskWrapper) const
 {
+  if (m_memMapped)
+    return GetChildMapped(wordSought, onDiskWrapper);
+
   const PhraseNode *ret = NULL;
 
   int l = 0;
@@ -222,8 +293,35 @@ const PhraseNode *PhraseNode::GetChild(const Word &wordSought, OnDiskWrapper &on
   return ret;
 }
 
+const PhraseNode *PhraseNode::GetChildMapped(const Word &wordSought, OnDiskWrapper &onDiskWrapper) const
+{
+  // non-terms and terms are each sorted by vocab id
+  const uint64_t *begin = m_childVocabIds;
+  const uint64_t *end = m_childVocabIds + m_numChildrenLoad;
+  if (wordSought.IsNonTerminal())
+    end = begin + m_numNonTermChildren;
+  else
+    begin += m_numNonTermChildren;
+
+  const uint64_t *found;
+  if (!util::SortedUniformFind<const uint64_t*, util::IdentityAccessor<uint64_t>, util::Pivot64>(
+        util::IdentityAccessor<uint64_t>(), begin, end, wordSought.GetVocabId(), found)) {
+    return NULL;
+  }
+
+  uint64_t childFilePos = found[m_numChildrenLoad];
+  return new PhraseNode(childFilePos, onDiskWrapper);
+}
+
 void PhraseNode::GetChild(Word &wordFound, uint64_t &childFilePos, size_t ind, OnDiskWrapper &onDiskWrapper) const
 {
+  if (m_memMapped) {
+    wordFound = Word(ind < m_numNonTermChildren);
+    wordFound.SetVocabId(m_childVocabIds[ind]);
+    childFilePos = m_childVocabIds[m_numChildrenLoad + ind];
+    return;
+  }
+
 
   size_t wordSize = onDiskWrapper.GetSourceWordSize();
   size_t childSize = wordSize + sizeof(uint64_t);
@@ -50,15 +50,38 @@ protected:
   char *m_memLoad, *m_memLoadLast;
   uint64_t m_numChildrenLoad;
 
+  // mapped format only. Node in the mapped Source.dat, and the first entry
+  // of its sorted array of children vocab ids
+  const char *m_memMapped;
+  const uint64_t *m_childVocabIds;
+  uint32_t m_numNonTermChildren;
+
+  void LoadMapped(uint64_t filePos, const OnDiskWrapper &onDiskWrapper);
+  const PhraseNode *GetChildMapped(const Word &wordSought, OnDiskWrapper &onDiskWrapper) const;
+
   void AddTargetPhrase(size_t pos, const SourcePhrase &sourcePhrase
                        , TargetPhrase *targetPhrase, OnDiskWrapper &onDiskWrapper
                        , size_t tableLimit, const std::vector<float> &counts, OnDiskPt::PhrasePtr spShort);
   size_t ReadChild(Word &wordFound, uint64_t &childFilePos, const char *mem) const;
-  void GetChild(Word &wordFound, uint64_t &childFilePos, size_t ind, OnDiskWrapper &onDiskWrapper) const;
 
 public:
   static size_t GetNodeSize(size_t numChildren, size_t wordSize, size_t countSize);
 
+  /** Node layout of the memory-mapped format (OnDiskWrapper::MAPPED_VERSION_NUM).
+   *  Nodes start on 8 byte boundaries and hold, in this order:
+   *    uint64_t numChildren, value
+   *    float counts[countSize], uint32_t numNonTermChildren, padded to 8 bytes
+   *    uint64_t vocabIds[numChildren]
+   *    uint64_t childFilePos[numChildren]
+   *  Children are in Word order: the non-terminals first, then the terminals,
+   *  each sorted by vocab id, so that a child is found by an interpolation
+   *  search over the vocab ids, without reading any other part of the node.
+   */
+  static size_t GetMappedHeaderSize(size_t countSize);
+  static size_t GetMappedNodeSize(size_t numChildren, size_t countSize);
+  static void WriteMappedNode(char *mem, uint64_t value, const std::vector<float> &counts
+                              , const std::vector<std::pair<Word, uint64_t> > &children);
+
   PhraseNode(); // unsaved node
   PhraseNode(uint64_t filePos, OnDiskWrapper &onDiskWrapper); // load saved node
   ~PhraseNode();
@@ -93,6 +116,12 @@ public:
 
   const PhraseNode *GetChild(const Word &wordSought, OnDiskWrapper &onDiskWrapper) const;
 
+  // children of a loaded node, in Word order
+  uint64_t GetNumChildrenLoaded() const {
+    return m_numChildrenLoad;
+  }
+  void GetChild(Word &wordFound, uint64_t &childFilePos, size_t ind, OnDiskWrapper &onDiskWrapper) const;
+
   TargetPhraseCollection::shared_ptr
   GetTargetPhraseCollection(size_t tableLimit,
                             OnDiskWrapper &onDiskWrapper) const;
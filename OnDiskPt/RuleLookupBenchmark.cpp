@@ -0,0 +1,178 @@
+// Rule lookup throughput of an on-disk rule table, in either format.
+// Every span of each input sentence, up to a maximum length, is walked down
+// the source tree from the root and the target phrases of each node found
+// are read, under the child for the left-hand side label if the table has
+// one, as the chart decoder does for its terminal rules. Sentences are
+// shared out between the threads. A table in the stream format needs one
+// OnDiskWrapper per thread, as PhraseDictionaryOnDisk keeps; a mapped table
+// is loaded once and read by all threads.
+//
+// Usage: RuleLookupBenchmark -t <table> [-threads <n>] [-tlimit <n>]
+//          [-max-span <n>] [-repeat <n>] [-lhs <label>] < sentences
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include "moses/Util.h"
+#include "OnDiskWrapper.h"
+#include "PhraseNode.h"
+#include "Word.h"
+#include "util/usage.hh"
+
+using namespace std;
+using namespace OnDiskPt;
+
+namespace
+{
+
+struct Setup {
+  string table, lhs;
+  size_t threads, tableLimit, maxSpan, repeat;
+  vector<vector<string> > sentences;
+};
+
+struct Counts {
+  size_t lookups, found, targetPhrases;
+};
+
+void Lookups(const Setup &setup, OnDiskWrapper &wrapper, size_t thread, Counts &counts)
+{
+  counts.lookups = counts.found = counts.targetPhrases = 0;
+  const Vocab &vocab = wrapper.GetVocab();
+
+  bool hasLHS;
+  Word lhs(true);
+  lhs.SetVocabId(vocab.GetVocabId(setup.lhs, hasLHS));
+
+  for (size_t repeat = 0; repeat < setup.repeat; ++repeat) {
+    for (size_t i = thread; i < setup.sentences.size(); i += setup.threads) {
+      const vector<string> &tokens = setup.sentences[i];
+      for (size_t start = 0; start < tokens.size(); ++start) {
+        // NULL stands for the root, which the wrapper owns
+        const PhraseNode *node = NULL;
+        for (size_t end = start; end < tokens.size() && end < start + setup.maxSpan; ++end) {
+          ++counts.lookups;
+          bool known;
+          Word word(false);
+          word.SetVocabId(vocab.GetVocabId(tokens[end], known));
+          const PhraseNode &prevNode = node ? *node : wrapper.GetRootSourceNode();
+          const PhraseNode *child = known ? prevNode.GetChild(word, wrapper) : NULL;
+          delete node;
+          node = child;
+          if (node == NULL)
+            break;
+
+          ++counts.found;
+          const PhraseNode *lhsNode = hasLHS ? node->GetChild(lhs, wrapper) : node;
+          if (lhsNode) {
+            counts.targetPhrases += lhsNode->GetTargetPhraseCollection(setup.tableLimit, wrapper)->GetSize();
+            if (lhsNode != node)
+              delete lhsNode;
+          }
+        }
+        delete node;
+      }
+    }
+  }
+}
+
+void usage()
+{
+  cerr << "Usage: RuleLookupBenchmark -t <table> [-threads <n>] [-tlimit <n>] [-max-span <n>] [-repeat <n>] [-lhs <label>] < sentences\n"
+       "-t <table>        on-disk rule table, in either format\n"
+       "-threads <n>      number of threads (default: 1)\n"
+       "-tlimit <n>       max number of rules read per source phrase (default: 20)\n"
+       "-max-span <n>     longest span looked up (default: 10)\n"
+       "-repeat <n>       number of passes over the input (default: 1)\n"
+       "-lhs <label>      left-hand side label of the rules read (default: X)\n";
+  exit(1);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  Setup setup;
+  setup.threads = 1;
+  setup.tableLimit = 20;
+  setup.maxSpan = 10;
+  setup.repeat = 1;
+  setup.lhs = "X";
+
+  for (int i = 1; i < argc; ++i) {
+    if (i + 1 == argc)
+      usage();
+    if (!strcmp(argv[i], "-t"))
+      setup.table = argv[++i];
+    else if (!strcmp(argv[i], "-threads"))
+      setup.threads = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-tlimit"))
+      setup.tableLimit = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-max-span"))
+      setup.maxSpan = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-repeat"))
+      setup.repeat = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-lhs"))
+      setup.lhs = argv[++i];
+    else
+      usage();
+  }
+  if (setup.table.empty() || setup.threads == 0)
+    usage();
+#ifndef WITH_THREADS
+  setup.threads = 1;
+#endif
+
+  string line;
+  while (getline(cin, line)) {
+    setup.sentences.push_back(Moses::Tokenize(line, " "));
+  }
+
+  uint64_t version = OnDiskWrapper::GetVersion(setup.table);
+  bool mapped = version == (uint64_t) OnDiskWrapper::MAPPED_VERSION_NUM;
+  double start = util::WallTime();
+  boost::ptr_vector<OnDiskWrapper> wrappers;
+  for (size_t t = 0; t < (mapped ? 1 : setup.threads); ++t) {
+    wrappers.push_back(new OnDiskWrapper());
+    wrappers.back().BeginLoad(setup.table);
+  }
+  double loaded = util::WallTime();
+
+  vector<Counts> counts(setup.threads);
+#ifdef WITH_THREADS
+  boost::thread_group group;
+  for (size_t t = 0; t < setup.threads; ++t) {
+    group.create_thread(boost::bind(Lookups, boost::cref(setup), boost::ref(wrappers[t % wrappers.size()]),
+                                    t, boost::ref(counts[t])));
+  }
+  group.join_all();
+#else
+  Lookups(setup, wrappers[0], 0, counts[0]);
+#endif
+  double finished = util::WallTime();
+
+  Counts total = {0, 0, 0};
+  for (size_t t = 0; t < counts.size(); ++t) {
+    total.lookups += counts[t].lookups;
+    total.found += counts[t].found;
+    total.targetPhrases += counts[t].targetPhrases;
+  }
+  cout << "version " << version << (mapped ? " (mapped)" : " (streams)")
+       << " threads=" << setup.threads
+       << " load=" << (loaded - start) << "s"
+       << " lookups=" << total.lookups
+       << " found=" << total.found
+       << " target phrases=" << total.targetPhrases
+       << " time=" << (finished - loaded) << "s"
+       << " lookups/sec=" << total.lookups / (finished - loaded) << endl;
+  return 0;
+}
@@ -19,6 +19,7 @@
  ***********************************************************************/
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 #include "moses/Util.h"
 #include "moses/TargetPhrase.h"
@@ -434,6 +435,104 @@ uint64_t TargetPhrase::ReadScoresFromFile(std::fstream &fileTPColl)
   return bytesRead;
 }
 
+namespace
+{
+// Values in the mapped files are not aligned, copy them out
+template <typename T>
+inline T ReadValue(const char *mem)
+{
+  T ret;
+  memcpy(&ret, mem, sizeof(T));
+  return ret;
+}
+}
+
+uint64_t TargetPhrase::ReadOtherInfoFromMemory(const char *mem)
+{
+  uint64_t memUsed = 0;
+  m_filePos = ReadValue<uint64_t>(mem);
+  memUsed += sizeof(uint64_t);
+  assert(m_filePos != 0);
+
+  memUsed += ReadAlignFromMemory(mem + memUsed);
+  memUsed += ReadScoresFromMemory(mem + memUsed);
+
+  // sparse features
+  memUsed += ReadStringFromMemory(mem + memUsed, m_sparseFeatures);
+
+  // properties
+  memUsed += ReadStringFromMemory(mem + memUsed, m_property);
+
+  return memUsed;
+}
+
+uint64_t TargetPhrase::ReadStringFromMemory(const char *mem, std::string &outStr)
+{
+  uint64_t strSize = ReadValue<uint64_t>(mem);
+  if (strSize) {
+    outStr.assign(mem + sizeof(uint64_t), strSize);
+  }
+  return sizeof(uint64_t) + strSize;
+}
+
+uint64_t TargetPhrase::ReadFromMemory(const char *memTargetInd)
+{
+  const char *mem = memTargetInd + m_filePos;
+  uint64_t bytesRead = 0;
+
+  uint64_t numWords = ReadValue<uint64_t>(mem);
+  bytesRead += sizeof(uint64_t);
+
+  for (size_t ind = 0; ind < numWords; ++ind) {
+    WordPtr word(new Word());
+    bytesRead += word->ReadFromMemory(mem + bytesRead);
+    AddWord(word);
+  }
+
+  // read source words
+  uint64_t numSourceWords = ReadValue<uint64_t>(mem + bytesRead);
+  bytesRead += sizeof(uint64_t);
+
+  PhrasePtr sp(new SourcePhrase());
+  for (size_t ind = 0; ind < numSourceWords; ++ind) {
+    WordPtr word( new Word());
+    bytesRead += word->ReadFromMemory(mem + bytesRead);
+    sp->AddWord(word);
+  }
+  SetSourcePhrase(sp);
+
+  return bytesRead;
+}
+
+uint64_t TargetPhrase::ReadAlignFromMemory(const char *mem)
+{
+  uint64_t numAlign = ReadValue<uint64_t>(mem);
+  const char *currMem = mem + sizeof(uint64_t);
+
+  for (size_t ind = 0; ind < numAlign; ++ind) {
+    AlignPair alignPair;
+    alignPair.first = ReadValue<uint64_t>(currMem);
+    alignPair.second = ReadValue<uint64_t>(currMem + sizeof(uint64_t));
+    m_align.push_back(alignPair);
+
+    currMem += sizeof(uint64_t) * 2;
+  }
+
+  return currMem - mem;
+}
+
+uint64_t TargetPhrase::ReadScoresFromMemory(const char *mem)
+{
+  UTIL_THROW_IF2(m_scores.size() == 0, "Translation rules must must have some scores");
+
+  memcpy(&m_scores[0], mem, sizeof(float) * m_scores.size());
+
+  std::transform(m_scores.begin(),m_scores.end(),m_scores.begin(), Moses::TransformScore);
+  std::transform(m_scores.begin(),m_scores.end(),m_scores.begin(), Moses::FloorScore);
+
+  return sizeof(float) * m_scores.size();
+}
+
 void TargetPhrase::DebugPrint(ostream &out, const Vocab &vocab) const
 {
   Phrase::DebugPrint(out, vocab);
@@ -63,6 +63,10 @@ protected:
   uint64_t ReadScoresFromFile(std::fstream &fileTPColl);
   uint64_t ReadStringFromFile(std::fstream &fileTPColl, std::string &outStr);
 
+  uint64_t ReadAlignFromMemory(const char *mem);
+  uint64_t ReadScoresFromMemory(const char *mem);
+  uint64_t ReadStringFromMemory(const char *mem, std::string &outStr);
+
 public:
   TargetPhrase() {
   }
@@ -111,6 +115,10 @@ public:
   uint64_t ReadOtherInfoFromFile(uint64_t filePos, std::fstream &fileTPColl);
   uint64_t ReadFromFile(std::fstream &fileTP);
 
+  // same as above, from the mapped TargetColl.dat & TargetInd.dat
+  uint64_t ReadOtherInfoFromMemory(const char *mem);
+  uint64_t ReadFromMemory(const char *memTargetInd);
+
   virtual void DebugPrint(std::ostream &out, const Vocab &vocab) const;
 
   void SetProperty(const std::string &value) {
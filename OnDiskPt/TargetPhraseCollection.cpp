@@ -19,6 +19,7 @@
  ***********************************************************************/
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 #include "moses/Util.h"
 #include "moses/TargetPhraseCollection.h"
@@ -26,6 +27,7 @@
 #include "TargetPhraseCollection.h"
 #include "Vocab.h"
 #include "OnDiskWrapper.h"
+#include "util/exception.hh"
 
 using namespace std;
 
@@ -149,6 +151,11 @@ Moses::TargetPhraseCollection::shared_ptr TargetPhraseCollection::ConvertToMoses
 
 void TargetPhraseCollection::ReadFromFile(size_t tableLimit, uint64_t filePos, OnDiskWrapper &onDiskWrapper)
 {
+  if (onDiskWrapper.IsMapped()) {
+    ReadFromMemory(tableLimit, filePos, onDiskWrapper);
+    return;
+  }
+
   fstream &fileTPColl = onDiskWrapper.GetFileTargetColl();
   fstream &fileTP = onDiskWrapper.GetFileTargetInd();
 
@@ -180,6 +187,35 @@ void TargetPhraseCollection::ReadFromFile(size_t tableLimit, uint64_t filePos, O
   }
 }
 
+void TargetPhraseCollection::ReadFromMemory(size_t tableLimit, uint64_t filePos, const OnDiskWrapper &onDiskWrapper)
+{
+  UTIL_THROW_IF2(filePos >= onDiskWrapper.GetTargetCollMemorySize(),
+                 "Bad target phrase collection offset " << filePos << " in mapped phrase table");
+  const char *mem = onDiskWrapper.GetTargetCollMemory() + filePos;
+  const char *memTargetInd = onDiskWrapper.GetTargetIndMemory();
+
+  size_t numScores = onDiskWrapper.GetNumScores();
+
+  uint64_t numPhrases;
+  memcpy(&numPhrases, mem, sizeof(uint64_t));
+  mem += sizeof(uint64_t);
+
+  // table limit
+  if (tableLimit) {
+    numPhrases = std::min(numPhrases, (uint64_t) tableLimit);
+  }
+
+  m_coll.reserve(numPhrases);
+  for (size_t ind = 0; ind < numPhrases; ++ind) {
+    TargetPhrase *tp = new TargetPhrase(numScores);
+
+    mem += tp->ReadOtherInfoFromMemory(mem);
+    tp->ReadFromMemory(memTargetInd);
+
+    m_coll.push_back(tp);
+  }
+}
+
 uint64_t TargetPhraseCollection::GetFilePos() const
 {
   return m_filePos;
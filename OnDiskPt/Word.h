@@ -70,6 +70,9 @@ public:
   void SetVocabId(uint32_t vocabId) {
     m_vocabId = vocabId;
   }
+  uint64_t GetVocabId() const {
+    return m_vocabId;
+  }
 
   void ConvertToMoses(
     const std::vector<Moses::FactorType> &outputFactorsVec,
@@ -4,6 +4,9 @@
 #include "util/file_piece.hh"
 #include "util/usage.hh"
 
+#include <algorithm>
+#include <vector>
+
 #include <stdint.h>
 
 namespace {
@@ -67,53 +70,122 @@ template <class Model, class Width> void QueryFromBytes(const Model &model, int
   std::cout << "RSSMax: " << util::RSSMax() << std::endl;
 }
 
-template <class Model, class Width> void DispatchFunction(const Model &model, bool query) {
-  if (query) {
+// The text is split into lanes, like the hypotheses of a decoder batch that
+// each extend their own history.  Returns the probability sum of each lane.
+template <class Model, class Width> std::vector<double> ScoreLanes(const Model &model, const std::vector<Width> &words, std::size_t lanes, bool batch) {
+  const Width kEOS = model.GetVocabulary().EndSentence();
+  std::vector<lm::ngram::State> state(lanes, model.BeginSentenceState()), next(lanes);
+  std::vector<std::size_t> pos(lanes), end(lanes);
+  for (std::size_t l = 0; l < lanes; ++l) {
+    pos[l] = words.size() * l / lanes;
+    end[l] = words.size() * (l + 1) / lanes;
+  }
+  std::vector<double> sums(lanes, 0.0);
+  if (!batch) {
+    // One lane after the other: each lookup waits for the previous one.
+    for (std::size_t l = 0; l < lanes; ++l) {
+      for (; pos[l] < end[l]; ++pos[l]) {
+        const Width word = words[pos[l]];
+        sums[l] += model.FullScore(state[l], word, next[l]).prob;
+        state[l] = (word == kEOS) ? model.BeginSentenceState() : next[l];
+      }
+    }
+    return sums;
+  }
+  // One word of every lane per round, prefetched for all lanes first.
+  for (std::size_t round = 0; ; ++round) {
+    bool any = false;
+    for (std::size_t l = 0; l < lanes; ++l) {
+      if (pos[l] + round < end[l]) model.Prefetch(state[l], words[pos[l] + round]);
+    }
+    for (std::size_t l = 0; l < lanes; ++l) {
+      if (pos[l] + round >= end[l]) continue;
+      const Width word = words[pos[l] + round];
+      sums[l] += model.FullScore(state[l], word, next[l]).prob;
+      state[l] = (word == kEOS) ? model.BeginSentenceState() : next[l];
+      any = true;
+    }
+    if (!any) break;
+  }
+  return sums;
+}
+
+template <class Model, class Width> void BatchFromBytes(const Model &model, int fd_in, std::size_t lanes) {
+  std::vector<Width> words;
+  Width buf[4096];
+  while (std::size_t got = util::ReadOrEOF(fd_in, buf, sizeof(buf))) {
+    UTIL_THROW_IF2(got % sizeof(Width), "File size not a multiple of vocab id size " << sizeof(Width));
+    words.insert(words.end(), buf, buf + got / sizeof(Width));
+  }
+  lanes = std::max<std::size_t>(1, std::min(lanes, words.size()));
+
+  double start = util::CPUTime();
+  std::vector<double> single(ScoreLanes<Model, Width>(model, words, lanes, false));
+  double middle = util::CPUTime();
+  std::vector<double> batched(ScoreLanes<Model, Width>(model, words, lanes, true));
+  double after = util::CPUTime();
+
+  double single_total = 0.0, batched_total = 0.0;
+  for (std::size_t l = 0; l < lanes; ++l) {
+    single_total += single[l];
+    batched_total += batched[l];
+  }
+  std::cerr << "Probability sum is " << single_total << " single, " << batched_total << " batched" << std::endl;
+  std::cout << "Queries: " << words.size() << "\nBatch: " << lanes << std::endl;
+  std::cout << "Single_queries_per_sec: " << words.size() / (middle - start) << std::endl;
+  std::cout << "Batch_queries_per_sec: " << words.size() / (after - middle) << std::endl;
+  std::cout << "RSSMax: " << util::RSSMax() << std::endl;
+}
+
+template <class Model, class Width> void DispatchFunction(const Model &model, const char *mode, std::size_t lanes) {
+  if (!strcmp(mode, "query")) {
     QueryFromBytes<Model, Width>(model, 0);
+  } else if (!strcmp(mode, "batch")) {
+    BatchFromBytes<Model, Width>(model, 0, lanes);
   } else {
     ConvertToBytes<Model, Width>(model, 0);
   }
 }
 
-template <class Model> void DispatchWidth(const char *file, bool query) {
+template <class Model> void DispatchWidth(const char *file, const char *mode, std::size_t lanes) {
   lm::ngram::Config config;
   config.load_method = util::READ;
   std::cerr << "Using load_method = READ." << std::endl;
   Model model(file, config);
   lm::WordIndex bound = model.GetVocabulary().Bound();
   if (bound <= 256) {
-    DispatchFunction<Model, uint8_t>(model, query);
+    DispatchFunction<Model, uint8_t>(model, mode, lanes);
   } else if (bound <= 65536) {
-    DispatchFunction<Model, uint16_t>(model, query);
+    DispatchFunction<Model, uint16_t>(model, mode, lanes);
   } else if (bound <= (1ULL << 32)) {
-    DispatchFunction<Model, uint32_t>(model, query);
+    DispatchFunction<Model, uint32_t>(model, mode, lanes);
   } else {
-    DispatchFunction<Model, uint64_t>(model, query);
+    DispatchFunction<Model, uint64_t>(model, mode, lanes);
   }
 }
 
-void Dispatch(const char *file, bool query) {
+void Dispatch(const char *file, const char *mode, std::size_t lanes) {
   using namespace lm::ngram;
   lm::ngram::ModelType model_type;
   if (lm::ngram::RecognizeBinary(file, model_type)) {
     switch(model_type) {
       case PROBING:
-        DispatchWidth<lm::ngram::ProbingModel>(file, query);
+        DispatchWidth<lm::ngram::ProbingModel>(file, mode, lanes);
         break;
       case REST_PROBING:
-        DispatchWidth<lm::ngram::RestProbingModel>(file, query);
+        DispatchWidth<lm::ngram::RestProbingModel>(file, mode, lanes);
         break;
       case TRIE:
-        DispatchWidth<lm::ngram::TrieModel>(file, query);
+        DispatchWidth<lm::ngram::TrieModel>(file, mode, lanes);
         break;
       case QUANT_TRIE:
-        DispatchWidth<lm::ngram::QuantTrieModel>(file, query);
+        DispatchWidth<lm::ngram::QuantTrieModel>(file, mode, lanes);
         break;
       case ARRAY_TRIE:
-        DispatchWidth<lm::ngram::ArrayTrieModel>(file, query);
+        DispatchWidth<lm::ngram::ArrayTrieModel>(file, mode, lanes);
         break;
       case QUANT_ARRAY_TRIE:
-        DispatchWidth<lm::ngram::QuantArrayTrieModel>(file, query);
+        DispatchWidth<lm::ngram::QuantArrayTrieModel>(file, mode, lanes);
         break;
       default:
         UTIL_THROW(util::Exception, "Unrecognized kenlm model type " << model_type);
@@ -126,7 +198,8 @@ void Dispatch(const char *file, bool query) {
 } // namespace
 
 int main(int argc, char *argv[]) {
-  if (argc != 3 || (strcmp(argv[1], "vocab") && strcmp(argv[1], "query"))) {
+  bool batch = argc >= 2 && !strcmp(argv[1], "batch");
+  if ((argc != 3 && !(batch && argc == 4)) || (strcmp(argv[1], "vocab") && strcmp(argv[1], "query") && !batch)) {
     std::cerr
       << "Benchmark program for KenLM.  Intended usage:\n"
       << "#Convert text to vocabulary ids offline.  These ids are tied to a model.\n"
@@ -134,9 +207,12 @@ int main(int argc, char *argv[]) {
       << "#Ensure files are in RAM.\n"
       << "cat $text.vocab $model >/dev/null\n"
       << "#Timed query against the model.\n"
-      << argv[0] << " query $model <$text.vocab\n";
+      << argv[0] << " query $model <$text.vocab\n"
+      << "#Compare single queries with batches of independent queries (default 16),\n"
+      << "#as a decoder scoring many hypotheses at once.\n"
+      << argv[0] << " batch $model [batch size] <$text.vocab\n";
     return 1;
   }
-  Dispatch(argv[2], !strcmp(argv[1], "query"));
+  Dispatch(argv[2], argv[1], argc == 4 ? atoi(argv[3]) : 16);
   return 0;
 }
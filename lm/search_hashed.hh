@@ -125,6 +125,23 @@ template <class Value> class HashedSearch {
       return LongestPointer(found->value.prob);
     }
 
+    // Prefetch what scoring word after [context_rbegin, context_rend) will
+    // look up.  The hashes only depend on the words, so all orders can be
+    // fetched at once.
+    void Prefetch(WordIndex word, const WordIndex *context_rbegin, const WordIndex *context_rend) const {
+#ifdef __GNUC__
+      __builtin_prefetch(&unigram_.Lookup(word));
+#endif
+      Node node = static_cast<Node>(word);
+      const WordIndex *i = context_rbegin;
+      for (typename std::vector<Middle>::const_iterator m = middle_.begin(); m != middle_.end(); ++m, ++i) {
+        if (i == context_rend) return;
+        node = CombineWordHash(node, *i);
+        m->Prefetch(node);
+      }
+      if (i != context_rend) longest_.Prefetch(CombineWordHash(node, *i));
+    }
+
     // Generate a node without necessarily checking that it actually exists.
     // Optionally return false if it's know to not exist.
     bool FastMakeNode(const WordIndex *begin, const WordIndex *end, Node &node) const {
@@ -1,27 +1,46 @@
 #include "util/usage.hh"
 #include "moses/TranslationModel/ProbingPT/storing.hh"
 
+#include <boost/thread/thread.hpp>
 
+#include <cstdlib>
+
+void Usage(const char *program)
+{
+  std::cerr << "Usage: " << program << " path_to_phrasetable output_dir num_scores [is_reordering [threads]]" << std::endl;
+  std::cerr << "is_reordering should be either true or false, but it is currently a stub feature." << std::endl;
+  std::cerr << "threads defaults to the number of cores. The output does not depend on it." << std::endl;
+  //std::cerr << "Usage: " << program << " path_to_phrasetable number_of_uniq_lines output_bin_file output_hash_table output_vocab_id" << std::endl;
+}
 
 int main(int argc, char* argv[])
 {
 
   const char * is_reordering = "false";
+  std::size_t threads = std::max(1U, boost::thread::hardware_concurrency());
 
-  if (!(argc == 5 || argc == 4)) {
+  if (!(argc == 6 || argc == 5 || argc == 4)) {
     // Tell the user how to run the program
-    std::cerr << "Provided " << argc << " arguments, needed 4 or 5." << std::endl;
-    std::cerr << "Usage: " << argv[0] << " path_to_phrasetable output_dir num_scores is_reordering" << std::endl;
-    std::cerr << "is_reordering should be either true or false, but it is currently a stub feature." << std::endl;
-    //std::cerr << "Usage: " << argv[0] << " path_to_phrasetable number_of_uniq_lines output_bin_file output_hash_table output_vocab_id" << std::endl;
+    std::cerr << "Provided " << argc << " arguments, needed 4, 5 or 6." << std::endl;
+    Usage(argv[0]);
     return 1;
   }
 
-  if (argc == 5) {
+  if (argc >= 5) {
     is_reordering = argv[4];
   }
+  if (argc == 6) {
+    char *end;
+    long num = strtol(argv[5], &end, 10);
+    if (end == argv[5] || *end != '\0' || num < 1) {
+      std::cerr << "threads must be a number of at least 1, not " << argv[5] << std::endl;
+      Usage(argv[0]);
+      return 1;
+    }
+    threads = num;
+  }
 
-  createProbingPT(argv[1], argv[2], argv[3], is_reordering);
+  createProbingPT(argv[1], argv[2], argv[3], is_reordering, threads);
 
   util::PrintUsage(std::cout);
   return 0;
@@ -7,6 +7,7 @@
 #include "util/murmur_hash.hh"
 #include "util/probing_hash_table.hh"
 #include "util/usage.hh"
+#include "util/exception.hh"
 
 #include "moses/TranslationModel/ProbingPT/quering.hh"
 
@@ -26,16 +27,116 @@
 #include <unistd.h>
 #include <fcntl.h>
 
+namespace
+{
+
+//Looks up every source phrase with the copying query path: the encoded entry is copied
+//out of the mmapped file, decoded into target_text and the words mapped through the
+//vocabulary map. Returns a checksum over the decoded words and scores.
+double LookupCopying(QueryEngine &queries, const std::vector<std::vector<uint64_t> > &phrases,
+                     const std::map<unsigned int, std::string> &vocab, size_t &found)
+{
+  double checksum = 0;
+  for (size_t i = 0; i < phrases.size(); ++i) {
+    std::pair<bool, std::vector<target_text> > query_result = queries.query(phrases[i]);
+    if (!query_result.first) continue;
+    ++found;
+    const std::vector<target_text> &targets = query_result.second;
+    for (size_t j = 0; j < targets.size(); ++j) {
+      for (size_t k = 0; k < targets[j].target_phrase.size(); ++k) {
+        const std::string &word = vocab.find(targets[j].target_phrase[k])->second;
+        checksum += word.size();
+      }
+      for (size_t k = 0; k < targets[j].prob.size(); ++k) {
+        checksum += targets[j].prob[k];
+      }
+    }
+  }
+  return checksum;
+}
+
+//Same lookups with the zero-copy path: the entry is decoded in place from the mmapped
+//file and the words resolved through a flat table built once.
+double LookupZeroCopy(const QueryEngine &queries, const std::vector<std::vector<uint64_t> > &phrases,
+                      const std::vector<const std::string *> &vocab, size_t &found)
+{
+  double checksum = 0;
+  std::vector<unsigned int> words;
+  std::vector<float> scores(queries.getNumScores());
+  unsigned int alignId;
+  for (size_t i = 0; i < phrases.size(); ++i) {
+    const unsigned char *begin, *end;
+    if (!queries.query(&phrases[i][0], phrases[i].size(), begin, end)) continue;
+    ++found;
+    target_text_reader reader(begin, end, queries.getNumScores());
+    while (reader.next(words, scores.empty() ? NULL : &scores[0], alignId)) {
+      for (size_t k = 0; k < words.size(); ++k) {
+        checksum += vocab[words[k]]->size();
+      }
+      for (size_t k = 0; k < scores.size(); ++k) {
+        checksum += scores[k];
+      }
+    }
+  }
+  return checksum;
+}
+
+//Compares the lookups/sec of the two query paths on the source phrases in a file,
+//one per line, looked up passes times.
+int Benchmark(QueryEngine &queries, const char *file, size_t passes)
+{
+  std::vector<std::vector<uint64_t> > phrases;
+  std::ifstream in(file);
+  UTIL_THROW_IF2(!in, "Cannot open " << file);
+  std::string line;
+  while (getline(in, line)) {
+    std::vector<uint64_t> ids = getVocabIDs(StringPiece(line));
+    if (!ids.empty()) phrases.push_back(ids);
+  }
+  std::cerr << "Read " << phrases.size() << " source phrases" << std::endl;
+
+  std::map<unsigned int, std::string> vocab = queries.getVocab();
+  std::vector<const std::string *> flatVocab(vocab.empty() ? 0 : vocab.rbegin()->first + 1);
+  for (std::map<unsigned int, std::string>::const_iterator iter = vocab.begin(); iter != vocab.end(); ++iter) {
+    flatVocab[iter->first] = &iter->second;
+  }
+
+  for (size_t path = 0; path < 2; ++path) {
+    double checksum = 0;
+    size_t found = 0;
+    double start = util::WallTime();
+    for (size_t pass = 0; pass < passes; ++pass) {
+      checksum += path == 0
+                  ? LookupCopying(queries, phrases, vocab, found)
+                  : LookupZeroCopy(queries, phrases, flatVocab, found);
+    }
+    double elapsed = util::WallTime() - start;
+    std::cout << (path == 0 ? "copying  " : "zero-copy")
+              << " lookups=" << phrases.size() * passes
+              << " found=" << found
+              << " seconds=" << elapsed
+              << " lookups/sec=" << (elapsed > 0 ? phrases.size() * passes / elapsed : 0)
+              << " checksum=" << checksum << std::endl;
+  }
+  return 0;
+}
+
+}
+
 int main(int argc, char* argv[])
 {
-  if (argc != 2) {
+  if (argc != 2 && argc != 3 && argc != 4) {
     // Tell the user how to run the program
-    std::cerr << "Usage: " << argv[0] << " path_to_directory" << std::endl;
+    std::cerr << "Usage: " << argv[0] << " path_to_directory [source_phrases_to_benchmark [passes]]" << std::endl;
     return 1;
   }
 
   QueryEngine queries(argv[1]);
 
+  if (argc > 2) {
+    return Benchmark(queries, argv[2], argc > 3 ? atoi(argv[3]) : 1);
+  }
+
   //Interactive search
   std::cout << "Please enter a string to be searched, or exit to exit." << std::endl;
   while (true) {
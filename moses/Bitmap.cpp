@@ -27,65 +27,82 @@ namespace Moses
 
 TO_STRING_BODY(Bitmap);
 
-Bitmap::Bitmap(size_t size, const std::vector<bool>& initializer)
-  :m_bitmap(initializer.begin(), initializer.end())
-{
+const size_t Bitmap::kBitsPerWord;
+const size_t Bitmap::kInlineWords;
 
-  // The initializer may not be of the same length.  Change to the desired
-  // length.  If we need to add any elements, initialize them to false.
-  m_bitmap.resize(size, false);
+void Bitmap::Allocate(size_t size)
+{
+  m_size = size;
+  m_numWords = (size + kBitsPerWord - 1) / kBitsPerWord;
+  m_bits = m_numWords <= kInlineWords ? m_inline : new Word[m_numWords];
+}
 
-  m_numWordsCovered = std::count(m_bitmap.begin(), m_bitmap.end(), true);
+Bitmap::Bitmap(size_t size, const std::vector<bool>& initializer)
+{
+  Allocate(size);
+  std::fill(m_bits, m_bits + m_numWords, Word(0));
+
+  // The initializer may not be of the same length.  Only use the part that
+  // falls within the desired length, the rest is initialized to false.
+  m_numWordsCovered = 0;
+  for (size_t pos = 0; pos < size && pos < initializer.size(); ++pos) {
+    if (initializer[pos]) {
+      m_bits[pos / kBitsPerWord] |= Word(1) << (pos % kBitsPerWord);
+    }
+  }
+  for (size_t i = 0; i < m_numWords; ++i) {
+    m_numWordsCovered += PopCount(m_bits[i]);
+  }
 
   // Find the first gap, and cache it.
-  std::vector<char>::const_iterator first_gap = std::find(
-        m_bitmap.begin(), m_bitmap.end(), false);
-  m_firstGap = (
-                 (first_gap == m_bitmap.end()) ?
-                 NOT_FOUND : first_gap - m_bitmap.begin());
+  m_firstGap = Find(0, false);
 }
 
 //! Create Bitmap of length size and initialise.
 Bitmap::Bitmap(size_t size)
-  :m_bitmap(size, false)
-  ,m_firstGap(0)
+  :m_firstGap(0)
   ,m_numWordsCovered(0)
-
 {
+  Allocate(size);
+  std::fill(m_bits, m_bits + m_numWords, Word(0));
 }
 
 //! Deep copy.
 Bitmap::Bitmap(const Bitmap &copy)
-  :m_bitmap(copy.m_bitmap)
-  ,m_firstGap(copy.m_firstGap)
+  :m_firstGap(copy.m_firstGap)
   ,m_numWordsCovered(copy.m_numWordsCovered)
 {
+  Allocate(copy.m_size);
+  std::copy(copy.m_bits, copy.m_bits + m_numWords, m_bits);
 }
 
 Bitmap::Bitmap(const Bitmap &copy, const Range &range)
-  :m_bitmap(copy.m_bitmap)
-  ,m_firstGap(copy.m_firstGap)
+  :m_firstGap(copy.m_firstGap)
   ,m_numWordsCovered(copy.m_numWordsCovered)
 {
+  Allocate(copy.m_size);
+  std::copy(copy.m_bits, copy.m_bits + m_numWords, m_bits);
   SetValueNonOverlap(range);
 }
 
 // for unordered_set in stack
 size_t Bitmap::hash() const
 {
-  size_t ret = boost::hash_value(m_bitmap);
+  size_t ret = boost::hash_range(m_bits, m_bits + m_numWords);
+  boost::hash_combine(ret, m_size);
   return ret;
 }
 
 bool Bitmap::operator==(const Bitmap& other) const
 {
-  return m_bitmap == other.m_bitmap;
+  return m_size == other.m_size
+         && std::equal(m_bits, m_bits + m_numWords, other.m_bits);
 }
 
 // friend
 std::ostream& operator<<(std::ostream& out, const Bitmap& bitmap)
 {
-  for (size_t i = 0 ; i < bitmap.m_bitmap.size() ; i++) {
+  for (size_t i = 0 ; i < bitmap.m_size ; i++) {
     out << int(bitmap.GetValue(i));
   }
   return out;
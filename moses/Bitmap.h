@@ -26,9 +26,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <limits>
 #include <vector>
 #include <iostream>
+#include <cassert>
 #include <cstring>
 #include <cmath>
 #include <cstdlib>
+#include <stdint.h>
 #include "TypeDef.h"
 #include "Range.h"
 
@@ -38,38 +40,140 @@ typedef unsigned long WordsBitmapID;
 
 /** Vector of boolean to represent whether a word has been translated or not.
  *
- * Implemented using a vector of char, which is usually the same representation
- * for the elements that a C array of bool would use.  A vector of bool, or a
- * Boost dynamic_bitset, could be much more efficient in theory.  Unfortunately
- * algorithms like std::find() are not optimized for vector<bool> on gcc or
- * clang, and dynamic_bitset lacks all the optimized search operations we want.
- * Only benchmarking will tell what works best.  Perhaps dynamic_bitset could
- * still be a dramatic improvement, if we flip the meaning of the bits around
- * so we can use its find_first() and find_next() for the most common searches.
+ * Bits are packed into 64-bit words, so that searches for gaps and
+ * coverage tests handle 64 positions at a time using count-trailing-zeros
+ * and population count. Bitmaps of up to 256 positions are stored inline;
+ * only longer inputs need a separate allocation. Bits beyond GetSize() are
+ * always zero.
  */
 class Bitmap
 {
   friend std::ostream& operator<<(std::ostream& out, const Bitmap& bitmap);
+public:
+  typedef uint64_t Word;
+  static const size_t kBitsPerWord = 64;
+  static const size_t kInlineWords = 4;
+
 private:
-  std::vector<char> m_bitmap; //! Ticks of words in sentence that have been done.
+  size_t m_size; //! number of positions
+  size_t m_numWords;
+  Word *m_bits; //! Ticks of words in sentence that have been done, points to m_inline if short enough.
+  Word m_inline[kInlineWords];
   size_t m_firstGap; //! Cached position of first gap, or NOT_FOUND.
   size_t m_numWordsCovered;
 
   Bitmap(); // not implemented
   Bitmap& operator= (const Bitmap& other);
 
+  static size_t CountTrailingZeros(Word w) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(w);
+#else
+    size_t ret = 0;
+    while (!(w & 1)) {
+      w >>= 1;
+      ++ret;
+    }
+    return ret;
+#endif
+  }
+
+  static size_t HighestBit(Word w) {
+#if defined(__GNUC__)
+    return kBitsPerWord - 1 - __builtin_clzll(w);
+#else
+    size_t ret = 0;
+    while (w >>= 1) ++ret;
+    return ret;
+#endif
+  }
+
+  static size_t PopCount(Word w) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(w);
+#else
+    size_t ret = 0;
+    for (; w; w &= w - 1) ++ret;
+    return ret;
+#endif
+  }
+
+  //! bits [from, kBitsPerWord) set
+  static Word MaskFrom(size_t from) {
+    return ~Word(0) << from;
+  }
+  //! bits [0, to] set
+  static Word MaskTo(size_t to) {
+    return ~Word(0) >> (kBitsPerWord - 1 - to);
+  }
+
+  void Allocate(size_t size);
+
+  //! valid bits of word i
+  Word ValidBits(size_t i) const {
+    return (i + 1 < m_numWords || m_size % kBitsPerWord == 0) ?
+           ~Word(0) : MaskTo(m_size % kBitsPerWord - 1);
+  }
+
+  //! first position >= pos that is (value == true) set / (value == false) not set, or NOT_FOUND
+  size_t Find(size_t pos, bool value) const {
+    if (pos >= m_size) return NOT_FOUND;
+    size_t i = pos / kBitsPerWord;
+    Word w = (value ? m_bits[i] : ~m_bits[i] & ValidBits(i)) & MaskFrom(pos % kBitsPerWord);
+    while (!w) {
+      if (++i == m_numWords) return NOT_FOUND;
+      w = value ? m_bits[i] : ~m_bits[i] & ValidBits(i);
+    }
+    return i * kBitsPerWord + CountTrailingZeros(w);
+  }
+
+  //! last position <= pos that is set / not set, or NOT_FOUND
+  size_t FindBackwards(size_t pos, bool value) const {
+    size_t i = pos / kBitsPerWord;
+    Word w = (value ? m_bits[i] : ~m_bits[i] & ValidBits(i)) & MaskTo(pos % kBitsPerWord);
+    while (!w) {
+      if (i-- == 0) return NOT_FOUND;
+      w = value ? m_bits[i] : ~m_bits[i] & ValidBits(i);
+    }
+    return i * kBitsPerWord + HighestBit(w);
+  }
+
+  //! up to kBitsPerWord bits starting at position from, as an integer
+  Word GetBits(size_t from, size_t length) const {
+    if (length == 0 || from >= m_size) return 0;
+    size_t i = from / kBitsPerWord;
+    size_t offset = from % kBitsPerWord;
+    Word ret = m_bits[i] >> offset;
+    if (offset && i + 1 < m_numWords) {
+      ret |= m_bits[i + 1] << (kBitsPerWord - offset);
+    }
+    return length < kBitsPerWord ? ret & MaskTo(length - 1) : ret;
+  }
+
+  //! set or clear all positions of the range, returns number of bits changed
+  size_t SetRange(size_t startPos, size_t endPos, bool value) {
+    size_t changed = 0;
+    for (size_t i = startPos / kBitsPerWord; i <= endPos / kBitsPerWord; ++i) {
+      Word mask = ~Word(0);
+      if (i == startPos / kBitsPerWord) mask &= MaskFrom(startPos % kBitsPerWord);
+      if (i == endPos / kBitsPerWord) mask &= MaskTo(endPos % kBitsPerWord);
+      if (value) {
+        changed += PopCount(~m_bits[i] & mask);
+        m_bits[i] |= mask;
+      } else {
+        changed += PopCount(m_bits[i] & mask);
+        m_bits[i] &= ~mask;
+      }
+    }
+    return changed;
+  }
+
   /** Update the first gap, when bits are flipped */
   void UpdateFirstGap(size_t startPos, size_t endPos, bool value) {
     if (value) {
       //may remove gap
       if (startPos <= m_firstGap && m_firstGap <= endPos) {
-        m_firstGap = NOT_FOUND;
-        for (size_t i = endPos + 1 ; i < m_bitmap.size(); ++i) {
-          if (!m_bitmap[i]) {
-            m_firstGap = i;
-            break;
-          }
-        }
+        m_firstGap = Find(endPos + 1, false);
       }
 
     } else {
@@ -86,9 +190,7 @@ private:
     size_t startPos = range.GetStartPos();
     size_t endPos = range.GetEndPos();
 
-    for(size_t pos = startPos ; pos <= endPos ; pos++) {
-      m_bitmap[pos] = true;
-    }
+    SetRange(startPos, endPos, true);
 
     m_numWordsCovered += range.GetNumWordsCovered();
     UpdateFirstGap(startPos, endPos, true);
@@ -106,6 +208,10 @@ public:
 
   explicit Bitmap(const Bitmap &copy, const Range &range);
 
+  ~Bitmap() {
+    if (m_bits != m_inline) delete [] m_bits;
+  }
+
   //! Count of words translated.
   size_t GetNumWordsCovered() const {
     return m_numWordsCovered;
@@ -119,38 +225,22 @@ public:
 
   //! position of last word not yet translated, or NOT_FOUND if everything already translated
   size_t GetLastGapPos() const {
-    for (int pos = int(m_bitmap.size()) - 1 ; pos >= 0 ; pos--) {
-      if (!m_bitmap[pos]) {
-        return pos;
-      }
-    }
-    // no starting pos
-    return NOT_FOUND;
+    return m_size ? FindBackwards(m_size - 1, false) : NOT_FOUND;
   }
 
 
   //! position of last translated word
   size_t GetLastPos() const {
-    for (int pos = int(m_bitmap.size()) - 1 ; pos >= 0 ; pos--) {
-      if (m_bitmap[pos]) {
-        return pos;
-      }
-    }
-    // no starting pos
-    return NOT_FOUND;
+    return m_size ? FindBackwards(m_size - 1, true) : NOT_FOUND;
   }
 
   //! whether a word has been translated at a particular position
   bool GetValue(size_t pos) const {
-    return bool(m_bitmap[pos]);
+    return (m_bits[pos / kBitsPerWord] >> (pos % kBitsPerWord)) & 1;
   }
   //! set value at a particular position
   void SetValue( size_t pos, bool value ) {
-    bool origValue = m_bitmap[pos];
-    if (origValue == value) {
-      // do nothing
-    } else {
-      m_bitmap[pos] = value;
+    if (SetRange(pos, pos, value)) {
       UpdateFirstGap(pos, pos, value);
       if (value) {
         ++m_numWordsCovered;
@@ -166,58 +256,60 @@ public:
   }
   //! whether the wordrange overlaps with any translated word in this bitmap
   bool Overlap(const Range &compare) const {
-    for (size_t pos = compare.GetStartPos() ; pos <= compare.GetEndPos() ; pos++) {
-      if (m_bitmap[pos])
+    size_t startPos = compare.GetStartPos();
+    size_t endPos = compare.GetEndPos();
+    for (size_t i = startPos / kBitsPerWord; i <= endPos / kBitsPerWord; ++i) {
+      Word mask = ~Word(0);
+      if (i == startPos / kBitsPerWord) mask &= MaskFrom(startPos % kBitsPerWord);
+      if (i == endPos / kBitsPerWord) mask &= MaskTo(endPos % kBitsPerWord);
+      if (m_bits[i] & mask)
         return true;
     }
     return false;
   }
   //! number of elements
   size_t GetSize() const {
-    return m_bitmap.size();
+    return m_size;
   }
 
   inline size_t GetEdgeToTheLeftOf(size_t l) const {
     if (l == 0) return l;
-    while (l && !m_bitmap[l-1]) {
-      --l;
-    }
-    return l;
+    size_t pos = FindBackwards(l - 1, true);
+    return pos == NOT_FOUND ? 0 : pos + 1;
   }
 
   inline size_t GetEdgeToTheRightOf(size_t r) const {
-    if (r+1 == m_bitmap.size()) return r;
-    return (
-             std::find(m_bitmap.begin() + r + 1, m_bitmap.end(), true) -
-             m_bitmap.begin()
-           ) - 1;
+    if (r+1 == m_size) return r;
+    size_t pos = Find(r + 1, true);
+    return (pos == NOT_FOUND ? m_size : pos) - 1;
   }
 
 
   //! converts bitmap into an integer ID: it consists of two parts: the first 16 bit are the pattern between the first gap and the last word-1, the second 16 bit are the number of filled positions. enforces a sentence length limit of 65535 and a max distortion of 16
   WordsBitmapID GetID() const {
-    assert(m_bitmap.size() < (1<<16));
+    assert(m_size < (1<<16));
 
     size_t start = GetFirstGapPos();
-    if (start == NOT_FOUND) start = m_bitmap.size(); // nothing left
+    if (start == NOT_FOUND) start = m_size; // nothing left
 
     size_t end = GetLastPos();
     if (end == NOT_FOUND) end = 0; // nothing translated yet
 
     assert(end < start || end-start <= 16);
     WordsBitmapID id = 0;
-    for(size_t pos = end; pos > start; pos--) {
-      id = id*2 + (int) GetValue(pos);
+    if (end > start) {
+      // position start+1 is the least significant bit
+      id = GetBits(start + 1, std::min(end - start, kBitsPerWord));
     }
     return id + (1<<16) * start;
   }
 
   //! converts bitmap into an integer ID, with an additional span covered
   WordsBitmapID GetIDPlus( size_t startPos, size_t endPos ) const {
-    assert(m_bitmap.size() < (1<<16));
+    assert(m_size < (1<<16));
 
     size_t start = GetFirstGapPos();
-    if (start == NOT_FOUND) start = m_bitmap.size(); // nothing left
+    if (start == NOT_FOUND) start = m_size; // nothing left
 
     size_t end = GetLastPos();
     if (end == NOT_FOUND) end = 0; // nothing translated yet
@@ -227,10 +319,15 @@ public:
 
     assert(end < start || end-start <= 16);
     WordsBitmapID id = 0;
-    for(size_t pos = end; pos > start; pos--) {
-      id = id*2;
-      if (GetValue(pos) || (startPos<=pos && pos<=endPos))
-        id++;
+    if (end > start) {
+      size_t length = std::min(end - start, kBitsPerWord);
+      id = GetBits(start + 1, length);
+      // add the span, as far as it falls into the pattern
+      size_t from = std::max(startPos, start + 1);
+      size_t to = std::min(endPos, start + length);
+      if (from <= to) {
+        id |= MaskTo(to - start - 1) & MaskFrom(from - start - 1);
+      }
     }
     return id + (1<<16) * start;
   }
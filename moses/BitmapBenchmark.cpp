@@ -0,0 +1,103 @@
+// Microbenchmark for the coverage checks done for every hypothesis in
+// SearchNormal::ProcessOneHypothesis(): first gap, distortion limit
+// (edges to the left and right of a span), overlap of the extension, and
+// the coverage id and next bitmap looked up for every extension.
+//
+// Usage: BitmapBenchmark [sentence length] [distortion limit] [iterations]
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "moses/Bitmap.h"
+#include "moses/Bitmaps.h"
+#include "moses/Range.h"
+#include "util/usage.hh"
+
+namespace Moses
+{
+namespace
+{
+
+const size_t kMaxPhraseLength = 7;
+
+// coverage vectors as a stack decoder produces them: a covered prefix,
+// then a few phrases within the distortion limit
+std::vector<const Bitmap*> MakeCoverages(Bitmaps &bitmaps, size_t length, size_t distortionLimit)
+{
+  std::vector<const Bitmap*> ret;
+  size_t state = 42;
+  for (size_t i = 0; i < 1000; ++i) {
+    const Bitmap *bm = &bitmaps.GetInitialBitmap();
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    size_t prefix = (state >> 33) % length;
+    if (prefix) bm = &bitmaps.GetBitmap(*bm, Range(0, prefix - 1));
+    for (size_t phrases = (state >> 20) % 3; phrases; --phrases) {
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+      size_t start = prefix + 1 + (state >> 33) % (distortionLimit + 1);
+      size_t end = start + (state >> 40) % 3;
+      if (end >= length || bm->Overlap(Range(start, end))) continue;
+      bm = &bitmaps.GetBitmap(*bm, Range(start, end));
+    }
+    ret.push_back(bm);
+  }
+  return ret;
+}
+
+// the checks of ProcessOneHypothesis() for one coverage vector, returns
+// the number of extensions that pass
+size_t Expand(Bitmaps &bitmaps, const Bitmap &bm, size_t distortionLimit, size_t &checksum)
+{
+  size_t expansions = 0;
+  size_t sourceSize = bm.GetSize();
+  size_t firstGap = bm.GetFirstGapPos();
+  if (firstGap == NOT_FOUND) return 0;
+
+  for (size_t startPos = firstGap; startPos < sourceSize; ++startPos) {
+    if (bm.GetValue(startPos)) continue;
+    if (startPos > firstGap + distortionLimit) break;
+
+    checksum += bm.GetEdgeToTheLeftOf(startPos);
+    for (size_t endPos = startPos; endPos < sourceSize && endPos < startPos + kMaxPhraseLength; ++endPos) {
+      Range extRange(startPos, endPos);
+      if (bm.Overlap(extRange)) break;
+      checksum += bm.GetEdgeToTheRightOf(endPos);
+      if (startPos != firstGap && endPos + 1 - firstGap > distortionLimit) continue;
+
+      checksum += bm.GetIDPlus(startPos, endPos);
+      checksum += bitmaps.GetBitmap(bm, extRange).GetNumWordsCovered();
+      ++expansions;
+    }
+  }
+  return expansions;
+}
+
+} // namespace
+} // namespace Moses
+
+int main(int argc, char *argv[])
+{
+  size_t length = argc > 1 ? std::atoi(argv[1]) : 40;
+  size_t distortionLimit = argc > 2 ? std::atoi(argv[2]) : 6;
+  size_t iterations = argc > 3 ? std::atoi(argv[3]) : 2000;
+
+  Moses::Bitmaps bitmaps(length, std::vector<bool>());
+  std::vector<const Moses::Bitmap*> coverages = Moses::MakeCoverages(bitmaps, length, distortionLimit);
+
+  size_t expansions = 0;
+  size_t checksum = 0;
+  double start = util::WallTime();
+  for (size_t i = 0; i < iterations; ++i) {
+    for (size_t c = 0; c < coverages.size(); ++c) {
+      expansions += Moses::Expand(bitmaps, *coverages[c], distortionLimit, checksum);
+    }
+  }
+  double elapsed = util::WallTime() - start;
+
+  std::cout << "length=" << length
+            << " distortion_limit=" << distortionLimit
+            << " hypotheses/sec=" << iterations * coverages.size() / elapsed
+            << " expansions/sec=" << expansions / elapsed
+            << " checksum=" << checksum << std::endl;
+  return 0;
+}
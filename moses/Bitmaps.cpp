@@ -9,13 +9,12 @@ namespace Moses
 Bitmaps::Bitmaps(size_t inputSize, const std::vector<bool> &initSourceCompleted)
 {
   m_initBitmap = new Bitmap(inputSize, initSourceCompleted);
-  m_coll[m_initBitmap];
+  m_coll.insert(m_initBitmap);
 }
 
 Bitmaps::~Bitmaps()
 {
-  BOOST_FOREACH (const Coll::value_type& myPair, m_coll) {
-    const Bitmap *bm = myPair.first;
+  BOOST_FOREACH (const Bitmap *bm, m_coll) {
     delete bm;
   }
 }
@@ -24,34 +23,31 @@ const Bitmap &Bitmaps::GetNextBitmap(const Bitmap &bm, const Range &range)
 {
   Bitmap *newBM = new Bitmap(bm, range);
 
-  Coll::const_iterator iter = m_coll.find(newBM);
-  if (iter == m_coll.end()) {
-    m_coll[newBM] = NextBitmaps();
-    return *newBM;
-  } else {
+  std::pair<Coll::const_iterator, bool> ret = m_coll.insert(newBM);
+  if (!ret.second) {
     delete newBM;
-    return *iter->first;
   }
+  return **ret.first;
 }
 
 const Bitmap &Bitmaps::GetBitmap(const Bitmap &bm, const Range &range)
 {
-  Coll::iterator iter = m_coll.find(&bm);
-  assert(iter != m_coll.end());
-
-  const Bitmap *newBM;
-  NextBitmaps &next = iter->second;
-  NextBitmaps::const_iterator iterNext = next.find(range);
-  if (iterNext == next.end()) {
-    // not seen the link yet.
-    newBM = &GetNextBitmap(bm, range);
-    next[range] = newBM;
-  } else {
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  assert(m_coll.find(&bm) != m_coll.end());
+
+  NextBitmaps::key_type key(&bm, range);
+  NextBitmaps::const_iterator iter = m_next.find(key);
+  if (iter != m_next.end()) {
     // link exist
-    //std::cerr << "link exists" << endl;
-    newBM = iterNext->second;
+    return *iter->second;
   }
-  return *newBM;
+
+  // not seen the link yet.
+  const Bitmap &newBM = GetNextBitmap(bm, range);
+  m_next[key] = &newBM;
+  return newBM;
 }
 
 }
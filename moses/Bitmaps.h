@@ -1,8 +1,13 @@
 #pragma once
 
+#include <boost/functional/hash.hpp>
 #include <boost/unordered_set.hpp>
 #include <boost/unordered_map.hpp>
 #include <set>
+#include <utility>
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
 #include "Bitmap.h"
 #include "Util.h"
 
@@ -11,11 +16,17 @@ namespace Moses
 
 class Bitmaps
 {
-  typedef boost::unordered_map<Range, const Bitmap*> NextBitmaps;
-  typedef boost::unordered_map<const Bitmap*, NextBitmaps, UnorderedComparer<Bitmap>, UnorderedComparer<Bitmap> > Coll;
+  typedef boost::unordered_set<const Bitmap*, UnorderedComparer<Bitmap>, UnorderedComparer<Bitmap> > Coll;
   //typedef std::set<const Bitmap*, OrderedComparer<Bitmap> > Coll;
+  //! (bitmap, range) -> bitmap with the range covered, in a single flat index
+  typedef boost::unordered_map<std::pair<const Bitmap*, Range>, const Bitmap*> NextBitmaps;
   Coll m_coll;
+  NextBitmaps m_next;
   const Bitmap *m_initBitmap;
+#ifdef WITH_THREADS
+  //! stacks may be expanded by several threads (threads-stack-subtasks)
+  boost::mutex m_mutex;
+#endif
 
   const Bitmap &GetNextBitmap(const Bitmap &bm, const Range &range);
 public:
@@ -159,6 +159,19 @@ void ChartCell::CleanupArcList()
   }
 }
 
+void ChartCell::AssignHypothesisIds()
+{
+  // collections in the order of their labels' ids, not of the hash map
+  ChartCellLabelSet::const_iterator iter;
+  for (iter = m_targetLabelSet.begin(); iter != m_targetLabelSet.end(); ++iter) {
+    if (*iter == NULL) continue;
+    MapType::iterator m = m_hypoColl.find((*iter)->GetLabel());
+    if (m != m_hypoColl.end()) {
+      m->second.AssignIds(m_manager);
+    }
+  }
+}
+
 //! debug info - size of each hypo collection in this cell
 void ChartCell::OutputSizes(std::ostream &out) const
 {
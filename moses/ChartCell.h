@@ -117,6 +117,10 @@ public:
 
   void CleanupArcList();
 
+  /** after the cells of one width were decoded concurrently, give their
+   *  hypotheses ids that do not depend on the order of decoding */
+  void AssignHypothesisIds();
+
   void OutputSizes(std::ostream &out) const;
   size_t GetSize() const;
 
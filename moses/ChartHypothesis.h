@@ -90,6 +90,10 @@ public:
     return m_id;
   }
 
+  void SetId(unsigned id) {
+    m_id = id;
+  }
+
   const ChartTranslationOption &GetTranslationOption() const {
     return *m_transOpt;
   }
@@ -265,6 +265,21 @@ void ChartHypothesisCollection::SortHypotheses()
   }
 }
 
+void ChartHypothesisCollection::AssignIds(ChartManager &manager)
+{
+  for (size_t i = 0; i < m_hyposOrdered.size(); ++i) {
+    // the collection owns its hypotheses, the sorted list just doesn't say so
+    ChartHypothesis *mainHypo = const_cast<ChartHypothesis*>(m_hyposOrdered[i]);
+    mainHypo->SetId(manager.GetNextHypoId());
+    const ChartArcList *arcList = mainHypo->GetArcList();
+    if (arcList) {
+      for (size_t j = 0; j < arcList->size(); ++j) {
+        (*arcList)[j]->SetId(manager.GetNextHypoId());
+      }
+    }
+  }
+}
+
 //! Call CleanupArcList() for each main hypo in collection
 void ChartHypothesisCollection::CleanupArcList()
 {
@@ -21,6 +21,7 @@
 #pragma once
 
 #include <set>
+#include <boost/unordered_set.hpp>
 #include "ChartHypothesis.h"
 #include "RuleCube.h"
 
@@ -90,6 +91,9 @@ public:
   void SortHypotheses();
   void CleanupArcList();
 
+  //! give the sorted hypotheses, and their arcs, new ids in that order
+  void AssignIds(ChartManager &manager);
+
   //! return vector of hypothesis that has been sorted by score
   const HypoList &GetSortedHypotheses() const {
     return m_hyposOrdered;
@@ -35,6 +35,9 @@
 #include "moses/ChartKBestExtractor.h"
 #include "moses/HypergraphOutput.h"
 #include "moses/TranslationTask.h"
+#include "moses/ThreadPool.h"
+
+#include <boost/bind.hpp>
 
 using namespace std;
 
@@ -80,27 +83,15 @@ void ChartManager::Decode()
 
   // MAIN LOOP
   size_t size = m_source.GetSize();
-  for (int startPos = size-1; startPos >= 0; --startPos) {
-    for (size_t width = 1; width <= size-startPos; ++width) {
-      size_t endPos = startPos + width - 1;
-      Range range(startPos, endPos);
-
-      // create trans opt
-      m_translationOptionList.Clear();
-      m_parser.Create(range, m_translationOptionList);
-      m_translationOptionList.ApplyThreshold(options()->search.trans_opt_threshold);
-
-      const InputPath &inputPath = m_parser.GetInputPath(range);
-      m_translationOptionList.EvaluateWithSourceContext(m_source, inputPath);
-
-      // decode
-      ChartCell &cell = m_hypoStackColl.Get(range);
-      cell.Decode(m_translationOptionList, m_hypoStackColl);
-
-      m_translationOptionList.Clear();
-      cell.PruneToSize();
-      cell.CleanupArcList();
-      cell.SortHypotheses();
+  size_t numSubTasks = options()->search.chart_subtasks;
+  if (numSubTasks > 1 && m_parser.SetLookupByWidth(numSubTasks)) {
+    DecodeByWidth(numSubTasks);
+  } else {
+    for (int startPos = size-1; startPos >= 0; --startPos) {
+      for (size_t width = 1; width <= size-startPos; ++width) {
+        size_t endPos = startPos + width - 1;
+        DecodeCell(Range(startPos, endPos), m_translationOptionList, 0);
+      }
     }
   }
 
@@ -125,6 +116,103 @@ void ChartManager::Decode()
   }
 }
 
+/** look up the rules of one span, with the given set of rule lookup
+ *  managers, and fill its cell */
+void ChartManager::DecodeCell(const Range &range,
+                              ChartTranslationOptionList &transOptList,
+                              size_t lookup)
+{
+  // create trans opt
+  transOptList.Clear();
+  m_parser.Create(range, transOptList, lookup);
+  transOptList.ApplyThreshold(options()->search.trans_opt_threshold);
+
+  const InputPath &inputPath = m_parser.GetInputPath(range);
+  transOptList.EvaluateWithSourceContext(m_source, inputPath);
+
+  // decode
+  ChartCell &cell = m_hypoStackColl.Get(range);
+  cell.Decode(transOptList, m_hypoStackColl);
+
+  transOptList.Clear();
+  cell.PruneToSize();
+  cell.CleanupArcList();
+  cell.SortHypotheses();
+}
+
+/** Decode the chart width by width instead of start position by start
+ *  position. The cells of one width only read from narrower cells, so they
+ *  are decoded concurrently in sub-tasks that idle threads of the pool can
+ *  take over, each with its own rule lookup and translation option list.
+ *  Sub-task i decodes the cells starting at i, i + numSubTasks, ..., so
+ *  the cells of a start position are always looked up with the same set of
+ *  rule lookup managers, which keep the partial rules found from there.
+ */
+void ChartManager::DecodeByWidth(size_t numSubTasks)
+{
+  size_t size = m_source.GetSize();
+
+  // one word spans create the unknown words, so their cells are decoded
+  // one after the other, in the order of Decode()
+  for (int startPos = size-1; startPos >= 0; --startPos) {
+    DecodeCell(Range(startPos, startPos), m_translationOptionList, startPos % numSubTasks);
+  }
+  FinishWidth(1);
+
+  std::vector<boost::shared_ptr<ChartTranslationOptionList> > transOptLists;
+  for (size_t i = 0; i < numSubTasks; ++i) {
+    transOptLists.push_back(boost::shared_ptr<ChartTranslationOptionList>(
+                              new ChartTranslationOptionList(options()->syntax.rule_limit, m_source)));
+  }
+
+  for (size_t width = 2; width <= size; ++width) {
+    size_t numCells = size - width + 1;
+    size_t step = std::min(numSubTasks, numCells);
+    std::vector<boost::shared_ptr<Task> > tasks;
+    for (size_t i = 0; i < step; ++i) {
+      tasks.push_back(boost::shared_ptr<Task>(new FunctionTask(
+          boost::bind(&ChartManager::DecodeCells, this, width, i, step,
+                      transOptLists[i].get()))));
+    }
+    RunSubTasks(tasks);
+
+    // hypotheses got their ids in the order the sub-tasks happened to
+    // create them in
+    for (size_t startPos = 0; startPos < numCells; ++startPos) {
+      m_hypoStackColl.Get(Range(startPos, startPos + width - 1)).AssignHypothesisIds();
+    }
+    FinishWidth(width);
+  }
+}
+
+//! decode the cells of the given width that start at first, first + step, ...
+void ChartManager::DecodeCells(size_t width, size_t first, size_t step,
+                               ChartTranslationOptionList *transOptList)
+{
+  size_t size = m_source.GetSize();
+  for (size_t startPos = first; startPos + width <= size; startPos += step) {
+    DecodeCell(Range(startPos, startPos + width - 1), *transOptList, first);
+  }
+}
+
+/** the best score of each label in a cell is computed (and cached) when a
+ *  rule that uses the cell is looked up. Compute it once the cells of a
+ *  width are done, so that the sub-tasks of the next widths only read it */
+void ChartManager::FinishWidth(size_t width)
+{
+  size_t size = m_source.GetSize();
+  for (size_t startPos = 0; startPos + width <= size; ++startPos) {
+    const ChartCellLabelSet &labels
+    = m_hypoStackColl.Get(Range(startPos, startPos + width - 1)).GetTargetLabelSet();
+    ChartCellLabelSet::const_iterator iter;
+    for (iter = labels.begin(); iter != labels.end(); ++iter) {
+      if (*iter && (*iter)->GetStack().cube && !(*iter)->GetStack().cube->empty()) {
+        (*iter)->GetBestScore(&m_translationOptionList);
+      }
+    }
+  }
+}
+
 /** add specific translation options and hypotheses according to the XML override translation scheme.
  *  Doesn't seem to do anything about walls and zones.
  *  @todo check walls & zones. Check that the implementation doesn't leak, xml options sometimes does if you're not careful
@@ -22,6 +22,7 @@
 #pragma once
 
 #include <vector>
+#include <boost/atomic.hpp>
 #include <boost/unordered_map.hpp>
 #include "ChartCell.h"
 #include "ChartCellCollection.h"
@@ -47,12 +48,19 @@ private:
   ChartCellCollection m_hypoStackColl;
   std::auto_ptr<SentenceStats> m_sentenceStats;
   clock_t m_start; /**< starting time, used for logging */
-  unsigned m_hypothesisId; /* For handing out hypothesis ids to ChartHypothesis */
+  boost::atomic<unsigned> m_hypothesisId; /* For handing out hypothesis ids to ChartHypothesis */
 
   ChartParser m_parser;
 
   ChartTranslationOptionList m_translationOptionList; /**< pre-computed list of translation options for the phrases in this sentence */
 
+  void DecodeCell(const Range &range, ChartTranslationOptionList &transOptList,
+                  size_t lookup);
+  void DecodeByWidth(size_t numSubTasks);
+  void DecodeCells(size_t width, size_t first, size_t step,
+                   ChartTranslationOptionList *transOptList);
+  void FinishWidth(size_t width);
+
   /* auxilliary functions for SearchGraphs */
   void FindReachableHypotheses(
     const ChartHypothesis *hypo, std::map<unsigned,bool> &reachable , size_t* winners, size_t* losers) const;
@@ -133,7 +141,7 @@ public:
 
   //! contigious hypo id for each input sentence. For debugging purposes
   unsigned GetNextHypoId() {
-    return m_hypothesisId++;
+    return m_hypothesisId.fetch_add(1, boost::memory_order_relaxed);
   }
 
   const ChartParser &GetParser() const {
@@ -0,0 +1,276 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+// Loads its own StaticData, so it is built as a test of its own
+#define BOOST_TEST_MODULE ChartManagerTest
+#include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "moses/ChartCell.h"
+#include "moses/ChartCellLabel.h"
+#include "moses/ChartHypothesis.h"
+#include "moses/ChartKBestExtractor.h"
+#include "moses/ChartManager.h"
+#include "moses/Parameter.h"
+#include "moses/Sentence.h"
+#include "moses/StaticData.h"
+#include "moses/ThreadPool.h"
+#include "moses/TranslationTask.h"
+#include "util/exception.hh"
+
+using namespace Moses;
+using namespace std;
+
+namespace
+{
+
+//! the same pseudo-random grammar on every platform
+class Generator
+{
+public:
+  explicit Generator(unsigned seed) : m_seed(seed) {}
+
+  size_t operator()(size_t n) {
+    m_seed = m_seed * 1103515245 + 12345;
+    return (m_seed >> 16) % n;
+  }
+
+  template <class T>
+  const T &Pick(const vector<T> &from) {
+    return from[(*this)(from.size())];
+  }
+
+  //! few distinct scores, so that many rules tie
+  string Scores() {
+    ostringstream out;
+    out << 0.2 * (1 + (*this)(4)) << " " << 0.2 * (1 + (*this)(4));
+    return out.str();
+  }
+
+private:
+  unsigned m_seed;
+};
+
+vector<string> Words(const char *prefix, size_t n)
+{
+  vector<string> words;
+  for (size_t i = 0; i < n; ++i) {
+    ostringstream word;
+    word << prefix << i;
+    words.push_back(word.str());
+  }
+  return words;
+}
+
+/** A hierarchical grammar with lexical rules for every source word, longer
+ *  phrases, and rules with one or two (possibly swapped) non-terminals of
+ *  several labels, plus the glue rules. */
+void WriteGrammar(const string &rulePath, const string &gluePath)
+{
+  Generator random(7);
+  vector<string> source = Words("s", 6), target = Words("t", 8);
+  vector<string> labels;
+  labels.push_back("NP");
+  labels.push_back("VP");
+  labels.push_back("PP");
+  labels.push_back("S");
+
+  ofstream rules(rulePath.c_str());
+  for (size_t i = 0; i < source.size(); ++i) {
+    for (size_t k = 0; k < 3; ++k) {
+      rules << source[i] << " [X] ||| " << random.Pick(target) << " [" << random.Pick(labels)
+            << "] ||| " << random.Scores() << " ||| " << endl;
+    }
+    rules << source[i] << " [X] ||| " << random.Pick(target) << " [S] ||| "
+          << random.Scores() << " ||| " << endl;
+  }
+  for (size_t k = 0; k < 15; ++k) {
+    rules << random.Pick(source) << " " << random.Pick(source) << " [X] ||| "
+          << random.Pick(target) << " [" << random.Pick(labels) << "] ||| "
+          << random.Scores() << " ||| " << endl;
+  }
+  for (size_t k = 0; k < 80; ++k) {
+    string first = random.Pick(labels), second = random.Pick(labels);
+    string word = random.Pick(source), targetWord = random.Pick(target);
+    switch (random(4)) {
+    case 0:
+      rules << "[X][" << first << "] " << word << " [X] ||| " << targetWord << " [X][" << first
+            << "] [" << random.Pick(labels) << "] ||| " << random.Scores() << " ||| 0-1" << endl;
+      break;
+    case 1:
+      rules << word << " [X][" << first << "] [X] ||| [X][" << first << "] " << targetWord
+            << " [" << random.Pick(labels) << "] ||| " << random.Scores() << " ||| 1-0" << endl;
+      break;
+    case 2:
+      rules << "[X][" << first << "] " << word << " [X][" << second << "] [X] ||| [X][" << first
+            << "] " << targetWord << " [X][" << second << "] [" << random.Pick(labels)
+            << "] ||| " << random.Scores() << " ||| 0-0 2-2" << endl;
+      break;
+    default:
+      rules << "[X][" << first << "] [X][" << second << "] [X] ||| [X][" << second << "] [X]["
+            << first << "] [" << random.Pick(labels) << "] ||| " << random.Scores()
+            << " ||| 0-1 1-0" << endl;
+    }
+  }
+
+  ofstream glue(gluePath.c_str());
+  for (size_t i = 0; i < labels.size(); ++i) {
+    glue << "[X][S] [X][" << labels[i] << "] [X] ||| [X][S] [X][" << labels[i]
+         << "] [S] ||| 0.5 0.5 ||| 0-0 1-1" << endl;
+    glue << "<s> [X][" << labels[i] << "] </s> [X] ||| <s> [X][" << labels[i]
+         << "] </s> [Q] ||| 1 1 ||| 1-1" << endl;
+  }
+}
+
+struct GrammarFixture {
+  GrammarFixture()
+    : dir(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()) {
+    boost::filesystem::create_directory(dir);
+    const string rules = (dir / "rules").string(), glue = (dir / "glue").string();
+    const string config = (dir / "moses.ini").string();
+    WriteGrammar(rules, glue);
+    {
+      ofstream ini(config.c_str());
+      ini << "[mapping]\n0 T 0\n1 T 1\n\n"
+          << "[search-algorithm]\n3\n\n"
+          << "[cube-pruning-pop-limit]\n20\n\n"
+          << "[rule-limit]\n4\n\n"
+          << "[max-chart-span]\n5\n1000\n\n"
+          << "[verbose]\n0\n\n"
+          // keeps the arcs of recombined hypotheses; nothing is written there
+          << "[n-best-list]\n" << (dir / "nbest").string() << "\n20\n\n"
+          << "[feature]\n"
+          << "UnknownWordPenalty\nWordPenalty\nPhrasePenalty\n"
+          << "PhraseDictionaryMemory name=TM0 num-features=2 path=" << rules
+          << " input-factor=0 output-factor=0\n"
+          << "PhraseDictionaryMemory name=Glue num-features=2 path=" << glue
+          << " input-factor=0 output-factor=0\n\n"
+          << "[weight]\n"
+          << "UnknownWordPenalty0= 1\nWordPenalty0= -0.5\nPhrasePenalty0= 0.2\n"
+          << "TM0= 0.3 0.2\nGlue= 1 0\n";
+    }
+    UTIL_THROW_IF2(!parameter.LoadParam(config), "Cannot read " << config);
+    UTIL_THROW_IF2(!StaticData::LoadDataStatic(&parameter, ""), "Cannot load " << config);
+  }
+
+  ~GrammarFixture() {
+    boost::filesystem::remove_all(dir);
+  }
+
+  boost::filesystem::path dir;
+  Parameter parameter;
+};
+
+BOOST_GLOBAL_FIXTURE(GrammarFixture);
+
+//! the rules of a derivation, top down
+void WriteDerivation(const ChartKBestExtractor::Derivation &derivation, ostream &out)
+{
+  const ChartHypothesis &hypo = derivation.edge.head->hypothesis;
+  out << "(" << hypo.GetCurrSourceRange() << " " << hypo.GetCurrTargetPhrase();
+  for (size_t i = 0; i < derivation.subderivations.size(); ++i) {
+    WriteDerivation(*derivation.subderivations[i], out);
+  }
+  out << ")";
+}
+
+/** Decode a sentence and write, cell by cell, the rules of the hypotheses
+ *  in the order that they ended up in, then the n-best list */
+void Decode(const string &text, size_t numSubTasks, string *result)
+{
+  boost::shared_ptr<AllOptions> opts(new AllOptions(*StaticData::Instance().options()));
+  opts->search.chart_subtasks = numSubTasks;
+  boost::shared_ptr<InputType> source(new Sentence(opts, 0, text));
+  ttasksptr ttask = TranslationTask::create(source);
+
+  ostringstream out;
+  {
+    ChartManager manager(ttask);
+    manager.Decode();
+
+    size_t size = source->GetSize();
+    for (size_t width = 1; width <= size; ++width) {
+      for (size_t startPos = 0; startPos + width <= size; ++startPos) {
+        Range range(startPos, startPos + width - 1);
+        const ChartCell &cell = manager.GetChartCellCollection().Get(range);
+        out << range << ":" << endl;
+        const ChartCellLabelSet &labels = cell.GetTargetLabelSet();
+        ChartCellLabelSet::const_iterator iter;
+        for (iter = labels.begin(); iter != labels.end(); ++iter) {
+          if (*iter == NULL) continue;
+          const HypoList *hypos = cell.GetSortedHypotheses((*iter)->GetLabel());
+          for (size_t i = 0; hypos && i < hypos->size(); ++i) {
+            const ChartHypothesis &hypo = *(*hypos)[i];
+            out << "  " << hypo.GetFutureScore() << " " << hypo.GetCurrTargetPhrase() << endl;
+          }
+        }
+      }
+    }
+
+    ChartKBestExtractor::KBestVec nBestList;
+    manager.CalcNBest(opts->nbest.nbest_size, nBestList);
+    for (size_t i = 0; i < nBestList.size(); ++i) {
+      const ChartKBestExtractor::Derivation &derivation = *nBestList[i];
+      out << ChartKBestExtractor::GetOutputPhrase(derivation) << " ||| "
+          << *ChartKBestExtractor::GetOutputScoreBreakdown(derivation) << " ||| "
+          << derivation.score << " ||| ";
+      WriteDerivation(derivation, out);
+      out << endl;
+    }
+  }
+  *result = out.str();
+}
+
+//! decode on a worker of a pool with idle threads, which take over sub-tasks
+void DecodeInPool(const string &text, size_t numSubTasks, string *result)
+{
+  ThreadPool pool(4);
+  pool.Submit(boost::shared_ptr<Task>(new FunctionTask(
+                                        boost::bind(&Decode, boost::cref(text), numSubTasks, result))));
+  pool.Stop(true);
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(decode_by_width_matches_sequential)
+{
+  Generator random(11);
+  vector<string> source = Words("s", 6);
+  for (size_t k = 0; k < 6; ++k) {
+    string text = random.Pick(source);
+    for (size_t length = 4 + random(9); length > 1; --length) {
+      text += " " + random.Pick(source);
+    }
+
+    string sequential;
+    Decode(text, 0, &sequential);
+    BOOST_REQUIRE(sequential.find("|||") != string::npos);
+    for (size_t numSubTasks = 2; numSubTasks <= 3; ++numSubTasks) {
+      string byWidth;
+      DecodeInPool(text, numSubTasks, &byWidth);
+      BOOST_CHECK_EQUAL(sequential, byWidth);
+    }
+  }
+}
@@ -162,28 +162,54 @@ ChartParser
   , m_unknown(ttask)
   , m_decodeGraphList(StaticData::Instance().GetDecodeGraphs())
   , m_source(*(ttask->GetSource().get()))
+  , m_cells(cells)
 {
   const StaticData &staticData = StaticData::Instance();
 
   staticData.InitializeForInput(ttask);
   CreateInputPaths(m_source);
 
+  m_ruleLookupManagers.resize(1);
+  CreateRuleLookupManagers(m_ruleLookupManagers[0]);
+}
+
+void ChartParser::CreateRuleLookupManagers(std::vector<ChartRuleLookupManager*> &managers)
+{
   const std::vector<PhraseDictionary*> &dictionaries = PhraseDictionary::GetColl();
   assert(dictionaries.size() == m_decodeGraphList.size());
-  m_ruleLookupManagers.reserve(dictionaries.size());
+  managers.reserve(dictionaries.size());
   for (std::size_t i = 0; i < dictionaries.size(); ++i) {
     const PhraseDictionary *dict = dictionaries[i];
     PhraseDictionary *nonConstDict = const_cast<PhraseDictionary*>(dict);
     std::size_t maxChartSpan = m_decodeGraphList[i]->GetMaxChartSpan();
-    ChartRuleLookupManager *lookupMgr = nonConstDict->CreateRuleLookupManager(*this, cells, maxChartSpan);
-    m_ruleLookupManagers.push_back(lookupMgr);
+    ChartRuleLookupManager *lookupMgr = nonConstDict->CreateRuleLookupManager(*this, m_cells, maxChartSpan);
+    managers.push_back(lookupMgr);
+  }
+}
+
+bool ChartParser::SetLookupByWidth(size_t numLookups)
+{
+  const std::vector<ChartRuleLookupManager*> &first = m_ruleLookupManagers[0];
+  for (size_t i = 0; i < first.size(); ++i) {
+    if (!first[i]->CanLookupByWidth()) return false;
   }
 
+  m_ruleLookupManagers.resize(std::max(numLookups, m_ruleLookupManagers.size()));
+  for (size_t lookup = 0; lookup < m_ruleLookupManagers.size(); ++lookup) {
+    std::vector<ChartRuleLookupManager*> &managers = m_ruleLookupManagers[lookup];
+    if (managers.empty()) CreateRuleLookupManagers(managers);
+    for (size_t i = 0; i < managers.size(); ++i) {
+      managers[i]->SetLookupByWidth();
+    }
+  }
+  return true;
 }
 
 ChartParser::~ChartParser()
 {
-  RemoveAllInColl(m_ruleLookupManagers);
+  for (size_t lookup = 0; lookup < m_ruleLookupManagers.size(); ++lookup) {
+    RemoveAllInColl(m_ruleLookupManagers[lookup]);
+  }
   StaticData::Instance().CleanUpAfterSentenceProcessing(m_ttask.lock());
 
   InputPathMatrix::const_iterator iterOuter;
@@ -198,12 +224,13 @@ ChartParser::~ChartParser()
   }
 }
 
-void ChartParser::Create(const Range &range, ChartParserCallback &to)
+void ChartParser::Create(const Range &range, ChartParserCallback &to, size_t lookup)
 {
-  assert(m_decodeGraphList.size() == m_ruleLookupManagers.size());
+  const std::vector<ChartRuleLookupManager*> &ruleLookupManagers = m_ruleLookupManagers[lookup];
+  assert(m_decodeGraphList.size() == ruleLookupManagers.size());
 
   std::vector <DecodeGraph*>::const_iterator iterDecodeGraph;
-  std::vector <ChartRuleLookupManager*>::const_iterator iterRuleLookupManagers = m_ruleLookupManagers.begin();
+  std::vector <ChartRuleLookupManager*>::const_iterator iterRuleLookupManagers = ruleLookupManagers.begin();
   for (iterDecodeGraph = m_decodeGraphList.begin(); iterDecodeGraph != m_decodeGraphList.end(); ++iterDecodeGraph, ++iterRuleLookupManagers) {
     const DecodeGraph &decodeGraph = **iterDecodeGraph;
     assert(decodeGraph.GetSize() == 1);
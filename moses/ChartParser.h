@@ -67,7 +67,17 @@ public:
   ChartParser(ttasksptr const& ttask, ChartCellCollectionBase &cells);
   ~ChartParser();
 
-  void Create(const Range &range, ChartParserCallback &to);
+  /** look up the rules of a span with the given set of rule lookup
+   *  managers (see SetLookupByWidth()). Spans of one word, for which
+   *  unknown words are created, must not be looked up concurrently */
+  void Create(const Range &range, ChartParserCallback &to, size_t lookup = 0);
+
+  /** prepare for looking up the rules of any span as soon as all narrower
+   *  cells are decoded, using numLookups independent sets of rule lookup
+   *  managers, one for each of the sub-tasks that decode the cells of a
+   *  width concurrently. Returns false, and changes nothing, if a rule
+   *  table only supports lookups in the order of ChartManager::Decode() */
+  bool SetLookupByWidth(size_t numLookups);
 
   //! the sentence being decoded
   //const Sentence &GetSentence() const;
@@ -84,13 +94,16 @@ public:
 private:
   ChartParserUnknown m_unknown;
   std::vector <DecodeGraph*> m_decodeGraphList;
-  std::vector<ChartRuleLookupManager*> m_ruleLookupManagers;
+  //! one set of lookup managers, with one per dictionary, for each sub-task
+  std::vector<std::vector<ChartRuleLookupManager*> > m_ruleLookupManagers;
   InputType const& m_source; /**< source sentence to be translated */
+  ChartCellCollectionBase &m_cells;
 
   typedef std::vector< std::vector<InputPath*> > InputPathMatrix;
   InputPathMatrix	m_inputPathMatrix;
 
   void CreateInputPaths(const InputType &input);
+  void CreateRuleLookupManagers(std::vector<ChartRuleLookupManager*> &managers);
   InputPath &GetInputPath(size_t startPos, size_t endPos);
 
 };
@@ -43,7 +43,8 @@ public:
   ChartRuleLookupManager(const ChartParser &parser,
                          const ChartCellCollectionBase &cellColl)
     : m_parser(parser)
-    , m_cellCollection(cellColl) {}
+    , m_cellCollection(cellColl)
+    , m_lookupByWidth(false) {}
 
   virtual ~ChartRuleLookupManager();
 
@@ -69,6 +70,23 @@ public:
     size_t lastPos,  // last position to consider if using lookahead
     ChartParserCallback &outColl) = 0;
 
+  /** whether this lookup manager can look up the rules of a span as soon
+   *  as all narrower cells are decoded, independently of the other spans.
+   *  Otherwise, spans must be looked up in the order of ChartManager::Decode()
+   */
+  virtual bool CanLookupByWidth() const {
+    return false;
+  }
+
+  //! look up spans independently of each other (see CanLookupByWidth())
+  void SetLookupByWidth() {
+    m_lookupByWidth = true;
+  }
+
+  bool IsLookupByWidth() const {
+    return m_lookupByWidth;
+  }
+
 private:
   //! Non-copyable: copy constructor and assignment operator not implemented.
   ChartRuleLookupManager(const ChartRuleLookupManager &);
@@ -77,6 +95,7 @@ private:
 
   const ChartParser &m_parser;
   const ChartCellCollectionBase &m_cellCollection;
+  bool m_lookupByWidth;
 };
 
 }  // namespace Moses
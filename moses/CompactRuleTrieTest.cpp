@@ -0,0 +1,163 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+#include "FactorCollection.h"
+#include "TargetPhrase.h"
+#include "TranslationModel/PhraseDictionaryNodeMemory.h"
+#include "TranslationModel/RuleTable/CompactRuleTrie.h"
+#include "util/string_stream.hh"
+
+using namespace Moses;
+using namespace std;
+
+namespace
+{
+
+Word MakeWord(const string &str, bool isNonTerminal = false)
+{
+  Word word(isNonTerminal);
+  word.SetFactor(0, FactorCollection::Instance().AddFactor(str, isNonTerminal));
+  return word;
+}
+
+PhraseDictionaryNodeMemory *AddNonTerminal(PhraseDictionaryNodeMemory &node, const string &label)
+{
+  Word nonTerm = MakeWord(label, true);
+#if defined(UNLABELLED_SOURCE)
+  return node.GetOrCreateNonTerminalChild(nonTerm);
+#else
+  return node.GetOrCreateChild(nonTerm, nonTerm);
+#endif
+}
+
+void AddRule(PhraseDictionaryNodeMemory &node)
+{
+  node.GetTargetPhraseCollection()->Add(new TargetPhrase());
+}
+
+// terminals t0..t99 under the root, each with a few terminal children, and
+// non-terminals under some of them
+struct Fixture {
+  Fixture() {
+    for (size_t i = 0; i < 100; ++i) {
+      util::StringStream str;
+      str << "t" << i;
+      PhraseDictionaryNodeMemory *child = root.GetOrCreateChild(MakeWord(str.str()));
+      AddRule(*child);
+      for (size_t j = 0; j < i % 7; ++j) {
+        util::StringStream str2;
+        str2 << "t" << j * 13;
+        AddRule(*child->GetOrCreateChild(MakeWord(str2.str())));
+      }
+      if (i % 10 == 0) {
+        AddRule(*AddNonTerminal(*child, "NP"));
+        AddRule(*AddNonTerminal(*child, "VP"));
+      }
+    }
+    AddRule(*AddNonTerminal(root, "S"));
+    AddRule(*AddNonTerminal(*AddNonTerminal(root, "NP"), "VP"));
+    trie.Build(root);
+  }
+
+  PhraseDictionaryNodeMemory root;
+  CompactRuleTrie trie;
+};
+
+void CheckSame(const PhraseDictionaryNodeMemory &node, const CompactRuleTrie::Node &compact)
+{
+  BOOST_CHECK(node.GetTargetPhraseCollection() == compact.GetTargetPhraseCollection());
+  BOOST_CHECK_EQUAL(node.IsLeaf(), compact.IsLeaf());
+  BOOST_REQUIRE_EQUAL(node.GetTerminalMap().size(),
+                      size_t(compact.EndTerminals() - compact.BeginTerminals()));
+  BOOST_REQUIRE_EQUAL(node.GetNonTerminalMap().size(),
+                      size_t(compact.EndNonTerminals() - compact.BeginNonTerminals()));
+
+  const PhraseDictionaryNodeMemory::TerminalMap &terminals = node.GetTerminalMap();
+  for (PhraseDictionaryNodeMemory::TerminalMap::const_iterator p = terminals.begin(); p != terminals.end(); ++p) {
+    const CompactRuleTrie::Node *child = compact.GetChild(p->first);
+    BOOST_REQUIRE(child != NULL);
+    CheckSame(p->second, *child);
+  }
+
+  // same order as the map, so that rules are found in the same order
+  const PhraseDictionaryNodeMemory::NonTerminalMap &nonTerms = node.GetNonTerminalMap();
+  const CompactRuleTrie::NonTerminalEdge *edge = compact.BeginNonTerminals();
+  for (PhraseDictionaryNodeMemory::NonTerminalMap::const_iterator p = nonTerms.begin(); p != nonTerms.end(); ++p, ++edge) {
+#if defined(UNLABELLED_SOURCE)
+    BOOST_CHECK_EQUAL(p->first[0], edge->targetNonTerm);
+#else
+    BOOST_CHECK_EQUAL(p->first.first[0], edge->sourceNonTerm);
+    BOOST_CHECK_EQUAL(p->first.second[0], edge->targetNonTerm);
+#endif
+    CheckSame(p->second, *edge->child);
+  }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(compact_rule_trie)
+
+BOOST_FIXTURE_TEST_CASE(same_as_original, Fixture)
+{
+  // root, t0..t99, their terminal children, their non-terminal children,
+  // and S, NP and NP VP under the root
+  BOOST_CHECK_EQUAL(trie.GetNumNodes(), size_t(1 + 100 + (14 * 21 + 1) + 10 * 2 + 3));
+  CheckSame(root, trie.GetRootNode());
+}
+
+BOOST_FIXTURE_TEST_CASE(unknown_words, Fixture)
+{
+  const CompactRuleTrie::Node &rootNode = trie.GetRootNode();
+  BOOST_CHECK(rootNode.GetChild(MakeWord("t100")) == NULL);
+  BOOST_CHECK(rootNode.GetChild(MakeWord("unknown")) == NULL);
+
+  const CompactRuleTrie::Node *t1 = rootNode.GetChild(MakeWord("t1"));
+  BOOST_REQUIRE(t1 != NULL);
+  BOOST_CHECK(t1->GetChild(MakeWord("t0")) != NULL);
+  BOOST_CHECK(t1->GetChild(MakeWord("t13")) == NULL);
+  BOOST_CHECK(!t1->HasNonTerminals());
+}
+
+BOOST_FIXTURE_TEST_CASE(outlives_original, Fixture)
+{
+  root = PhraseDictionaryNodeMemory();
+  const CompactRuleTrie::Node *t20 = trie.GetRootNode().GetChild(MakeWord("t20"));
+  BOOST_REQUIRE(t20 != NULL);
+  BOOST_CHECK_EQUAL(t20->GetTargetPhraseCollection()->GetSize(), size_t(1));
+  BOOST_CHECK(t20->HasNonTerminals());
+}
+
+BOOST_AUTO_TEST_CASE(empty)
+{
+  CompactRuleTrie trie;
+  BOOST_CHECK(trie.IsEmpty());
+  trie.Build(PhraseDictionaryNodeMemory());
+  BOOST_CHECK(!trie.IsEmpty());
+  BOOST_CHECK(trie.GetRootNode().IsLeaf());
+  trie.Clear();
+  BOOST_CHECK(trie.IsEmpty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,240 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#pragma once
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/unordered_map.hpp>
+#include <stdint.h>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+namespace Moses
+{
+
+/** A cache shared by all threads and kept across sentences, in about a
+ * given number of bytes.
+ *
+ * The cache is split into shards by the hash of the key, each behind its
+ * own lock, so that threads looking up different keys rarely wait for each
+ * other. Within a shard, entries are evicted in CLOCK order: a hand sweeps
+ * over the entries and evicts the first one that has not been retrieved
+ * since the hand last passed it.
+ *
+ * SizeOf()(key, value) estimates the memory behind a key and its value,
+ * on top of what the cache spends on each entry. Keys can be looked up by
+ * any type K that Hash and Equal accept and that converts to Key, to avoid
+ * building a Key for every lookup.
+ */
+template <class Key, class Value, class SizeOf,
+          class Hash = boost::hash<Key>, class Equal = std::equal_to<Key> >
+class ConcurrentClockCache
+{
+public:
+  explicit ConcurrentClockCache(size_t bytes, size_t shards = 64)
+    : m_numShards(shards ? shards : 1)
+    , m_shardBytes(bytes / m_numShards)
+    , m_shards(new Shard[m_numShards]) {
+  }
+
+  /** cache a value. Nothing changes if the key is cached already, or if the
+   *  entry would not fit into a shard. **/
+  template <class K>
+  void Insert(const K &key, const Value &value) {
+    size_t bytes = EstimateBytes(key, value);
+    if(bytes > m_shardBytes)
+      return;
+
+    Shard &shard = GetShard(key);
+    Lock lock(shard);
+    typename Index::iterator it = shard.index.find(key, Hash(), Equal());
+    if(it != shard.index.end()) {
+      shard.entries[it->second].referenced = true;
+      return;
+    }
+
+    MakeRoom(shard, bytes);
+    Entry entry;
+    entry.key = key;
+    entry.value = value;
+    entry.bytes = bytes;
+    entry.referenced = false;
+    shard.index[entry.key] = shard.entries.size();
+    shard.entries.push_back(entry);
+    shard.bytes += bytes;
+  }
+
+  //! copy the value of key to value. false if the key is not cached
+  template <class K>
+  bool Retrieve(const K &key, Value &value) {
+    Shard &shard = GetShard(key);
+    Lock lock(shard);
+    typename Index::const_iterator it = shard.index.find(key, Hash(), Equal());
+    if(it == shard.index.end()) {
+      ++shard.misses;
+      return false;
+    }
+    ++shard.hits;
+    Entry &entry = shard.entries[it->second];
+    entry.referenced = true;
+    value = entry.value;
+    return true;
+  }
+
+  /** mark a key as used, as Insert() does for a cached key, without
+   *  counting a hit or a miss. false if the key is not cached **/
+  template <class K>
+  bool Touch(const K &key) {
+    Shard &shard = GetShard(key);
+    Lock lock(shard);
+    typename Index::iterator it = shard.index.find(key, Hash(), Equal());
+    if(it == shard.index.end())
+      return false;
+    shard.entries[it->second].referenced = true;
+    return true;
+  }
+
+  uint64_t GetHits() const {
+    return Sum(&Shard::hits);
+  }
+  uint64_t GetMisses() const {
+    return Sum(&Shard::misses);
+  }
+  uint64_t GetEvictions() const {
+    return Sum(&Shard::evictions);
+  }
+  //! estimated size of the cached entries
+  size_t GetBytes() const {
+    return Sum(&Shard::bytes);
+  }
+  size_t GetSize() const {
+    size_t ret = 0;
+    for(size_t i = 0; i < m_numShards; ++i) {
+      Lock lock(m_shards[i]);
+      ret += m_shards[i].entries.size();
+    }
+    return ret;
+  }
+
+  //! estimated memory taken by an entry
+  template <class K>
+  static size_t EstimateBytes(const K &key, const Value &value) {
+    return GetEntryBytes() + SizeOf()(key, value);
+  }
+
+  //! memory taken by an entry, without what its key and value point to
+  static size_t GetEntryBytes() {
+    // entry, index node and its bucket pointers
+    return sizeof(Entry) + sizeof(typename Index::value_type) + 2 * sizeof(void*);
+  }
+
+private:
+  struct Entry {
+    Key key;
+    Value value;
+    size_t bytes;
+    bool referenced;
+  };
+
+  typedef boost::unordered_map<Key, size_t, Hash, Equal> Index;
+
+  struct Shard {
+#ifdef WITH_THREADS
+    mutable boost::mutex mutex;
+#endif
+    Index index; //! key -> position in entries
+    std::vector<Entry> entries; //! in CLOCK order
+    size_t hand;
+    size_t bytes;
+    uint64_t hits, misses, evictions;
+    char padding[64]; //! keep the locks of neighbouring shards apart
+
+    Shard() : hand(0), bytes(0), hits(0), misses(0), evictions(0) {}
+  };
+
+  class Lock
+  {
+  public:
+#ifdef WITH_THREADS
+    explicit Lock(const Shard &shard) : m_lock(shard.mutex) {}
+  private:
+    boost::mutex::scoped_lock m_lock;
+#else
+    explicit Lock(const Shard &) {}
+#endif
+  };
+
+  template <class K>
+  Shard &GetShard(const K &key) const {
+    return m_shards[Hash()(key) % m_numShards];
+  }
+
+  template <class T>
+  T Sum(T Shard::*counter) const {
+    T ret = 0;
+    for(size_t i = 0; i < m_numShards; ++i) {
+      Lock lock(m_shards[i]);
+      ret += m_shards[i].*counter;
+    }
+    return ret;
+  }
+
+  //! evict entries of a shard until bytes more fit into it
+  void MakeRoom(Shard &shard, size_t bytes) {
+    while(!shard.entries.empty() && shard.bytes + bytes > m_shardBytes) {
+      if(shard.hand >= shard.entries.size())
+        shard.hand = 0;
+      Entry &entry = shard.entries[shard.hand];
+      if(entry.referenced) {
+        // second chance
+        entry.referenced = false;
+        ++shard.hand;
+        continue;
+      }
+
+      // evict, and fill the hole with the last entry
+      shard.bytes -= entry.bytes;
+      shard.index.erase(entry.key);
+      ++shard.evictions;
+      if(shard.hand + 1 != shard.entries.size()) {
+        std::swap(entry, shard.entries.back());
+        shard.index[entry.key] = shard.hand;
+      }
+      shard.entries.pop_back();
+    }
+  }
+
+  size_t m_numShards;
+  size_t m_shardBytes;
+  boost::scoped_array<Shard> m_shards;
+
+  // no copying
+  ConcurrentClockCache(const ConcurrentClockCache &);
+  ConcurrentClockCache &operator=(const ConcurrentClockCache &);
+};
+
+}
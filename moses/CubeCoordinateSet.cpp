@@ -0,0 +1,87 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include "CubeCoordinateSet.h"
+
+#include <algorithm>
+
+#include "util/exception.hh"
+#include "util/murmur_hash.hh"
+
+namespace Moses
+{
+
+namespace
+{
+// most cubes are popped a few dozen times at most
+const std::size_t kInitialBuckets = 32;
+}
+
+CubeCoordinateSet::CubeCoordinateSet(std::size_t arity)
+  : m_arity(arity)
+  , m_buckets(kInitialBuckets, 0)
+{
+  UTIL_THROW_IF2(arity == 0, "A cube needs at least one dimension");
+  m_coordinates.reserve(kInitialBuckets / 2 * arity);
+}
+
+std::size_t CubeCoordinateSet::Hash(const int *coordinates) const
+{
+  return util::MurmurHashNative(coordinates, m_arity * sizeof(int));
+}
+
+std::pair<std::size_t, bool> CubeCoordinateSet::Insert(const int *coordinates)
+{
+  // the table is at most half full, so there is always an empty bucket
+  const std::size_t mask = m_buckets.size() - 1;
+  std::size_t bucket = Hash(coordinates) & mask;
+  while (m_buckets[bucket]) {
+    const std::size_t index = m_buckets[bucket] - 1;
+    if (std::equal(coordinates, coordinates + m_arity, Get(index))) {
+      return std::make_pair(index, false);
+    }
+    bucket = (bucket + 1) & mask;
+  }
+
+  const std::size_t index = GetSize();
+  m_coordinates.insert(m_coordinates.end(), coordinates, coordinates + m_arity);
+  m_buckets[bucket] = index + 1;
+  if (2 * (index + 1) > m_buckets.size()) {
+    Grow();
+  }
+  return std::make_pair(index, true);
+}
+
+void CubeCoordinateSet::Grow()
+{
+  std::vector<uint32_t> buckets(m_buckets.size() * 2, 0);
+  const std::size_t mask = buckets.size() - 1;
+  const std::size_t size = GetSize();
+  for (std::size_t index = 0; index < size; ++index) {
+    std::size_t bucket = Hash(Get(index)) & mask;
+    while (buckets[bucket]) {
+      bucket = (bucket + 1) & mask;
+    }
+    buckets[bucket] = index + 1;
+  }
+  m_buckets.swap(buckets);
+}
+
+}
@@ -0,0 +1,75 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <stdint.h>
+
+namespace Moses
+{
+
+/** The cells of a cube (in the cube pruning sense) that were visited, for
+ *  cubes with a fixed number of dimensions. The coordinates of all cells are
+ *  packed into one array, arity ints per cell, in the order they were
+ *  inserted, and are found by an open addressing hash table of indices into
+ *  that array. Inserting a cell allocates nothing but the occasional growth
+ *  of the two arrays.
+ *
+ *  Used by RuleCube (chart decoding) and Syntax::Cube.
+ */
+class CubeCoordinateSet
+{
+public:
+  explicit CubeCoordinateSet(std::size_t arity);
+
+  std::size_t GetArity() const {
+    return m_arity;
+  }
+
+  //! number of cells in the set
+  std::size_t GetSize() const {
+    return m_coordinates.size() / m_arity;
+  }
+
+  /** Adds a cell unless it is in the set already. Returns the index of the
+   *  cell and whether it was added. The coordinates must not point into the
+   *  set. */
+  std::pair<std::size_t, bool> Insert(const int *coordinates);
+
+  //! coordinates of a cell, valid until the next Insert()
+  const int *Get(std::size_t index) const {
+    return &m_coordinates[index * m_arity];
+  }
+
+private:
+  std::size_t Hash(const int *coordinates) const;
+  void Grow();
+
+  std::size_t m_arity;
+  std::vector<int> m_coordinates;
+  //! index + 1 of the cell in each bucket, 0 if the bucket is empty
+  std::vector<uint32_t> m_buckets;
+};
+
+}
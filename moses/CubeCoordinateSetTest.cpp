@@ -0,0 +1,74 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <boost/test/unit_test.hpp>
+
+#include <set>
+#include <vector>
+
+#include "CubeCoordinateSet.h"
+#include "util/random.hh"
+
+using namespace Moses;
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(cube_coordinate_set)
+
+BOOST_AUTO_TEST_CASE(insert_and_get)
+{
+  CubeCoordinateSet cells(3);
+  BOOST_CHECK_EQUAL(3, cells.GetArity());
+  BOOST_CHECK_EQUAL(0, cells.GetSize());
+
+  int a[] = { 0, 0, 0 };
+  int b[] = { 0, 1, 0 };
+  BOOST_CHECK(cells.Insert(a) == make_pair(size_t(0), true));
+  BOOST_CHECK(cells.Insert(b) == make_pair(size_t(1), true));
+  BOOST_CHECK(cells.Insert(a) == make_pair(size_t(0), false));
+  BOOST_CHECK_EQUAL(2, cells.GetSize());
+  BOOST_CHECK_EQUAL(1, cells.Get(1)[1]);
+}
+
+// many more cells than the initial table holds, against a std::set
+BOOST_AUTO_TEST_CASE(random_cells)
+{
+  util::rand_init(42);
+  CubeCoordinateSet cells(2);
+  set<vector<int> > expected;
+  vector<vector<int> > order;
+  for (size_t i = 0; i < 20000; ++i) {
+    vector<int> cell(2);
+    cell[0] = util::rand_excl(200);
+    cell[1] = util::rand_excl(200);
+    pair<size_t, bool> p = cells.Insert(&cell[0]);
+    BOOST_CHECK_EQUAL(expected.insert(cell).second, p.second);
+    if (p.second) {
+      BOOST_CHECK_EQUAL(order.size(), p.first);
+      order.push_back(cell);
+    } else {
+      BOOST_CHECK(vector<int>(cells.Get(p.first), cells.Get(p.first) + 2) == cell);
+    }
+  }
+  BOOST_CHECK_EQUAL(order.size(), cells.GetSize());
+  for (size_t i = 0; i < order.size(); ++i) {
+    BOOST_CHECK(vector<int>(cells.Get(i), cells.Get(i) + 2) == order[i]);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,263 @@
+// Microbenchmark for the bookkeeping of cube pruning in RuleCube and
+// Syntax::Cube: the priority queue of cube items and the set of visited
+// coordinates, with the coordinates packed into a CubeCoordinateSet as the
+// decoders do now, and with a hash set of coordinate vectors as they did
+// before. Scoring is reduced to adding up the scores along the dimensions,
+// so what is measured is the cost of a pop apart from feature functions.
+//
+// The cubes are grouped into cells as the chart and syntax decoders see
+// them: each cell has a few dozen rules with up to two non-terminals, each
+// rule a cube of its translations times the stacks of its non-terminals,
+// and the cubes of a cell are popped from a common queue (RuleCubeQueue)
+// until the pop limit is reached.
+//
+// Usage: CubePruningBenchmark [pop limit] [stack size] [cells]
+// Both implementations must pop the same items in the same order.
+
+#include <cstdlib>
+#include <iostream>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include <boost/unordered_set.hpp>
+
+#include "moses/CubeCoordinateSet.h"
+#include "util/random.hh"
+#include "util/usage.hh"
+
+namespace Moses
+{
+namespace
+{
+
+const size_t kMaxTranslations = 20;
+const size_t kMaxRulesPerCell = 60;
+
+//! scores along each dimension of a cube, best first; the last dimension
+//! is the translations
+typedef std::vector<std::vector<float> > CubeShape;
+
+std::vector<float> SortedScores(size_t size)
+{
+  std::vector<float> scores;
+  float score = 0;
+  for (size_t i = 0; i < size; ++i) {
+    score -= util::rand_excl(1000) / 100.0f;
+    scores.push_back(score);
+  }
+  return scores;
+}
+
+std::vector<std::vector<CubeShape> > MakeCells(size_t cells, size_t stackSize)
+{
+  util::rand_init(42);
+  std::vector<std::vector<CubeShape> > ret(cells);
+  for (size_t c = 0; c < cells; ++c) {
+    size_t rules = 1 + util::rand_excl(kMaxRulesPerCell);
+    for (size_t r = 0; r < rules; ++r) {
+      CubeShape shape(util::rand_excl(3));
+      for (size_t i = 0; i < shape.size(); ++i) {
+        shape[i] = SortedScores(1 + util::rand_excl(stackSize));
+      }
+      shape.push_back(SortedScores(1 + util::rand_excl(kMaxTranslations)));
+      ret[c].push_back(shape);
+    }
+  }
+  return ret;
+}
+
+float Score(const CubeShape &shape, const int *coordinates)
+{
+  float score = 0;
+  for (size_t i = 0; i < shape.size(); ++i) {
+    score += shape[i][coordinates[i]];
+  }
+  return score;
+}
+
+void AddToChecksum(size_t &checksum, const int *coordinates, size_t arity)
+{
+  for (size_t i = 0; i < arity; ++i) {
+    checksum = checksum * 31 + coordinates[i];
+  }
+}
+
+template <class Item>
+struct ItemOrderer {
+  bool operator()(const Item &p, const Item &q) const {
+    return p.first < q.first;
+  }
+};
+
+//! the visited set of Syntax::Cube before CubeCoordinateSet
+class HashSetCube
+{
+public:
+  explicit HashSetCube(const CubeShape &shape) : m_shape(shape) {
+    Push(std::vector<int>(shape.size(), 0));
+  }
+
+  bool IsEmpty() const {
+    return m_queue.empty();
+  }
+
+  float GetTopScore() const {
+    return m_queue.top().first;
+  }
+
+  void Pop(size_t &checksum) {
+    const std::vector<int> &coordinates = *m_queue.top().second;
+    m_queue.pop();
+    AddToChecksum(checksum, &coordinates[0], coordinates.size());
+    std::vector<int> neighbour(coordinates);
+    for (size_t i = 0; i < neighbour.size(); ++i) {
+      if (m_shape[i].size() > size_t(neighbour[i] + 1)) {
+        ++neighbour[i];
+        Push(neighbour);
+        --neighbour[i];
+      }
+    }
+  }
+
+private:
+  typedef std::pair<float, const std::vector<int> *> Item;
+
+  void Push(const std::vector<int> &coordinates) {
+    std::pair<boost::unordered_set<std::vector<int> >::iterator, bool> p =
+      m_visited.insert(coordinates);
+    if (p.second) {
+      m_queue.push(Item(Score(m_shape, &coordinates[0]), &*p.first));
+    }
+  }
+
+  const CubeShape &m_shape;
+  boost::unordered_set<std::vector<int> > m_visited;
+  std::priority_queue<Item, std::vector<Item>, ItemOrderer<Item> > m_queue;
+};
+
+//! the visited set of RuleCube and Syntax::Cube
+class PackedCube
+{
+public:
+  explicit PackedCube(const CubeShape &shape)
+    : m_shape(shape)
+    , m_visited(shape.size())
+    , m_neighbour(shape.size(), 0) {
+    Push();
+  }
+
+  bool IsEmpty() const {
+    return m_queue.empty();
+  }
+
+  float GetTopScore() const {
+    return m_queue.top().first;
+  }
+
+  void Pop(size_t &checksum) {
+    const int *coordinates = m_visited.Get(m_queue.top().second);
+    m_queue.pop();
+    AddToChecksum(checksum, coordinates, m_neighbour.size());
+    std::copy(coordinates, coordinates + m_neighbour.size(), m_neighbour.begin());
+    for (size_t i = 0; i < m_neighbour.size(); ++i) {
+      if (m_shape[i].size() > size_t(m_neighbour[i] + 1)) {
+        ++m_neighbour[i];
+        Push();
+        --m_neighbour[i];
+      }
+    }
+  }
+
+private:
+  typedef std::pair<float, size_t> Item;
+
+  void Push() {
+    std::pair<size_t, bool> p = m_visited.Insert(&m_neighbour[0]);
+    if (p.second) {
+      m_queue.push(Item(Score(m_shape, &m_neighbour[0]), p.first));
+    }
+  }
+
+  const CubeShape &m_shape;
+  CubeCoordinateSet m_visited;
+  std::vector<int> m_neighbour;
+  std::priority_queue<Item, std::vector<Item>, ItemOrderer<Item> > m_queue;
+};
+
+template <class Cube>
+struct CubeOrderer {
+  bool operator()(const Cube *p, const Cube *q) const {
+    return p->GetTopScore() < q->GetTopScore();
+  }
+};
+
+//! pops the cubes of a cell like RuleCubeQueue, returns the number of pops
+template <class Cube>
+size_t DecodeCell(const std::vector<CubeShape> &cell, size_t popLimit, size_t &checksum)
+{
+  std::vector<Cube*> cubes;
+  std::priority_queue<Cube*, std::vector<Cube*>, CubeOrderer<Cube> > queue;
+  for (size_t i = 0; i < cell.size(); ++i) {
+    cubes.push_back(new Cube(cell[i]));
+    queue.push(cubes.back());
+  }
+  size_t pops = 0;
+  while (pops < popLimit && !queue.empty()) {
+    Cube *cube = queue.top();
+    queue.pop();
+    cube->Pop(checksum);
+    ++pops;
+    if (!cube->IsEmpty()) {
+      queue.push(cube);
+    }
+  }
+  for (size_t i = 0; i < cubes.size(); ++i) {
+    delete cubes[i];
+  }
+  return pops;
+}
+
+template <class Cube>
+double Run(const std::vector<std::vector<CubeShape> > &cells, size_t popLimit,
+           size_t &pops, size_t &checksum)
+{
+  pops = checksum = 0;
+  double start = util::WallTime();
+  for (size_t c = 0; c < cells.size(); ++c) {
+    pops += DecodeCell<Cube>(cells[c], popLimit, checksum);
+  }
+  return util::WallTime() - start;
+}
+
+} // namespace
+} // namespace Moses
+
+int main(int argc, char *argv[])
+{
+  using namespace Moses;
+
+  size_t popLimit = argc > 1 ? std::atoi(argv[1]) : 1000;
+  size_t stackSize = argc > 2 ? std::atoi(argv[2]) : 100;
+  size_t numCells = argc > 3 ? std::atoi(argv[3]) : 2000;
+
+  std::vector<std::vector<CubeShape> > cells = MakeCells(numCells, stackSize);
+
+  size_t hashPops, hashChecksum, packedPops, packedChecksum;
+  double hashTime = Run<HashSetCube>(cells, popLimit, hashPops, hashChecksum);
+  double packedTime = Run<PackedCube>(cells, popLimit, packedPops, packedChecksum);
+
+  if (hashPops != packedPops || hashChecksum != packedChecksum) {
+    std::cerr << "The implementations popped different items" << std::endl;
+    return 1;
+  }
+
+  std::cout << "pop_limit=" << popLimit
+            << " stack_size=" << stackSize
+            << " cells=" << numCells
+            << " pops=" << packedPops
+            << " hash_set pops/sec=" << hashPops / hashTime
+            << " packed pops/sec=" << packedPops / packedTime
+            << " speedup=" << hashTime / packedTime << std::endl;
+  return 0;
+}
@@ -196,6 +196,7 @@ batch_run()
 
 #ifdef WITH_THREADS
   ThreadPool pool(staticData.ThreadCount());
+  pool.SetLongestFirst(staticData.ThreadsLongestFirst());
 #endif
 
   // using context for adaptation:
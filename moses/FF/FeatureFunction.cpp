@@ -83,6 +83,7 @@ FeatureFunction::~FeatureFunction() {}
 
 void FeatureFunction::ParseLine(const std::string &line)
 {
+  m_argLine = line;
   vector<string> toks = Tokenize(line);
   UTIL_THROW_IF2(toks.empty(), "Empty line");
 
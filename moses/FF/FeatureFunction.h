@@ -29,6 +29,8 @@ class InputPath;
 class StackVec;
 class DistortionScoreProducer;
 class TranslationTask;
+class SnapshotReader;
+class SnapshotWriter;
 
 /** base class for all feature functions.
  */
@@ -75,6 +77,16 @@ public:
     m_options = opts;
   }
 
+  //! override to save what Load() loaded in a snapshot (see Snapshot.h). false if nothing was saved
+  virtual bool WriteSnapshot(SnapshotWriter &/*snapshot*/) const {
+    return false;
+  }
+
+  //! override to restore from a snapshot instead of calling Load(). false if the snapshot is out of date
+  virtual bool ReadSnapshot(AllOptions::ptr const& /*opts*/, SnapshotReader &/*snapshot*/) {
+    return false;
+  }
+
   AllOptions::ptr const&
   options() const {
     return m_options;
@@ -121,6 +133,12 @@ public:
     return m_requireSortingAfterSourceContext;
   }
 
+  //! false if InitializeForInput() keeps per-sentence state in thread-local
+  //! storage, which the sub-tasks that idle threads take over don't see
+  virtual bool IsUsableInSubTasks() const {
+    return true;
+  }
+
   virtual std::vector<float> DefaultWeights() const;
 
   size_t GetIndex() const;
@@ -70,6 +70,11 @@ public:
 
   void InitializeForInput(ttasksptr const& ttask);
 
+  // the sentence is kept in m_local
+  bool IsUsableInSubTasks() const {
+    return false;
+  }
+
   bool IsUseable(const FactorMask &mask) const;
 
   void EvaluateInIsolation(const Phrase &source
@@ -74,6 +74,11 @@ public:
 
   void InitializeForInput(ttasksptr const& ttask);
 
+  // the sentence is kept in m_local
+  bool IsUsableInSubTasks() const {
+    return false;
+  }
+
   //TODO: This implements the old interface, but cannot be updated because
   //it appears to be stateful
   void EvaluateWhenApplied(const Hypothesis& cur_hypo,
@@ -0,0 +1,103 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+#pragma once
+
+#include <utility>
+
+#include <boost/functional/hash.hpp>
+
+#include "moses/ConcurrentClockCache.h"
+#include "moses/Phrase.h"
+#include "moses/TypeDef.h"
+
+namespace Moses
+{
+
+namespace LexicalReorderingCache
+{
+
+typedef std::pair<Phrase, Phrase> Key;
+
+// looks up a pair without copying the phrases into a Key
+struct KeyRef {
+  KeyRef(const Phrase &f, const Phrase &e) : f(f), e(e) {}
+  operator Key() const {
+    return Key(f, e);
+  }
+  const Phrase &f;
+  const Phrase &e;
+};
+
+inline size_t Hash(const Phrase &f, const Phrase &e)
+{
+  size_t seed = hash_value(f);
+  boost::hash_combine(seed, e);
+  return seed;
+}
+
+struct KeyHasher {
+  size_t operator()(const Key &key) const {
+    return Hash(key.first, key.second);
+  }
+  size_t operator()(const KeyRef &key) const {
+    return Hash(key.f, key.e);
+  }
+};
+
+struct KeyEqual {
+  bool operator()(const Key &a, const Key &b) const {
+    return a == b;
+  }
+  bool operator()(const KeyRef &a, const Key &b) const {
+    return a.f == b.first && a.e == b.second;
+  }
+  bool operator()(const Key &a, const KeyRef &b) const {
+    return b.f == a.first && b.e == a.second;
+  }
+};
+
+//! memory behind the phrases of a pair and its scores
+struct Bytes {
+  size_t operator()(const KeyRef &key, const Scores &scores) const {
+    return 2 * (key.f.GetSize() + key.e.GetSize()) * sizeof(Word)
+           + scores.size() * sizeof(float);
+  }
+};
+
+}
+
+/** Lexical reordering scores of (source phrase, target phrase) pairs,
+ * shared by all threads and kept across sentences, in about a given number
+ * of bytes. See ConcurrentClockCache. Pairs without scores in the table are
+ * cached as well, with empty scores.
+ */
+class ConcurrentLexicalReorderingCache
+  : public ConcurrentClockCache<LexicalReorderingCache::Key, Scores,
+    LexicalReorderingCache::Bytes, LexicalReorderingCache::KeyHasher,
+    LexicalReorderingCache::KeyEqual>
+{
+  typedef ConcurrentClockCache<LexicalReorderingCache::Key, Scores,
+          LexicalReorderingCache::Bytes, LexicalReorderingCache::KeyHasher,
+          LexicalReorderingCache::KeyEqual> Base;
+
+public:
+  explicit ConcurrentLexicalReorderingCache(size_t bytes, size_t shards = 64)
+    : Base(bytes, shards) {
+  }
+
+  //! nothing changes if the pair is cached already
+  void Cache(const Phrase &f, const Phrase &e, const Scores &scores) {
+    Insert(LexicalReorderingCache::KeyRef(f, e), scores);
+  }
+
+  //! false if the pair is not cached
+  bool Retrieve(const Phrase &f, const Phrase &e, Scores &scores) {
+    return Base::Retrieve(LexicalReorderingCache::KeyRef(f, e), scores);
+  }
+
+  //! estimated memory taken by an entry
+  static size_t EstimateBytes(const Phrase &f, const Phrase &e, const Scores &scores) {
+    return Base::EstimateBytes(LexicalReorderingCache::KeyRef(f, e), scores);
+  }
+};
+
+}
@@ -23,6 +23,7 @@ LexicalReordering(const std::string &line)
 
   map<string,string> sparseArgs;
   m_haveDefaultScores = false;
+  m_cacheBytes = 0;
   for (size_t i = 0; i < m_args.size(); ++i) {
     const vector<string> &args = m_args[i];
 
@@ -43,7 +44,9 @@ LexicalReordering(const std::string &line)
       for(size_t i=0; i<tokens.size(); i++)
         m_defaultScores.push_back( TransformScore( Scan<float>(tokens[i])));
       m_haveDefaultScores = true;
-    } else UTIL_THROW2("Unknown argument " + args[0]);
+    } else if (args[0] == "cache-mb")
+      m_cacheBytes = Scan<size_t>(args[1]) << 20;
+    else UTIL_THROW2("Unknown argument " + args[0]);
   }
 
   switch(m_configuration->GetCondition()) {
@@ -91,6 +94,8 @@ Load(AllOptions::ptr const& opts)
   if (m_filePath.size())
     m_table.reset(LRTable::LoadAvailable(m_filePath, m_factorsF,
                                          m_factorsE, std::vector<FactorType>()));
+  if (m_cacheBytes)
+    m_cache.reset(new ConcurrentLexicalReorderingCache(m_cacheBytes));
 }
 
 Scores
@@ -161,8 +166,53 @@ void
 LexicalReordering::
 SetCache(TranslationOptionList& tol) const
 {
-  BOOST_FOREACH(TranslationOption* to, tol)
-  this->SetCache(*to);
+  std::vector<TranslationOption*> tos(tol.begin(), tol.end());
+  this->SetCache(tos);
+}
+
+void
+LexicalReordering::
+SetCache(const std::vector<TranslationOption*>& tos) const
+{
+  if (!m_table) return; // e.g. OOV with Mmsapt, see above
+
+  typedef LexicalReorderingTable::PhrasePair PhrasePair;
+  std::vector<TranslationOption*> todo;
+  std::vector<PhrasePair> pairs;
+  Scores scores;
+  BOOST_FOREACH(TranslationOption* to, tos) {
+    if (to->GetLexReorderingScores(this)) continue;
+    Phrase const& sphrase = to->GetInputPath().GetPhrase();
+    Phrase const& tphrase = to->GetTargetPhrase();
+    if (m_cache && m_cache->Retrieve(sphrase, tphrase, scores)) {
+      to->CacheLexReorderingScores(*this, scores);
+      continue;
+    }
+    todo.push_back(to);
+    pairs.push_back(PhrasePair(&sphrase, &tphrase));
+  }
+  if (todo.empty()) return;
+
+  std::vector<Scores> found;
+  m_table->GetScoreBatch(pairs, found);
+  for (size_t i = 0; i < todo.size(); ++i) {
+    if (m_cache) m_cache->Cache(*pairs[i].first, *pairs[i].second, found[i]);
+    todo[i]->CacheLexReorderingScores(*this, found[i]);
+  }
+}
+
+void
+LexicalReordering::
+CleanUpAfterSentenceProcessing(const InputType& source)
+{
+  if (!m_cache) return;
+  uint64_t hits = m_cache->GetHits();
+  uint64_t lookups = hits + m_cache->GetMisses();
+  VERBOSE(1, "Line " << source.GetTranslationId() << ": " << GetScoreProducerDescription()
+          << " cache: " << hits << " of " << lookups << " lookups hit ("
+          << (lookups ? 100.0 * hits / lookups : 0.0) << "%) since start, "
+          << m_cache->GetSize() << " entries in " << (m_cache->GetBytes() >> 20) << " MB, "
+          << m_cache->GetEvictions() << " evicted" << endl);
 }
 
 
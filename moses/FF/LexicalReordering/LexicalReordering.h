@@ -14,6 +14,7 @@
 #include "moses/FF/StatefulFeatureFunction.h"
 #include "util/exception.hh"
 
+#include "ConcurrentLexicalReorderingCache.h"
 #include "LRState.h"
 #include "LexicalReorderingTable.h"
 #include "SparseReordering.h"
@@ -48,6 +49,11 @@ public:
     if (m_table) m_table->InitializeForInput(ttask);
   }
 
+  bool
+  IsUsableInSubTasks() const {
+    return !m_table || m_table->IsUsableInSubTasks();
+  }
+
   Scores
   GetProb(const Phrase& f, const Phrase& e) const;
 
@@ -82,6 +88,18 @@ public:
   void
   SetCache(TranslationOptionList& tol) const;
 
+  /** Cache the scores of many translation options at once, e.g. of all
+   *  options of a sentence, with one batch lookup in the table. Options of
+   *  the same source span should come one after the other. */
+  virtual
+  void
+  SetCache(const std::vector<TranslationOption*>& tos) const;
+
+protected:
+  //! reports the use of the cache
+  void
+  CleanUpAfterSentenceProcessing(const InputType& source);
+
 private:
   bool DecodeCondition(std::string s);
   bool DecodeDirection(std::string s);
@@ -96,6 +114,8 @@ private:
   std::string m_filePath;
   bool m_haveDefaultScores;
   Scores m_defaultScores;
+  size_t m_cacheBytes;
+  boost::scoped_ptr<ConcurrentLexicalReorderingCache> m_cache;
 public:
   LRModel const& GetModel() const;
 };
@@ -69,6 +69,17 @@ LoadAvailable(const std::string& filePath,
   return ret;
 }
 
+void
+LexicalReorderingTable::
+GetScoreBatch(const std::vector<PhrasePair>& pairs,
+              std::vector<Scores>& scores)
+{
+  const Phrase context(ARRAY_SIZE_INCR);
+  scores.resize(pairs.size());
+  for(size_t i = 0; i < pairs.size(); ++i)
+    scores[i] = GetScore(*pairs[i].first, *pairs[i].second, context);
+}
+
 LexicalReorderingTableMemory::
 LexicalReorderingTableMemory(const std::string& filePath,
                              const std::vector<FactorType>& f_factors,
@@ -111,6 +122,26 @@ LexicalReorderingTableMemory::GetScore(const Phrase& f,
   return Scores();
 }
 
+void
+LexicalReorderingTableMemory::
+GetScoreBatch(const std::vector<PhrasePair>& pairs,
+              std::vector<Scores>& scores)
+{
+  // the key of a source phrase is only made once for all its pairs
+  const Phrase* lastF = NULL;
+  std::string f;
+  scores.resize(pairs.size());
+  for(size_t i = 0; i < pairs.size(); ++i) {
+    if(pairs[i].first != lastF) {
+      lastF = pairs[i].first;
+      f = auxClearString(lastF->GetStringRep(m_FactorsF));
+    }
+    TableType::const_iterator r
+    = m_Table.find(MakeKey(f, auxClearString(pairs[i].second->GetStringRep(m_FactorsE)), ""));
+    scores[i] = (r != m_Table.end()) ? r->second : Scores();
+  }
+}
+
 void
 LexicalReorderingTableMemory::
 DbgDump(std::ostream* out) const
@@ -262,6 +293,67 @@ GetScore(const Phrase& f, const Phrase& e, const Phrase& c)
   } else return auxFindScoreForContext(cands, c);
 };
 
+void
+LexicalReorderingTableTree::
+GetScoreBatch(const std::vector<PhrasePair>& pairs,
+              std::vector<Scores>& scores)
+{
+  if(m_UseCache || !m_Cache.empty()) {
+    LexicalReorderingTable::GetScoreBatch(pairs, scores);
+    return;
+  }
+
+  // an empty key has no candidates
+  std::vector<IPhrase> keys(pairs.size());
+  const Phrase* lastF = NULL;
+  IPhrase f;
+  for(size_t i = 0; i < pairs.size(); ++i) {
+    const Phrase& e = *pairs[i].second;
+    if((!m_FactorsF.empty() && 0 == pairs[i].first->GetSize())
+        || (!m_FactorsE.empty() && 0 == e.GetSize()))
+      continue; // not a proper key, see GetScore()
+    if(pairs[i].first != lastF) {
+      lastF = pairs[i].first;
+      f = MakeSourceTableKey(*lastF);
+    }
+    keys[i] = f;
+    AppendTargetTableKey(keys[i], e);
+  }
+
+  // find each distinct key once, in the order of the prefix tree
+  std::vector<size_t> order = SortedOrder(keys);
+  std::vector<OFF_T> offsets(pairs.size(), InvalidOffT);
+  for(size_t i = 0; i < order.size(); ++i) {
+    if(i && keys[order[i]] == keys[order[i-1]])
+      offsets[order[i]] = offsets[order[i-1]];
+    else
+      offsets[order[i]] = m_Table->FindCandidates(keys[order[i]]);
+  }
+
+  // then read their candidates forward through the file
+  order = SortedOrder(offsets);
+  scores.assign(pairs.size(), Scores());
+  Candidates cands;
+  Scores found;
+  for(size_t i = 0; i < order.size(); ++i) {
+    OFF_T offset = offsets[order[i]];
+    if(offset == InvalidOffT) continue;
+    if(i == 0 || offset != offsets[order[i-1]]) {
+      cands.clear();
+      m_Table->GetCandidates(offset, &cands);
+      if(cands.empty()) {
+        found.clear();
+      } else if(m_FactorsC.empty()) {
+        UTIL_THROW_IF2(1 != cands.size(), "Error");
+        found = cands[0].GetScore(0);
+      } else {
+        found = auxFindScoreForContext(cands, Phrase(ARRAY_SIZE_INCR));
+      }
+    }
+    scores[order[i]] = found;
+  }
+}
+
 Scores
 LexicalReorderingTableTree::
 auxFindScoreForContext(const Candidates& cands, const Phrase& context)
@@ -494,23 +586,38 @@ MakeCacheKey(const Phrase& f, const Phrase& e) const
 IPhrase
 LexicalReorderingTableTree::
 MakeTableKey(const Phrase& f, const Phrase& e) const
+{
+  IPhrase key = MakeSourceTableKey(f);
+  AppendTargetTableKey(key, e);
+  return key;
+};
+
+IPhrase
+LexicalReorderingTableTree::
+MakeSourceTableKey(const Phrase& f) const
 {
   IPhrase key;
-  std::vector<std::string> keyPart;
   if(!m_FactorsF.empty()) {
+    std::vector<std::string> keyPart;
     for(size_t i = 0; i < f.GetSize(); ++i)
       keyPart.push_back(f.GetWord(i).GetString(m_FactorsF, false));
     auxAppend(key, m_Table->ConvertPhrase(keyPart, SourceVocId));
-    keyPart.clear();
   }
+  return key;
+}
+
+void
+LexicalReorderingTableTree::
+AppendTargetTableKey(IPhrase& key, const Phrase& e) const
+{
   if(!m_FactorsE.empty()) {
     if(!key.empty()) key.push_back(PrefixTreeMap::MagicWord);
+    std::vector<std::string> keyPart;
     for(size_t i = 0; i < e.GetSize(); ++i)
       keyPart.push_back(e.GetWord(i).GetString(m_FactorsE, false));
     auxAppend(key, m_Table->ConvertPhrase(keyPart,TargetVocId));
   }
-  return key;
-};
+}
 
 
 struct State {
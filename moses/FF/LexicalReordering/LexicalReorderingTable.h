@@ -2,8 +2,10 @@
 
 #pragma once
 
+#include <algorithm>
 #include <vector>
 #include <map>
+#include <utility>
 #include <memory>
 #include <string>
 #include <iostream>
@@ -52,12 +54,34 @@ public:
   Scores
   GetScore(const Phrase& f, const Phrase& e, const Phrase& c) = 0;
 
+  //! a source and a target phrase, e.g. of a translation option
+  typedef std::pair<const Phrase*, const Phrase*> PhrasePair;
+
+  /** Scores of many phrase pairs without context, e.g. of all translation
+   *  options of a sentence: scores[i] is GetScore() of pairs[i] with an
+   *  empty context.  The default looks up one pair after the other; tables
+   *  override it to make the key of a source phrase once for all its pairs
+   *  (which should come one after the other), and where it pays off, to
+   *  look up each distinct key once, in the order of the table.
+   */
+  virtual
+  void
+  GetScoreBatch(const std::vector<PhrasePair>& pairs,
+                std::vector<Scores>& scores);
+
   virtual
   void
   InitializeForInput(ttasksptr const& ttask) {
     /* override for on-demand loading */
   };
 
+  //! false if InitializeForInput() sets up the table for its thread only
+  virtual
+  bool
+  IsUsableInSubTasks() const {
+    return true;
+  }
+
   virtual
   void
   InitializeForInputPhrase(const Phrase&) { }
@@ -84,6 +108,27 @@ protected:
   FactorList m_FactorsF;
   FactorList m_FactorsE;
   FactorList m_FactorsC;
+
+  //! positions of keys, in the order of the keys they are of
+  template <class Key>
+  static
+  std::vector<size_t>
+  SortedOrder(const std::vector<Key>& keys) {
+    std::vector<size_t> order(keys.size());
+    for(size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), KeyLess<Key>(keys));
+    return order;
+  }
+
+private:
+  template <class Key>
+  struct KeyLess {
+    explicit KeyLess(const std::vector<Key>& keys) : keys(keys) { }
+    bool operator()(size_t a, size_t b) const {
+      return keys[a] < keys[b];
+    }
+    const std::vector<Key>& keys;
+  };
 };
 
 //! @todo what is this?
@@ -109,6 +154,11 @@ public:
   std::vector<float>
   GetScore(const Phrase& f, const Phrase& e, const Phrase& c);
 
+  virtual
+  void
+  GetScoreBatch(const std::vector<PhrasePair>& pairs,
+                std::vector<Scores>& scores);
+
   void
   DbgDump(std::ostream* out) const;
 
@@ -175,10 +225,22 @@ public:
   std::vector<float>
   GetScore(const Phrase& f, const Phrase& e, const Phrase& c);
 
+  virtual
+  void
+  GetScoreBatch(const std::vector<PhrasePair>& pairs,
+                std::vector<Scores>& scores);
+
   virtual
   void
   InitializeForInput(ttasksptr const& ttask);
 
+  // each thread loads its own prefix tree in InitializeForInput()
+  virtual
+  bool
+  IsUsableInSubTasks() const {
+    return false;
+  }
+
   virtual
   void
   InitializeForInputPhrase(const Phrase& f) {
@@ -194,6 +256,12 @@ private:
   IPhrase
   MakeTableKey(const Phrase& f, const Phrase& e) const;
 
+  IPhrase
+  MakeSourceTableKey(const Phrase& f) const;
+
+  void
+  AppendTargetTableKey(IPhrase& key, const Phrase& e) const;
+
   void
   Cache(const ConfusionNet& input);
 
@@ -0,0 +1,246 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "moses/FF/LexicalReordering/ConcurrentLexicalReorderingCache.h"
+#include "moses/FF/LexicalReordering/LexicalReorderingTable.h"
+#ifdef HAVE_CMPH
+#include "moses/TranslationModel/CompactPT/LexicalReorderingTableCompact.h"
+#include "moses/TranslationModel/CompactPT/LexicalReorderingTableCreator.h"
+#endif
+#include "util/string_stream.hh"
+
+using namespace Moses;
+using namespace std;
+
+namespace
+{
+
+Phrase MakePhrase(FactorDirection direction, const string &str)
+{
+  Phrase phrase;
+  phrase.CreateFromString(direction, vector<FactorType>(1, 0), str, NULL);
+  return phrase;
+}
+
+Phrase MakePhrase(size_t id)
+{
+  util::StringStream str;
+  str << "w" << id << " x" << id;
+  return MakePhrase(Input, str.str());
+}
+
+Scores MakeScores(size_t id)
+{
+  return Scores(6, -float(id));
+}
+
+struct TableFixture {
+  TableFixture()
+    : path((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string()) {
+    ofstream table(path.c_str());
+    table << "das ||| the ||| 0.1 0.2 0.3 0.4 0.5 0.6" << endl;
+    table << "das ||| that ||| 0.6 0.5 0.4 0.3 0.2 0.1" << endl;
+    table << "das haus ||| the house ||| 0.2 0.2 0.2 0.2 0.2 0.2" << endl;
+    table << "haus ||| house ||| 0.3 0.3 0.3 0.3 0.3 0.3" << endl;
+  }
+  ~TableFixture() {
+    boost::filesystem::remove(path);
+  }
+  string path;
+};
+
+#ifdef WITH_THREADS
+void CacheAndRetrieve(ConcurrentLexicalReorderingCache *cache, size_t offset, size_t *wrong)
+{
+  for (size_t i = 0; i < 2000; ++i) {
+    size_t id = (offset + i) % 500;
+    Phrase f = MakePhrase(id), e = MakePhrase(id + 1);
+    Scores scores;
+    if (cache->Retrieve(f, e, scores)) {
+      if (scores != MakeScores(id)) ++*wrong;
+    } else {
+      cache->Cache(f, e, MakeScores(id));
+    }
+  }
+}
+#endif
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(lexical_reordering)
+
+BOOST_FIXTURE_TEST_CASE(batch_matches_single_lookups, TableFixture)
+{
+  LexicalReorderingTableMemory table(path, vector<FactorType>(1, 0),
+                                     vector<FactorType>(1, 0), vector<FactorType>());
+  Phrase das = MakePhrase(Input, "das"), dasHaus = MakePhrase(Input, "das haus");
+  Phrase the = MakePhrase(Output, "the"), that = MakePhrase(Output, "that");
+  Phrase theHouse = MakePhrase(Output, "the house"), house = MakePhrase(Output, "house");
+
+  typedef LexicalReorderingTable::PhrasePair PhrasePair;
+  vector<PhrasePair> pairs;
+  pairs.push_back(PhrasePair(&das, &the));
+  pairs.push_back(PhrasePair(&das, &that));
+  pairs.push_back(PhrasePair(&das, &house));
+  pairs.push_back(PhrasePair(&dasHaus, &theHouse));
+  pairs.push_back(PhrasePair(&das, &the));
+
+  vector<Scores> scores;
+  table.GetScoreBatch(pairs, scores);
+  BOOST_REQUIRE_EQUAL(pairs.size(), scores.size());
+  for (size_t i = 0; i < pairs.size(); ++i) {
+    BOOST_CHECK(scores[i] == table.GetScore(*pairs[i].first, *pairs[i].second, Phrase(ARRAY_SIZE_INCR)));
+  }
+  BOOST_CHECK_EQUAL(6, scores[0].size());
+  BOOST_CHECK(scores[2].empty());
+  BOOST_CHECK(scores[0] != scores[1]);
+  BOOST_CHECK(scores[0] == scores[4]);
+}
+
+#ifdef HAVE_CMPH
+BOOST_AUTO_TEST_CASE(compact_batch_matches_single_lookups)
+{
+  // the compact table needs its input sorted with LC_ALL=C
+  const boost::filesystem::path dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  boost::filesystem::create_directory(dir);
+  const string text = (dir / "reordering").string();
+  const string compact = (dir / "reordering.minlexr").string();
+  {
+    ofstream table(text.c_str());
+    table << "das haus ||| the house ||| 0.2 0.2 0.2 0.2 0.2 0.2" << endl;
+    table << "das ||| that ||| 0.6 0.5 0.4 0.3 0.2 0.1" << endl;
+    table << "das ||| the ||| 0.1 0.2 0.3 0.4 0.5 0.6" << endl;
+    table << "haus ||| house ||| 0.3 0.3 0.3 0.3 0.3 0.3" << endl;
+    table << "klein ||| small ||| 0.4 0.4 0.4 0.1 0.1 0.1" << endl;
+  }
+  LexicalReorderingTableCreator(text, compact, dir.string());
+
+  {
+    LexicalReorderingTableCompact table(compact, vector<FactorType>(1, 0),
+                                        vector<FactorType>(1, 0), vector<FactorType>());
+    Phrase das = MakePhrase(Input, "das"), dasHaus = MakePhrase(Input, "das haus");
+    Phrase haus = MakePhrase(Input, "haus"), klein = MakePhrase(Input, "klein");
+    Phrase the = MakePhrase(Output, "the"), that = MakePhrase(Output, "that");
+    Phrase theHouse = MakePhrase(Output, "the house"), house = MakePhrase(Output, "house");
+    Phrase small = MakePhrase(Output, "small");
+
+    // in the order of the translation options, not of the table
+    typedef LexicalReorderingTable::PhrasePair PhrasePair;
+    vector<PhrasePair> pairs;
+    pairs.push_back(PhrasePair(&klein, &small));
+    pairs.push_back(PhrasePair(&das, &the));
+    pairs.push_back(PhrasePair(&das, &that));
+    pairs.push_back(PhrasePair(&das, &house));
+    pairs.push_back(PhrasePair(&dasHaus, &theHouse));
+    pairs.push_back(PhrasePair(&haus, &house));
+    pairs.push_back(PhrasePair(&klein, &house));
+    pairs.push_back(PhrasePair(&das, &the));
+
+    vector<Scores> scores;
+    table.GetScoreBatch(pairs, scores);
+    BOOST_REQUIRE_EQUAL(pairs.size(), scores.size());
+    for (size_t i = 0; i < pairs.size(); ++i) {
+      BOOST_CHECK(scores[i] == table.GetScore(*pairs[i].first, *pairs[i].second, Phrase(ARRAY_SIZE_INCR)));
+    }
+    BOOST_CHECK_EQUAL(6, scores[0].size());
+    BOOST_CHECK(scores[3].empty());
+    BOOST_CHECK(scores[6].empty());
+    BOOST_CHECK(scores[1] != scores[2]);
+    BOOST_CHECK(scores[1] == scores[7]);
+  }
+  boost::filesystem::remove_all(dir);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(cache_and_retrieve)
+{
+  ConcurrentLexicalReorderingCache cache(1 << 20, 4);
+  Scores scores;
+  BOOST_CHECK(!cache.Retrieve(MakePhrase(1), MakePhrase(2), scores));
+
+  cache.Cache(MakePhrase(1), MakePhrase(2), MakeScores(1));
+  BOOST_CHECK(cache.Retrieve(MakePhrase(1), MakePhrase(2), scores));
+  BOOST_CHECK(scores == MakeScores(1));
+  // the pair is ordered
+  BOOST_CHECK(!cache.Retrieve(MakePhrase(2), MakePhrase(1), scores));
+
+  // caching again leaves the first entry
+  cache.Cache(MakePhrase(1), MakePhrase(2), MakeScores(3));
+  BOOST_CHECK(cache.Retrieve(MakePhrase(1), MakePhrase(2), scores));
+  BOOST_CHECK(scores == MakeScores(1));
+
+  // pairs that are not in the table are cached as well
+  cache.Cache(MakePhrase(3), MakePhrase(4), Scores());
+  scores = MakeScores(3);
+  BOOST_CHECK(cache.Retrieve(MakePhrase(3), MakePhrase(4), scores));
+  BOOST_CHECK(scores.empty());
+
+  BOOST_CHECK_EQUAL(3, cache.GetHits());
+  BOOST_CHECK_EQUAL(2, cache.GetMisses());
+  BOOST_CHECK_EQUAL(2, cache.GetSize());
+}
+
+BOOST_AUTO_TEST_CASE(eviction)
+{
+  size_t bytes = ConcurrentLexicalReorderingCache::EstimateBytes(MakePhrase(0), MakePhrase(1), MakeScores(0));
+  ConcurrentLexicalReorderingCache cache(10 * bytes, 1);
+  for (size_t i = 0; i < 100; ++i) {
+    cache.Cache(MakePhrase(i), MakePhrase(i + 1), MakeScores(i));
+    BOOST_CHECK(cache.GetBytes() <= 10 * bytes);
+  }
+  BOOST_CHECK_EQUAL(10, cache.GetSize());
+  BOOST_CHECK_EQUAL(90, cache.GetEvictions());
+
+  // the last one is in, and has the right scores
+  Scores scores;
+  BOOST_CHECK(cache.Retrieve(MakePhrase(99), MakePhrase(100), scores));
+  BOOST_CHECK(scores == MakeScores(99));
+}
+
+#ifdef WITH_THREADS
+BOOST_AUTO_TEST_CASE(concurrent)
+{
+  ConcurrentLexicalReorderingCache cache(1 << 16, 8);
+  const size_t numThreads = 8;
+  size_t wrong[numThreads] = {0};
+  boost::thread_group threads;
+  for (size_t t = 0; t < numThreads; ++t) {
+    threads.create_thread(boost::bind(&CacheAndRetrieve, &cache, t * 37, &wrong[t]));
+  }
+  threads.join_all();
+  for (size_t t = 0; t < numThreads; ++t) {
+    BOOST_CHECK_EQUAL(0, wrong[t]);
+  }
+  BOOST_CHECK_EQUAL(numThreads * 2000, cache.GetHits() + cache.GetMisses());
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -19,5 +19,17 @@ StatefulFeatureFunction
   m_statefulFFs.push_back(this);
 }
 
+void
+StatefulFeatureFunction
+::EvaluateBatchWhenApplied(const std::vector<const Hypothesis*>& hypos,
+                           const std::vector<const FFState*>& prev_states,
+                           const std::vector<ScoreComponentCollection*>& accumulators,
+                           std::vector<const FFState*>& states) const
+{
+  for (size_t i = 0; i < hypos.size(); ++i) {
+    states[i] = EvaluateWhenApplied(*hypos[i], prev_states[i], accumulators[i]);
+  }
+}
+
 }
 
@@ -42,6 +42,20 @@ public:
     const FFState* prev_state,
     ScoreComponentCollection* accumulator) const = 0;
 
+  /**
+   * \brief Evaluate a batch of hypotheses, e.g. new extensions of a stack.
+   * The result must be the same as calling EvaluateWhenApplied() for each
+   * one: prev_states[i] is the previous state of hypos[i], its scores are
+   * added to *accumulators[i] and its new state returned in states[i].
+   * The default does exactly that; feature functions that look up large
+   * tables can override it to overlap the lookups of several hypotheses.
+   */
+  virtual void EvaluateBatchWhenApplied(
+    const std::vector<const Hypothesis*>& hypos,
+    const std::vector<const FFState*>& prev_states,
+    const std::vector<ScoreComponentCollection*>& accumulators,
+    std::vector<const FFState*>& states) const;
+
   // virtual FFState* EvaluateWhenAppliedWithContext(
   //   ttasksptr const& ttasks,
   //   const Hypothesis& cur_hypo,
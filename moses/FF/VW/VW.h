@@ -306,6 +306,11 @@ public:
     }
   }
 
+  // in training, the target sentence is stored per thread
+  virtual bool IsUsableInSubTasks() const {
+    return !m_train;
+  }
+
   virtual void InitializeForInput(ttasksptr const& ttask) {
     InputType const& source = *(ttask->GetSource().get());
     // tabbed sentence is assumed only in training
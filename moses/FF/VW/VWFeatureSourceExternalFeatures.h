@@ -39,6 +39,11 @@ public:
       VWFeatureSource::SetParameter(key, value);
   }
 
+  // the features of the sentence are stored per thread
+  virtual bool IsUsableInSubTasks() const {
+    return false;
+  }
+
   virtual void InitializeForInput(ttasksptr const& ttask) {
     InputType const& source = *(ttask->GetSource().get());
     UTIL_THROW_IF2(source.GetType() != TabbedSentenceInput,
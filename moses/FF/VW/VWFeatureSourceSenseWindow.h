@@ -32,6 +32,11 @@ public:
     VWFeatureBase::UpdateRegister();
   }
 
+  // the feature strings of the sentence are stored per thread
+  virtual bool IsUsableInSubTasks() const {
+    return false;
+  }
+
   // precompute feature strings for each input sentence
   virtual void InitializeForInput(ttasksptr const& ttask) {
     InputType const& input = *(ttask->GetSource().get());
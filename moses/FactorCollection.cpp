@@ -23,83 +23,187 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifdef WITH_THREADS
 #include <boost/thread/locks.hpp>
 #endif
+#include <algorithm>
+#include <cstring>
+#include <new>
 #include <ostream>
 #include <string>
 #include "FactorCollection.h"
 #include "Util.h"
+#include "util/exception.hh"
+#include "util/murmur_hash.hh"
 #include "util/pool.hh"
 
 using namespace std;
 
 namespace Moses
 {
+namespace
+{
+const size_t kInitialTableSize = 1024;
+
+// util::Pool doesn't align, so keep every allocation a multiple of this
+size_t AlignedSize(size_t size)
+{
+  const size_t align = sizeof(void*) > sizeof(size_t) ? sizeof(void*) : sizeof(size_t);
+  return (size + align - 1) & ~(align - 1);
+}
+}
+
 FactorCollection FactorCollection::s_instance;
 
-const Factor *FactorCollection::AddFactor(const StringPiece &factorString, bool isNonTerminal)
+FactorCollection::Table::Table(size_t size)
+  : mask(size - 1)
+  , used(0)
+  , slots(new boost::atomic<const Entry*>[size])
+{
+  for (size_t i = 0; i < size; ++i) slots[i].store(NULL, boost::memory_order_relaxed);
+}
+
+FactorCollection::Table::~Table()
+{
+  delete [] slots;
+}
+
+FactorCollection::FactorCollection()
+  : m_factorIdNonTerminal(0)
+  , m_factorId(moses_MaxNumNonterminals)
+{
+  m_tables[0].store(new Table(kInitialTableSize));
+  m_tables[1].store(new Table(kInitialTableSize));
+}
+
+const FactorCollection::Entry *FactorCollection::Find(const Table &table, const StringPiece &factorString, size_t hash)
+{
+  // tables are never more than half full, so this ends at an empty slot
+  for (size_t i = hash & table.mask; ; i = (i + 1) & table.mask) {
+    const Entry *entry = table.slots[i].load(boost::memory_order_acquire);
+    if (entry == NULL) return NULL;
+    if (entry->hash == hash && entry->factor.in.m_string == factorString) return entry;
+  }
+}
+
+const FactorCollection::Entry *FactorCollection::Insert(const StringPiece &factorString, size_t hash, bool isNonTerminal)
 {
-  FactorFriend to_ins;
-  to_ins.in.m_string = factorString;
-  to_ins.in.m_id = (isNonTerminal) ? m_factorIdNonTerminal : m_factorId;
-  Set & set = (isNonTerminal) ? m_set : m_setNonTerminal;
-  // If we're threaded, hope a read-only lock is sufficient.
 #ifdef WITH_THREADS
-  {
-    // read=lock scope
-    boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
-    Set::const_iterator i = set.find(to_ins);
-    if (i != set.end()) return &i->in;
+  boost::mutex::scoped_lock lock(m_insertLock);
+#endif
+  // another thread may have inserted it since we looked
+  Table *table = m_tables[isNonTerminal].load(boost::memory_order_relaxed);
+  if (const Entry *found = Find(*table, factorString, hash)) return found;
+
+  if (isNonTerminal) {
+    UTIL_THROW_IF2(m_factorIdNonTerminal + 1 >= moses_MaxNumNonterminals, "Number of non-terminals exceeds maximum size reserved. Adjust parameter moses_MaxNumNonterminals, then recompile");
   }
-  boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
-#endif // WITH_THREADS
-  std::pair<Set::iterator, bool> ret(set.insert(to_ins));
-  if (ret.second) {
-    ret.first->in.m_string.set(
-      memcpy(m_string_backing.Allocate(factorString.size()), factorString.data(), factorString.size()),
-      factorString.size());
-    if (isNonTerminal) {
-      m_factorIdNonTerminal++;
-      UTIL_THROW_IF2(m_factorIdNonTerminal >= moses_MaxNumNonterminals, "Number of non-terminals exceeds maximum size reserved. Adjust parameter moses_MaxNumNonterminals, then recompile");
-    } else {
-      m_factorId++;
+
+  // the string lives right behind its entry
+  char *memory = static_cast<char*>(m_entry_backing.Allocate(AlignedSize(sizeof(Entry) + factorString.size())));
+  Entry *entry = new (memory) Entry();
+  char *string = memory + sizeof(Entry);
+  memcpy(string, factorString.data(), factorString.size());
+  entry->factor.in.m_string.set(string, factorString.size());
+  entry->factor.in.m_id = isNonTerminal ? m_factorIdNonTerminal++ : m_factorId++;
+  entry->hash = hash;
+
+  if (2 * (table->used + 1) > table->mask + 1) {
+    // readers may still be probing the old table, keep it around
+    Table *bigger = new Table(2 * (table->mask + 1));
+    for (size_t i = 0; i <= table->mask; ++i) {
+      const Entry *old = table->slots[i].load(boost::memory_order_relaxed);
+      if (old == NULL) continue;
+      size_t j = old->hash & bigger->mask;
+      while (bigger->slots[j].load(boost::memory_order_relaxed) != NULL) j = (j + 1) & bigger->mask;
+      bigger->slots[j].store(old, boost::memory_order_relaxed);
     }
+    bigger->used = table->used;
+    m_retired.push_back(table);
+    table = bigger;
+    // publishes the copied slots along with the table
+    m_tables[isNonTerminal].store(table, boost::memory_order_release);
   }
-  return &ret.first->in;
+
+  size_t i = hash & table->mask;
+  while (table->slots[i].load(boost::memory_order_relaxed) != NULL) i = (i + 1) & table->mask;
+  table->slots[i].store(entry, boost::memory_order_release);
+  ++table->used;
+  return entry;
 }
 
-const Factor *FactorCollection::GetFactor(const StringPiece &factorString, bool isNonTerminal)
+const Factor *FactorCollection::AddFactor(const StringPiece &factorString, bool isNonTerminal)
 {
-  FactorFriend to_find;
-  to_find.in.m_string = factorString;
-  to_find.in.m_id = (isNonTerminal) ? m_factorIdNonTerminal : m_factorId;
-  Set & set = (isNonTerminal) ? m_set : m_setNonTerminal;
-  {
-    // read=lock scope
+  size_t hash = util::MurmurHashNative(factorString.data(), factorString.size());
 #ifdef WITH_THREADS
-    boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
-#endif // WITH_THREADS
-    Set::const_iterator i = set.find(to_find);
-    if (i != set.end()) return &i->in;
+  Lookaside *lookaside = m_lookaside.get();
+  if (lookaside == NULL) {
+    lookaside = new Lookaside();
+    m_lookaside.reset(lookaside);
+  }
+  const Entry *&cached = lookaside->entries[isNonTerminal][hash & (Lookaside::kSize - 1)];
+  if (cached != NULL && cached->hash == hash && cached->factor.in.m_string == factorString) {
+    return &cached->factor.in;
   }
-  return NULL;
+#endif
+  const Entry *entry = Find(*m_tables[isNonTerminal].load(boost::memory_order_acquire), factorString, hash);
+  if (entry == NULL) entry = Insert(factorString, hash, isNonTerminal);
+#ifdef WITH_THREADS
+  cached = entry;
+#endif
+  return &entry->factor.in;
 }
 
+const Factor *FactorCollection::GetFactor(const StringPiece &factorString, bool isNonTerminal)
+{
+  size_t hash = util::MurmurHashNative(factorString.data(), factorString.size());
+  const Entry *entry = Find(*m_tables[isNonTerminal].load(boost::memory_order_acquire), factorString, hash);
+  return entry ? &entry->factor.in : NULL;
+}
 
-FactorCollection::~FactorCollection() {}
+FactorCollection::~FactorCollection()
+{
+  delete m_tables[0].load();
+  delete m_tables[1].load();
+  for (size_t i = 0; i < m_retired.size(); ++i) delete m_retired[i];
+}
 
 TO_STRING_BODY(FactorCollection);
 
 // friend
+namespace
+{
+bool IdOrder(const Factor *a, const Factor *b)
+{
+  return a->GetId() < b->GetId();
+}
+}
+
+void FactorCollection::GetFactors(std::vector<const Factor*> &factors) const
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_insertLock);
+#endif
+  factors.clear();
+  for (size_t isNonTerminal = 0; isNonTerminal < 2; ++isNonTerminal) {
+    const Table &table = *m_tables[isNonTerminal].load();
+    for (size_t i = 0; i <= table.mask; ++i) {
+      const Entry *entry = table.slots[i].load(boost::memory_order_relaxed);
+      if (entry != NULL) factors.push_back(&entry->factor.in);
+    }
+  }
+  // non-terminal ids are below moses_MaxNumNonterminals, terminal ids above
+  std::sort(factors.begin(), factors.end(), IdOrder);
+}
+
 ostream& operator<<(ostream& out, const FactorCollection& factorCollection)
 {
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> lock(factorCollection.m_accessLock);
+  boost::mutex::scoped_lock lock(factorCollection.m_insertLock);
 #endif
-  for (FactorCollection::Set::const_iterator i = factorCollection.m_set.begin(); i != factorCollection.m_set.end(); ++i) {
-    out << i->in;
+  const FactorCollection::Table &table = *factorCollection.m_tables[0].load();
+  for (size_t i = 0; i <= table.mask; ++i) {
+    const FactorCollection::Entry *entry = table.slots[i].load(boost::memory_order_relaxed);
+    if (entry != NULL) out << entry->factor.in;
   }
   return out;
 }
 
 }
-
-
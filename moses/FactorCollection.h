@@ -28,14 +28,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #endif
 
 #ifdef WITH_THREADS
-#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
 #endif
 
-#include "util/murmur_hash.hh"
-#include <boost/unordered_set.hpp>
+#include <boost/atomic.hpp>
 
-#include <functional>
 #include <string>
+#include <vector>
 
 #include "util/string_piece.hh"
 #include "util/pool.hh"
@@ -67,36 +67,51 @@ class FactorCollection
 {
   friend std::ostream& operator<<(std::ostream&, const FactorCollection&);
 
-  struct HashFactor : public std::unary_function<const FactorFriend &, std::size_t> {
-    std::size_t operator()(const FactorFriend &factor) const {
-      return util::MurmurHashNative(factor.in.m_string.data(), factor.in.m_string.size());
-    }
+  //! a factor and the hash of its string, allocated once and never moved
+  struct Entry {
+    FactorFriend factor;
+    std::size_t hash;
   };
-  struct EqualsFactor : public std::binary_function<const FactorFriend &, const FactorFriend &, bool> {
-    bool operator()(const FactorFriend &left, const FactorFriend &right) const {
-      return left.in.GetString() == right.in.GetString();
-    }
+
+  /** Open addressing hash table of entries.  Slots are only ever filled
+   * (under m_insertLock) and a table that gets too full is replaced by a
+   * bigger copy, so readers can probe whichever table they loaded without
+   * taking a lock.  Replaced tables stay alive until the collection dies.
+   */
+  struct Table {
+    explicit Table(std::size_t size);
+    ~Table();
+    std::size_t mask;
+    std::size_t used;
+    boost::atomic<const Entry*> *slots;
+  };
+
+  //! per thread direct-mapped cache of recently interned strings
+  struct Lookaside {
+    static const std::size_t kSize = 1024;
+    const Entry *entries[2][kSize];
   };
-  typedef boost::unordered_set<FactorFriend, HashFactor, EqualsFactor> Set;
-  Set m_set;
-  Set m_setNonTerminal;
 
-  util::Pool m_string_backing;
+  boost::atomic<Table*> m_tables[2]; /**< indexed by isNonTerminal */
+  std::vector<Table*> m_retired;
+
+  util::Pool m_entry_backing;
 
   static FactorCollection s_instance;
 #ifdef WITH_THREADS
-  //reader-writer lock
-  mutable boost::shared_mutex m_accessLock;
+  //! serializes insertions, lookups don't lock
+  mutable boost::mutex m_insertLock;
+  boost::thread_specific_ptr<Lookaside> m_lookaside;
 #endif
 
   size_t m_factorIdNonTerminal; /**< unique, contiguous ids, starting from 0, for each non-terminal factor */
   size_t m_factorId; /**< unique, contiguous ids, starting from moses_MaxNumNonterminals, for each terminal factor */
 
   //! constructor. only the 1 static variable can be created
-  FactorCollection()
-    : m_factorIdNonTerminal(0)
-    , m_factorId(moses_MaxNumNonterminals) {
-  }
+  FactorCollection();
+
+  static const Entry *Find(const Table &table, const StringPiece &factorString, std::size_t hash);
+  const Entry *Insert(const StringPiece &factorString, std::size_t hash, bool isNonTerminal);
 
 public:
   static FactorCollection& Instance() {
@@ -116,6 +131,9 @@ public:
 
   const Factor *GetFactor(const StringPiece &factorString, bool isNonTerminal = false);
 
+  //! every factor, non-terminals first, each kind in the order it was added
+  void GetFactors(std::vector<const Factor*> &factors) const;
+
   // TODO: remove calls to this function, replacing them with the simpler AddFactor(factorString)
   const Factor *AddFactor(FactorDirection /*direction*/, FactorType /*factorType*/, const StringPiece &factorString, bool isNonTerminal = false) {
     return AddFactor(factorString, isNonTerminal);
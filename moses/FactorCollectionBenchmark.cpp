@@ -0,0 +1,174 @@
+// Stress benchmark for interning strings in FactorCollection from many
+// threads, as input parsing and phrase table decoding do. Each thread
+// interns a Zipf-like stream of words from a shared vocabulary that starts
+// out empty, so the collection grows while it is being read. Compares
+// FactorCollection with the reader-writer locked hash set it used before,
+// reimplemented below, and checks that all threads got the same Factor for
+// the same string.
+//
+// Usage: FactorCollectionBenchmark [threads] [vocabulary] [lookups per thread]
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/unordered_set.hpp>
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+
+#include "moses/FactorCollection.h"
+#include "util/murmur_hash.hh"
+#include "util/string_stream.hh"
+#include "util/usage.hh"
+
+namespace Moses
+{
+namespace
+{
+
+// strings in a hash set behind a shared_mutex, as FactorCollection kept them
+class LockedCollection
+{
+public:
+  const std::string *AddFactor(const std::string &str) {
+#ifdef WITH_THREADS
+    {
+      boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
+      Set::const_iterator i = m_set.find(str);
+      if (i != m_set.end()) return &*i;
+    }
+    boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
+#endif
+    return &*m_set.insert(str).first;
+  }
+
+private:
+  struct Hash {
+    std::size_t operator()(const std::string &str) const {
+      return util::MurmurHashNative(str.data(), str.size());
+    }
+  };
+  typedef boost::unordered_set<std::string, Hash> Set;
+  Set m_set;
+#ifdef WITH_THREADS
+  boost::shared_mutex m_accessLock;
+#endif
+};
+
+struct Setup {
+  std::vector<std::string> words;
+  size_t lookups;
+};
+
+// word ranks skewed towards the frequent end of the vocabulary
+size_t NextRank(size_t &state, size_t vocabulary)
+{
+  state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+  double u = static_cast<double>(state >> 11) / static_cast<double>(1ULL << 53);
+  return static_cast<size_t>(u * u * u * vocabulary);
+}
+
+void InternFactors(const Setup &setup, size_t seed, std::vector<const Factor*> &seen)
+{
+  FactorCollection &collection = FactorCollection::Instance();
+  size_t state = seed;
+  for (size_t i = 0; i < setup.lookups; ++i) {
+    size_t rank = NextRank(state, setup.words.size());
+    const Factor *factor = collection.AddFactor(setup.words[rank]);
+    if (seen[rank] == NULL) seen[rank] = factor;
+    else if (seen[rank] != factor) std::abort();
+  }
+}
+
+void InternLocked(const Setup &setup, size_t seed, LockedCollection &collection)
+{
+  size_t state = seed;
+  for (size_t i = 0; i < setup.lookups; ++i) {
+    collection.AddFactor(setup.words[NextRank(state, setup.words.size())]);
+  }
+}
+
+template <class Function>
+double RunThreads(size_t threads, Function function)
+{
+  double start = util::WallTime();
+#ifdef WITH_THREADS
+  boost::thread_group group;
+  for (size_t t = 0; t < threads; ++t) {
+    group.create_thread(boost::bind(function, t));
+  }
+  group.join_all();
+#else
+  function(0);
+#endif
+  return util::WallTime() - start;
+}
+
+struct InternFactorsThread {
+  typedef void result_type;
+  const Setup &setup;
+  std::vector<std::vector<const Factor*> > &seen;
+  void operator()(size_t t) const {
+    InternFactors(setup, t + 1, seen[t]);
+  }
+};
+
+struct InternLockedThread {
+  typedef void result_type;
+  const Setup &setup;
+  LockedCollection &collection;
+  void operator()(size_t t) const {
+    InternLocked(setup, t + 1, collection);
+  }
+};
+
+} // namespace
+} // namespace Moses
+
+int main(int argc, char *argv[])
+{
+  using namespace Moses;
+  size_t threads = argc > 1 ? std::atoi(argv[1]) : 8;
+  size_t vocabulary = argc > 2 ? std::atoi(argv[2]) : 200000;
+  Setup setup;
+  setup.lookups = argc > 3 ? std::atoi(argv[3]) : 2000000;
+#ifndef WITH_THREADS
+  threads = 1;
+#endif
+
+  for (size_t i = 0; i < vocabulary; ++i) {
+    util::StringStream str;
+    str << "word" << i;
+    setup.words.push_back(str.str());
+  }
+
+  std::vector<std::vector<const Factor*> > seen(threads, std::vector<const Factor*>(vocabulary));
+  InternFactorsThread factorsThread = { setup, seen };
+  double factorTime = RunThreads(threads, factorsThread);
+
+  // every thread must have been handed the same pointer for the same word
+  for (size_t w = 0; w < vocabulary; ++w) {
+    const Factor *factor = NULL;
+    for (size_t t = 0; t < threads; ++t) {
+      if (seen[t][w] == NULL) continue;
+      if (factor != NULL && seen[t][w] != factor) {
+        std::cerr << "Different factors for " << setup.words[w] << std::endl;
+        return 1;
+      }
+      factor = seen[t][w];
+    }
+  }
+
+  LockedCollection locked;
+  InternLockedThread lockedThread = { setup, locked };
+  double lockedTime = RunThreads(threads, lockedThread);
+
+  double lookups = static_cast<double>(threads) * setup.lookups;
+  std::cout << "threads=" << threads << " vocabulary=" << vocabulary << std::endl
+            << "lock-free: lookups/sec=" << lookups / factorTime << std::endl
+            << "locked:    lookups/sec=" << lookups / lockedTime << std::endl;
+  return 0;
+}
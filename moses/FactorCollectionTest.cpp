@@ -0,0 +1,109 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+
+#include "FactorCollection.h"
+#include "util/string_stream.hh"
+
+using namespace Moses;
+using namespace std;
+
+namespace
+{
+
+string Word(const string &prefix, size_t i)
+{
+  util::StringStream str;
+  str << prefix << i;
+  return str.str();
+}
+
+void Intern(const string &prefix, size_t count, vector<const Factor*> &factors)
+{
+  FactorCollection &collection = FactorCollection::Instance();
+  for (size_t i = 0; i < count; ++i) {
+    factors.push_back(collection.AddFactor(Word(prefix, i)));
+  }
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(factor_collection)
+
+BOOST_AUTO_TEST_CASE(stable_factors)
+{
+  FactorCollection &collection = FactorCollection::Instance();
+  BOOST_CHECK(collection.GetFactor("factor_collection_unseen") == NULL);
+
+  // enough strings to grow the table a few times
+  vector<const Factor*> factors;
+  Intern("stable_", 20000, factors);
+  for (size_t i = 0; i < factors.size(); ++i) {
+    BOOST_REQUIRE_EQUAL(factors[i]->GetString(), Word("stable_", i));
+    BOOST_REQUIRE_EQUAL(collection.AddFactor(Word("stable_", i)), factors[i]);
+    BOOST_REQUIRE_EQUAL(collection.GetFactor(Word("stable_", i)), factors[i]);
+    BOOST_REQUIRE_EQUAL(factors[i]->GetId(), factors[0]->GetId() + i);
+  }
+
+  const Factor *nonTerminal = collection.AddFactor(Word("stable_", 0), true);
+  BOOST_CHECK(nonTerminal != factors[0]);
+  BOOST_CHECK_LT(nonTerminal->GetId(), moses_MaxNumNonterminals);
+  BOOST_CHECK_EQUAL(collection.GetFactor(Word("stable_", 0), true), nonTerminal);
+}
+
+#ifdef WITH_THREADS
+BOOST_AUTO_TEST_CASE(concurrent_factors)
+{
+  const size_t threads = 4, count = 5000;
+  vector<vector<const Factor*> > factors(threads);
+  boost::thread_group group;
+  for (size_t t = 0; t < threads; ++t) {
+    group.create_thread(boost::bind(&Intern, "concurrent_", count, boost::ref(factors[t])));
+  }
+  group.join_all();
+
+  vector<bool> ids(count);
+  size_t firstId = factors[0][0]->GetId();
+  for (size_t i = 0; i < count; ++i) {
+    for (size_t t = 1; t < threads; ++t) {
+      BOOST_REQUIRE_EQUAL(factors[t][i], factors[0][i]);
+    }
+    firstId = std::min(firstId, factors[0][i]->GetId());
+  }
+  // ids are contiguous, without duplicates
+  for (size_t i = 0; i < count; ++i) {
+    size_t id = factors[0][i]->GetId() - firstId;
+    BOOST_REQUIRE_LT(id, count);
+    BOOST_REQUIRE(!ids[id]);
+    ids[id] = true;
+  }
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
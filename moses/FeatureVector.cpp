@@ -27,6 +27,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <boost/thread/locks.hpp>
 #endif // WITH_THREADS
 
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
 #include "FeatureVector.h"
 #include "util/string_piece_hash.hh"
 #include "util/string_stream.hh"
@@ -162,6 +166,152 @@ bool FName::operator!=(const FName& rhs) const
   return ! (*this == rhs);
 }
 
+void FlatFNVmap::PlusEquals(const FlatFNVmap& rhs, bool subtract)
+{
+  // count the names that are only in rhs
+  size_t extra = 0;
+  const_iterator i = m_entries.begin(), j = rhs.m_entries.begin();
+  while (j != rhs.m_entries.end()) {
+    if (i == m_entries.end() || j->first < i->first) {
+      ++extra;
+      ++j;
+    } else if (i->first < j->first) {
+      ++i;
+    } else {
+      ++i;
+      ++j;
+    }
+  }
+
+  if (extra == 0) {
+    // all names present, add in place (rhs may be *this)
+    iterator i = m_entries.begin();
+    for (const_iterator j = rhs.m_entries.begin(); j != rhs.m_entries.end(); ++j) {
+      while (i->first < j->first) ++i;
+      if (subtract) {
+        i->second -= j->second;
+      } else {
+        i->second += j->second;
+      }
+    }
+    return;
+  }
+
+  // merge from the back into the grown vector
+  size_t n = m_entries.size();
+  size_t k = n + extra;
+  size_t m = rhs.m_entries.size();
+  m_entries.resize(k, rhs.m_entries[0]);
+  while (m > 0) {
+    const value_type &r = rhs.m_entries[m - 1];
+    if (n > 0 && r.first < m_entries[n - 1].first) {
+      m_entries[--k] = m_entries[--n];
+    } else if (n > 0 && r.first == m_entries[n - 1].first) {
+      m_entries[--k] = m_entries[--n];
+      if (subtract) {
+        m_entries[k].second -= r.second;
+      } else {
+        m_entries[k].second += r.second;
+      }
+      --m;
+    } else {
+      m_entries[--k] = value_type(r.first, subtract ? FValue(0) - r.second : FValue(0) + r.second);
+      --m;
+    }
+  }
+}
+
+namespace
+{
+struct NameLess {
+  bool operator()(const FlatFNVmap::value_type& a, const FlatFNVmap::value_type& b) const {
+    return a.first < b.first;
+  }
+};
+}
+
+void FlatFNVmap::Assign(std::vector<value_type>& entries)
+{
+  // sort by name, keeping the last value of each name
+  std::stable_sort(entries.begin(), entries.end(), NameLess());
+  size_t kept = 0;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (kept > 0 && entries[kept - 1].first == entries[i].first) {
+      entries[kept - 1].second = entries[i].second;
+    } else {
+      entries[kept++] = entries[i];
+    }
+  }
+  entries.erase(entries.begin() + kept, entries.end());
+
+  if (m_entries.empty()) {
+    m_entries.swap(entries);
+    return;
+  }
+  std::vector<value_type> merged;
+  merged.reserve(m_entries.size() + entries.size());
+  const_iterator i = m_entries.begin(), j = entries.begin();
+  while (i != m_entries.end() || j != entries.end()) {
+    if (j == entries.end() || (i != m_entries.end() && i->first < j->first)) {
+      merged.push_back(*i++);
+    } else {
+      if (i != m_entries.end() && i->first == j->first) {
+        ++i;
+      }
+      merged.push_back(*j++);
+    }
+  }
+  m_entries.swap(merged);
+}
+
+FValue FlatFNVmap::InnerProduct(const FlatFNVmap& rhs) const
+{
+  FValue product = 0.0;
+  const_iterator j = rhs.m_entries.begin();
+  for (const_iterator i = m_entries.begin(); i != m_entries.end(); ++i) {
+    j = std::lower_bound(j, rhs.m_entries.end(), i->first, EntryLess());
+    if (j == rhs.m_entries.end()) break;
+    if (j->first == i->first) {
+      product += i->second * j->second;
+    }
+  }
+  return product;
+}
+
+namespace
+{
+// element-wise dst[i] += src[i] or dst[i] -= src[i], four at a time with SSE
+void AddCore(FValue *dst, const FValue *src, size_t n, bool subtract)
+{
+  size_t i = 0;
+#ifdef __SSE__
+  if (subtract) {
+    for (; i + 4 <= n; i += 4) {
+      _mm_storeu_ps(dst + i, _mm_sub_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+    }
+  } else {
+    for (; i + 4 <= n; i += 4) {
+      _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+    }
+  }
+#endif
+  for (; i < n; ++i) {
+    if (subtract) {
+      dst[i] -= src[i];
+    } else {
+      dst[i] += src[i];
+    }
+  }
+}
+
+void AddCore(std::valarray<FValue> &dst, const std::valarray<FValue> &src, bool subtract)
+{
+  if (src.size()) {
+    AddCore(&dst[0], &src[0], src.size(), subtract);
+  }
+}
+}
+
 FVector::FVector(size_t coreFeatures) : m_coreFeatures(coreFeatures) {}
 
 void FVector::resize(size_t newsize)
@@ -187,6 +337,7 @@ bool FVector::load(const std::string& filename)
     return false;
   }
   string line;
+  vector<FNVmap::value_type> values;
   while(getline(in,line)) {
     if (line[0] == '#') continue;
     istringstream linestream(line);
@@ -196,8 +347,9 @@ bool FVector::load(const std::string& filename)
     linestream >> value;
     FName fname(namestring);
     //cerr << "Setting sparse weight " << fname << " to value " << value << "." << endl;
-    set(fname,value);
+    values.push_back(FNVmap::value_type(fname, value));
   }
+  m_features.Assign(values);
   return true;
 }
 
@@ -370,18 +522,15 @@ FVector& FVector::operator+= (const FVector& rhs)
 {
   if (rhs.m_coreFeatures.size() > m_coreFeatures.size())
     resize(rhs.m_coreFeatures.size());
-  for (const_iterator i = rhs.cbegin(); i != rhs.cend(); ++i)
-    set(i->first, get(i->first) + i->second);
-  for (size_t i = 0; i < rhs.m_coreFeatures.size(); ++i)
-    m_coreFeatures[i] += rhs.m_coreFeatures[i];
+  m_features.PlusEquals(rhs.m_features);
+  AddCore(m_coreFeatures, rhs.m_coreFeatures, false);
   return *this;
 }
 
 // add only sparse features
 void FVector::sparsePlusEquals(const FVector& rhs)
 {
-  for (const_iterator i = rhs.cbegin(); i != rhs.cend(); ++i)
-    set(i->first, get(i->first) + i->second);
+  m_features.PlusEquals(rhs.m_features);
 }
 
 // add only core features
@@ -389,8 +538,7 @@ void FVector::corePlusEquals(const FVector& rhs)
 {
   if (rhs.m_coreFeatures.size() > m_coreFeatures.size())
     resize(rhs.m_coreFeatures.size());
-  for (size_t i = 0; i < rhs.m_coreFeatures.size(); ++i)
-    m_coreFeatures[i] += rhs.m_coreFeatures[i];
+  AddCore(m_coreFeatures, rhs.m_coreFeatures, false);
 }
 
 // assign only core features
@@ -400,6 +548,11 @@ void FVector::coreAssign(const FVector& rhs)
     m_coreFeatures[i] = rhs.m_coreFeatures[i];
 }
 
+void FVector::sparseAssign(std::vector<std::pair<FName, FValue> >& values)
+{
+  m_features.Assign(values);
+}
+
 void FVector::incrementSparseHopeFeatures()
 {
   for (const_iterator i = cbegin(); i != cend(); ++i)
@@ -548,13 +701,8 @@ FVector& FVector::operator-= (const FVector& rhs)
 {
   if (rhs.m_coreFeatures.size() > m_coreFeatures.size())
     resize(rhs.m_coreFeatures.size());
-  for (const_iterator i = rhs.cbegin(); i != rhs.cend(); ++i)
-    set(i->first, get(i->first) -(i->second));
-  for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
-    if (i < rhs.m_coreFeatures.size()) {
-      m_coreFeatures[i] -= rhs.m_coreFeatures[i];
-    }
-  }
+  m_features.PlusEquals(rhs.m_features, true);
+  AddCore(m_coreFeatures, rhs.m_coreFeatures, true);
   return *this;
 }
 
@@ -805,10 +953,7 @@ FValue FVector::sum() const
 FValue FVector::inner_product(const FVector& rhs) const
 {
   assert(m_coreFeatures.size() == rhs.m_coreFeatures.size());
-  FValue product = 0.0;
-  for (const_iterator i = cbegin(); i != cend(); ++i) {
-    product += ((i->second)*(rhs.get(i->first)));
-  }
+  FValue product = m_features.InnerProduct(rhs.m_features);
   for (size_t i = 0; i < m_coreFeatures.size(); ++i) {
     product += m_coreFeatures[i]*rhs.m_coreFeatures[i];
   }
@@ -829,12 +974,8 @@ void FVector::merge(const FVector &other)
   }
 
   // sparse
-  FNVmap::const_iterator iter;
-  for (iter = other.m_features.begin(); iter != other.m_features.end(); ++iter) {
-    const FName  &otherKey = iter->first;
-    const FValue otherVal = iter->second;
-    m_features[otherKey] = otherVal;
-  }
+  vector<FNVmap::value_type> values(other.m_features.begin(), other.m_features.end());
+  m_features.Assign(values);
 }
 
 const FVector operator+(const FVector& lhs, const FVector& rhs)
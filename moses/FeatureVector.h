@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef FEATUREVECTOR_H
 #define FEATUREVECTOR_H
 
+#include <algorithm>
 #include <iostream>
 #include <map>
 #include <sstream>
@@ -87,6 +88,10 @@ struct FName {
 
   bool operator==(const FName& rhs) const ;
   bool operator!=(const FName& rhs) const ;
+  //! orders by id, i.e. by the time the name was first seen
+  bool operator<(const FName& rhs) const {
+    return m_id < rhs.m_id;
+  }
 
   static size_t getId(const std::string& name);
   static size_t getHopeIdCount(const std::string& name);
@@ -121,6 +126,102 @@ struct FNameHash
 
 class ProxyFVector;
 
+/**
+ * Values of sparse features, kept as (name, value) pairs sorted by the
+ * name's id. Adding two vectors and inner products are merges of sorted
+ * sequences, lookups are binary searches, and all entries of a vector are
+ * contiguous in memory.
+ **/
+class FlatFNVmap
+{
+public:
+  typedef std::pair<FName, FValue> value_type;
+  typedef std::vector<value_type>::iterator iterator;
+  typedef std::vector<value_type>::const_iterator const_iterator;
+
+  iterator begin() {
+    return m_entries.begin();
+  }
+  iterator end() {
+    return m_entries.end();
+  }
+  const_iterator begin() const {
+    return m_entries.begin();
+  }
+  const_iterator end() const {
+    return m_entries.end();
+  }
+  const_iterator cbegin() const {
+    return m_entries.begin();
+  }
+  const_iterator cend() const {
+    return m_entries.end();
+  }
+  size_t size() const {
+    return m_entries.size();
+  }
+  bool empty() const {
+    return m_entries.empty();
+  }
+  void clear() {
+    m_entries.clear();
+  }
+
+  iterator find(const FName& name) {
+    iterator i = std::lower_bound(m_entries.begin(), m_entries.end(), name, EntryLess());
+    return (i != m_entries.end() && i->first == name) ? i : m_entries.end();
+  }
+  const_iterator find(const FName& name) const {
+    const_iterator i = std::lower_bound(m_entries.begin(), m_entries.end(), name, EntryLess());
+    return (i != m_entries.end() && i->first == name) ? i : m_entries.end();
+  }
+
+  //! value of the name, inserted as 0 if not present. O(size()) if the
+  //! name is new, so build large vectors with Assign()
+  FValue& operator[](const FName& name) {
+    iterator i = std::lower_bound(m_entries.begin(), m_entries.end(), name, EntryLess());
+    if (i == m_entries.end() || i->first != name) {
+      i = m_entries.insert(i, value_type(name, 0));
+    }
+    return i->second;
+  }
+
+  void erase(const FName& name) {
+    iterator i = find(name);
+    if (i != m_entries.end()) m_entries.erase(i);
+  }
+
+  /** Add (or subtract) the values of rhs, inserting names not present
+   *  here. Equivalent to (*this)[name] += value for each entry of rhs. */
+  void PlusEquals(const FlatFNVmap& rhs, bool subtract = false);
+
+  /** Set the values of the names in entries, with one sort and one merge.
+   *  Equivalent to (*this)[name] = value for each entry in turn, so the
+   *  last value of a name wins. entries is sorted in the process. */
+  void Assign(std::vector<value_type>& entries);
+
+  /** Sum of products of values with the same name */
+  FValue InnerProduct(const FlatFNVmap& rhs) const;
+
+  void swap(FlatFNVmap& other) {
+    m_entries.swap(other.m_entries);
+  }
+
+private:
+  struct EntryLess {
+    bool operator()(const value_type& entry, const FName& name) const {
+      return entry.first < name;
+    }
+  };
+
+  std::vector<value_type> m_entries;
+};
+
+inline void swap(FlatFNVmap &first, FlatFNVmap &second)
+{
+  first.swap(second);
+}
+
 /**
  * A sparse feature (or weight) vector.
  **/
@@ -141,7 +242,7 @@ public:
   **/
   void resize(size_t newsize);
 
-  typedef boost::unordered_map<FName,FValue,FNameHash, FNameEquals> FNVmap;
+  typedef FlatFNVmap FNVmap;
   /** Iterators */
   typedef FNVmap::iterator iterator;
   typedef FNVmap::const_iterator const_iterator;
@@ -237,6 +338,8 @@ public:
   void sparsePlusEquals(const FVector& rhs);
   void corePlusEquals(const FVector& rhs);
   void coreAssign(const FVector& rhs);
+  // set many sparse features at once, the last value of a name wins
+  void sparseAssign(std::vector<std::pair<FName, FValue> >& values);
 
   void incrementSparseHopeFeatures();
   void incrementSparseFearFeatures();
@@ -301,9 +404,12 @@ private:
     ar >> values;
     ar >> m_coreFeatures;
     UTIL_THROW_IF2(names.size() != values.size(), "Error");
+    std::vector<FNVmap::value_type> entries;
+    entries.reserve(names.size());
     for (size_t i = 0; i < names.size(); ++i) {
-      set(FName(names[i]), values[i]);
+      entries.push_back(FNVmap::value_type(FName(names[i]), values[i]));
     }
+    m_features.Assign(entries);
   }
 
   BOOST_SERIALIZATION_SPLIT_MEMBER()
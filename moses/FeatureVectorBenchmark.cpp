@@ -0,0 +1,169 @@
+// Microbenchmark for the feature vector operations done for every
+// hypothesis: adding the score breakdown of the translation option
+// (PlusEquals) and weighting the result (InnerProduct). Compares FVector
+// with the hash map layout it used before, reimplemented below.
+//
+// Usage: FeatureVectorBenchmark [dense] [sparse per phrase] [sparse weights] [iterations]
+
+#include <cstdlib>
+#include <iostream>
+#include <valarray>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+#include "moses/FeatureVector.h"
+#include "util/string_stream.hh"
+#include "util/usage.hh"
+
+namespace Moses
+{
+namespace
+{
+
+// sparse features in a hash map, as FVector used to keep them
+class MapFVector
+{
+public:
+  typedef boost::unordered_map<FName, FValue, FNameHash, FNameEquals> Map;
+
+  explicit MapFVector(size_t coreFeatures) : m_core(coreFeatures) {}
+
+  FValue &operator[](const FName &name) {
+    return m_sparse[name];
+  }
+
+  void PlusEquals(const MapFVector &rhs) {
+    for (Map::const_iterator i = rhs.m_sparse.begin(); i != rhs.m_sparse.end(); ++i) {
+      m_sparse[i->first] += i->second;
+    }
+    for (size_t i = 0; i < rhs.m_core.size(); ++i) {
+      m_core[i] += rhs.m_core[i];
+    }
+  }
+
+  FValue InnerProduct(const MapFVector &rhs) const {
+    FValue product = 0;
+    for (Map::const_iterator i = m_sparse.begin(); i != m_sparse.end(); ++i) {
+      Map::const_iterator j = rhs.m_sparse.find(i->first);
+      if (j != rhs.m_sparse.end()) product += i->second * j->second;
+    }
+    for (size_t i = 0; i < m_core.size(); ++i) {
+      product += m_core[i] * rhs.m_core[i];
+    }
+    return product;
+  }
+
+  std::valarray<FValue> m_core;
+  Map m_sparse;
+};
+
+struct Setup {
+  size_t dense, sparsePerPhrase, weights, phrases;
+  std::vector<FName> names;
+};
+
+FName Name(size_t i)
+{
+  util::StringStream str;
+  str << "bench_" << i;
+  return FName(str.str());
+}
+
+template <class Vector>
+void Fill(Vector &v, const Setup &setup, size_t seed)
+{
+  for (size_t i = 0; i < setup.dense; ++i) v[i] = 0.1f * (i + seed);
+  for (size_t i = 0; i < setup.sparsePerPhrase; ++i) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    v[setup.names[(seed >> 33) % setup.names.size()]] = 1;
+  }
+}
+
+void FillCore(MapFVector &v, const Setup &setup, size_t seed)
+{
+  for (size_t i = 0; i < setup.dense; ++i) v.m_core[i] = 0.1f * (i + seed);
+}
+
+// extend a hypothesis over a path of phrases, weighting after each step
+template <class Vector, class Add, class Weigh>
+double Run(const std::vector<Vector> &phrases, const Vector &weights, const Vector &empty,
+           size_t iterations, Add add, Weigh weigh, FValue &checksum)
+{
+  double start = util::WallTime();
+  for (size_t it = 0; it < iterations; ++it) {
+    Vector hypo(empty);
+    for (size_t p = 0; p < phrases.size(); ++p) {
+      Vector next(hypo);
+      add(next, phrases[(p + it) % phrases.size()]);
+      checksum += weigh(next, weights);
+      hypo = next;
+    }
+  }
+  return util::WallTime() - start;
+}
+
+void AddFlat(FVector &lhs, const FVector &rhs)
+{
+  lhs += rhs;
+}
+FValue WeighFlat(const FVector &lhs, const FVector &rhs)
+{
+  return lhs.inner_product(rhs);
+}
+void AddMap(MapFVector &lhs, const MapFVector &rhs)
+{
+  lhs.PlusEquals(rhs);
+}
+FValue WeighMap(const MapFVector &lhs, const MapFVector &rhs)
+{
+  return lhs.InnerProduct(rhs);
+}
+
+} // namespace
+} // namespace Moses
+
+int main(int argc, char *argv[])
+{
+  using namespace Moses;
+  Setup setup;
+  setup.dense = argc > 1 ? std::atoi(argv[1]) : 20;
+  setup.sparsePerPhrase = argc > 2 ? std::atoi(argv[2]) : 5;
+  setup.weights = argc > 3 ? std::atoi(argv[3]) : 50000;
+  size_t iterations = argc > 4 ? std::atoi(argv[4]) : 20000;
+  setup.phrases = 20;
+  for (size_t i = 0; i < setup.weights; ++i) setup.names.push_back(Name(i));
+
+  std::vector<FVector> flatPhrases;
+  std::vector<MapFVector> mapPhrases;
+  for (size_t p = 0; p < setup.phrases; ++p) {
+    flatPhrases.push_back(FVector(setup.dense));
+    Fill(flatPhrases.back(), setup, p);
+    mapPhrases.push_back(MapFVector(setup.dense));
+    FillCore(mapPhrases.back(), setup, p);
+    for (FVector::const_iterator i = flatPhrases.back().cbegin(); i != flatPhrases.back().cend(); ++i) {
+      mapPhrases.back()[i->first] = i->second;
+    }
+  }
+  FVector flatWeights(setup.dense);
+  MapFVector mapWeights(setup.dense);
+  for (size_t i = 0; i < setup.dense; ++i) {
+    flatWeights[i] = mapWeights.m_core[i] = 0.5f;
+  }
+  for (size_t i = 0; i < setup.names.size(); ++i) {
+    flatWeights[setup.names[i]] = mapWeights[setup.names[i]] = 0.01f * (i % 7);
+  }
+
+  FValue flatSum = 0, mapSum = 0;
+  double flatTime = Run(flatPhrases, flatWeights, FVector(setup.dense), iterations,
+                        AddFlat, WeighFlat, flatSum);
+  double mapTime = Run(mapPhrases, mapWeights, MapFVector(setup.dense), iterations,
+                       AddMap, WeighMap, mapSum);
+
+  double steps = static_cast<double>(iterations) * setup.phrases;
+  std::cout << "dense=" << setup.dense << " sparse_per_phrase=" << setup.sparsePerPhrase
+            << " sparse_weights=" << setup.weights << std::endl
+            << "flat: extensions/sec=" << steps / flatTime << " checksum=" << flatSum << std::endl
+            << "map:  extensions/sec=" << steps / mapTime << " checksum=" << mapSum << std::endl;
+  return 0;
+}
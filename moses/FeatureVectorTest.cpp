@@ -307,5 +307,67 @@ BOOST_AUTO_TEST_CASE(ip)
 }
 
 
+BOOST_AUTO_TEST_CASE(sparse_merge)
+{
+  // names interned out of order, vectors with interleaved and disjoint names
+  FName n3("merge_c");
+  FName n1("merge_a");
+  FName n4("merge_d");
+  FName n2("merge_b");
+  FVector f1, f2;
+  f1[n3] = 1;
+  f1[n1] = 2;
+  f2[n4] = 3;
+  f2[n2] = 4;
+  f2[n3] = 5;
+
+  f1 += f2;
+  BOOST_CHECK_EQUAL(f1.size(), 4);
+  BOOST_CHECK_EQUAL((FValue)f1[n1], 2);
+  BOOST_CHECK_EQUAL((FValue)f1[n2], 4);
+  BOOST_CHECK_EQUAL((FValue)f1[n3], 6);
+  BOOST_CHECK_EQUAL((FValue)f1[n4], 3);
+  for (FVector::const_iterator i = f1.cbegin(); i + 1 != f1.cend(); ++i) {
+    BOOST_CHECK(i->first < (i + 1)->first);
+  }
+
+  f1 += f1;
+  BOOST_CHECK_EQUAL((FValue)f1[n3], 12);
+  f2 -= f1;
+  BOOST_CHECK_EQUAL((FValue)f2[n1], -4);
+  BOOST_CHECK_EQUAL((FValue)f2[n3], -7);
+  BOOST_CHECK_EQUAL(f1.inner_product(f2), 4 * -4 + 8 * -4 + 12 * -7 + 6 * -3);
+}
+
+BOOST_AUTO_TEST_CASE(sparse_assign)
+{
+  FName n1("assign_a");
+  FName n2("assign_b");
+  FName n3("assign_c");
+  FName n4("assign_d");
+  FVector f;
+  f[n2] = 1;
+  f[n4] = 2;
+
+  // unsorted, with a repeated name and names already present
+  vector<pair<FName, FValue> > values;
+  values.push_back(make_pair(n3, 3));
+  values.push_back(make_pair(n1, 4));
+  values.push_back(make_pair(n4, 5));
+  values.push_back(make_pair(n3, 6));
+  f.sparseAssign(values);
+
+  BOOST_CHECK_EQUAL(f.size(), 4);
+  BOOST_CHECK_EQUAL((FValue)f[n1], 4);
+  BOOST_CHECK_EQUAL((FValue)f[n2], 1);
+  BOOST_CHECK_EQUAL((FValue)f[n3], 6);
+  BOOST_CHECK_EQUAL((FValue)f[n4], 5);
+
+  // written in the order the names were first seen
+  ostringstream out;
+  f.write(out, " ", ";");
+  BOOST_CHECK_EQUAL(out.str(), "assign_a 4;assign_b 1;assign_c 6;assign_d 5;");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -0,0 +1,184 @@
+// Per-sentence latency of the rules PhraseDictionaryFuzzyMatch extracts from
+// a translation memory: once through a temporary directory, with the input,
+// extract files and rule table written to disk and scored by
+// train-model.perl, as the decoder does by default, and once in memory, as
+// with in-memory=true. Both must give the same rules, with the same scores up
+// to the rounding of the text rule table.
+//
+// Usage: FuzzyMatchBenchmark <tm source> <tm target> <tm alignment> <input>
+//          [bin-dir [match-threads]]
+// The temporary directory path needs scripts/training/train-model.perl in
+// <bin-dir>/.., and the score and consolidate programs in <bin-dir>, which
+// defaults to the directory of this program. With match-threads > 1, the
+// sentences are extracted in a thread pool of that size, like in the
+// decoder, so that the candidate TM sentences are scored in parallel.
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+
+#include "moses/InputFileStream.h"
+#include "moses/StaticData.h"
+#include "moses/ThreadPool.h"
+#include "moses/TranslationModel/fuzzy-match/FuzzyMatchWrapper.h"
+#include "moses/TranslationModel/fuzzy-match/SentenceAlignment.h"
+#include "moses/Util.h"
+#include "util/usage.hh"
+
+namespace Moses
+{
+namespace
+{
+
+typedef tmmt::FuzzyMatchWrapper::ExtractedRule ExtractedRule;
+
+bool RuleLess(const ExtractedRule &a, const ExtractedRule &b)
+{
+  if (a.source != b.source) return a.source < b.source;
+  if (a.target != b.target) return a.target < b.target;
+  return a.scores < b.scores;
+}
+
+bool SameRules(std::vector<ExtractedRule> a, std::vector<ExtractedRule> b)
+{
+  if (a.size() != b.size()) return false;
+  std::sort(a.begin(), a.end(), RuleLess);
+  std::sort(b.begin(), b.end(), RuleLess);
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].source != b[i].source || a[i].target != b[i].target
+        || a[i].scores.size() != b[i].scores.size()) {
+      return false;
+    }
+    for (size_t j = 0; j < a[i].scores.size(); ++j) {
+      if (std::fabs(a[i].scores[j] - b[i].scores[j]) > 1e-5) return false;
+    }
+  }
+  return true;
+}
+
+//! what the decoder does without in-memory=true, but for adding the rules
+double ExtractThroughFiles(tmmt::FuzzyMatchWrapper &wrapper, long translationId,
+                           const std::string &input, std::vector<ExtractedRule> &rules)
+{
+  double start = util::WallTime();
+  boost::filesystem::path dir = boost::filesystem::temp_directory_path()
+                                / boost::filesystem::unique_path("moses.%%%%%%");
+  boost::filesystem::create_directory(dir);
+  {
+    std::ofstream in((dir / "in").string().c_str());
+    in << input << std::endl;
+  }
+
+  InputFileStream table(wrapper.Extract(translationId, dir.string()));
+  std::string line;
+  while (getline(table, line)) {
+    std::vector<std::string> tokens = TokenizeMultiCharSeparator(line, "|||");
+    if (tokens.size() < 4) continue;
+    rules.push_back(ExtractedRule());
+    ExtractedRule &rule = rules.back();
+    rule.source = Trim(tokens[0]);
+    rule.target = Trim(tokens[1]);
+    rule.scores = Tokenize<float>(tokens[2]);
+    rule.alignment = Trim(tokens[3]);
+  }
+  double time = util::WallTime() - start;
+
+  boost::filesystem::remove_all(dir);
+  return time;
+}
+
+double ExtractInMemory(tmmt::FuzzyMatchWrapper &wrapper, long translationId,
+                       const std::string &input, std::vector<ExtractedRule> &rules)
+{
+  double start = util::WallTime();
+  wrapper.ExtractRules(translationId, input, rules);
+  return util::WallTime() - start;
+}
+
+struct Totals {
+  long sentences;
+  size_t rules;
+  double filesTime, filesMax, memoryTime, memoryMax;
+  bool same;
+};
+
+void ExtractAll(tmmt::FuzzyMatchWrapper &wrapper, const char *inputPath, Totals &totals)
+{
+  std::ifstream input(inputPath);
+  std::string line;
+  while (getline(input, line)) {
+    std::vector<ExtractedRule> filesRules, memoryRules;
+    double files = ExtractThroughFiles(wrapper, totals.sentences, line, filesRules);
+    double memory = ExtractInMemory(wrapper, totals.sentences, line, memoryRules);
+    if (!SameRules(filesRules, memoryRules)) {
+      std::cerr << "Rules of sentence " << totals.sentences << " differ" << std::endl;
+      totals.same = false;
+      return;
+    }
+    totals.rules += memoryRules.size();
+    totals.filesTime += files;
+    totals.filesMax = std::max(totals.filesMax, files);
+    totals.memoryTime += memory;
+    totals.memoryMax = std::max(totals.memoryMax, memory);
+    ++totals.sentences;
+  }
+}
+
+} // namespace
+} // namespace Moses
+
+int main(int argc, char *argv[])
+{
+  using namespace Moses;
+
+  if (argc < 5) {
+    std::cerr << "Usage: " << argv[0] << " <tm source> <tm target> <tm alignment> <input>"
+              << " [bin-dir [match-threads]]" << std::endl;
+    return 1;
+  }
+  // the bin directory is taken from the path of the executable
+  StaticData::InstanceNonConst().SetExecPath(argc > 5 ? std::string(argv[5]) + "/" : argv[0]);
+
+  size_t threads = argc > 6 ? Scan<size_t>(argv[6]) : 1;
+
+  double start = util::WallTime();
+  tmmt::FuzzyMatchWrapper wrapper(argv[1], argv[2], argv[3]);
+  wrapper.SetMatchThreads(threads);
+  double load = util::WallTime() - start;
+
+  Totals totals = Totals();
+  totals.same = true;
+#ifdef WITH_THREADS
+  if (threads > 1) {
+    ThreadPool pool(threads);
+    pool.Submit(boost::shared_ptr<Task>(new FunctionTask(
+                                          boost::bind(&ExtractAll, boost::ref(wrapper), argv[4], boost::ref(totals)))));
+    pool.Stop(true);
+  } else
+#endif
+    ExtractAll(wrapper, argv[4], totals);
+
+  if (!totals.same) {
+    return 1;
+  }
+  if (!totals.sentences) {
+    std::cerr << "No input" << std::endl;
+    return 1;
+  }
+
+  std::cout << "sentences=" << totals.sentences
+            << " rules=" << totals.rules
+            << " load=" << load << "s"
+            << " files=" << totals.filesTime / totals.sentences << "s/sentence"
+            << " (max " << totals.filesMax << "s)"
+            << " memory=" << totals.memoryTime / totals.sentences << "s/sentence"
+            << " (max " << totals.memoryMax << "s)"
+            << " speedup=" << totals.filesTime / totals.memoryTime << std::endl;
+  return 0;
+}
@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "Word.h"
 #include "Util.h"
 #include "InputFileStream.h"
+#include "Snapshot.h"
 #include "StaticData.h"
 #include "util/exception.hh"
 #include "util/string_stream.hh"
@@ -108,6 +109,46 @@ void GenerationDictionary::Load(AllOptions::ptr const& opts)
   inFile.Close();
 }
 
+bool GenerationDictionary::WriteSnapshot(SnapshotWriter &snapshot) const
+{
+  snapshot.WriteFileStamp(m_filePath);
+  snapshot.WriteInt(m_collection.size());
+  for (Collection::const_iterator iterWord = m_collection.begin(); iterWord != m_collection.end(); ++iterWord) {
+    snapshot.WriteWord(*iterWord->first);
+    // the output words are expanded in the order of the map
+    const OutputWordCollection &outputWords = iterWord->second;
+    snapshot.WriteInt(outputWords.bucket_count());
+    std::vector<const OutputWordCollection::value_type*> entries = ReverseIterationOrder(outputWords);
+    snapshot.WriteInt(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+      snapshot.WriteWord(entries[i]->first);
+      snapshot.WriteScores(entries[i]->second);
+    }
+  }
+  return true;
+}
+
+bool GenerationDictionary::ReadSnapshot(AllOptions::ptr const& opts, SnapshotReader &snapshot)
+{
+  if (!snapshot.ReadFileStamp(m_filePath)) {
+    return false;
+  }
+  m_options = opts;
+
+  for (uint64_t numInputWords = snapshot.ReadInt(); numInputWords; --numInputWords) {
+    Word *inputWord = new Word();  // deleted in destructor
+    snapshot.ReadWord(*inputWord);
+    OutputWordCollection &outputWords = m_collection[inputWord];
+    outputWords.rehash(snapshot.ReadInt());
+    for (uint64_t numOutputWords = snapshot.ReadInt(); numOutputWords; --numOutputWords) {
+      Word outputWord;
+      snapshot.ReadWord(outputWord);
+      snapshot.ReadScores(outputWords[outputWord]);
+    }
+  }
+  return true;
+}
+
 GenerationDictionary::~GenerationDictionary()
 {
   Collection::const_iterator iter;
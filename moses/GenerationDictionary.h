@@ -64,6 +64,9 @@ public:
   //! load data file
   void Load(AllOptions::ptr const& opts);
 
+  bool WriteSnapshot(SnapshotWriter &snapshot) const;
+  bool ReadSnapshot(AllOptions::ptr const& opts, SnapshotReader &snapshot);
+
   /** number of unique input entries in the generation table.
   * NOT the number of lines in the generation table
   */
@@ -38,11 +38,40 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "moses/FF/StatelessFeatureFunction.h"
 
 #include <boost/foreach.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#endif
 
 using namespace std;
 
 namespace Moses
 {
+
+namespace
+{
+// With lazy-score-breakdown, the scores of a new hypothesis are only summed
+// to get its weighted score. The collections for that are kept per thread
+// and reused, rather than allocated for every hypothesis.
+#ifdef WITH_THREADS
+boost::thread_specific_ptr<std::vector<ScoreComponentCollection> > s_scratchScores;
+#else
+boost::scoped_ptr<std::vector<ScoreComponentCollection> > s_scratchScores;
+#endif
+
+//! size zeroed collections of this thread
+std::vector<ScoreComponentCollection> &ScratchScores(size_t size)
+{
+  if (!s_scratchScores.get()) {
+    s_scratchScores.reset(new std::vector<ScoreComponentCollection>);
+  }
+  std::vector<ScoreComponentCollection> &scores = *s_scratchScores;
+  if (scores.size() < size) scores.resize(size);
+  for (size_t i = 0; i < size; ++i) {
+    scores[i].ZeroAll();
+  }
+  return scores;
+}
+}
 Hypothesis::
 Hypothesis(Manager& manager, InputType const& source, const TranslationOption &initialTransOpt, const Bitmap &bitmap, int id)
   : m_prevHypo(NULL)
@@ -53,6 +82,8 @@ Hypothesis(Manager& manager, InputType const& source, const TranslationOption &i
     m_sourceCompleted.GetFirstGapPos()>0 ? m_sourceCompleted.GetFirstGapPos()-1 : NOT_FOUND)
   , m_currTargetWordsRange(NOT_FOUND, NOT_FOUND)
   , m_wordDeleted(false)
+  , m_evaluated(false)
+  , m_lazyScoreBreakdown(false)
   , m_futureScore(0.0f)
   , m_estimatedScore(0.0f)
   , m_ffStates(StatefulFeatureFunction::GetStatefulFeatureFunctions().size())
@@ -83,15 +114,20 @@ Hypothesis(const Hypothesis &prevHypo, const TranslationOption &transOpt, const
                            prevHypo.m_currTargetWordsRange.GetEndPos()
                            + transOpt.GetTargetPhrase().GetSize())
   , m_wordDeleted(false)
+  , m_evaluated(false)
+  , m_lazyScoreBreakdown(prevHypo.GetManager().options()->search.lazy_score_breakdown)
   , m_futureScore(0.0f)
   , m_estimatedScore(0.0f)
+  , m_currScoreBreakdown(!m_lazyScoreBreakdown)
   , m_ffStates(prevHypo.m_ffStates.size())
   , m_arcList(NULL)
   , m_transOpt(transOpt)
   , m_manager(prevHypo.GetManager())
   , m_id(id)
 {
-  m_currScoreBreakdown.PlusEquals(transOpt.GetScoreBreakdown());
+  if (!m_lazyScoreBreakdown) {
+    m_currScoreBreakdown.PlusEquals(transOpt.GetScoreBreakdown());
+  }
   m_wordDeleted = transOpt.IsDeletionOption();
 }
 
@@ -146,12 +182,102 @@ void
 Hypothesis::
 EvaluateWhenApplied(float estimatedScore)
 {
-  const StaticData &staticData = StaticData::Instance();
-
   // some stateless score producers cache their values in the translation
   // option: add these here
   // language model scores for n-grams completely contained within a target
   // phrase are also included here
+  float score;
+  if (!m_lazyScoreBreakdown) {
+    EvaluateFeatures(m_currScoreBreakdown, &m_ffStates);
+    score = m_currScoreBreakdown.GetWeightedScore();
+  } else {
+    // lazy-score-breakdown: keep only the weighted score, the breakdown is
+    // recomputed by GetCurrScoreBreakdown() for hypotheses that are output
+    ScoreComponentCollection &scores = ScratchScores(1)[0];
+    scores.PlusEquals(m_transOpt.GetScoreBreakdown());
+    EvaluateFeatures(scores, &m_ffStates);
+    score = scores.GetWeightedScore();
+  }
+  SetEvaluated(score, estimatedScore);
+}
+
+void
+Hypothesis::
+SetEvaluated(float score, float estimatedScore)
+{
+  m_evaluated = true;
+
+  // FUTURE COST
+  m_estimatedScore = estimatedScore;
+
+  // TOTAL
+  m_futureScore = score + m_estimatedScore;
+  if (m_prevHypo) m_futureScore += m_prevHypo->GetScore();
+}
+
+void
+Hypothesis::
+EvaluateWhenApplied(const std::vector<Hypothesis*> &hypos,
+                    const std::vector<float> &estimatedScores)
+{
+  if (hypos.empty()) return;
+  const StaticData &staticData = StaticData::Instance();
+
+  // with lazy-score-breakdown, the scores are only needed until the
+  // weighted score is known
+  std::vector<ScoreComponentCollection> *lazyScores = NULL;
+  if (hypos[0]->m_lazyScoreBreakdown) lazyScores = &ScratchScores(hypos.size());
+  std::vector<ScoreComponentCollection*> accumulators(hypos.size());
+  for (size_t h = 0; h < hypos.size(); ++h) {
+    if (!hypos[h]->m_lazyScoreBreakdown) {
+      accumulators[h] = &hypos[h]->m_currScoreBreakdown;
+    } else {
+      accumulators[h] = &(*lazyScores)[h];
+      accumulators[h]->PlusEquals(hypos[h]->m_transOpt.GetScoreBreakdown());
+    }
+  }
+
+  const vector<const StatelessFeatureFunction*>& sfs =
+    StatelessFeatureFunction::GetStatelessFeatureFunctions();
+  for (unsigned i = 0; i < sfs.size(); ++i) {
+    const StatelessFeatureFunction &ff = *sfs[i];
+    if(!staticData.IsFeatureFunctionIgnored(ff)) {
+      for (size_t h = 0; h < hypos.size(); ++h) {
+        ff.EvaluateWhenApplied(*hypos[h], accumulators[h]);
+      }
+    }
+  }
+
+  std::vector<const Hypothesis*> constHypos(hypos.begin(), hypos.end());
+  std::vector<const FFState*> prevStates(hypos.size());
+  std::vector<const FFState*> states(hypos.size());
+  const vector<const StatefulFeatureFunction*>& ffs =
+    StatefulFeatureFunction::GetStatefulFeatureFunctions();
+  for (unsigned i = 0; i < ffs.size(); ++i) {
+    const StatefulFeatureFunction &ff = *ffs[i];
+    if(!staticData.IsFeatureFunctionIgnored(ff)) {
+      for (size_t h = 0; h < hypos.size(); ++h) {
+        const Hypothesis *prevHypo = hypos[h]->m_prevHypo;
+        prevStates[h] = prevHypo ? prevHypo->m_ffStates[i] : NULL;
+      }
+      ff.EvaluateBatchWhenApplied(constHypos, prevStates, accumulators, states);
+      for (size_t h = 0; h < hypos.size(); ++h) {
+        hypos[h]->m_ffStates[i] = states[h];
+      }
+    }
+  }
+
+  for (size_t h = 0; h < hypos.size(); ++h) {
+    hypos[h]->SetEvaluated(accumulators[h]->GetWeightedScore(), estimatedScores[h]);
+  }
+}
+
+void
+Hypothesis::
+EvaluateFeatures(ScoreComponentCollection &accumulator,
+                 std::vector<const FFState*> *states) const
+{
+  const StaticData &staticData = StaticData::Instance();
 
   // compute values of stateless feature functions that were not
   // cached in the translation option
@@ -160,7 +286,7 @@ EvaluateWhenApplied(float estimatedScore)
   for (unsigned i = 0; i < sfs.size(); ++i) {
     const StatelessFeatureFunction &ff = *sfs[i];
     if(!staticData.IsFeatureFunctionIgnored(ff)) {
-      ff.EvaluateWhenApplied(*this, &m_currScoreBreakdown);
+      ff.EvaluateWhenApplied(*this, &accumulator);
     }
   }
 
@@ -170,16 +296,42 @@ EvaluateWhenApplied(float estimatedScore)
     const StatefulFeatureFunction &ff = *ffs[i];
     if(!staticData.IsFeatureFunctionIgnored(ff)) {
       FFState const* s = m_prevHypo ? m_prevHypo->m_ffStates[i] : NULL;
-      m_ffStates[i] = ff.EvaluateWhenApplied(*this, s, &m_currScoreBreakdown);
+      FFState const* state = ff.EvaluateWhenApplied(*this, s, &accumulator);
+      if (states) {
+        (*states)[i] = state;
+      } else {
+        delete state;
+      }
     }
   }
+}
 
-  // FUTURE COST
-  m_estimatedScore = estimatedScore;
+/**
+ * The breakdown is not kept during search with lazy-score-breakdown.
+ * Replay the feature functions for this hypothesis: the states of the
+ * previous hypothesis are still around, the new states are discarded.
+ * Like the lazily summed GetScoreBreakdown(), this is only done once the
+ * search is over, by the thread that outputs the translation.
+ */
+const ScoreComponentCollection&
+Hypothesis::
+GetCurrScoreBreakdown() const
+{
+  if (m_lazyScoreBreakdown) {
+    UTIL_THROW_IF2(!HasScoreBreakdown(),
+                   "Score breakdowns are not available during the search with lazy-score-breakdown");
+    m_currScoreBreakdown = m_transOpt.GetScoreBreakdown();
+    if (m_evaluated) EvaluateFeatures(m_currScoreBreakdown, NULL);
+    m_lazyScoreBreakdown = false;
+  }
+  return m_currScoreBreakdown;
+}
 
-  // TOTAL
-  m_futureScore = m_currScoreBreakdown.GetWeightedScore() + m_estimatedScore;
-  if (m_prevHypo) m_futureScore += m_prevHypo->GetScore();
+bool
+Hypothesis::
+HasScoreBreakdown() const
+{
+  return !m_lazyScoreBreakdown || m_manager.IsSearchDone();
 }
 
 const Hypothesis* Hypothesis::GetPrevHypo()const
@@ -223,7 +375,9 @@ PrintHypothesis() const
   //	TRACE_ERR( "\tlanguage model cost "); // <<m_score[ScoreType::LanguageModelScore]<<endl;
   //	TRACE_ERR( "\tword penalty "); // <<(m_score[ScoreType::WordPenalty]*weightWordPenalty)<<endl;
   TRACE_ERR( "\tscore "<<m_futureScore - m_estimatedScore<<" + future cost "<<m_estimatedScore<<" = "<<m_futureScore<<endl);
-  TRACE_ERR(  "\tunweighted feature scores: " << m_currScoreBreakdown << endl);
+  if (HasScoreBreakdown()) {
+    TRACE_ERR(  "\tunweighted feature scores: " << GetCurrScoreBreakdown() << endl);
+  }
   //PrintLMScores();
 }
 
@@ -287,7 +441,9 @@ ostream& operator<<(ostream& out, const Hypothesis& hypo)
 
   // scores
   out << " [total=" << hypo.GetFutureScore() << "]";
-  out << " " << hypo.GetScoreBreakdown();
+  if (hypo.HasScoreBreakdown()) {
+    out << " " << hypo.GetScoreBreakdown();
+  }
 
   // alignment
   out << " " << hypo.GetCurrTargetPhrase().GetAlignNonTerm();
@@ -36,6 +36,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "ScoreComponentCollection.h"
 #include "InputType.h"
 #include "ObjectPool.h"
+#include "SentenceArena.h"
 #include "xmlrpc-c.h"
 
 namespace Moses
@@ -62,7 +63,7 @@ typedef std::vector<Hypothesis*> ArcList;
 		The expansion of hypotheses is handled in the class Manager, which
     stores active hypothesis in the search in hypothesis stacks.
 ***/
-class Hypothesis
+class Hypothesis : public ArenaAllocated
 {
   friend std::ostream& operator<<(std::ostream&, const Hypothesis&);
 protected:
@@ -72,11 +73,15 @@ protected:
   Range				m_currSourceWordsRange; /*! source word positions of the last phrase that was used to create this hypothesis */
   Range        m_currTargetWordsRange; /*! target word positions of the last phrase that was used to create this hypothesis */
   bool							m_wordDeleted;
+  bool							m_evaluated; /*! EvaluateWhenApplied() was called */
+  mutable bool			m_lazyScoreBreakdown; /*! m_currScoreBreakdown is still to be computed */
   float							m_futureScore;  /*! score so far */
   float							m_estimatedScore; /*! estimated future cost to translate rest of sentence */
   /*! sum of scores of this hypothesis, and previous hypotheses. Lazily initialised.  */
   mutable boost::scoped_ptr<ScoreComponentCollection> m_scoreBreakdown;
-  ScoreComponentCollection m_currScoreBreakdown; /*! scores for this hypothesis only */
+  /*! scores for this hypothesis only. With lazy-score-breakdown, only the
+   *  weighted score is kept during search and this is empty until needed */
+  mutable ScoreComponentCollection m_currScoreBreakdown;
   std::vector<const FFState*> m_ffStates;
   const Hypothesis 	*m_winningHypo;
   ArcList 					*m_arcList; /*! all arcs that end at the same trellis point as this hypothesis */
@@ -122,9 +127,30 @@ public:
 
   void EvaluateWhenApplied(float estimatedScore);
 
+  /** EvaluateWhenApplied() for several hypotheses at once, one feature
+   *  function at a time, so that stateful feature functions see the whole
+   *  batch (see StatefulFeatureFunction::EvaluateBatchWhenApplied()) */
+  static void EvaluateWhenApplied(const std::vector<Hypothesis*> &hypos,
+                                  const std::vector<float> &estimatedScores);
+
+private:
+  //! store the result of EvaluateWhenApplied()
+  void SetEvaluated(float score, float estimatedScore);
+
+  /** add the scores of the feature functions evaluated when the hypothesis
+   *  is applied. The new states are stored in *states, or deleted if NULL */
+  void EvaluateFeatures(ScoreComponentCollection &accumulator,
+                        std::vector<const FFState*> *states) const;
+
+public:
+
   int GetId()const {
     return m_id;
   }
+  //! hypotheses built by sub-tasks are numbered when added to their stack
+  void SetId(int id) {
+    m_id = id;
+  }
 
   const Hypothesis* GetPrevHypo() const;
 
@@ -208,10 +234,16 @@ public:
   inline const ArcList* GetArcList() const {
     return m_arcList;
   }
+  //! scores of the last phrase only, recomputed if not kept during search
+  const ScoreComponentCollection& GetCurrScoreBreakdown() const;
+
+  //! whether the score breakdown can be asked for yet
+  bool HasScoreBreakdown() const;
+
   const ScoreComponentCollection& GetScoreBreakdown() const {
     if (!m_scoreBreakdown) {
       m_scoreBreakdown.reset(new ScoreComponentCollection);
-      m_scoreBreakdown->PlusEquals(m_currScoreBreakdown);
+      m_scoreBreakdown->PlusEquals(GetCurrScoreBreakdown());
       if (m_prevHypo) {
         m_scoreBreakdown->PlusEquals(m_prevHypo->GetScoreBreakdown());
       }
@@ -20,6 +20,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
 #include <algorithm>
+#include <cmath>
 #include <set>
 #include <queue>
 #include "HypothesisStackNormal.h"
@@ -38,6 +39,8 @@ HypothesisStackNormal::HypothesisStackNormal(Manager& manager) :
   m_nBestIsEnabled = manager.options()->nbest.enabled;
   m_bestScore = -std::numeric_limits<float>::infinity();
   m_worstScore = -std::numeric_limits<float>::infinity();
+  m_adaptivePruning = false;
+  m_minAdaptiveStackSize = 0;
 }
 
 /** remove all hypotheses from the collection */
@@ -226,6 +229,57 @@ void HypothesisStackNormal::PruneToSize(size_t newSize)
   }
 }
 
+float HypothesisStackNormal::GetFlatness() const
+{
+  if (m_hypos.size() < 2) return 0;
+
+  // entropy of p_i = exp(s_i - best) / Z, computed relative to the best
+  // score so that nothing overflows
+  float sum = 0, weighted = 0;
+  for (const_iterator iter = m_hypos.begin(); iter != m_hypos.end(); ++iter) {
+    float diff = (*iter)->GetFutureScore() - m_bestScore;
+    float p = exp(diff);
+    sum += p;
+    weighted += p * diff;
+  }
+  float entropy = log(sum) - weighted / sum;
+
+  // the stack may hold more hypotheses than it will keep (lazy pruning)
+  size_t size = m_hypos.size();
+  if (m_maxHypoStackSize && size > m_maxHypoStackSize) size = m_maxHypoStackSize;
+  if (size < 2) return 1;
+  float flatness = (exp(entropy) - 1) / (size - 1);
+  return std::max(0.0f, std::min(1.0f, flatness));
+}
+
+void HypothesisStackNormal::Prune()
+{
+  if (!m_adaptivePruning) {
+    PruneToSize(m_maxHypoStackSize);
+    return;
+  }
+
+  float flatness = GetFlatness();
+  size_t newSize = m_maxHypoStackSize;
+  if (newSize > m_minAdaptiveStackSize) {
+    newSize = m_minAdaptiveStackSize
+              + static_cast<size_t>(flatness * (newSize - m_minAdaptiveStackSize) + 0.5f);
+  }
+
+  // the narrower beam is applied by not keeping more hypotheses than
+  // there are within it, they are the best ones anyway
+  float threshold = m_bestScore + m_beamWidth * (0.5f + 0.5f * flatness);
+  size_t withinBeam = 0;
+  for (const_iterator iter = m_hypos.begin(); iter != m_hypos.end(); ++iter) {
+    if ((*iter)->GetFutureScore() > threshold) ++withinBeam;
+  }
+  withinBeam = std::max(withinBeam, size_t(1));
+  if (newSize == 0 || withinBeam < newSize) newSize = withinBeam;
+
+  VERBOSE(3,", adaptive pruning: flatness " << flatness << ", size " << newSize);
+  PruneToSize(newSize);
+}
+
 const Hypothesis *HypothesisStackNormal::GetBestHypothesis() const
 {
   if (!m_hypos.empty()) {
@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <limits>
 #include <set>
+#include <boost/unordered_map.hpp>
 #include "Hypothesis.h"
 #include "HypothesisStack.h"
 #include "Bitmap.h"
@@ -42,10 +43,12 @@ public:
 protected:
   float m_bestScore; /**< score of the best hypothesis in collection */
   float m_worstScore; /**< score of the worse hypothesis in collection */
-  std::map< WordsBitmapID, float > m_diversityWorstScore; /**< score of worst hypothesis for particular source word coverage */
+  boost::unordered_map< WordsBitmapID, float > m_diversityWorstScore; /**< score of worst hypothesis for particular source word coverage */
   float m_beamWidth; /**< minimum score due to threashold pruning */
   size_t m_maxHypoStackSize; /**< maximum number of hypothesis allowed in this stack */
   size_t m_minHypoStackDiversity; /**< minimum number of hypothesis with different source word coverage */
+  bool m_adaptivePruning; /**< scale stack size and beam by the flatness of the scores */
+  size_t m_minAdaptiveStackSize; /**< smallest stack size with adaptive pruning */
   bool m_nBestIsEnabled; /**< flag to determine whether to keep track of old arcs */
 
   /** add hypothesis to stack. Prune if necessary.
@@ -62,9 +65,10 @@ protected:
 
 public:
   float GetWorstScoreForBitmap( WordsBitmapID id ) {
-    if (m_diversityWorstScore.find( id ) == m_diversityWorstScore.end())
+    boost::unordered_map< WordsBitmapID, float >::const_iterator iter = m_diversityWorstScore.find( id );
+    if (iter == m_diversityWorstScore.end())
       return -std::numeric_limits<float>::infinity();
-    return m_diversityWorstScore[ id ];
+    return iter->second;
   }
   virtual float GetWorstScoreForBitmap( const Bitmap &coverage ) {
     return GetWorstScoreForBitmap( coverage.GetID() );
@@ -91,6 +95,15 @@ public:
     m_minHypoStackDiversity = minHypoStackDiversity;
   }
 
+  /** scale the size of the stack between minHypoStackSize and the maximum
+   * stack size, and the beam between half and all of the beam width,
+   * depending on how flat the scores in the stack are (see Prune())
+   */
+  inline void SetAdaptivePruning(size_t minHypoStackSize) {
+    m_adaptivePruning = true;
+    m_minAdaptiveStackSize = minHypoStackSize;
+  }
+
   /** set beam threshold, hypotheses in the stack must not be worse than
    * this factor times the best score to be allowed in the stack
    * \param beamThreshold minimum factor (typical number: 0.03)
@@ -115,6 +128,19 @@ public:
    * \param newSize maximum size */
   void PruneToSize(size_t newSize);
 
+  /** pruning before the stack is expanded.
+   * With static pruning, this is PruneToSize() to the maximum stack size.
+   * With adaptive pruning, the stack is pruned to a size and beam that
+   * grow with the flatness of the scores in the stack: the perplexity of
+   * the distribution over its hypotheses, relative to the number of
+   * hypotheses. A stack with one clearly best hypothesis keeps few, one
+   * with many similar scores keeps many. */
+  void Prune();
+
+  /** flatness of the scores in the stack, from 0 (all probability mass on
+   * the best hypothesis) to 1 (all hypotheses score the same) */
+  float GetFlatness() const;
+
   //! return the hypothesis with best score. Used to get the translated at end of decoding
   const Hypothesis *GetBestHypothesis() const;
   //! return all hypothesis, sorted by descending score. Used in creation of N best list
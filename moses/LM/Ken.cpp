@@ -35,6 +35,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "util/string_stream.hh"
 
 #include "Ken.h"
+#include "KenCache.h"
 #include "Base.h"
 #include "moses/FF/FFState.h"
 #include "moses/TypeDef.h"
@@ -121,6 +122,7 @@ template <class Model> LanguageModelKen<Model>::LanguageModelKen(const std::stri
 template <class Model> LanguageModelKen<Model>::LanguageModelKen(const LanguageModelKen<Model> &copy_from)
   :LanguageModel(copy_from.GetArgLine()),
    m_ngram(copy_from.m_ngram),
+   m_cache(copy_from.m_cache),
 // TODO: don't copy this.
    m_beginSentenceFactor(copy_from.m_beginSentenceFactor),
    m_factorType(copy_from.m_factorType),
@@ -206,26 +208,117 @@ template <class Model> FFState *LanguageModelKen<Model>::EvaluateWhenApplied(con
   typename Model::State aux_state;
   typename Model::State *state0 = &ret->state, *state1 = &aux_state;
 
-  float score = m_ngram->Score(in_state, TranslateID(hypo.GetWord(position)), *state0);
+  std::size_t hits = 0;
+  float score = CachedScore(in_state, TranslateID(hypo.GetWord(position)), *state0, hits);
   ++position;
   for (; position < adjust_end; ++position) {
-    score += m_ngram->Score(*state0, TranslateID(hypo.GetWord(position)), *state1);
+    score += CachedScore(*state0, TranslateID(hypo.GetWord(position)), *state1, hits);
     std::swap(state0, state1);
   }
+  if (m_cache) m_cache->Count(hits, adjust_end - begin);
+
+  FinishEvaluation(hypo, *state0, score, ret->state, out);
+  return ret.release();
+}
+
+/* The first words of all hypotheses are scored in rounds, word i of every
+ * hypothesis in round i: the hash table entries of a round are prefetched
+ * for all hypotheses before any of them is looked up, so the cache misses
+ * overlap instead of following each other. Queries found in the cache
+ * are neither prefetched nor looked up.
+ */
+template <class Model> void LanguageModelKen<Model>::EvaluateBatchWhenApplied(const std::vector<const Hypothesis*> &hypos, const std::vector<const FFState*> &prev_states, const std::vector<ScoreComponentCollection*> &accumulators, std::vector<const FFState*> &states) const
+{
+  const std::size_t size = hypos.size();
+  std::vector<typename Model::State> current(size), next(size);
+  std::vector<std::size_t> rounds(size);
+  std::vector<float> scores(size, 0.0);
+  std::vector<bool> cached(size);
+  std::size_t maxRounds = 0, hits = 0, lookups = 0;
+  for (std::size_t h = 0; h < size; ++h) {
+    current[h] = static_cast<const KenLMState&>(*prev_states[h]).state;
+    const Hypothesis &hypo = *hypos[h];
+    if (hypo.GetCurrTargetLength()) {
+      const std::size_t begin = hypo.GetCurrTargetWordsRange().GetStartPos();
+      const std::size_t end = hypo.GetCurrTargetWordsRange().GetEndPos() + 1;
+      // like EvaluateWhenApplied(), score at least the first word
+      const std::size_t firstWords = std::max<std::size_t>(m_ngram->Order() - 1, 1);
+      rounds[h] = std::min(end, begin + firstWords) - begin;
+      maxRounds = std::max(maxRounds, rounds[h]);
+    }
+  }
+
+  for (std::size_t round = 0; round < maxRounds; ++round) {
+    for (std::size_t h = 0; h < size; ++h) {
+      if (round >= rounds[h]) continue;
+      const Hypothesis &hypo = *hypos[h];
+      lm::WordIndex word = TranslateID(hypo.GetWord(hypo.GetCurrTargetWordsRange().GetStartPos() + round));
+      float prob;
+      cached[h] = m_cache && m_cache->Find(current[h], word, prob, next[h]);
+      if (cached[h]) {
+        scores[h] += prob;
+        current[h] = next[h];
+        ++hits;
+      } else {
+        m_ngram->Prefetch(current[h], word);
+      }
+      ++lookups;
+    }
+    for (std::size_t h = 0; h < size; ++h) {
+      if (round >= rounds[h] || cached[h]) continue;
+      const Hypothesis &hypo = *hypos[h];
+      lm::WordIndex word = TranslateID(hypo.GetWord(hypo.GetCurrTargetWordsRange().GetStartPos() + round));
+      float prob = m_ngram->Score(current[h], word, next[h]);
+      if (m_cache) m_cache->Insert(current[h], word, prob, next[h]);
+      scores[h] += prob;
+      current[h] = next[h];
+    }
+  }
+  if (m_cache) m_cache->Count(hits, lookups);
+
+  for (std::size_t h = 0; h < size; ++h) {
+    KenLMState *ret = new KenLMState();
+    states[h] = ret;
+    if (rounds[h]) {
+      FinishEvaluation(*hypos[h], current[h], scores[h], ret->state, accumulators[h]);
+    } else {
+      ret->state = current[h];
+    }
+  }
+}
+
+template <class Model> float LanguageModelKen<Model>::CachedScore(const typename Model::State &in_state, lm::WordIndex word, typename Model::State &out_state, std::size_t &hits) const
+{
+  if (!m_cache) return m_ngram->Score(in_state, word, out_state);
+  float prob;
+  if (m_cache->Find(in_state, word, prob, out_state)) {
+    ++hits;
+    return prob;
+  }
+  prob = m_ngram->Score(in_state, word, out_state);
+  m_cache->Insert(in_state, word, prob, out_state);
+  return prob;
+}
+
+template <class Model> void LanguageModelKen<Model>::FinishEvaluation(const Hypothesis &hypo, const typename Model::State &last, float score, typename Model::State &out_state, ScoreComponentCollection *out) const
+{
+  const std::size_t begin = hypo.GetCurrTargetWordsRange().GetStartPos();
+  const std::size_t end = hypo.GetCurrTargetWordsRange().GetEndPos() + 1;
+  const std::size_t adjust_end = std::min(end, begin + m_ngram->Order() - 1);
 
   if (hypo.IsSourceCompleted()) {
     // Score end of sentence.
     std::vector<lm::WordIndex> indices(m_ngram->Order() - 1);
-    const lm::WordIndex *last = LastIDs(hypo, &indices.front());
-    score += m_ngram->FullScoreForgotState(&indices.front(), last, m_ngram->GetVocabulary().EndSentence(), ret->state).prob;
+    const lm::WordIndex *last_id = LastIDs(hypo, &indices.front());
+    score += m_ngram->FullScoreForgotState(&indices.front(), last_id, m_ngram->GetVocabulary().EndSentence(), out_state).prob;
   } else if (adjust_end < end) {
     // Get state after adding a long phrase.
     std::vector<lm::WordIndex> indices(m_ngram->Order() - 1);
-    const lm::WordIndex *last = LastIDs(hypo, &indices.front());
-    m_ngram->GetState(&indices.front(), last, ret->state);
-  } else if (state0 != &ret->state) {
+    const lm::WordIndex *last_id = LastIDs(hypo, &indices.front());
+    m_ngram->GetState(&indices.front(), last_id, out_state);
+  } else if (&last != &out_state) {
     // Short enough phrase that we can just reuse the state.
-    ret->state = *state0;
+    out_state = last;
   }
 
   score = TransformLMScore(score);
@@ -238,8 +331,6 @@ template <class Model> FFState *LanguageModelKen<Model>::EvaluateWhenApplied(con
   } else {
     out->PlusEquals(this, score);
   }
-
-  return ret.release();
 }
 
 class LanguageModelChartStateKenLM : public FFState
@@ -405,6 +496,33 @@ bool LanguageModelKen<Model>::IsUseable(const FactorMask &mask) const
   return ret;
 }
 
+template <class Model>
+void LanguageModelKen<Model>::SetParameter(const std::string& key, const std::string& value)
+{
+  if (key == "cache-mb") {
+    std::size_t megabytes = Scan<std::size_t>(value);
+    if (megabytes) {
+      m_cache.reset(new KenLMCache(megabytes << 20));
+    } else {
+      m_cache.reset();
+    }
+  } else {
+    LanguageModel::SetParameter(key, value);
+  }
+}
+
+template <class Model>
+void LanguageModelKen<Model>::CleanUpAfterSentenceProcessing(const InputType& source)
+{
+  if (m_cache) {
+    uint64_t lookups = m_cache->GetLookups();
+    uint64_t hits = m_cache->GetHits();
+    VERBOSE(1, "Line " << source.GetTranslationId() << ": " << GetScoreProducerDescription()
+            << " cache: " << hits << " of " << lookups << " lookups hit ("
+            << (lookups ? 100.0 * hits / lookups : 0.0) << "%) since start" << endl);
+  }
+}
+
 
 /* Instantiate LanguageModelKen here.  Tells the compiler to generate code
  * for the instantiations' non-inline member functions in this file.
@@ -38,6 +38,7 @@ namespace Moses
 
 //class LanguageModel;
 class FFState;
+class KenLMCache;
 
 LanguageModel *ConstructKenLM(const std::string &line);
 
@@ -58,6 +59,8 @@ public:
 
   virtual FFState *EvaluateWhenApplied(const Hypothesis &hypo, const FFState *ps, ScoreComponentCollection *out) const;
 
+  virtual void EvaluateBatchWhenApplied(const std::vector<const Hypothesis*> &hypos, const std::vector<const FFState*> &prev_states, const std::vector<ScoreComponentCollection*> &accumulators, std::vector<const FFState*> &states) const;
+
   virtual FFState *EvaluateWhenApplied(const ChartHypothesis& cur_hypo, int featureID, ScoreComponentCollection *accumulator) const;
 
   virtual FFState *EvaluateWhenApplied(const Syntax::SHyperedge& hyperedge, int featureID, ScoreComponentCollection *accumulator) const;
@@ -67,9 +70,16 @@ public:
 
   virtual bool IsUseable(const FactorMask &mask) const;
 
+  virtual void SetParameter(const std::string& key, const std::string& value);
+
 protected:
+  virtual void CleanUpAfterSentenceProcessing(const InputType& source);
+
   boost::shared_ptr<Model> m_ngram;
 
+  //! queries shared across sentences and threads, if cache-mb is set
+  boost::shared_ptr<KenLMCache> m_cache;
+
   const Factor *m_beginSentenceFactor;
 
   FactorType m_factorType;
@@ -86,6 +96,13 @@ protected:
 private:
   LanguageModelKen(const LanguageModelKen<Model> &copy_from);
 
+  // Score one word, going through the cache if there is one.
+  float CachedScore(const typename Model::State &in_state, lm::WordIndex word, typename Model::State &out_state, std::size_t &hits) const;
+
+  // Score the rest of a hypothesis after its first words (the end of
+  // sentence, or the state after a long phrase) and add the total.
+  void FinishEvaluation(const Hypothesis &hypo, const typename Model::State &last, float score, typename Model::State &out_state, ScoreComponentCollection *out) const;
+
   // Convert last words of hypothesis into vocab ids, returning an end pointer.
   lm::WordIndex *LastIDs(const Hypothesis &hypo, lm::WordIndex *indices) const {
     lm::WordIndex *index = indices;
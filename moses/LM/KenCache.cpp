@@ -0,0 +1,116 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <cstring>
+
+#include "KenCache.h"
+
+namespace Moses
+{
+
+KenLMCache::KenLMCache(std::size_t bytes)
+{
+  std::size_t slots = 1;
+  while (2 * slots * sizeof(Slot) <= bytes) slots *= 2;
+  m_mask = slots - 1;
+  m_slots = new Slot[slots];
+  for (std::size_t i = 0; i < slots; ++i) {
+    m_slots[i].seq.store(0, boost::memory_order_relaxed);
+  }
+  for (std::size_t i = 0; i < kCounterStripes; ++i) {
+    m_counters[i].hits.store(0, boost::memory_order_relaxed);
+    m_counters[i].lookups.store(0, boost::memory_order_relaxed);
+  }
+}
+
+KenLMCache::~KenLMCache()
+{
+  delete [] m_slots;
+}
+
+bool KenLMCache::Find(const lm::ngram::State &in_state, lm::WordIndex word,
+                      float &prob, lm::ngram::State &out_state) const
+{
+  const Slot &slot = m_slots[Index(in_state, word)];
+  uint32_t seq = slot.seq.load(boost::memory_order_acquire);
+  if (seq == 0 || (seq & 1)) return false;
+
+  // copy, then check that no writer got in between
+  Entry entry;
+  std::memcpy(&entry, &slot.entry, sizeof(Entry));
+  boost::atomic_thread_fence(boost::memory_order_acquire);
+  if (slot.seq.load(boost::memory_order_relaxed) != seq) return false;
+
+  if (entry.word != word || !(entry.inState == in_state)) return false;
+  prob = entry.prob;
+  out_state = entry.outState;
+  return true;
+}
+
+void KenLMCache::Insert(const lm::ngram::State &in_state, lm::WordIndex word,
+                        float prob, const lm::ngram::State &out_state)
+{
+  Slot &slot = m_slots[Index(in_state, word)];
+  uint32_t seq = slot.seq.load(boost::memory_order_relaxed);
+  if (seq & 1) return;
+  if (!slot.seq.compare_exchange_strong(seq, seq + 1, boost::memory_order_acquire,
+                                        boost::memory_order_relaxed)) {
+    return;
+  }
+  boost::atomic_thread_fence(boost::memory_order_release);
+
+  slot.entry.inState = in_state;
+  slot.entry.word = word;
+  slot.entry.prob = prob;
+  slot.entry.outState = out_state;
+
+  // wraps around to 0 after 2^31 writes to the slot, which only reads as empty
+  slot.seq.store(seq + 2, boost::memory_order_release);
+}
+
+void KenLMCache::Count(std::size_t hits, std::size_t lookups)
+{
+  // threads have their own stacks, so the address of a local variable is
+  // a cheap way to spread them over the stripes
+  std::size_t stripe = (reinterpret_cast<std::size_t>(&hits) >> 12) % kCounterStripes;
+  m_counters[stripe].hits.fetch_add(hits, boost::memory_order_relaxed);
+  m_counters[stripe].lookups.fetch_add(lookups, boost::memory_order_relaxed);
+}
+
+uint64_t KenLMCache::GetHits() const
+{
+  uint64_t ret = 0;
+  for (std::size_t i = 0; i < kCounterStripes; ++i) {
+    ret += m_counters[i].hits.load(boost::memory_order_relaxed);
+  }
+  return ret;
+}
+
+uint64_t KenLMCache::GetLookups() const
+{
+  uint64_t ret = 0;
+  for (std::size_t i = 0; i < kCounterStripes; ++i) {
+    ret += m_counters[i].lookups.load(boost::memory_order_relaxed);
+  }
+  return ret;
+}
+
+}
@@ -0,0 +1,106 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_LM_KenCache_h
+#define moses_LM_KenCache_h
+
+#include <cstddef>
+
+#include <boost/atomic.hpp>
+#include <stdint.h>
+
+#include "lm/state.hh"
+#include "lm/word_index.hh"
+
+namespace Moses
+{
+
+/** Cache of KenLM queries, (state, word) -> (probability, new state), that
+ * is shared by all threads and kept across sentences.
+ *
+ * The cache is direct-mapped: a query can only be kept in one slot, and
+ * inserting overwrites whatever was there, so eviction needs neither
+ * bookkeeping nor a lock. Each slot has a sequence number that is odd while
+ * the slot is being written. A reader that sees a write in progress counts
+ * a miss, a writer that finds a slot being written skips the insert: no
+ * thread ever waits for another.
+ */
+class KenLMCache
+{
+public:
+  //! a cache of (a power of 2 number of slots in) about this many bytes
+  explicit KenLMCache(std::size_t bytes);
+  ~KenLMCache();
+
+  bool Find(const lm::ngram::State &in_state, lm::WordIndex word,
+            float &prob, lm::ngram::State &out_state) const;
+
+  void Insert(const lm::ngram::State &in_state, lm::WordIndex word,
+              float prob, const lm::ngram::State &out_state);
+
+  //! add the hits and lookups of a caller to the counters
+  void Count(std::size_t hits, std::size_t lookups);
+
+  uint64_t GetHits() const;
+  uint64_t GetLookups() const;
+
+  std::size_t GetNumSlots() const {
+    return m_mask + 1;
+  }
+
+private:
+  struct Entry {
+    lm::ngram::State inState;
+    lm::WordIndex word;
+    float prob;
+    lm::ngram::State outState;
+  };
+
+  struct Slot {
+    boost::atomic<uint32_t> seq; //! 0: empty, odd: being written
+    Entry entry;
+  };
+
+  // counters are striped over cache lines, so threads don't all update
+  // the same line
+  static const std::size_t kCounterStripes = 16;
+  struct Counters {
+    boost::atomic<uint64_t> hits;
+    boost::atomic<uint64_t> lookups;
+    char padding[64];
+  };
+
+  std::size_t Index(const lm::ngram::State &in_state, lm::WordIndex word) const {
+    return lm::ngram::hash_value(in_state, word) & m_mask;
+  }
+
+  Slot *m_slots;
+  std::size_t m_mask;
+  Counters m_counters[kCounterStripes];
+
+  // no copying
+  KenLMCache(const KenLMCache &);
+  KenLMCache &operator=(const KenLMCache &);
+};
+
+}
+
+#endif
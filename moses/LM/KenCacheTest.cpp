@@ -0,0 +1,122 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#define BOOST_TEST_MODULE KenCacheTest
+#include <boost/test/unit_test.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+
+#include "lm/state.hh"
+#include "moses/LM/KenCache.h"
+
+using namespace Moses;
+
+namespace
+{
+
+lm::ngram::State MakeState(lm::WordIndex first, unsigned char length)
+{
+  lm::ngram::State state;
+  state.length = length;
+  for (unsigned char i = 0; i < length; ++i) {
+    state.words[i] = first + i;
+    state.backoff[i] = -0.5f * i;
+  }
+  return state;
+}
+
+// what the "model" returns, so that readers can check any entry they find
+float Prob(lm::WordIndex first, lm::WordIndex word)
+{
+  return -0.25f * ((first + word) % 97);
+}
+
+void Query(KenLMCache &cache, size_t seed, size_t queries, bool &ok)
+{
+  size_t state = seed;
+  for (size_t i = 0; i < queries; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    lm::WordIndex first = (state >> 33) % 500;
+    lm::WordIndex word = (state >> 20) % 50;
+    lm::ngram::State in = MakeState(first, 2), out;
+    float prob;
+    if (cache.Find(in, word, prob, out)) {
+      if (prob != Prob(first, word) || !(out == MakeState(word, 3))) ok = false;
+    } else {
+      cache.Insert(in, word, Prob(first, word), MakeState(word, 3));
+    }
+  }
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(find_inserted)
+{
+  KenLMCache cache(1 << 20);
+  lm::ngram::State in = MakeState(7, 2), out;
+  float prob;
+  BOOST_CHECK(!cache.Find(in, 3, prob, out));
+
+  cache.Insert(in, 3, -1.5f, MakeState(3, 3));
+  BOOST_REQUIRE(cache.Find(in, 3, prob, out));
+  BOOST_CHECK_EQUAL(prob, -1.5f);
+  BOOST_CHECK(out == MakeState(3, 3));
+  BOOST_CHECK_EQUAL(out.backoff[2], -1.0f);
+
+  BOOST_CHECK(!cache.Find(in, 4, prob, out));
+  BOOST_CHECK(!cache.Find(MakeState(7, 1), 3, prob, out));
+}
+
+BOOST_AUTO_TEST_CASE(bounded)
+{
+  // a tiny cache keeps only some of the entries, but never a wrong one
+  KenLMCache cache(4096);
+  BOOST_CHECK_LE(cache.GetNumSlots() * 64, 4096);
+  bool ok = true;
+  Query(cache, 1, 100000, ok);
+  BOOST_CHECK(ok);
+}
+
+BOOST_AUTO_TEST_CASE(counters)
+{
+  KenLMCache cache(4096);
+  cache.Count(3, 10);
+  cache.Count(1, 5);
+  BOOST_CHECK_EQUAL(cache.GetHits(), 4);
+  BOOST_CHECK_EQUAL(cache.GetLookups(), 15);
+}
+
+#ifdef WITH_THREADS
+BOOST_AUTO_TEST_CASE(concurrent)
+{
+  KenLMCache cache(1 << 16);
+  const size_t threads = 4;
+  bool ok[threads];
+  boost::thread_group group;
+  for (size_t t = 0; t < threads; ++t) {
+    ok[t] = true;
+    group.create_thread(boost::bind(&Query, boost::ref(cache), t + 1, 200000, boost::ref(ok[t])));
+  }
+  group.join_all();
+  for (size_t t = 0; t < threads; ++t) BOOST_CHECK(ok[t]);
+}
+#endif
@@ -0,0 +1,98 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#define BOOST_TEST_MODULE KenTest
+#include <boost/test/unit_test.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "moses/FF/FFState.h"
+#include "moses/LM/Ken.h"
+#include "moses/MockHypothesis.h"
+#include "moses/ScoreComponentCollection.h"
+#include "moses/Util.h"
+
+using namespace Moses;
+using namespace MosesTest;
+using namespace std;
+
+/* KenLM loads nothing below a bigram model, which is the case where only
+ * the first word of each phrase is scored word by word: the batch has one
+ * round, and everything else is left to FinishEvaluation().
+ */
+BOOST_AUTO_TEST_CASE(batch_matches_single_bigram)
+{
+  const string path = boost::unit_test::framework::master_test_suite().argv[1];
+  boost::scoped_ptr<LanguageModel> lm(ConstructKenLM("KENLM factor=0 path=" + path));
+  // gives the model its place in the score vectors
+  FeatureFunction::Register(lm.get());
+
+  vector<string> targets;
+  vector<Alignment> alignments;
+  targets.push_back("i");
+  alignments.push_back(Alignment(0,0));
+  targets.push_back("do not");
+  alignments.push_back(Alignment(3,3));
+  targets.push_back("know");
+  alignments.push_back(Alignment(1,2));
+  targets.push_back(".");
+  alignments.push_back(Alignment(4,4));
+  MockHypothesisGuard guard("je ne sais pas .", alignments, targets);
+
+  vector<const Hypothesis*> hypos;
+  for (const Hypothesis *hypo = *guard; hypo->GetPrevHypo(); hypo = hypo->GetPrevHypo()) {
+    hypos.push_back(hypo);
+  }
+  reverse(hypos.begin(), hypos.end());
+  BOOST_REQUIRE_EQUAL(hypos.size(), targets.size());
+
+  // one hypothesis after the other, as the search does without batches
+  vector<const FFState*> prevStates, singleStates;
+  vector<ScoreComponentCollection> singleScores(hypos.size());
+  const FFState *state = lm->EmptyHypothesisState(hypos[0]->GetInput());
+  for (size_t h = 0; h < hypos.size(); ++h) {
+    prevStates.push_back(state);
+    state = lm->EvaluateWhenApplied(*hypos[h], state, &singleScores[h]);
+    singleStates.push_back(state);
+  }
+
+  vector<ScoreComponentCollection> batchScores(hypos.size());
+  vector<ScoreComponentCollection*> accumulators;
+  for (size_t h = 0; h < hypos.size(); ++h) {
+    accumulators.push_back(&batchScores[h]);
+  }
+  vector<const FFState*> batchStates(hypos.size());
+  lm->EvaluateBatchWhenApplied(hypos, prevStates, accumulators, batchStates);
+
+  for (size_t h = 0; h < hypos.size(); ++h) {
+    float single = singleScores[h].GetScoreForProducer(lm.get());
+    float batch = batchScores[h].GetScoreForProducer(lm.get());
+    // every hypothesis adds words, so each of them has a score
+    BOOST_CHECK(single != 0.0f);
+    BOOST_CHECK_CLOSE(single, batch, 0.001);
+    BOOST_CHECK(*singleStates[h] == *batchStates[h]);
+  }
+
+  delete prevStates[0];
+  RemoveAllInColl(singleStates);
+  RemoveAllInColl(batchStates);
+}
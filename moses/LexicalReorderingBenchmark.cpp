@@ -0,0 +1,169 @@
+// Lexicalized reordering lookups as made when collecting translation options: for each
+// input sentence, the (source, target) pairs of all its spans that are in a
+// text phrase table (the first ttable-limit targets of each source phrase)
+// are looked up in a reordering table, once one pair after the other with
+// GetScore(), as the decoder used to, and once with GetScoreBatch() per
+// sentence. The scores of both must be the same.
+//
+// Usage: LexicalReorderingBenchmark <reordering table> <phrase table> <input>
+//          [max-phrase-length [ttable-limit]]
+// The reordering table is loaded like by the decoder: a compact (.minlexr,
+// if built --with-cmph), binary (.binlexr.*) or text table.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/scoped_ptr.hpp>
+
+#include "moses/FF/LexicalReordering/LexicalReorderingTable.h"
+#include "moses/InputFileStream.h"
+#include "moses/Phrase.h"
+#include "moses/Util.h"
+#include "util/usage.hh"
+
+namespace Moses
+{
+namespace
+{
+
+typedef std::map<std::string, std::vector<Phrase> > PhraseTable;
+
+Phrase MakePhrase(FactorDirection direction, const std::string &str)
+{
+  Phrase phrase;
+  phrase.CreateFromString(direction, std::vector<FactorType>(1, 0), str, NULL);
+  return phrase;
+}
+
+void LoadPhraseTable(const std::string &path, size_t limit, PhraseTable &table)
+{
+  InputFileStream in(path);
+  std::string line;
+  while (getline(in, line)) {
+    std::vector<std::string> fields = TokenizeMultiCharSeparator(line, "|||");
+    if (fields.size() < 2) continue;
+    std::vector<Phrase> &targets = table[Trim(fields[0])];
+    if (targets.size() < limit) targets.push_back(MakePhrase(Output, Trim(fields[1])));
+  }
+}
+
+//! all pairs of a sentence, span by span, with the source phrases they point to
+struct SentencePairs {
+  std::vector<Phrase> sources;
+  std::vector<std::pair<size_t, const Phrase*> > pairs;
+};
+
+double LookUpSingle(LexicalReorderingTable &table, const std::vector<SentencePairs> &sentences,
+                    std::vector<std::vector<Scores> > &scores)
+{
+  const Phrase context(ARRAY_SIZE_INCR);
+  scores.assign(sentences.size(), std::vector<Scores>());
+  double start = util::WallTime();
+  for (size_t s = 0; s < sentences.size(); ++s) {
+    const SentencePairs &sentence = sentences[s];
+    for (size_t i = 0; i < sentence.pairs.size(); ++i) {
+      scores[s].push_back(table.GetScore(sentence.sources[sentence.pairs[i].first],
+                                         *sentence.pairs[i].second, context));
+    }
+  }
+  return util::WallTime() - start;
+}
+
+double LookUpBatch(LexicalReorderingTable &table, const std::vector<SentencePairs> &sentences,
+                   std::vector<std::vector<Scores> > &scores)
+{
+  scores.assign(sentences.size(), std::vector<Scores>());
+  double start = util::WallTime();
+  for (size_t s = 0; s < sentences.size(); ++s) {
+    const SentencePairs &sentence = sentences[s];
+    std::vector<LexicalReorderingTable::PhrasePair> pairs;
+    for (size_t i = 0; i < sentence.pairs.size(); ++i) {
+      pairs.push_back(std::make_pair(&sentence.sources[sentence.pairs[i].first],
+                                     sentence.pairs[i].second));
+    }
+    table.GetScoreBatch(pairs, scores[s]);
+  }
+  return util::WallTime() - start;
+}
+
+} // namespace
+} // namespace Moses
+
+int main(int argc, char *argv[])
+{
+  using namespace Moses;
+
+  if (argc < 4) {
+    std::cerr << "Usage: " << argv[0] << " <reordering table> <phrase table> <input>"
+              << " [max-phrase-length [ttable-limit]]" << std::endl;
+    return 1;
+  }
+  size_t maxLength = argc > 4 ? std::atoi(argv[4]) : 7;
+  size_t limit = argc > 5 ? std::atoi(argv[5]) : 20;
+
+  PhraseTable phraseTable;
+  LoadPhraseTable(argv[2], limit, phraseTable);
+
+  std::vector<SentencePairs> sentences;
+  std::ifstream input(argv[3]);
+  std::string line;
+  size_t numPairs = 0;
+  while (getline(input, line)) {
+    std::vector<std::string> words = Tokenize(line);
+    sentences.push_back(SentencePairs());
+    SentencePairs &sentence = sentences.back();
+    // the source phrases first, as pairs point into the vector
+    std::vector<const std::vector<Phrase>*> targets;
+    for (size_t start = 0; start < words.size(); ++start) {
+      std::string source;
+      for (size_t end = start; end < words.size() && end < start + maxLength; ++end) {
+        source += (end > start ? " " : "") + words[end];
+        PhraseTable::const_iterator it = phraseTable.find(source);
+        if (it == phraseTable.end()) continue;
+        sentence.sources.push_back(MakePhrase(Input, source));
+        targets.push_back(&it->second);
+      }
+    }
+    for (size_t i = 0; i < targets.size(); ++i) {
+      for (size_t j = 0; j < targets[i]->size(); ++j) {
+        sentence.pairs.push_back(std::make_pair(i, &(*targets[i])[j]));
+      }
+    }
+    numPairs += sentence.pairs.size();
+  }
+
+  double start = util::WallTime();
+  boost::scoped_ptr<LexicalReorderingTable> table(
+    LexicalReorderingTable::LoadAvailable(argv[1], std::vector<FactorType>(1, 0),
+                                          std::vector<FactorType>(1, 0),
+                                          std::vector<FactorType>()));
+  double load = util::WallTime() - start;
+
+  // an untimed pass first, so that both modes find the table in the page cache
+  std::vector<std::vector<Scores> > single, batch;
+  LookUpSingle(*table, sentences, single);
+  double singleTime = LookUpSingle(*table, sentences, single);
+  double batchTime = LookUpBatch(*table, sentences, batch);
+
+  size_t found = 0;
+  for (size_t s = 0; s < sentences.size(); ++s) {
+    if (single[s] != batch[s]) {
+      std::cerr << "Scores of sentence " << s << " differ" << std::endl;
+      return 1;
+    }
+    for (size_t i = 0; i < single[s].size(); ++i) found += !single[s][i].empty();
+  }
+
+  std::cout << "sentences=" << sentences.size()
+            << " pairs=" << numPairs
+            << " found=" << found
+            << " load=" << load << "s"
+            << " single=" << singleTime << "s"
+            << " batch=" << batchTime << "s"
+            << " speedup=" << singleTime / batchTime << std::endl;
+  return 0;
+}
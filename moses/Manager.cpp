@@ -69,6 +69,7 @@ Manager::Manager(ttasksptr const& ttask)
   : BaseManager(ttask)
   , interrupted_flag(0)
   , m_hypoId(0)
+  , m_searchDone(false)
 {
   boost::shared_ptr<InputType> source = ttask->GetSource();
   m_transOptColl = source->CreateTranslationOptionCollection(ttask);
@@ -145,6 +146,7 @@ void Manager::Decode()
   Timer searchTime;
   searchTime.start();
   m_search->Decode();
+  m_searchDone = true;
   VERBOSE(1, "Line " << m_source.GetTranslationId()
           << ": Search took " << searchTime << " seconds" << endl);
   IFVERBOSE(2) {
@@ -119,6 +119,7 @@ protected:
   size_t interrupted_flag;
   std::auto_ptr<SentenceStats> m_sentenceStats;
   int m_hypoId; //used to number the hypos as they are created.
+  bool m_searchDone; //!< Decode() has finished the search
 
   void GetConnectedGraph(
     std::map< int, bool >* pConnected,
@@ -156,6 +157,10 @@ public:
   const  TranslationOptionCollection* getSntTranslationOptions();
 
   void Decode();
+  //! whether Decode() has finished the search, so that only output is left
+  bool IsSearchDone() const {
+    return m_searchDone;
+  }
   const Hypothesis *GetBestHypothesis() const;
   const Hypothesis *GetActualBestHypothesis() const;
   void CalcNBest(size_t count, TrellisPathList &ret,bool onlyDistinct=0) const;
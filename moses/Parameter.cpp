@@ -87,6 +87,10 @@ Parameter::Parameter()
   AddParam(search_opts,"early-discarding-threshold", "edt", "threshold for constructing hypotheses based on estimate cost");
   AddParam(search_opts,"stack", "s", "maximum stack size for histogram pruning. 0 = unlimited stack size");
   AddParam(search_opts,"stack-diversity", "sd", "minimum number of hypothesis of each coverage in stack (default 0)");
+  AddParam(search_opts,"stack-pruning", "stack pruning policy: static (default) uses -stack and -beam-threshold for every stack, adaptive shrinks stack size and beam for stacks with peaked scores and grows them for stacks with flat scores");
+  AddParam(search_opts,"adaptive-stack-min", "smallest stack size with adaptive stack pruning (default stack/4)");
+  AddParam(search_opts,"adaptive-stack-max", "largest stack size with adaptive stack pruning (default 2*stack)");
+  AddParam(search_opts,"heuristic-early-stopping", "stop decoding once the best complete hypothesis scores at least as well as the best future score of every stack still to be expanded; future costs are estimates, not bounds, so this can change the output (default false)");
 
   // feature weight-related options
   AddParam(search_opts,"weight-file", "wf", "feature weights file. Do *not* put weights for 'core' features in here - they go in moses.ini");
@@ -107,8 +111,15 @@ Parameter::Parameter()
 
   // miscellaneous search options
   AddParam(search_opts,"disable-discarding", "dd", "disable hypothesis discarding"); // ??? memory management? UG
+  AddParam(search_opts,"sentence-arena", "allocate search-time objects (hypotheses, feature function states) from a per-sentence arena that is freed in one go at the end of the sentence");
+  AddParam(search_opts,"lazy-score-breakdown", "keep only the weighted score of hypotheses during search; score breakdowns of output hypotheses are recomputed by evaluating the feature functions again (default false)");
+  AddParam(search_opts,"eval-batch-size", "evaluate new hypotheses in batches of this size, so that feature functions like KenLM can overlap the table lookups of different hypotheses; output is unchanged, not used with early discarding (default 0 = one at a time)");
   AddParam(search_opts,"phrase-drop-allowed", "da", "if present, allow dropping of source words"); //da = drop any (word); see -du for comparison
   AddParam(search_opts,"threads","th", "number of threads to use in decoding (defaults to single-threaded)");
+  AddParam(search_opts,"threads-longest-first", "translate the longest queued sentences first (default false)");
+  AddParam(search_opts,"threads-subtask-min-length", "split translation option collection for inputs of at least this many words into sub-tasks that idle threads can take over (default 0 = never)");
+  AddParam(search_opts,"threads-stack-subtasks", "expand the hypotheses of each stack in this many sub-tasks that idle threads can take over; output is identical to sequential expansion (default 0 = sequential)");
+  AddParam(search_opts,"threads-chart-subtasks", "chart and syntax decoding: decode the cells of each span width (the vertices of each level of the input forest for tree/forest-to-string) in this many sub-tasks that idle threads can take over, each with its own rule lookup; output does not depend on the number of sub-tasks. Chart decoding falls back to sequential decoding for rule tables that need spans in the sequential order (default 0 = sequential)");
 
   // distortion options
   po::options_description disto_opts("Distortion options");
@@ -268,6 +279,7 @@ Parameter::Parameter()
   AddParam(misc_opts,"feature-name-overwrite", "Override feature name (NOT arguments). Eg. SRILM-->KENLM, PhraseDictionaryMemory-->PhraseDictionaryScope3");
 
   AddParam(misc_opts,"feature", "All the feature functions should be here");
+  AddParam(misc_opts,"snapshot", "Restore the loaded models from this file, which is (re)written once they are loaded if it is missing or out of date");
   AddParam(misc_opts,"context-string",
            "A (tokenized) string containing context words for context-sensitive translation.");
   AddParam(misc_opts,"context-weights", "A key-value map for context-sensitive translation.");
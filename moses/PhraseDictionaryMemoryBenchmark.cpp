@@ -0,0 +1,226 @@
+// Lookup benchmark for the in-memory rule trie of PhraseDictionaryMemory,
+// in its original form (hash maps in every node) and as a CompactRuleTrie.
+// The trie is filled with every n-gram of a synthetic corpus with a skewed
+// vocabulary, and every span of a set of synthetic sentences is looked up:
+//   map      walk the original trie span by span
+//   compact  walk the compact trie span by span
+//   batched  walk the compact trie in the order and batches of
+//            PhraseDictionaryMemory::GetTargetPhraseCollectionBatch(),
+//            prefetching the nodes of a batch before they are searched
+// The compact mode releases the original trie once it is copied, as the
+// phrase table does, so the RSS printed is that of the structure walked.
+//
+// Usage: PhraseDictionaryMemoryBenchmark map|compact [corpus sentences] [test sentences]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "moses/FactorCollection.h"
+#include "moses/TargetPhrase.h"
+#include "moses/TranslationModel/PhraseDictionaryNodeMemory.h"
+#include "moses/TranslationModel/RuleTable/CompactRuleTrie.h"
+#include "util/string_stream.hh"
+#include "util/usage.hh"
+
+namespace Moses
+{
+namespace
+{
+
+const size_t kVocabSize = 50000;
+const size_t kSentenceLength = 25;
+const size_t kMaxPhraseLength = 5;
+const size_t kBatchSize = 16;
+
+typedef std::vector<Word> Sentence;
+
+struct Counts {
+  Counts() : lookups(0), found(0), targetPhrases(0) {}
+  size_t lookups, found, targetPhrases;
+};
+
+// current, not peak, resident set size
+size_t RSSKb()
+{
+  size_t pages = 0, resident = 0;
+  FILE *statm = fopen("/proc/self/statm", "r");
+  if (statm) {
+    if (fscanf(statm, "%lu %lu", &pages, &resident) != 2) resident = 0;
+    fclose(statm);
+  }
+  return resident * 4;
+}
+
+std::vector<Word> MakeVocab()
+{
+  std::vector<Word> vocab(kVocabSize);
+  for (size_t i = 0; i < kVocabSize; ++i) {
+    util::StringStream str;
+    str << "w" << i;
+    vocab[i].SetFactor(0, FactorCollection::Instance().AddFactor(str.str()));
+  }
+  return vocab;
+}
+
+// frequent words are much more frequent than rare ones, as in text
+std::vector<Sentence> MakeSentences(const std::vector<Word> &vocab, size_t count, size_t seed)
+{
+  std::vector<Sentence> sentences(count);
+  size_t state = seed;
+  for (size_t s = 0; s < count; ++s) {
+    for (size_t i = 0; i < kSentenceLength; ++i) {
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+      size_t range = (state >> 33) % kVocabSize + 1;
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+      sentences[s].push_back(vocab[(state >> 33) % range]);
+    }
+  }
+  return sentences;
+}
+
+// every n-gram of the corpus becomes a rule, with up to three target phrases
+void Fill(PhraseDictionaryNodeMemory &root, const std::vector<Sentence> &corpus)
+{
+  for (size_t s = 0; s < corpus.size(); ++s) {
+    const Sentence &sentence = corpus[s];
+    for (size_t start = 0; start < sentence.size(); ++start) {
+      PhraseDictionaryNodeMemory *node = &root;
+      for (size_t end = start; end < sentence.size() && end < start + kMaxPhraseLength; ++end) {
+        node = node->GetOrCreateChild(sentence[end]);
+        TargetPhraseCollection::shared_ptr tpc = node->GetTargetPhraseCollection();
+        if (tpc->GetSize() < 3) {
+          tpc->Add(new TargetPhrase());
+        }
+      }
+    }
+  }
+}
+
+template <class Node>
+void Walk(const Node &root, const std::vector<Sentence> &sentences, Counts &counts)
+{
+  for (size_t s = 0; s < sentences.size(); ++s) {
+    const Sentence &sentence = sentences[s];
+    for (size_t start = 0; start < sentence.size(); ++start) {
+      const Node *node = &root;
+      for (size_t end = start; end < sentence.size() && end < start + kMaxPhraseLength; ++end) {
+        ++counts.lookups;
+        node = node->GetChild(sentence[end]);
+        if (node == NULL)
+          break;
+        ++counts.found;
+        counts.targetPhrases += node->GetTargetPhraseCollection()->GetSize();
+      }
+    }
+  }
+}
+
+// all phrases of length 1, then of length 2, ..., as the input paths of a
+// sentence are queued, in batches that are prefetched before they are searched
+void WalkBatched(const CompactRuleTrie::Node &root, const std::vector<Sentence> &sentences, Counts &counts)
+{
+  std::vector<const CompactRuleTrie::Node*> nodes;
+  const CompactRuleTrie::Node *children[kBatchSize];
+  for (size_t s = 0; s < sentences.size(); ++s) {
+    const Sentence &sentence = sentences[s];
+    // nodes[start] is the node of the phrase starting at start, one word shorter
+    nodes.assign(sentence.size(), &root);
+    for (size_t length = 1; length <= kMaxPhraseLength && length <= sentence.size(); ++length) {
+      size_t numStarts = sentence.size() - length + 1;
+      for (size_t begin = 0; begin < numStarts; begin += kBatchSize) {
+        size_t end = std::min(begin + kBatchSize, numStarts);
+        for (size_t start = begin; start < end; ++start) {
+          if (nodes[start])
+            nodes[start]->Prefetch();
+        }
+        for (size_t start = begin; start < end; ++start) {
+          const CompactRuleTrie::Node *&child = children[start - begin];
+          child = NULL;
+          if (nodes[start]) {
+            ++counts.lookups;
+            child = nodes[start]->GetChild(sentence[start + length - 1]);
+            if (child)
+              child->Prefetch();
+          }
+        }
+        for (size_t start = begin; start < end; ++start) {
+          const CompactRuleTrie::Node *child = children[start - begin];
+          if (child) {
+            ++counts.found;
+            counts.targetPhrases += child->GetTargetPhraseCollection()->GetSize();
+          }
+          nodes[start] = child;
+        }
+      }
+    }
+  }
+}
+
+void Report(const std::string &name, const Counts &counts, double seconds)
+{
+  std::cout << name
+            << " lookups=" << counts.lookups
+            << " found=" << counts.found
+            << " target_phrases=" << counts.targetPhrases
+            << " lookups/sec=" << counts.lookups / seconds << std::endl;
+}
+
+} // namespace
+} // namespace Moses
+
+int main(int argc, char *argv[])
+{
+  using namespace Moses;
+
+  if (argc < 2 || (std::string(argv[1]) != "map" && std::string(argv[1]) != "compact")) {
+    std::cerr << "Usage: " << argv[0] << " map|compact [corpus sentences] [test sentences]" << std::endl;
+    return 1;
+  }
+  bool compact = std::string(argv[1]) == "compact";
+  size_t corpusSize = argc > 2 ? std::atoi(argv[2]) : 200000;
+  size_t testSize = argc > 3 ? std::atoi(argv[3]) : 20000;
+
+  std::vector<Word> vocab = MakeVocab();
+  std::vector<Sentence> corpus = MakeSentences(vocab, corpusSize, 1);
+  std::vector<Sentence> test = MakeSentences(vocab, testSize, 2);
+  size_t baseRSS = RSSKb();
+
+  double start = util::WallTime();
+  PhraseDictionaryNodeMemory root;
+  Fill(root, corpus);
+  double loaded = util::WallTime();
+  std::cout << "load=" << loaded - start << "s";
+
+  CompactRuleTrie trie;
+  if (compact) {
+    trie.Build(root);
+    root = PhraseDictionaryNodeMemory();
+    std::cout << " compact=" << util::WallTime() - loaded << "s"
+              << " nodes=" << trie.GetNumNodes()
+              << " trie_kb=" << trie.GetMemoryUsage() / 1024;
+  }
+  std::cout << " rss_kb=" << RSSKb() - baseRSS
+            << " peak_rss_kb=" << util::RSSMax() / 1024 << std::endl;
+
+  if (compact) {
+    Counts counts;
+    double begin = util::WallTime();
+    Walk(trie.GetRootNode(), test, counts);
+    Report("compact", counts, util::WallTime() - begin);
+
+    Counts batched;
+    begin = util::WallTime();
+    WalkBatched(trie.GetRootNode(), test, batched);
+    Report("batched", batched, util::WallTime() - begin);
+  } else {
+    Counts counts;
+    double begin = util::WallTime();
+    Walk(root, test, counts);
+    Report("map", counts, util::WallTime() - begin);
+  }
+  return 0;
+}
@@ -156,19 +156,28 @@ int PrefixTreeMap::Read(const std::string& fileNameStem, int numVocs)
 
 
 void PrefixTreeMap::GetCandidates(const IPhrase& key, Candidates* cands)
+{
+  GetCandidates(FindCandidates(key), cands);
+}
+
+OFF_T PrefixTreeMap::FindCandidates(const IPhrase& key)
 {
   //check if key is valid
   if(key.empty() || key[0] >= m_Data.size() || !m_Data[key[0]]) {
-    return;
+    return InvalidOffT;
   }
   UTIL_THROW_IF2(m_Data[key[0]]->findKey(key[0]) >= m_Data[key[0]]->size(),
                  "Key not found: " << key[0]);
 
-  OFF_T candOffset = m_Data[key[0]]->find(key);
-  if(candOffset == InvalidOffT) {
+  return m_Data[key[0]]->find(key);
+}
+
+void PrefixTreeMap::GetCandidates(OFF_T offset, Candidates* cands)
+{
+  if(offset == InvalidOffT) {
     return;
   }
-  fSeek(m_FileTgt,candOffset);
+  fSeek(m_FileTgt,offset);
   cands->readBin(m_FileTgt);
 }
 
@@ -111,6 +111,11 @@ public:
   void GetCandidates(const IPhrase& key, Candidates* cands);
   void GetCandidates(const PPimp& p, Candidates* cands);
 
+  //! where the candidates of key are, InvalidOffT if it has none
+  OFF_T FindCandidates(const IPhrase& key);
+  //! the candidates at an offset returned by FindCandidates()
+  void GetCandidates(OFF_T offset, Candidates* cands);
+
   std::vector< std::string const * > ConvertPhrase(const IPhrase& p, unsigned int voc) const;
   IPhrase ConvertPhrase(const std::vector< std::string >& p, unsigned int voc) const;
   LabelId ConvertWord(const std::string& w, unsigned int voc) const;
@@ -27,7 +27,6 @@
 #include "StaticData.h"
 #include "Util.h"
 #include "Range.h"
-#include <boost/functional/hash.hpp>
 
 using namespace std;
 
@@ -40,9 +39,12 @@ RuleCube::RuleCube(const ChartTranslationOptions &transOpt,
                    const ChartCellCollection &allChartCells,
                    ChartManager &manager)
   : m_transOpt(transOpt)
+  , m_covered(transOpt.GetStackVec().size() + 1)
+  , m_neighbor(transOpt.GetStackVec().size() + 1, 0)
 {
   RuleCubeItem *item = new RuleCubeItem(transOpt, allChartCells);
-  m_covered.insert(item);
+  m_covered.Insert(&m_neighbor[0]);
+  m_items.push_back(item);
   if (StaticData::Instance().options()->cube.lazy_scoring) {
     item->EstimateScore();
   } else {
@@ -53,7 +55,7 @@ RuleCube::RuleCube(const ChartTranslationOptions &transOpt,
 
 RuleCube::~RuleCube()
 {
-  RemoveAllInColl(m_covered);
+  RemoveAllInColl(m_items);
 }
 
 RuleCubeItem *RuleCube::Pop(ChartManager &manager)
@@ -86,18 +88,26 @@ void RuleCube::CreateNeighbors(const RuleCubeItem &item, ChartManager &manager)
 void RuleCube::CreateNeighbor(const RuleCubeItem &item, int dimensionIndex,
                               ChartManager &manager)
 {
+  // look the neighbor up by its coordinates before creating it
+  const std::vector<HypothesisDimension> &hypoDims =
+    item.GetHypothesisDimensions();
+  m_neighbor[0] = item.GetTranslationDimension().GetPos();
+  for (size_t i = 0; i < hypoDims.size(); ++i) {
+    m_neighbor[i + 1] = hypoDims[i].GetPos();
+  }
+  ++m_neighbor[dimensionIndex + 1];
+  if (!m_covered.Insert(&m_neighbor[0]).second) {
+    return;  // already seen it
+  }
+
   RuleCubeItem *newItem = new RuleCubeItem(item, dimensionIndex);
-  std::pair<ItemSet::iterator, bool> result = m_covered.insert(newItem);
-  if (!result.second) {
-    delete newItem;  // already seen it
+  m_items.push_back(newItem);
+  if (StaticData::Instance().options()->cube.lazy_scoring) {
+    newItem->EstimateScore();
   } else {
-    if (StaticData::Instance().options()->cube.lazy_scoring) {
-      newItem->EstimateScore();
-    } else {
-      newItem->CreateHypothesis(m_transOpt, manager);
-    }
-    m_queue.push(newItem);
+    newItem->CreateHypothesis(m_transOpt, manager);
   }
+  m_queue.push(newItem);
 }
 
 std::ostream& operator<<(std::ostream &out, const RuleCube &obj)
@@ -21,12 +21,9 @@
 
 #pragma once
 
+#include "CubeCoordinateSet.h"
 #include "RuleCubeItem.h"
 
-#include <boost/functional/hash.hpp>
-#include <boost/unordered_set.hpp>
-#include <boost/version.hpp>
-
 #include "util/exception.hh"
 #include <queue>
 #include <set>
@@ -50,35 +47,6 @@ public:
   }
 };
 
-/** @todo what is this?
- */
-class RuleCubeItemHasher
-{
-public:
-  size_t operator()(const RuleCubeItem *p) const {
-    size_t seed = 0;
-    const std::vector<HypothesisDimension> &hypoDim = p->GetHypothesisDimensions();
-    const ChartTranslationOption *transOpt = p->GetTranslationDimension().GetTranslationOption().get();
-
-    boost::hash_combine(seed, hypoDim);
-    boost::hash_combine(seed, transOpt);
-
-    return seed;
-  }
-};
-
-/** @todo what is this?
- */
-class RuleCubeItemEqualityPred
-{
-public:
-  bool operator()(const RuleCubeItem *p, const RuleCubeItem *q) const {
-    bool ret = p->GetHypothesisDimensions() == q->GetHypothesisDimensions() &&
-               p->GetTranslationDimension() == q->GetTranslationDimension();
-    return ret;
-  }
-};
-
 /** @todo what is this?
  */
 class RuleCube
@@ -108,15 +76,10 @@ public:
   }
 
   size_t GetItemSetSize() const {
-    return m_covered.size();
+    return m_covered.GetSize();
   }
 
 private:
-  typedef boost::unordered_set<RuleCubeItem*,
-          RuleCubeItemHasher,
-          RuleCubeItemEqualityPred
-          > ItemSet;
-
   typedef std::priority_queue<RuleCubeItem*,
           std::vector<RuleCubeItem*>,
           RuleCubeItemScoreOrderer
@@ -129,7 +92,12 @@ private:
   void CreateNeighbor(const RuleCubeItem &, int, ChartManager &);
 
   const ChartTranslationOptions &m_transOpt;
-  ItemSet m_covered;
+  //! coordinates (translation position, hypothesis positions...) of the items
+  CubeCoordinateSet m_covered;
+  //! the items, in the order of m_covered
+  std::vector<RuleCubeItem*> m_items;
+  //! coordinates of the neighbour being created
+  std::vector<int> m_neighbor;
   Queue m_queue;
 };
 
@@ -21,6 +21,7 @@
 
 #include "StackVec.h"
 #include "ChartTranslationOptions.h"
+#include "SentenceArena.h"
 #include <vector>
 
 namespace Moses
@@ -49,6 +50,10 @@ public:
     return m_pos++;
   }
 
+  std::size_t GetPos() const {
+    return m_pos;
+  }
+
   bool HasMoreTranslations() const {
     return m_pos+1 < m_orderedTargetPhrases.size();
   }
@@ -86,6 +91,10 @@ public:
     return m_pos++;
   }
 
+  std::size_t GetPos() const {
+    return m_pos;
+  }
+
   bool HasMoreHypo() const {
     return m_pos+1 < m_orderedHypos->size();
   }
@@ -109,8 +118,10 @@ private:
 
 std::size_t hash_value(const HypothesisDimension &);
 
-/** @todo How is this used. Split out into separate source file */
-class RuleCubeItem
+/** @todo How is this used. Split out into separate source file
+ * Allocated from the sentence arena, if there is one.
+ */
+class RuleCubeItem : public ArenaAllocated
 {
 public:
   RuleCubeItem(const ChartTranslationOptions &, const ChartCellCollection &);
@@ -0,0 +1,79 @@
+// Startup time of an in-memory rule table: a text (or gzipped) rule table
+// is loaded into a PhraseDictionaryMemory with load-threads=N, and the time
+// it took is printed with the number of rules loaded, which does not depend
+// on the number of threads.
+//
+// Usage: RuleTableLoaderBenchmark <rule table> <num-features> [threads]
+// Run each thread count in a separate process, e.g.
+//   for t in 1 8 32; do RuleTableLoaderBenchmark rule-table.gz 4 $t; done
+// as feature functions can't be unregistered, and a second table would be
+// evaluated with the first one among its features.
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "moses/TranslationModel/PhraseDictionaryMemory.h"
+#include "moses/TranslationModel/PhraseDictionaryNodeMemory.h"
+#include "moses/parameters/AllOptions.h"
+#include "util/string_stream.hh"
+#include "util/usage.hh"
+
+namespace Moses
+{
+namespace
+{
+
+struct Counts {
+  Counts() : nodes(0), rules(0) {}
+  size_t nodes, rules;
+};
+
+void Count(const PhraseDictionaryNodeMemory &node, Counts &counts)
+{
+  ++counts.nodes;
+  counts.rules += node.GetTargetPhraseCollection()->GetSize();
+  const PhraseDictionaryNodeMemory::TerminalMap &terminals = node.GetTerminalMap();
+  for (PhraseDictionaryNodeMemory::TerminalMap::const_iterator p = terminals.begin(); p != terminals.end(); ++p) {
+    Count(p->second, counts);
+  }
+  const PhraseDictionaryNodeMemory::NonTerminalMap &nonTerms = node.GetNonTerminalMap();
+  for (PhraseDictionaryNodeMemory::NonTerminalMap::const_iterator p = nonTerms.begin(); p != nonTerms.end(); ++p) {
+    Count(p->second, counts);
+  }
+}
+
+} // namespace
+} // namespace Moses
+
+int main(int argc, char *argv[])
+{
+  using namespace Moses;
+
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0] << " <rule table> <num-features> [threads]" << std::endl;
+    return 1;
+  }
+  size_t threads = argc > 3 ? std::atoi(argv[3]) : 1;
+
+  util::StringStream line;
+  line << "PhraseDictionaryMemory name=TranslationModel0"
+       << " num-features=" << argv[2] << " path=" << argv[1]
+       << " input-factor=0 output-factor=0 load-threads=" << threads;
+  PhraseDictionaryMemory table(line.str());
+
+  AllOptions::ptr opts(new AllOptions);
+  double start = util::WallTime();
+  table.Load(opts);
+  double elapsed = util::WallTime() - start;
+
+  Counts counts;
+  Count(table.GetRootNode(), counts);
+  std::cout << "threads=" << threads
+            << " load=" << elapsed << "s"
+            << " nodes=" << counts.nodes
+            << " rules=" << counts.rules
+            << " rules/sec=" << counts.rules / elapsed
+            << " peak_rss_kb=" << util::RSSMax() / 1024 << std::endl;
+  return 0;
+}
@@ -58,6 +58,11 @@ ScoreComponentCollection()
   : m_scores(s_denseVectorSize)
 {}
 
+ScoreComponentCollection::
+ScoreComponentCollection(bool withDenseScores)
+  : m_scores(withDenseScores ? s_denseVectorSize : 0)
+{}
+
 
 void
 ScoreComponentCollection::
@@ -227,6 +232,7 @@ ScoreComponentCollection::
 Assign(const FeatureFunction* sp, const string &line)
 {
   istringstream istr(line);
+  std::vector<std::pair<FName, FValue> > values;
   while(istr) {
     string namestring;
     FValue value;
@@ -234,8 +240,9 @@ Assign(const FeatureFunction* sp, const string &line)
     if (!istr) break;
     istr >> value;
     FName fname(sp->GetScoreProducerDescription(), namestring);
-    m_scores[fname] = value;
+    values.push_back(std::make_pair(fname, value));
   }
+  m_scores.sparseAssign(values);
 }
 
 void
@@ -31,6 +31,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "moses/FF/FeatureFunction.h"
 #include "FeatureVector.h"
+#include "SentenceArena.h"
 #include "TypeDef.h"
 #include "Util.h"
 #include "util/exception.hh"
@@ -84,7 +85,7 @@ struct ScorePair {
  * representing that score must extend the ScoreProducer abstract base class.  For an example
  * refer to the DistortionScoreProducer class.
  */
-class ScoreComponentCollection
+class ScoreComponentCollection : public ArenaAllocated
 {
   friend std::ostream& operator<<(std::ostream& os, const ScoreComponentCollection& rhs);
   friend void swap(ScoreComponentCollection &first, ScoreComponentCollection &second);
@@ -120,6 +121,10 @@ public:
   //! Create a new score collection with all values set to 0.0
   ScoreComponentCollection();
 
+  /** Create a new score collection with all values set to 0.0, or one
+   *  without room for the dense scores, which allocates nothing */
+  explicit ScoreComponentCollection(bool withDenseScores);
+
   //! Clone a score collection
   ScoreComponentCollection(const ScoreComponentCollection& rhs)
     : m_scores(rhs.m_scores) {
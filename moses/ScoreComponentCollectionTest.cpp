@@ -145,6 +145,25 @@ BOOST_FIXTURE_TEST_CASE(sparse_feature, MockProducers)
   BOOST_CHECK_EQUAL( scc.GetScoreForProducer(&sparse,"first"), -3.8f);
 }
 
+BOOST_FIXTURE_TEST_CASE(sparse_feature_order, MockProducers)
+{
+  // sparse features are output (e.g. in n-best lists) in the order their
+  // names were first seen, whatever order they are assigned in
+  const string &descr = sparse.GetScoreProducerDescription();
+  FName third(descr, "order_c");
+  FName first(descr, "order_a");
+  FName second(descr, "order_b");
+
+  ScoreComponentCollection scc;
+  scc.Assign(&sparse, "order_b 2 order_a 1 order_c 3");
+  scc.Assign(&sparse, "order_b", 4);
+  ostringstream out;
+  string lastName;
+  scc.OutputFeatureScores(out, &sparse, lastName, false);
+  BOOST_CHECK_EQUAL(out.str(), " " + descr + "_order_c= 3 " + descr + "_order_a= 1 "
+                    + descr + "_order_b= 4");
+}
+
 /*
  Doesn't work because of the static registration of ScoreProducers
  in ScoreComponentCollection.
@@ -2,7 +2,9 @@
 #include "Timer.h"
 #include "SearchNormal.h"
 #include "SentenceStats.h"
+#include "ThreadPool.h"
 
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 
 using namespace std;
@@ -25,10 +27,15 @@ SearchNormal(Manager& manager, const TranslationOptionCollection &transOptColl)
 
   // initialize the stacks: create data structure and set limits
   std::vector < HypothesisStackNormal >::iterator iterStack;
+  bool adaptive = m_options.search.stack_pruning == AdaptiveStackPruning;
   for (size_t ind = 0 ; ind < m_hypoStackColl.size() ; ++ind) {
     HypothesisStackNormal *sourceHypoColl = new HypothesisStackNormal(m_manager);
-    sourceHypoColl->SetMaxHypoStackSize(this->m_options.search.stack_size,
+    sourceHypoColl->SetMaxHypoStackSize(adaptive
+                                        ? this->m_options.search.adaptive_stack_max
+                                        : this->m_options.search.stack_size,
                                         this->m_options.search.stack_diversity);
+    if (adaptive)
+      sourceHypoColl->SetAdaptivePruning(this->m_options.search.adaptive_stack_min);
     sourceHypoColl->SetBeamWidth(this->m_options.search.beam_width);
     m_hypoStackColl[ind] = sourceHypoColl;
   }
@@ -52,11 +59,21 @@ ProcessOneStack(HypothesisStack* hstack)
   // the stack is pruned before processing (lazy pruning):
   VERBOSE(3,"processing hypothesis from next stack");
   IFVERBOSE(2) stats.StartTimeStack();
-  sourceHypoColl.PruneToSize(m_options.search.stack_size);
+  sourceHypoColl.Prune();
   VERBOSE(3,std::endl);
   sourceHypoColl.CleanupArcList();
   IFVERBOSE(2)  stats.StopTimeStack();
 
+  size_t numSubTasks = std::min(m_options.search.stack_subtasks, sourceHypoColl.size());
+  if (numSubTasks > 1) {
+    ProcessStackInSubTasks(sourceHypoColl, numSubTasks);
+    return true;
+  }
+  if (EvaluateInBatches()) {
+    ProcessStackInBatches(sourceHypoColl);
+    return true;
+  }
+
   // go through each hypothesis on the stack and try to expand it
   // BOOST_FOREACH(Hypothesis* h, sourceHypoColl)
   HypothesisStackNormal::const_iterator h;
@@ -65,6 +82,144 @@ ProcessOneStack(HypothesisStack* hstack)
   return true;
 }
 
+/**
+ * Expand the hypotheses of one stack in sub-tasks that idle threads of the
+ * pool can take over. Each sub-task expands a contiguous part of the stack
+ * into its own candidate list; the stacks themselves are only touched when
+ * the lists are added in order afterwards, so hypotheses reach their stacks
+ * (and get their ids) in exactly the order of the sequential search.
+ */
+void
+SearchNormal::
+ProcessStackInSubTasks(const HypothesisStackNormal &hstack, size_t numSubTasks)
+{
+  std::vector<const Hypothesis*> hypos(hstack.begin(), hstack.end());
+  std::vector<CandidateList> candidates(numSubTasks);
+
+  std::vector<boost::shared_ptr<Task> > tasks;
+  for (size_t i = 0; i < numSubTasks; ++i) {
+    size_t begin = hypos.size() * i / numSubTasks;
+    size_t end = hypos.size() * (i + 1) / numSubTasks;
+    tasks.push_back(boost::shared_ptr<Task>(new FunctionTask(
+        boost::bind(&SearchNormal::ProcessHypotheses, this,
+                    boost::cref(hypos), begin, end, &candidates[i]))));
+  }
+
+  try {
+    RunSubTasks(tasks);
+  } catch (...) {
+    BOOST_FOREACH(const CandidateList &list, candidates) {
+      BOOST_FOREACH(const Candidate &candidate, list) {
+        delete candidate.hypo;
+      }
+    }
+    throw;
+  }
+
+  BOOST_FOREACH(const CandidateList &list, candidates) {
+    AddCandidates(list);
+  }
+}
+
+void
+SearchNormal::
+ProcessHypotheses(const std::vector<const Hypothesis*> &hypos,
+                  size_t begin, size_t end, CandidateList *candidates)
+{
+  for (size_t i = begin; i < end; ++i) {
+    ProcessOneHypothesis(*hypos[i], candidates);
+  }
+  if (EvaluateInBatches()) EvaluateCandidates(*candidates);
+}
+
+/**
+ * Expand the hypotheses of one stack, evaluating the new hypotheses in
+ * batches of (at least) eval-batch-size. Without early discarding, whether
+ * a hypothesis is built does not depend on the stacks, and expanding a
+ * stack only adds to later stacks, so adding the hypotheses batch by
+ * batch gives the same result as the sequential search.
+ */
+void
+SearchNormal::
+ProcessStackInBatches(const HypothesisStackNormal &hstack)
+{
+  CandidateList batch;
+  try {
+    HypothesisStackNormal::const_iterator h;
+    for (h = hstack.begin(); h != hstack.end(); ++h) {
+      ProcessOneHypothesis(**h, &batch);
+      if (batch.size() >= m_options.search.eval_batch_size) {
+        EvaluateCandidates(batch);
+        AddCandidates(batch);
+        batch.clear();
+      }
+    }
+    EvaluateCandidates(batch);
+  } catch (...) {
+    BOOST_FOREACH(const Candidate &candidate, batch) {
+      delete candidate.hypo;
+    }
+    throw;
+  }
+  AddCandidates(batch);
+}
+
+/**
+ * New hypotheses are evaluated in batches rather than one by one when
+ * they are built. Early discarding decides whether to build a hypothesis
+ * from the scores of the hypotheses before it, so it can't be batched.
+ */
+bool
+SearchNormal::
+EvaluateInBatches() const
+{
+  return m_options.search.eval_batch_size > 0 && !m_options.search.UseEarlyDiscarding();
+}
+
+void
+SearchNormal::
+EvaluateCandidates(const CandidateList &candidates) const
+{
+  std::vector<Hypothesis*> hypos;
+  std::vector<float> estimatedScores;
+  for (size_t begin = 0; begin < candidates.size(); begin += m_options.search.eval_batch_size) {
+    size_t end = std::min(begin + m_options.search.eval_batch_size, candidates.size());
+    hypos.clear();
+    estimatedScores.clear();
+    for (size_t i = begin; i < end; ++i) {
+      hypos.push_back(candidates[i].hypo);
+      estimatedScores.push_back(candidates[i].estimatedScore);
+    }
+    Hypothesis::EvaluateWhenApplied(hypos, estimatedScores);
+  }
+}
+
+/**
+ * Add the hypotheses built by a sub-task to their stacks. Early discarding
+ * depends on the state of the stack, so it is decided here rather than
+ * in the sub-task.
+ */
+void
+SearchNormal::
+AddCandidates(const CandidateList &candidates)
+{
+  SentenceStats &stats = m_manager.GetSentenceStats();
+  BOOST_FOREACH(const Candidate &candidate, candidates) {
+    Hypothesis *newHypo = candidate.hypo;
+    if (m_options.search.UseEarlyDiscarding()
+        && candidate.expectedScore < GetAllowedScore(*newHypo->GetPrevHypo(),
+            newHypo->GetTranslationOption())) {
+      IFVERBOSE(2) {
+        stats.AddNotBuilt();
+      }
+      delete newHypo;
+      continue;
+    }
+    newHypo->SetId(m_manager.GetNextHypoId());
+    AddHypothesis(newHypo);
+  }
+}
+
 
 /**
  * Main decoder loop that translates a sentence by expanding
@@ -79,13 +234,46 @@ void SearchNormal::Decode()
   m_hypoStackColl[0]->AddPrune(hypo);
 
   // go through each stack
-  BOOST_FOREACH(HypothesisStack* hstack, m_hypoStackColl) {
+  for (size_t ind = 0 ; ind < m_hypoStackColl.size() ; ++ind) {
+    if (m_options.search.heuristic_early_stopping && CanStopEarly(ind)) {
+      VERBOSE(2, "early stopping before stack " << ind << endl);
+      // the last stack still needs pruning and its arcs cleaned up
+      ind = m_hypoStackColl.size() - 1;
+    }
+    HypothesisStack* hstack = m_hypoStackColl[ind];
     if (!ProcessOneStack(hstack)) return;
     IFVERBOSE(2) OutputHypoStackSize();
     actual_hypoStack = static_cast<HypothesisStackNormal*>(hstack);
   }
 }
 
+/**
+ * Whether the stacks from stack ind on look unlikely to produce a better
+ * translation than the best complete hypothesis found so far: the best
+ * future score of each of them is below the best complete score. This is
+ * a heuristic, not a bound. Future costs are estimates (the language model
+ * estimates in particular are not optimistic), so a stack that is skipped
+ * could still have led to a better translation, and the output can differ
+ * from the search without heuristic-early-stopping.
+ * N-best lists are taken from the hypotheses found until then.
+ */
+bool
+SearchNormal::
+CanStopEarly(size_t ind) const
+{
+  size_t last = m_hypoStackColl.size() - 1;
+  if (ind >= last) return false;
+  float bestComplete
+  = static_cast<const HypothesisStackNormal*>(m_hypoStackColl[last])->GetBestScore();
+  if (bestComplete == -std::numeric_limits<float>::infinity()) return false;
+  for (; ind < last; ++ind) {
+    const HypothesisStackNormal &hstack
+    = *static_cast<const HypothesisStackNormal*>(m_hypoStackColl[ind]);
+    if (hstack.GetBestScore() > bestComplete) return false;
+  }
+  return true;
+}
+
 
 /** Find all translation options to expand one hypothesis, trigger expansion
  * this is mostly a check for overlap with already covered words, and for
@@ -94,7 +282,7 @@ void SearchNormal::Decode()
  */
 void
 SearchNormal::
-ProcessOneHypothesis(const Hypothesis &hypothesis)
+ProcessOneHypothesis(const Hypothesis &hypothesis, CandidateList *candidates)
 {
   // since we check for reordering limits, its good to have that limit handy
   bool isWordLattice = m_source.GetType() == WordLatticeInput;
@@ -122,7 +310,7 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
         }
 
         //TODO: does this method include incompatible WordLattice hypotheses?
-        ExpandAllHypotheses(hypothesis, startPos, endPos);
+        ExpandAllHypotheses(hypothesis, startPos, endPos, candidates);
       }
     }
     return; // done with special case (no reordering limit)
@@ -199,7 +387,7 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
 
       if (isLeftMostEdge) {
         // any length extension is okay if starting at left-most edge
-        ExpandAllHypotheses(hypothesis, startPos, endPos);
+        ExpandAllHypotheses(hypothesis, startPos, endPos, candidates);
       } else { // starting somewhere other than left-most edge, use caution
         // the basic idea is this: we would like to translate a phrase
         // starting from a position further right than the left-most
@@ -215,7 +403,7 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
             > m_options.reordering.max_distortion) continue;
 
         // everything is fine, we're good to go
-        ExpandAllHypotheses(hypothesis, startPos, endPos);
+        ExpandAllHypotheses(hypothesis, startPos, endPos, candidates);
       }
     }
   }
@@ -231,7 +419,8 @@ ProcessOneHypothesis(const Hypothesis &hypothesis)
 
 void
 SearchNormal::
-ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos)
+ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos,
+                    CandidateList *candidates)
 {
   // early discarding: check if hypothesis is too bad to build
   // this idea is explained in (Moore&Quirk, MT Summit 2007)
@@ -261,7 +450,8 @@ ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos
   TranslationOptionList::const_iterator iter;
   for (iter = tol->begin() ; iter != tol->end() ; ++iter) {
     const TranslationOption &transOpt = **iter;
-    ExpandHypothesis(hypothesis, transOpt, expectedScore, estimatedScore, nextBitmap);
+    ExpandHypothesis(hypothesis, transOpt, expectedScore, estimatedScore, nextBitmap,
+                     candidates);
   }
 }
 
@@ -273,13 +463,28 @@ ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos
  *        that is applied to create the new hypothesis
  * \param expectedScore base score for early discarding
  *        (base hypothesis score plus future score estimation)
+ * \param candidates if not NULL, the new hypothesis is appended to this
+ *        list instead of being added to its stack (see ProcessStackInSubTasks()
+ *        and ProcessStackInBatches())
  */
 void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis,
                                     const TranslationOption &transOpt,
                                     float expectedScore,
                                     float estimatedScore,
-                                    const Bitmap &bitmap)
+                                    const Bitmap &bitmap,
+                                    CandidateList *candidates)
 {
+  if (candidates) {
+    // ids are assigned when the candidate is added to the stack
+    Hypothesis *newHypo = new Hypothesis(hypothesis, transOpt, bitmap, 0);
+    if (! m_options.search.UseEarlyDiscarding() && ! EvaluateInBatches()) {
+      newHypo->EvaluateWhenApplied(estimatedScore);
+    }
+    Candidate candidate = { newHypo, expectedScore + transOpt.GetFutureScore(), estimatedScore };
+    candidates->push_back(candidate);
+    return;
+  }
+
   SentenceStats &stats = m_manager.GetSentenceStats();
 
   Hypothesis *newHypo;
@@ -315,14 +520,7 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis,
     // early discarding: check if hypothesis is too bad to build
   {
     // worst possible score may have changed -> recompute
-    size_t wordsTranslated = hypothesis.GetWordsBitmap().GetNumWordsCovered() + transOpt.GetSize();
-    float allowedScore = m_hypoStackColl[wordsTranslated]->GetWorstScore();
-    if (m_options.search.stack_diversity) {
-      WordsBitmapID id = hypothesis.GetWordsBitmap().GetIDPlus(transOpt.GetStartPos(), transOpt.GetEndPos());
-      float allowedScoreForBitmap = m_hypoStackColl[wordsTranslated]->GetWorstScoreForBitmap( id );
-      allowedScore = std::min( allowedScore, allowedScoreForBitmap );
-    }
-    allowedScore += m_options.search.early_discarding_threshold;
+    float allowedScore = GetAllowedScore(hypothesis, transOpt);
 
     // add expected score of translation option
     expectedScore += transOpt.GetFutureScore();
@@ -356,6 +554,31 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis,
 
   }
 
+  AddHypothesis(newHypo);
+}
+
+/**
+ * Lowest expected score for which a hypothesis extending \param hypothesis
+ * with \param transOpt is still built when early discarding
+ */
+float
+SearchNormal::
+GetAllowedScore(const Hypothesis &hypothesis, const TranslationOption &transOpt)
+{
+  size_t wordsTranslated = hypothesis.GetWordsBitmap().GetNumWordsCovered() + transOpt.GetSize();
+  float allowedScore = m_hypoStackColl[wordsTranslated]->GetWorstScore();
+  if (m_options.search.stack_diversity) {
+    WordsBitmapID id = hypothesis.GetWordsBitmap().GetIDPlus(transOpt.GetStartPos(), transOpt.GetEndPos());
+    float allowedScoreForBitmap = m_hypoStackColl[wordsTranslated]->GetWorstScoreForBitmap( id );
+    allowedScore = std::min( allowedScore, allowedScoreForBitmap );
+  }
+  return allowedScore + m_options.search.early_discarding_threshold;
+}
+
+void SearchNormal::AddHypothesis(Hypothesis *newHypo)
+{
+  SentenceStats &stats = m_manager.GetSentenceStats();
+
   // logging for the curious
   IFVERBOSE(3) {
     newHypo->PrintHypothesis();
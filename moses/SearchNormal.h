@@ -30,23 +30,63 @@ protected:
   /** pre-computed list of translation options for the phrases in this sentence */
   const TranslationOptionCollection &m_transOptColl;
 
+  /** hypothesis built by a sub-task of ProcessOneStack(). It is added to
+   *  its stack, or discarded, once all sub-tasks of the stack are done */
+  struct Candidate {
+    Hypothesis *hypo;
+    float expectedScore; //! for early discarding
+    float estimatedScore; //! future score, for batch evaluation
+  };
+  typedef std::vector<Candidate> CandidateList;
+
   // functions for creating hypotheses
 
   virtual bool
   ProcessOneStack(HypothesisStack* hstack);
 
+  void
+  ProcessStackInSubTasks(const HypothesisStackNormal &hstack, size_t numSubTasks);
+
+  void
+  ProcessHypotheses(const std::vector<const Hypothesis*> &hypos,
+                    size_t begin, size_t end, CandidateList *candidates);
+
+  void
+  AddCandidates(const CandidateList &candidates);
+
+  void
+  ProcessStackInBatches(const HypothesisStackNormal &hstack);
+
+  bool
+  EvaluateInBatches() const;
+
+  void
+  EvaluateCandidates(const CandidateList &candidates) const;
+
+  //! candidates are collected in *candidates instead of added to the stacks if not NULL
   virtual void
-  ProcessOneHypothesis(const Hypothesis &hypothesis);
+  ProcessOneHypothesis(const Hypothesis &hypothesis, CandidateList *candidates = NULL);
 
   virtual void
-  ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos);
+  ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos,
+                      CandidateList *candidates = NULL);
 
   virtual void
   ExpandHypothesis(const Hypothesis &hypothesis,
                    const TranslationOption &transOpt,
                    float expectedScore,
                    float estimatedScore,
-                   const Bitmap &bitmap);
+                   const Bitmap &bitmap,
+                   CandidateList *candidates = NULL);
+
+  bool
+  CanStopEarly(size_t ind) const;
+
+  float
+  GetAllowedScore(const Hypothesis &hypothesis, const TranslationOption &transOpt);
+
+  void
+  AddHypothesis(Hypothesis *newHypo);
 
 public:
   SearchNormal(Manager& manager, const TranslationOptionCollection &transOptColl);
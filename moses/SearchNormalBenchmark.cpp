@@ -0,0 +1,124 @@
+// Latency benchmark for expanding hypothesis stacks in sub-tasks
+// (threads-stack-subtasks). Sentences are translated one at a time on a
+// thread pool, so any speed-up comes from the idle threads taking over
+// sub-tasks of the sentence being decoded. Translations are written to
+// stdout as usual, latency statistics to stderr.
+//
+// Usage: SearchNormalBenchmark -f moses.ini [moses options] < input
+// e.g. for 1, 4 and 16 threads:
+//   SearchNormalBenchmark -f moses.ini -threads 1 > out.seq
+//   SearchNormalBenchmark -f moses.ini -threads 4 -threads-stack-subtasks 4 > out.4
+//   SearchNormalBenchmark -f moses.ini -threads 16 -threads-stack-subtasks 16 > out.16
+// The outputs must be identical to the sequential search.
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "moses/IOWrapper.h"
+#include "moses/InputType.h"
+#include "moses/Parameter.h"
+#include "moses/StaticData.h"
+#include "moses/ThreadPool.h"
+#include "moses/TranslationTask.h"
+#include "moses/Util.h"
+#include "moses/FF/FeatureFunction.h"
+#include "util/usage.hh"
+
+namespace Moses
+{
+namespace
+{
+
+#ifdef WITH_THREADS
+// runs a translation task and lets the submitting thread wait for it
+class WaitableTask : public Task
+{
+public:
+  explicit WaitableTask(boost::shared_ptr<TranslationTask> const& task)
+    : m_task(task), m_done(false) {}
+
+  virtual void Run() {
+    m_task->Run();
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_done = true;
+    m_finished.notify_all();
+  }
+
+  void Wait() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (!m_done) m_finished.wait(lock);
+  }
+
+private:
+  boost::shared_ptr<TranslationTask> m_task;
+  bool m_done;
+  boost::mutex m_mutex;
+  boost::condition_variable m_finished;
+};
+#endif
+
+double Percentile(const std::vector<double> &sorted, double p)
+{
+  if (sorted.empty()) return 0;
+  size_t i = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+  return sorted[i];
+}
+
+} // namespace
+} // namespace Moses
+
+int main(int argc, char const *argv[])
+{
+  using namespace Moses;
+
+  Parameter params;
+  if (!params.LoadParam(argc, argv)) return EXIT_FAILURE;
+  if (!StaticData::LoadDataStatic(&params, argv[0])) return EXIT_FAILURE;
+  const StaticData &staticData = StaticData::Instance();
+
+  boost::shared_ptr<IOWrapper> ioWrapper(new IOWrapper(*staticData.options()));
+#ifdef WITH_THREADS
+  ThreadPool pool(staticData.ThreadCount());
+#endif
+
+  std::vector<double> latencies;
+  double start = util::WallTime();
+  boost::shared_ptr<InputType> source;
+  while ((source = ioWrapper->ReadInput()) != NULL) {
+    boost::shared_ptr<TranslationTask> task = TranslationTask::create(source, ioWrapper);
+    FeatureFunction::SetupAll(*task);
+
+    double sentenceStart = util::WallTime();
+#ifdef WITH_THREADS
+    boost::shared_ptr<WaitableTask> waitable(new WaitableTask(task));
+    pool.Submit(waitable);
+    waitable->Wait();
+#else
+    task->Run();
+#endif
+    latencies.push_back(util::WallTime() - sentenceStart);
+  }
+  double elapsed = util::WallTime() - start;
+
+#ifdef WITH_THREADS
+  pool.Stop(true);
+#endif
+
+  std::sort(latencies.begin(), latencies.end());
+  double total = 0;
+  for (size_t i = 0; i < latencies.size(); ++i) total += latencies[i];
+  std::cerr << "threads=" << staticData.ThreadCount()
+            << " stack_subtasks=" << staticData.options()->search.stack_subtasks
+            << " sentences=" << latencies.size()
+            << " total_sec=" << elapsed
+            << " mean_ms=" << (latencies.empty() ? 0 : 1000 * total / latencies.size())
+            << " p50_ms=" << 1000 * Percentile(latencies, 0.5)
+            << " p90_ms=" << 1000 * Percentile(latencies, 0.9)
+            << " max_ms=" << 1000 * Percentile(latencies, 1.0)
+            << std::endl;
+
+  FeatureFunction::Destroy();
+  return EXIT_SUCCESS;
+}
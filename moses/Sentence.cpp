@@ -364,6 +364,8 @@ Sentence::
 Sentence(AllOptions::ptr const& opts, size_t const transId, string stext)
   : InputType(opts, transId)
 {
+  if (is_syntax(opts->search.algo))
+    m_defaultLabelSet.insert(opts->syntax.input_default_non_terminal);
   init(stext);
 }
 
@@ -0,0 +1,238 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <cstdlib>
+#include <new>
+
+#include <boost/type_traits/alignment_of.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#endif
+
+#include "SentenceArena.h"
+#include "StaticData.h"
+#include "Util.h"
+
+namespace Moses
+{
+
+namespace
+{
+
+// the most strictly aligned fundamental types, as in max_align_t
+union MaxAlign {
+  long double ld;
+  long long ll;
+  double d;
+  void *p;
+};
+
+// every object is prefixed by the arena it was allocated from, padded so
+// that the object is as aligned as malloc() would return it
+const std::size_t kAlignment = boost::alignment_of<MaxAlign>::value;
+const std::size_t kHeaderSize = sizeof(SentenceArena*) > kAlignment ?
+                                sizeof(SentenceArena*) : kAlignment;
+const std::size_t kGranularity = kHeaderSize;
+
+inline std::size_t SizeClass(std::size_t size)
+{
+  return (size + kHeaderSize + kGranularity - 1) / kGranularity;
+}
+
+#ifdef WITH_THREADS
+// the arena is owned by its Scope, not by the thread
+void NoCleanup(SentenceArena *) {}
+boost::thread_specific_ptr<SentenceArena> s_current(&NoCleanup);
+#else
+SentenceArena *s_current = NULL;
+#endif
+
+inline void SetCurrent(SentenceArena *arena)
+{
+#ifdef WITH_THREADS
+  s_current.reset(arena);
+#else
+  s_current = arena;
+#endif
+}
+
+}
+
+SentenceArena::Scope::Scope(bool enabled)
+  : m_arena(NULL)
+  , m_previous(SentenceArena::Current())
+{
+  if (enabled) {
+    m_arena = new SentenceArena;
+    SetCurrent(m_arena);
+  }
+}
+
+SentenceArena::Scope::~Scope()
+{
+  if (m_arena) {
+    SetCurrent(m_previous);
+    m_arena->Release();
+  }
+}
+
+SentenceArena *SentenceArena::Current()
+{
+#ifdef WITH_THREADS
+  return s_current.get();
+#else
+  return s_current;
+#endif
+}
+
+SentenceArena::SentenceArena()
+  : m_numAllocations(0)
+  , m_numLive(0)
+  , m_bytesReserved(0)
+  , m_released(false)
+{
+}
+
+SentenceArena::~SentenceArena()
+{
+  // util::Pool frees all blocks at once
+}
+
+void SentenceArena::Release()
+{
+  std::size_t numLive, bytesReserved;
+  {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    m_released = true;
+    numLive = m_numLive;
+    bytesReserved = m_bytesReserved;
+  }
+  // once released, the arena belongs to its live objects: the last one to
+  // be freed deletes it, possibly on another thread
+  if (numLive == 0) {
+    delete this;
+  } else {
+    VERBOSE(1, "Sentence arena: " << numLive << " objects still alive at the "
+            << "end of the sentence, keeping " << bytesReserved
+            << " bytes until they are deleted" << std::endl);
+  }
+}
+
+std::size_t SentenceArena::GetNumAllocations() const
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  return m_numAllocations;
+}
+
+std::size_t SentenceArena::GetNumLive() const
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  return m_numLive;
+}
+
+std::size_t SentenceArena::GetBytesReserved() const
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  return m_bytesReserved;
+}
+
+void *SentenceArena::Allocate(std::size_t size)
+{
+  std::size_t sizeClass = SizeClass(size);
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  void **ret;
+  if (sizeClass < m_freeLists.size() && m_freeLists[sizeClass]) {
+    ret = static_cast<void**>(m_freeLists[sizeClass]);
+    m_freeLists[sizeClass] = *ret;
+  } else {
+    std::size_t bytes = sizeClass * kGranularity;
+    ret = static_cast<void**>(m_pool.Allocate(bytes));
+    m_bytesReserved += bytes;
+  }
+  ++m_numAllocations;
+  ++m_numLive;
+
+  *ret = this;
+  return reinterpret_cast<char*>(ret) + kHeaderSize;
+}
+
+void SentenceArena::Free(void *ptr, std::size_t size)
+{
+  std::size_t sizeClass = SizeClass(size);
+  void **block = reinterpret_cast<void**>(static_cast<char*>(ptr) - kHeaderSize);
+  bool last;
+  {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    if (sizeClass >= m_freeLists.size()) {
+      m_freeLists.resize(sizeClass + 1, NULL);
+    }
+    *block = m_freeLists[sizeClass];
+    m_freeLists[sizeClass] = block;
+
+    --m_numLive;
+    last = m_released && m_numLive == 0;
+  }
+  if (last) {
+    delete this;
+  }
+}
+
+void *ArenaAllocated::operator new(std::size_t size)
+{
+  SentenceArena *arena = SentenceArena::Current();
+  if (arena) {
+    return arena->Allocate(size);
+  }
+
+  void **ret = static_cast<void**>(std::malloc(size + kHeaderSize));
+  if (ret == NULL) {
+    throw std::bad_alloc();
+  }
+  *ret = NULL;
+  return reinterpret_cast<char*>(ret) + kHeaderSize;
+}
+
+void ArenaAllocated::operator delete(void *ptr, std::size_t size)
+{
+  if (ptr == NULL) return;
+
+  void **block = reinterpret_cast<void**>(static_cast<char*>(ptr) - kHeaderSize);
+  SentenceArena *arena = static_cast<SentenceArena*>(*block);
+  if (arena) {
+    arena->Free(ptr, size);
+  } else {
+    std::free(block);
+  }
+}
+
+}
@@ -0,0 +1,134 @@
+// -*- mode: c++; indent-tabs-mode: nil; tab-width:2  -*-
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_SentenceArena_h
+#define moses_SentenceArena_h
+
+#include <cstddef>
+#include <vector>
+#include "util/pool.hh"
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+namespace Moses
+{
+
+/** Bump allocator for the short-lived objects created during the search for
+ *  one sentence (hypotheses, feature function states, score breakdowns).
+ *
+ *  Memory is carved out of a util::Pool. Objects deleted during search are
+ *  put on a free list for their size and handed out again, like
+ *  ObjectPool::freeObject(). All blocks are returned to the system in one go
+ *  when the arena is released at the end of the sentence.
+ *
+ *  An arena is installed as the current arena of the decoding thread with
+ *  SentenceArena::Scope (see TranslationTask::Run()). Classes that derive
+ *  from ArenaAllocated are allocated from the current arena, or from the
+ *  heap if there is none. Sub-tasks of the sentence may run on other
+ *  threads of the pool, which allocate from and free to the same arena, so
+ *  Allocate() and Free() take a lock.
+ *
+ *  The memory is only returned once every object of the arena is freed. An
+ *  object that outlives its sentence (or leaks) keeps all blocks of the
+ *  arena alive; Release() reports this at verbosity 1.
+ */
+class SentenceArena
+{
+public:
+  /** Installs a fresh arena as the current arena of this thread for the
+   *  lifetime of the scope. If disabled, nothing happens. */
+  class Scope
+  {
+  public:
+    explicit Scope(bool enabled = true);
+    ~Scope();
+
+    //! the arena installed by this scope, or NULL if disabled
+    SentenceArena *Get() const {
+      return m_arena;
+    }
+
+  private:
+    SentenceArena *m_arena;
+    SentenceArena *m_previous;
+
+    Scope(const Scope &);
+    Scope &operator=(const Scope &);
+  };
+
+  //! arena of the calling thread, NULL if none is installed
+  static SentenceArena *Current();
+
+  void *Allocate(std::size_t size);
+  void Free(void *ptr, std::size_t size);
+
+  //! number of objects handed out since the arena was created
+  std::size_t GetNumAllocations() const;
+  //! number of objects handed out that were not freed yet
+  std::size_t GetNumLive() const;
+  //! bytes obtained from the underlying pool
+  std::size_t GetBytesReserved() const;
+
+private:
+#ifdef WITH_THREADS
+  mutable boost::mutex m_mutex;
+#endif
+  util::Pool m_pool;
+  std::vector<void*> m_freeLists; /**< singly linked free list per size class */
+  std::size_t m_numAllocations;
+  std::size_t m_numLive;
+  std::size_t m_bytesReserved;
+  bool m_released;
+
+  SentenceArena();
+  ~SentenceArena();
+
+  /** called at the end of the sentence. If objects are still alive the
+   *  memory is kept until the last of them is freed. */
+  void Release();
+
+  SentenceArena(const SentenceArena &);
+  SentenceArena &operator=(const SentenceArena &);
+};
+
+/** Base class for objects that should be allocated from the current
+ *  SentenceArena. Each allocation is prefixed by a pointer to the arena it
+ *  came from (NULL for the heap), so objects created outside of a sentence,
+ *  e.g. while loading, can be deleted as usual. The prefix is padded to the
+ *  largest fundamental alignment, which the objects keep.
+ */
+class ArenaAllocated
+{
+public:
+  static void *operator new(std::size_t size);
+  static void operator delete(void *ptr, std::size_t size);
+
+  static void *operator new(std::size_t, void *place) {
+    return place;
+  }
+  static void operator delete(void *, void *) {
+  }
+};
+
+}
+
+#endif
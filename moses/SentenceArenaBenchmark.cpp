@@ -0,0 +1,122 @@
+// Allocation benchmark for SentenceArena.  Simulates the allocation pattern
+// of stack decoding: per sentence, many hypotheses each with a few feature
+// function states and a lazily built score breakdown, a large share of which
+// is pruned (deleted) while the sentence is still being searched.
+//
+// Usage: SentenceArenaBenchmark heap|arena [threads] [sentences]
+// Run the two modes in separate processes, peak RSS is per process.
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+#endif
+
+#include "moses/FF/FFState.h"
+#include "moses/ScoreComponentCollection.h"
+#include "moses/SentenceArena.h"
+#include "util/usage.hh"
+
+namespace Moses
+{
+namespace
+{
+
+// roughly the size of an n-gram LM state
+class BenchState : public FFState
+{
+public:
+  explicit BenchState(size_t v) {
+    for (size_t i = 0; i < 8; ++i) m_words[i] = v + i;
+  }
+  virtual size_t hash() const {
+    return m_words[0];
+  }
+  virtual bool operator==(const FFState& other) const {
+    return m_words[0] == static_cast<const BenchState&>(other).m_words[0];
+  }
+private:
+  size_t m_words[8];
+};
+
+// roughly the size of a Hypothesis
+class BenchHypothesis : public ArenaAllocated
+{
+public:
+  explicit BenchHypothesis(size_t id) : m_breakdown(NULL) {
+    for (size_t i = 0; i < 3; ++i) m_states[i] = new BenchState(id + i);
+    if (id % 4 == 0) m_breakdown = new ScoreComponentCollection;
+  }
+  ~BenchHypothesis() {
+    for (size_t i = 0; i < 3; ++i) delete m_states[i];
+    delete m_breakdown;
+  }
+private:
+  const FFState *m_states[3];
+  ScoreComponentCollection *m_breakdown;
+  char m_payload[160];
+};
+
+const size_t kHyposPerSentence = 200000;
+
+void TranslateSentences(bool useArena, size_t sentences, size_t seed)
+{
+  std::vector<BenchHypothesis*> stack;
+  for (size_t s = 0; s < sentences; ++s) {
+    SentenceArena::Scope arena(useArena);
+    stack.reserve(kHyposPerSentence);
+    size_t state = seed + s;
+    for (size_t i = 0; i < kHyposPerSentence; ++i) {
+      stack.push_back(new BenchHypothesis(i));
+      // prune like a stack would: drop a random older hypothesis
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+      if ((state >> 33) % 3 != 0) {
+        size_t victim = (state >> 17) % stack.size();
+        delete stack[victim];
+        stack[victim] = stack.back();
+        stack.pop_back();
+      }
+    }
+    for (size_t i = 0; i < stack.size(); ++i) delete stack[i];
+    stack.clear();
+  }
+}
+
+} // namespace
+} // namespace Moses
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2 || (std::string(argv[1]) != "heap" && std::string(argv[1]) != "arena")) {
+    std::cerr << "Usage: " << argv[0] << " heap|arena [threads] [sentences]" << std::endl;
+    return 1;
+  }
+  bool useArena = std::string(argv[1]) == "arena";
+  size_t threads = argc > 2 ? std::atoi(argv[2]) : 1;
+  size_t sentences = argc > 3 ? std::atoi(argv[3]) : 20;
+
+  double start = util::WallTime();
+#ifdef WITH_THREADS
+  boost::thread_group group;
+  for (size_t t = 0; t < threads; ++t) {
+    group.create_thread(boost::bind(&Moses::TranslateSentences, useArena, sentences, t));
+  }
+  group.join_all();
+#else
+  threads = 1;
+  Moses::TranslateSentences(useArena, sentences, 0);
+#endif
+  double elapsed = util::WallTime() - start;
+
+  // each hypothesis allocates itself, three states and every fourth one a
+  // score breakdown
+  double allocations = static_cast<double>(threads) * sentences
+                       * Moses::kHyposPerSentence * (1 + 3 + 0.25);
+  std::cout << argv[1] << " threads=" << threads
+            << " allocations/sec=" << allocations / elapsed
+            << " peak_rss_kb=" << util::RSSMax() / 1024 << std::endl;
+  return 0;
+}
@@ -0,0 +1,157 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <boost/test/unit_test.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+
+#include <vector>
+
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+#endif
+
+#include "SentenceArena.h"
+
+using namespace Moses;
+using namespace std;
+
+namespace
+{
+
+struct Small : public ArenaAllocated {
+  char c;
+};
+
+struct Aligned : public ArenaAllocated {
+  long double value;
+  char c;
+};
+
+template <class T>
+bool IsAligned(const T *p)
+{
+  return reinterpret_cast<size_t>(p) % boost::alignment_of<long double>::value == 0;
+}
+
+#ifdef WITH_THREADS
+void DeleteAll(const vector<Aligned*> &objects)
+{
+  for (size_t i = 0; i < objects.size(); ++i) {
+    delete objects[i];
+  }
+}
+#endif
+
+}
+
+BOOST_AUTO_TEST_SUITE(sentence_arena)
+
+BOOST_AUTO_TEST_CASE(keeps_alignment)
+{
+  Small *heapSmall = new Small;
+  Aligned *heapAligned = new Aligned;
+  BOOST_CHECK(IsAligned(heapSmall));
+  BOOST_CHECK(IsAligned(heapAligned));
+  {
+    SentenceArena::Scope arena;
+    vector<Small*> small;
+    vector<Aligned*> aligned;
+    for (size_t i = 0; i < 100; ++i) {
+      small.push_back(new Small);
+      aligned.push_back(new Aligned);
+      BOOST_CHECK(IsAligned(small.back()));
+      BOOST_CHECK(IsAligned(aligned.back()));
+    }
+    BOOST_CHECK_EQUAL(arena.Get()->GetNumLive(), 200);
+    for (size_t i = 0; i < 100; ++i) {
+      delete small[i];
+      delete aligned[i];
+    }
+    BOOST_CHECK_EQUAL(arena.Get()->GetNumLive(), 0);
+  }
+  delete heapSmall;
+  delete heapAligned;
+}
+
+BOOST_AUTO_TEST_CASE(reuses_freed_objects)
+{
+  SentenceArena::Scope arena;
+  Aligned *first = new Aligned;
+  delete first;
+  Aligned *second = new Aligned;
+  BOOST_CHECK_EQUAL(first, second);
+  delete second;
+  BOOST_CHECK_EQUAL(arena.Get()->GetNumAllocations(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(object_outlives_sentence)
+{
+  Aligned *survivor;
+  {
+    SentenceArena::Scope arena;
+    survivor = new Aligned;
+    delete new Aligned;
+  }
+  BOOST_CHECK(SentenceArena::Current() == NULL);
+  // deletes the arena as well
+  delete survivor;
+}
+
+#ifdef WITH_THREADS
+BOOST_AUTO_TEST_CASE(frees_from_other_threads)
+{
+  const size_t numThreads = 4;
+  const size_t numObjects = 10000;
+  SentenceArena::Scope arena;
+  vector<vector<Aligned*> > objects(numThreads);
+  for (size_t t = 0; t < numThreads; ++t) {
+    for (size_t i = 0; i < numObjects; ++i) {
+      objects[t].push_back(new Aligned);
+    }
+  }
+
+  // the owner keeps allocating while the other threads free
+  boost::thread_group threads;
+  for (size_t t = 0; t < numThreads; ++t) {
+    threads.create_thread(boost::bind(&DeleteAll, boost::cref(objects[t])));
+  }
+  for (size_t i = 0; i < numObjects; ++i) {
+    delete new Aligned;
+  }
+  threads.join_all();
+
+  BOOST_CHECK_EQUAL(arena.Get()->GetNumLive(), 0);
+  BOOST_CHECK_EQUAL(arena.Get()->GetNumAllocations(), (numThreads + 1) * numObjects);
+}
+
+BOOST_AUTO_TEST_CASE(last_object_freed_on_other_thread)
+{
+  vector<Aligned*> survivors;
+  {
+    SentenceArena::Scope arena;
+    for (size_t i = 0; i < 1000; ++i) {
+      survivors.push_back(new Aligned);
+    }
+  }
+  boost::thread thread(boost::bind(&DeleteAll, boost::cref(survivors)));
+  thread.join();
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
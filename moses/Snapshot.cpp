@@ -0,0 +1,473 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#include "Snapshot.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#include "moses/AlignmentInfo.h"
+#include "moses/FactorCollection.h"
+#include "moses/Phrase.h"
+#include "moses/PP/PhraseProperty.h"
+#include "moses/ScoreComponentCollection.h"
+#include "moses/StaticData.h"
+#include "moses/TargetPhrase.h"
+#include "moses/Util.h"
+#include "moses/Word.h"
+#include "util/exception.hh"
+#include "util/string_stream.hh"
+
+namespace Moses
+{
+
+namespace
+{
+
+const char kMagic[8] = {'M', 'o', 's', 'e', 's', 'S', 'n', 'p'};
+const uint64_t kVersion = 1;
+// written as raw bytes, to tell the byte order of the writer
+const uint32_t kByteOrder = 0x01020304;
+
+void StampFile(const std::string &path, uint64_t &size, uint64_t &modified)
+{
+  struct stat info;
+  if (stat(path.c_str(), &info) == 0) {
+    size = info.st_size;
+    modified = info.st_mtime;
+  } else {
+    size = util::kBadSize;
+    modified = 0;
+  }
+}
+
+} // namespace
+
+SnapshotWriter::SnapshotWriter(const std::string &path, const std::string &context)
+  : m_path(path)
+  , m_tempPath(path + ".tmp" + SPrint(getpid()))
+  , m_file(util::CreateOrThrow(m_tempPath.c_str()))
+  , m_out(m_file.get(), 1 << 20)
+  , m_offset(0)
+  , m_committed(false)
+  , m_sectionBegin(0)
+  , m_inSection(false)
+{
+  Write(kMagic, sizeof(kMagic));
+  WriteInt(kVersion);
+  Write(&kByteOrder, sizeof(kByteOrder));
+  WriteInt(MAX_NUM_FACTORS);
+  WriteString(context);
+
+  std::vector<const Factor*> factors;
+  FactorCollection::Instance().GetFactors(factors);
+  WriteInt(factors.size());
+  for (size_t i = 0; i < factors.size(); ++i) {
+    const Factor *factor = factors[i];
+    WriteInt(factor->GetId() < moses_MaxNumNonterminals);
+    WriteString(factor->GetString());
+    m_factorIndex[factor] = i;
+  }
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+  if (!m_committed) {
+    std::remove(m_tempPath.c_str());
+  }
+}
+
+void SnapshotWriter::BeginSection(const std::string &name)
+{
+  UTIL_THROW_IF2(m_inSection, "Snapshot section " << name << " begun inside another one");
+  m_inSection = true;
+  m_sectionBegin = m_offset;
+  Section section;
+  section.name = name;
+  section.offset = m_offset;
+  section.size = 0;
+  m_sections.push_back(section);
+}
+
+void SnapshotWriter::EndSection()
+{
+  UTIL_THROW_IF2(!m_inSection, "No snapshot section to end");
+  m_inSection = false;
+  m_sections.back().size = m_offset - m_sections.back().offset;
+}
+
+void SnapshotWriter::AbortSection()
+{
+  UTIL_THROW_IF2(!m_inSection, "No snapshot section to abort");
+  m_inSection = false;
+  m_sections.pop_back();
+  m_out.seekp(m_sectionBegin);
+  m_offset = m_sectionBegin;
+}
+
+void SnapshotWriter::Commit()
+{
+  UTIL_THROW_IF2(m_inSection, "Snapshot section " << m_sections.back().name << " not ended");
+
+  uint64_t index = m_offset;
+  WriteInt(m_sections.size());
+  for (size_t i = 0; i < m_sections.size(); ++i) {
+    WriteString(m_sections[i].name);
+    WriteInt(m_sections[i].offset);
+    WriteInt(m_sections[i].size);
+  }
+  Write(&index, sizeof(index));
+  m_out.flush();
+  // an aborted section may have been longer than what overwrote it
+  util::ResizeOrThrow(m_file.get(), m_offset);
+  util::FSyncOrThrow(m_file.get());
+
+  UTIL_THROW_IF(std::rename(m_tempPath.c_str(), m_path.c_str()) != 0, util::ErrnoException,
+                "Couldn't rename " << m_tempPath << " to " << m_path);
+  m_committed = true;
+}
+
+void SnapshotWriter::Write(const void *data, std::size_t size)
+{
+  m_out.write(data, size);
+  m_offset += size;
+}
+
+// 7 bits a byte, low bits first
+void SnapshotWriter::WriteInt(uint64_t value)
+{
+  char buffer[10];
+  size_t size = 0;
+  while (value >= 0x80) {
+    buffer[size++] = static_cast<char>((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  buffer[size++] = static_cast<char>(value);
+  Write(buffer, size);
+}
+
+void SnapshotWriter::WriteFloat(float value)
+{
+  Write(&value, sizeof(value));
+}
+
+void SnapshotWriter::WriteString(const StringPiece &value)
+{
+  WriteInt(value.size());
+  Write(value.data(), value.size());
+}
+
+void SnapshotWriter::WriteFileStamp(const std::string &path)
+{
+  uint64_t size, modified;
+  StampFile(path, size, modified);
+  WriteInt(size);
+  WriteInt(modified);
+}
+
+void SnapshotWriter::WriteFactor(const Factor *factor)
+{
+  if (factor == NULL) {
+    WriteInt(0);
+    return;
+  }
+  boost::unordered_map<const Factor*, uint32_t>::const_iterator p = m_factorIndex.find(factor);
+  UTIL_THROW_IF2(p == m_factorIndex.end(),
+                 "Factor " << *factor << " was added after the snapshot was begun");
+  WriteInt(p->second + 1);
+}
+
+void SnapshotWriter::WriteWord(const Word &word)
+{
+  size_t numFactors = MAX_NUM_FACTORS;
+  while (numFactors > 0 && word[numFactors - 1] == NULL) {
+    --numFactors;
+  }
+  WriteInt((numFactors << 2) | (word.IsOOV() << 1) | word.IsNonTerminal());
+  for (size_t i = 0; i < numFactors; ++i) {
+    WriteFactor(word[i]);
+  }
+}
+
+void SnapshotWriter::WritePhrase(const Phrase &phrase)
+{
+  WriteInt(phrase.GetSize());
+  for (size_t i = 0; i < phrase.GetSize(); ++i) {
+    WriteWord(phrase.GetWord(i));
+  }
+}
+
+void SnapshotWriter::WriteScores(const ScoreComponentCollection &scores)
+{
+  const FVector &vector = scores.GetScoresVector();
+  const std::valarray<FValue> &dense = vector.getCoreFeatures();
+  // mostly zeros but for the producer's own scores. -0 is kept
+  std::vector<size_t> nonZero;
+  for (size_t i = 0; i < dense.size(); ++i) {
+    float value = dense[i];
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if (bits != 0) {
+      nonZero.push_back(i);
+    }
+  }
+  WriteInt(nonZero.size());
+  for (size_t i = 0; i < nonZero.size(); ++i) {
+    WriteInt(nonZero[i]);
+    WriteFloat(dense[nonZero[i]]);
+  }
+
+  WriteInt(vector.cend() - vector.cbegin());
+  for (FVector::const_iterator p = vector.cbegin(); p != vector.cend(); ++p) {
+    WriteString(p->first.name());
+    WriteFloat(p->second);
+  }
+}
+
+void SnapshotWriter::WriteAlignment(const AlignmentInfo &alignment)
+{
+  WriteInt(alignment.GetSize());
+  for (AlignmentInfo::const_iterator p = alignment.begin(); p != alignment.end(); ++p) {
+    WriteInt(p->first);
+    WriteInt(p->second);
+  }
+}
+
+void SnapshotWriter::WriteTargetPhrase(const TargetPhrase &targetPhrase)
+{
+  // set by feature functions, which would have to restore it themselves
+  UTIL_THROW_IF2(!targetPhrase.m_data.empty() || !targetPhrase.m_cached_scores.empty(),
+                 "Target phrase " << static_cast<const Phrase&>(targetPhrase)
+                 << " holds feature function data");
+
+  WritePhrase(targetPhrase);
+  WriteInt(targetPhrase.m_lhsTarget != NULL);
+  if (targetPhrase.m_lhsTarget) {
+    WriteWord(*targetPhrase.m_lhsTarget);
+  }
+  WriteAlignment(targetPhrase.GetAlignTerm());
+  WriteAlignment(targetPhrase.GetAlignNonTerm());
+
+  WriteScores(targetPhrase.m_scoreBreakdown);
+  WriteFloat(targetPhrase.m_futureScore);
+  WriteFloat(targetPhrase.m_estimatedScore);
+
+  WriteInt(targetPhrase.m_properties.size());
+  for (TargetPhrase::Properties::const_iterator p = targetPhrase.m_properties.begin();
+       p != targetPhrase.m_properties.end(); ++p) {
+    const std::string *value = p->second->GetValueString();
+    UTIL_THROW_IF2(value == NULL, "Phrase property " << p->first << " doesn't keep its value");
+    WriteString(p->first);
+    WriteString(*value);
+  }
+}
+
+SnapshotReader::SnapshotReader(const std::string &path)
+  : m_path(path)
+{
+  util::scoped_fd file(util::OpenReadOrThrow(path.c_str()));
+  uint64_t size = util::SizeOrThrow(file.get());
+  util::MapRead(util::POPULATE_OR_READ, file.get(), 0, size, m_mem);
+  m_begin = m_pos = static_cast<const char*>(m_mem.get());
+  m_end = m_begin + size;
+}
+
+SnapshotReader *SnapshotReader::Open(const std::string &path, const std::string &context)
+{
+  if (!FileExists(path)) {
+    return NULL;
+  }
+  std::auto_ptr<SnapshotReader> reader(new SnapshotReader(path));
+
+  if (reader->m_end - reader->m_begin < static_cast<ptrdiff_t>(sizeof(kMagic) + sizeof(uint64_t))
+      || std::memcmp(reader->Read(sizeof(kMagic)), kMagic, sizeof(kMagic)) != 0) {
+    VERBOSE(1, path << " is not a snapshot" << std::endl);
+    return NULL;
+  }
+  uint64_t version = reader->ReadInt();
+  uint32_t byteOrder;
+  std::memcpy(&byteOrder, reader->Read(sizeof(byteOrder)), sizeof(byteOrder));
+  if (version != kVersion || byteOrder != kByteOrder || reader->ReadInt() != MAX_NUM_FACTORS) {
+    VERBOSE(1, "Snapshot " << path << " was written by another version of Moses" << std::endl);
+    return NULL;
+  }
+  if (reader->ReadString() != context) {
+    VERBOSE(1, "Snapshot " << path << " was written for another configuration" << std::endl);
+    return NULL;
+  }
+
+  FactorCollection &factorCollection = FactorCollection::Instance();
+  reader->m_factors.resize(reader->ReadInt());
+  for (size_t i = 0; i < reader->m_factors.size(); ++i) {
+    bool isNonTerminal = reader->ReadInt();
+    reader->m_factors[i] = factorCollection.AddFactor(reader->ReadString(), isNonTerminal);
+  }
+
+  uint64_t index;
+  reader->m_pos = reader->m_end - sizeof(index);
+  std::memcpy(&index, reader->Read(sizeof(index)), sizeof(index));
+  reader->m_pos = reader->m_begin + index;
+  for (uint64_t count = reader->ReadInt(); count; --count) {
+    std::string name = reader->ReadString().as_string();
+    uint64_t offset = reader->ReadInt();
+    uint64_t size = reader->ReadInt();
+    UTIL_THROW_IF2(offset + size > index, "Corrupt snapshot " << path);
+    reader->m_sections[name] = std::make_pair(offset, size);
+  }
+  return reader.release();
+}
+
+bool SnapshotReader::OpenSection(const std::string &name)
+{
+  boost::unordered_map<std::string, std::pair<uint64_t, uint64_t> >::const_iterator p
+    = m_sections.find(name);
+  if (p == m_sections.end()) {
+    return false;
+  }
+  m_pos = m_begin + p->second.first;
+  m_end = m_pos + p->second.second;
+  return true;
+}
+
+const char *SnapshotReader::Read(std::size_t size)
+{
+  UTIL_THROW_IF2(size > static_cast<std::size_t>(m_end - m_pos), "Corrupt snapshot " << m_path);
+  const char *ret = m_pos;
+  m_pos += size;
+  return ret;
+}
+
+uint64_t SnapshotReader::ReadInt()
+{
+  uint64_t value = 0;
+  for (unsigned shift = 0; ; shift += 7) {
+    UTIL_THROW_IF2(m_pos == m_end || shift > 63, "Corrupt snapshot " << m_path);
+    unsigned char byte = *m_pos++;
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+}
+
+float SnapshotReader::ReadFloat()
+{
+  float value;
+  std::memcpy(&value, Read(sizeof(value)), sizeof(value));
+  return value;
+}
+
+StringPiece SnapshotReader::ReadString()
+{
+  uint64_t size = ReadInt();
+  return StringPiece(Read(size), size);
+}
+
+bool SnapshotReader::ReadFileStamp(const std::string &path)
+{
+  uint64_t size, modified;
+  StampFile(path, size, modified);
+  uint64_t savedSize = ReadInt();
+  uint64_t savedModified = ReadInt();
+  return size == savedSize && modified == savedModified;
+}
+
+const Factor *SnapshotReader::ReadFactor()
+{
+  uint64_t index = ReadInt();
+  if (index == 0) {
+    return NULL;
+  }
+  UTIL_THROW_IF2(index > m_factors.size(), "Corrupt snapshot " << m_path);
+  return m_factors[index - 1];
+}
+
+void SnapshotReader::ReadWord(Word &word)
+{
+  uint64_t header = ReadInt();
+  size_t numFactors = header >> 2;
+  UTIL_THROW_IF2(numFactors > MAX_NUM_FACTORS, "Corrupt snapshot " << m_path);
+  word.SetIsNonTerminal(header & 1);
+  word.SetIsOOV(header & 2);
+  for (size_t i = 0; i < numFactors; ++i) {
+    word.SetFactor(i, ReadFactor());
+  }
+}
+
+void SnapshotReader::ReadPhrase(Phrase &phrase)
+{
+  for (uint64_t size = ReadInt(); size; --size) {
+    ReadWord(phrase.AddWord());
+  }
+}
+
+void SnapshotReader::ReadScores(ScoreComponentCollection &scores)
+{
+  size_t coreSize = scores.GetScoresVector().coreSize();
+  for (uint64_t count = ReadInt(); count; --count) {
+    uint64_t index = ReadInt();
+    UTIL_THROW_IF2(index >= coreSize, "Corrupt snapshot " << m_path);
+    scores.Assign(index, ReadFloat());
+  }
+  for (uint64_t count = ReadInt(); count; --count) {
+    FName name(ReadString());
+    scores.SparsePlusEquals(name, ReadFloat());
+  }
+}
+
+void SnapshotReader::ReadAlignment(std::set<std::pair<size_t, size_t> > &alignment)
+{
+  for (uint64_t count = ReadInt(); count; --count) {
+    size_t source = ReadInt();
+    alignment.insert(std::make_pair(source, static_cast<size_t>(ReadInt())));
+  }
+}
+
+TargetPhrase *SnapshotReader::ReadTargetPhrase(const PhraseDictionary *container)
+{
+  std::auto_ptr<TargetPhrase> targetPhrase(new TargetPhrase(container));
+
+  ReadPhrase(*targetPhrase);
+  if (ReadInt()) {
+    Word *lhs = new Word;
+    targetPhrase->SetTargetLHS(lhs);
+    ReadWord(*lhs);
+  }
+  std::set<std::pair<size_t, size_t> > alignTerm, alignNonTerm;
+  ReadAlignment(alignTerm);
+  ReadAlignment(alignNonTerm);
+  targetPhrase->SetAlignTerm(alignTerm);
+  targetPhrase->SetAlignNonTerm(alignNonTerm);
+
+  ReadScores(targetPhrase->m_scoreBreakdown);
+  targetPhrase->m_futureScore = ReadFloat();
+  targetPhrase->m_estimatedScore = ReadFloat();
+
+  for (uint64_t count = ReadInt(); count; --count) {
+    std::string key = ReadString().as_string();
+    targetPhrase->SetProperty(key, ReadString().as_string());
+  }
+  return targetPhrase.release();
+}
+
+}  // namespace Moses
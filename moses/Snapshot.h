@@ -0,0 +1,182 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+#include "util/file.hh"
+#include "util/file_stream.hh"
+#include "util/mmap.hh"
+#include "util/string_piece.hh"
+
+namespace Moses
+{
+
+class AlignmentInfo;
+class Factor;
+class Phrase;
+class PhraseDictionary;
+class ScoreComponentCollection;
+class TargetPhrase;
+class Word;
+
+/** A snapshot is an image of the models of a decoder once they have been
+ * loaded, written to one file so that a later decoder with the same
+ * configuration restores them instead of reading the original files.
+ *
+ * The file starts with a description of the configuration it was written
+ * for (the feature functions, their arguments and weights) and every factor
+ * of the FactorCollection, in the order they were added, so that restored
+ * factors get the ids they had.  Then come the sections, one per feature
+ * function that could save its data, and an index of the sections.  The
+ * integers and floats are in the byte order of the machine that wrote them.
+ */
+class SnapshotWriter
+{
+public:
+  //! the snapshot is written to a temporary file, which replaces path in Commit()
+  SnapshotWriter(const std::string &path, const std::string &context);
+  ~SnapshotWriter();
+
+  void BeginSection(const std::string &name);
+  void EndSection();
+  //! drop what was written since BeginSection()
+  void AbortSection();
+
+  void Commit();
+
+  void WriteInt(uint64_t value);
+  void WriteFloat(float value);
+  void WriteString(const StringPiece &value);
+  //! size and modification time of a file the data was read from
+  void WriteFileStamp(const std::string &path);
+
+  void WriteFactor(const Factor *factor);
+  void WriteWord(const Word &word);
+  void WritePhrase(const Phrase &phrase);
+  void WriteScores(const ScoreComponentCollection &scores);
+  //! throws if the target phrase holds data that can't be restored
+  void WriteTargetPhrase(const TargetPhrase &targetPhrase);
+
+private:
+  struct Section {
+    std::string name;
+    uint64_t offset, size;
+  };
+
+  void Write(const void *data, std::size_t size);
+  void WriteAlignment(const AlignmentInfo &alignment);
+
+  std::string m_path, m_tempPath;
+  util::scoped_fd m_file;
+  util::FileStream m_out;
+  uint64_t m_offset;
+  bool m_committed;
+
+  boost::unordered_map<const Factor*, uint32_t> m_factorIndex;
+  std::vector<Section> m_sections;
+  uint64_t m_sectionBegin;
+  bool m_inSection;
+};
+
+/** Reads a snapshot written by SnapshotWriter from a read-only mapping of
+ * the file.
+ */
+class SnapshotReader
+{
+public:
+  /** NULL if there is no snapshot at path, or if it was written for another
+   * configuration.  Otherwise the factors of the snapshot are added to the
+   * FactorCollection.
+   */
+  static SnapshotReader *Open(const std::string &path, const std::string &context);
+
+  const std::string &GetPath() const {
+    return m_path;
+  }
+
+  //! false if the snapshot has no section of that name
+  bool OpenSection(const std::string &name);
+
+  uint64_t ReadInt();
+  float ReadFloat();
+  StringPiece ReadString();
+  //! false if the file changed since the snapshot was written
+  bool ReadFileStamp(const std::string &path);
+
+  const Factor *ReadFactor();
+  void ReadWord(Word &word);
+  void ReadPhrase(Phrase &phrase);
+  void ReadScores(ScoreComponentCollection &scores);
+  TargetPhrase *ReadTargetPhrase(const PhraseDictionary *container);
+
+private:
+  explicit SnapshotReader(const std::string &path);
+
+  const char *Read(std::size_t size);
+  void ReadAlignment(std::set<std::pair<size_t, size_t> > &alignment);
+
+  std::string m_path;
+  util::scoped_memory m_mem;
+  const char *m_begin, *m_pos, *m_end;
+
+  std::vector<const Factor*> m_factors;
+  boost::unordered_map<std::string, std::pair<uint64_t, uint64_t> > m_sections;
+};
+
+/** The entries of a hash map, in the reverse order of iteration.  Inserted
+ * in that order into a map with as many buckets, they are iterated over in
+ * the original order (by boost::unordered_map), so that ties between the
+ * entries are broken the same way after a restore as after a load.
+ */
+template <class Map>
+std::vector<const typename Map::value_type*> ReverseIterationOrder(const Map &map)
+{
+  std::vector<const typename Map::value_type*> entries;
+  entries.reserve(map.size());
+  for (typename Map::const_iterator p = map.begin(); p != map.end(); ++p) {
+    entries.push_back(&*p);
+  }
+  std::reverse(entries.begin(), entries.end());
+  return entries;
+}
+
+template <class K, class T, class H, class P, class A>
+size_t BucketCount(const boost::unordered_map<K, T, H, P, A> &map)
+{
+  return map.bucket_count();
+}
+
+template <class K, class T, class C, class A>
+size_t BucketCount(const std::map<K, T, C, A> &/*map*/)
+{
+  return 0;
+}
+
+}  // namespace Moses
@@ -0,0 +1,152 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+
+#include <boost/filesystem.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "FactorCollection.h"
+#include "Snapshot.h"
+#include "TargetPhrase.h"
+
+using namespace Moses;
+using namespace std;
+
+namespace
+{
+
+Word MakeWord(const string &str, bool isNonTerminal = false)
+{
+  Word word(isNonTerminal);
+  word.SetFactor(0, FactorCollection::Instance().AddFactor(str, isNonTerminal));
+  return word;
+}
+
+struct Fixture {
+  Fixture()
+    : path((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string())
+    , dataPath(path + ".data") {
+    std::ofstream data(dataPath.c_str());
+    data << "model" << endl;
+  }
+  ~Fixture() {
+    boost::filesystem::remove(path);
+    boost::filesystem::remove(dataPath);
+  }
+  string path, dataPath;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(snapshot)
+
+BOOST_FIXTURE_TEST_CASE(target_phrase, Fixture)
+{
+  TargetPhrase targetPhrase;
+  targetPhrase.AddWord(MakeWord("das"));
+  Word haus = MakeWord("haus");
+  haus.SetFactor(2, FactorCollection::Instance().AddFactor("NN"));
+  targetPhrase.AddWord(haus);
+  targetPhrase.AddWord(MakeWord("X", true));
+  targetPhrase.SetTargetLHS(new Word(MakeWord("NP", true)));
+  set<pair<size_t, size_t> > alignTerm, alignNonTerm;
+  alignTerm.insert(make_pair(0, 0));
+  alignTerm.insert(make_pair(1, 1));
+  alignNonTerm.insert(make_pair(2, 2));
+  targetPhrase.SetAlignTerm(alignTerm);
+  targetPhrase.SetAlignNonTerm(alignNonTerm);
+  targetPhrase.GetScoreBreakdown().SparsePlusEquals(FName("snapshot-test"), -1.5f);
+
+  {
+    SnapshotWriter writer(path, "context");
+    writer.BeginSection("phrases");
+    writer.WriteTargetPhrase(targetPhrase);
+    writer.WriteInt(1ULL << 40);
+    writer.EndSection();
+    writer.Commit();
+  }
+
+  boost::scoped_ptr<SnapshotReader> reader(SnapshotReader::Open(path, "context"));
+  BOOST_REQUIRE(reader);
+  BOOST_REQUIRE(reader->OpenSection("phrases"));
+  boost::scoped_ptr<TargetPhrase> restored(reader->ReadTargetPhrase(NULL));
+  BOOST_CHECK_EQUAL(reader->ReadInt(), 1ULL << 40);
+
+  BOOST_CHECK(restored->Phrase::operator==(targetPhrase));
+  BOOST_CHECK_EQUAL(restored->GetWord(1).GetFactor(2), haus.GetFactor(2));
+  BOOST_CHECK(restored->GetWord(2).IsNonTerminal());
+  BOOST_CHECK(restored->GetTargetLHS() == targetPhrase.GetTargetLHS());
+  BOOST_CHECK(&restored->GetAlignTerm() == &targetPhrase.GetAlignTerm());
+  BOOST_CHECK(&restored->GetAlignNonTerm() == &targetPhrase.GetAlignNonTerm());
+  BOOST_CHECK_EQUAL(restored->GetScoreBreakdown().GetScoresVector()[FName("snapshot-test")], -1.5f);
+}
+
+BOOST_FIXTURE_TEST_CASE(sections, Fixture)
+{
+  {
+    SnapshotWriter writer(path, "context");
+    writer.BeginSection("aborted");
+    for (size_t i = 0; i < 1000; ++i) {
+      writer.WriteString("not saved");
+    }
+    writer.AbortSection();
+    writer.BeginSection("saved");
+    writer.WriteString("saved");
+    writer.WriteFileStamp(dataPath);
+    writer.WriteFloat(0.25f);
+    writer.EndSection();
+    writer.Commit();
+  }
+
+  boost::scoped_ptr<SnapshotReader> reader(SnapshotReader::Open(path, "context"));
+  BOOST_REQUIRE(reader);
+  BOOST_CHECK(!reader->OpenSection("aborted"));
+  BOOST_REQUIRE(reader->OpenSection("saved"));
+  BOOST_CHECK_EQUAL(reader->ReadString(), "saved");
+  BOOST_CHECK(reader->ReadFileStamp(dataPath));
+  BOOST_CHECK_EQUAL(reader->ReadFloat(), 0.25f);
+  BOOST_CHECK_THROW(reader->ReadInt(), util::Exception);
+
+  std::ofstream data(dataPath.c_str(), std::ios::app);
+  data << "changed" << endl;
+  data.close();
+  BOOST_REQUIRE(reader->OpenSection("saved"));
+  reader->ReadString();
+  BOOST_CHECK(!reader->ReadFileStamp(dataPath));
+}
+
+BOOST_FIXTURE_TEST_CASE(out_of_date, Fixture)
+{
+  BOOST_CHECK(SnapshotReader::Open(path, "context") == NULL);
+  {
+    SnapshotWriter writer(path, "context");
+    writer.Commit();
+  }
+  BOOST_CHECK(SnapshotReader::Open(path, "another context") == NULL);
+  boost::scoped_ptr<SnapshotReader> reader(SnapshotReader::Open(path, "context"));
+  BOOST_CHECK(reader);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
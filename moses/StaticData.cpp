@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <string>
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #include "moses/FF/Factory.h"
 #include "TypeDef.h"
@@ -43,9 +44,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "DecodeGraph.h"
 #include "InputFileStream.h"
 #include "ScoreComponentCollection.h"
+#include "Snapshot.h"
 #include "DecodeGraph.h"
 #include "TranslationModel/PhraseDictionary.h"
 #include "TranslationModel/PhraseDictionaryTreeAdaptor.h"
+#include "util/string_stream.hh"
 
 #ifdef WITH_THREADS
 #include <boost/thread.hpp>
@@ -171,6 +174,7 @@ StaticData
 #endif
     }
   }
+  m_parameter->SetParameter(m_threadsLongestFirst, "threads-longest-first", false);
   return true;
 }
 
@@ -594,6 +598,15 @@ CleanUpAfterSentenceProcessing(ttasksptr const& ttask) const
 
 void StaticData::LoadFeatureFunctions()
 {
+  // models that the snapshot has a current copy of are restored from it
+  string snapshotPath;
+  m_parameter->SetParameter<string>(snapshotPath, "snapshot", "");
+  boost::scoped_ptr<SnapshotReader> snapshot;
+  if (!snapshotPath.empty()) {
+    snapshot.reset(SnapshotReader::Open(snapshotPath, GetSnapshotContext()));
+  }
+  bool snapshotStale = !snapshot;
+
   const std::vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
   std::vector<FeatureFunction*>::const_iterator iter;
   for (iter = ffs.begin(); iter != ffs.end(); ++iter) {
@@ -609,19 +622,102 @@ void StaticData::LoadFeatureFunctions()
     }
 
     if (doLoad) {
-      VERBOSE(1, "Loading " << ff->GetScoreProducerDescription() << endl);
-      ff->Load(options());
+      LoadFeatureFunction(*ff, snapshot.get(), snapshotStale);
     }
   }
 
   const std::vector<PhraseDictionary*> &pts = PhraseDictionary::GetColl();
   for (size_t i = 0; i < pts.size(); ++i) {
-    PhraseDictionary *pt = pts[i];
-    VERBOSE(1, "Loading " << pt->GetScoreProducerDescription() << endl);
-    pt->Load(options());
+    LoadFeatureFunction(*pts[i], snapshot.get(), snapshotStale);
   }
 
   CheckLEGACYPT();
+
+  // sub-tasks run on threads that did not initialize the features for the
+  // sentence, so a single feature with thread-local sentence state rules
+  // them out
+  SearchOptions &search = m_options->search;
+  for (iter = ffs.begin(); iter != ffs.end(); ++iter) {
+    if (!(*iter)->IsUsableInSubTasks()) {
+      if (search.subtask_min_length || search.stack_subtasks || search.chart_subtasks) {
+        VERBOSE(1, (*iter)->GetScoreProducerDescription()
+                << " keeps its sentence state per thread, decoding without sub-tasks" << endl);
+        search.subtask_min_length = search.stack_subtasks = search.chart_subtasks = 0;
+      }
+      break;
+    }
+  }
+
+  if (!snapshotPath.empty() && snapshotStale) {
+    snapshot.reset();
+    WriteSnapshot(snapshotPath);
+  }
+}
+
+void StaticData::LoadFeatureFunction(FeatureFunction &ff, SnapshotReader *snapshot, bool &snapshotStale)
+{
+  if (snapshot && snapshot->OpenSection(ff.GetScoreProducerDescription())) {
+    if (ff.ReadSnapshot(options(), *snapshot)) {
+      VERBOSE(1, "Restored " << ff.GetScoreProducerDescription() << " from " << snapshot->GetPath() << endl);
+      return;
+    }
+    VERBOSE(1, "Snapshot of " << ff.GetScoreProducerDescription() << " is out of date" << endl);
+    snapshotStale = true;
+  }
+  VERBOSE(1, "Loading " << ff.GetScoreProducerDescription() << endl);
+  ff.Load(options());
+}
+
+/** What the models in a snapshot depend on, besides their files: the
+ * feature functions with their arguments and weights, as the scores of the
+ * target phrases are weighted when they are loaded.
+ */
+string StaticData::GetSnapshotContext() const
+{
+  util::StringStream context;
+  const std::vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
+  for (size_t i = 0; i < ffs.size(); ++i) {
+    const FeatureFunction &ff = *ffs[i];
+    context << ff.GetArgLine() << "\t" << IsFeatureFunctionIgnored(ff);
+    vector<float> weights = GetWeights(&ff);
+    for (size_t j = 0; j < weights.size(); ++j) {
+      context << " " << weights[j];
+    }
+    context << "\n";
+  }
+  const PARAM_VEC *params = m_parameter->GetParam("feature-overwrite");
+  if (params) {
+    for (size_t i = 0; i < params->size(); ++i) {
+      context << params->at(i) << "\n";
+    }
+  }
+  return context.str();
+}
+
+void StaticData::WriteSnapshot(const std::string &path) const
+{
+  Timer timer;
+  timer.start();
+  SnapshotWriter snapshot(path, GetSnapshotContext());
+
+  const std::vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
+  for (size_t i = 0; i < ffs.size(); ++i) {
+    const FeatureFunction &ff = *ffs[i];
+    snapshot.BeginSection(ff.GetScoreProducerDescription());
+    try {
+      if (ff.WriteSnapshot(snapshot)) {
+        snapshot.EndSection();
+      } else {
+        snapshot.AbortSection();
+      }
+    } catch (const util::Exception &e) {
+      snapshot.AbortSection();
+      VERBOSE(1, ff.GetScoreProducerDescription() << " can't be saved in a snapshot: " << e.what() << endl);
+    }
+  }
+
+  snapshot.Commit();
+  VERBOSE(1, "Wrote snapshot " << path << " in " << timer << " seconds" << endl);
 }
 
 bool StaticData::CheckWeights() const
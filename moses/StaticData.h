@@ -53,6 +53,7 @@ namespace Moses
 class InputType;
 class DecodeGraph;
 class DecodeStep;
+class SnapshotReader;
 
 class DynamicCacheBasedLanguageModel;
 class PhraseDictionaryDynamicCacheBased;
@@ -111,6 +112,7 @@ protected:
   UnknownLHSList m_unknownLHS;
 
   int m_threadCount;
+  bool m_threadsLongestFirst;
   // long m_startTranslationId;
 
   // alternate weight settings
@@ -259,6 +261,10 @@ public:
     return m_threadCount;
   }
 
+  bool ThreadsLongestFirst() const {
+    return m_threadsLongestFirst;
+  }
+
   void SetExecPath(const std::string &path);
   const std::string &GetBinDirectory() const;
 
@@ -347,6 +353,9 @@ public:
   void CleanUpAfterSentenceProcessing(ttasksptr const& ttask) const;
 
   void LoadFeatureFunctions();
+  void LoadFeatureFunction(FeatureFunction &ff, SnapshotReader *snapshot, bool &snapshotStale);
+  std::string GetSnapshotContext() const;
+  void WriteSnapshot(const std::string &path) const;
   bool CheckWeights() const;
   void LoadSparseWeightsFromConfig();
   bool LoadWeightSettings();
@@ -1,5 +1,7 @@
 #include "Cube.h"
 
+#include <algorithm>
+
 #include "moses/FF/FFState.h"
 #include "moses/FF/StatefulFeatureFunction.h"
 #include "moses/FF/StatelessFeatureFunction.h"
@@ -15,23 +17,20 @@ namespace Syntax
 
 Cube::Cube(const SHyperedgeBundle &bundle)
   : m_bundle(bundle)
+  , m_visited(bundle.stacks.size()+1)
+  , m_neighbour(bundle.stacks.size()+1, 0)
 {
   // Create the SHyperedge for the 'corner' of the cube.
-  std::vector<int> coordinates(bundle.stacks.size()+1, 0);
-  SHyperedge *hyperedge = CreateHyperedge(coordinates);
+  SHyperedge *hyperedge = CreateHyperedge(&m_neighbour[0]);
   // Add its coordinates to the set of visited coordinates.
-  std::pair<CoordinateSet::iterator, bool> p = m_visited.insert(coordinates);
-  const std::vector<int> &storedCoordinates = *p.first;
-  // Add the SHyperedge to the queue along with its coordinates (which will be
-  // needed for creating its neighbours).
-  m_queue.push(QueueItem(hyperedge, &storedCoordinates));
+  std::size_t index = m_visited.Insert(&m_neighbour[0]).first;
+  // Add the SHyperedge to the queue along with the index of its coordinates.
+  m_queue.push(QueueItem(hyperedge, index));
 }
 
 Cube::~Cube()
 {
-  // Delete the SHyperedges belonging to any unpopped items.  Note that the
-  // coordinate vectors are not deleted here since they are owned by m_visited
-  // (and so will be deleted by its destructor).
+  // Delete the SHyperedges belonging to any unpopped items.
   while (!m_queue.empty()) {
     QueueItem item = m_queue.top();
     m_queue.pop();
@@ -44,49 +43,50 @@ SHyperedge *Cube::Pop()
 {
   QueueItem item = m_queue.top();
   m_queue.pop();
-  CreateNeighbours(*item.second);
+  CreateNeighbours(item.second);
   return item.first;
 }
 
-void Cube::CreateNeighbours(const std::vector<int> &coordinates)
+void Cube::CreateNeighbours(std::size_t index)
 {
-  // Create a copy of the origin coordinates that will be adjusted for
-  // each neighbour.
-  std::vector<int> tmpCoordinates(coordinates);
+  // Copy the origin coordinates, which will be adjusted for each neighbour.
+  // (The set's copy moves when a neighbour is inserted.)
+  const std::size_t arity = m_neighbour.size();
+  std::copy(m_visited.Get(index), m_visited.Get(index) + arity,
+            m_neighbour.begin());
 
   // Create each neighbour along the vertex stack dimensions.
-  for (std::size_t i = 0; i < coordinates.size()-1; ++i) {
-    const std::size_t x = coordinates[i];
+  for (std::size_t i = 0; i < arity-1; ++i) {
+    const std::size_t x = m_neighbour[i];
     if (m_bundle.stacks[i]->size() > x+1) {
-      ++tmpCoordinates[i];
-      CreateNeighbour(tmpCoordinates);
-      --tmpCoordinates[i];
+      ++m_neighbour[i];
+      CreateNeighbour();
+      --m_neighbour[i];
     }
   }
   // Create the neighbour along the translation dimension.
-  const std::size_t x = coordinates.back();
+  const std::size_t x = m_neighbour.back();
   if (m_bundle.translations->GetSize() > x+1) {
-    ++tmpCoordinates.back();
-    CreateNeighbour(tmpCoordinates);
-    --tmpCoordinates.back();
+    ++m_neighbour.back();
+    CreateNeighbour();
+    --m_neighbour.back();
   }
 }
 
-void Cube::CreateNeighbour(const std::vector<int> &coordinates)
+void Cube::CreateNeighbour()
 {
   // Add the coordinates to the set of visited coordinates if not already
   // present.
-  std::pair<CoordinateSet::iterator, bool> p = m_visited.insert(coordinates);
+  std::pair<std::size_t, bool> p = m_visited.Insert(&m_neighbour[0]);
   if (!p.second) {
     // We have visited this neighbour before, so there is nothing to do.
     return;
   }
-  SHyperedge *hyperedge = CreateHyperedge(coordinates);
-  const std::vector<int> &storedCoordinates = *p.first;
-  m_queue.push(QueueItem(hyperedge, &storedCoordinates));
+  SHyperedge *hyperedge = CreateHyperedge(&m_neighbour[0]);
+  m_queue.push(QueueItem(hyperedge, p.first));
 }
 
-SHyperedge *Cube::CreateHyperedge(const std::vector<int> &coordinates)
+SHyperedge *Cube::CreateHyperedge(const int *coordinates)
 {
   SHyperedge *hyperedge = new SHyperedge();
 
@@ -97,8 +97,9 @@ SHyperedge *Cube::CreateHyperedge(const std::vector<int> &coordinates)
     StatefulFeatureFunction::GetStatefulFeatureFunctions().size());
   hyperedge->head = head;
 
-  hyperedge->tail.resize(coordinates.size()-1);
-  for (std::size_t i = 0; i < coordinates.size()-1; ++i) {
+  const std::size_t numStacks = m_bundle.stacks.size();
+  hyperedge->tail.resize(numStacks);
+  for (std::size_t i = 0; i < numStacks; ++i) {
     boost::shared_ptr<SVertex> pred = (*m_bundle.stacks[i])[coordinates[i]];
     hyperedge->tail[i] = pred.get();
   }
@@ -106,7 +107,7 @@ SHyperedge *Cube::CreateHyperedge(const std::vector<int> &coordinates)
   hyperedge->label.inputWeight = m_bundle.inputWeight;
 
   hyperedge->label.translation =
-    *(m_bundle.translations->begin()+coordinates.back());
+    *(m_bundle.translations->begin()+coordinates[numStacks]);
 
   // Calculate feature deltas.
 
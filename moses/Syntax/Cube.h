@@ -4,7 +4,7 @@
 #include <vector>
 #include <utility>
 
-#include <boost/unordered_set.hpp>
+#include "moses/CubeCoordinateSet.h"
 
 #include "SHyperedge.h"
 #include "SHyperedgeBundle.h"
@@ -34,9 +34,9 @@ public:
   }
 
 private:
-  typedef boost::unordered_set<std::vector<int> > CoordinateSet;
-
-  typedef std::pair<SHyperedge *, const std::vector<int> *> QueueItem;
+  // A SHyperedge and the index of its coordinates in m_visited (which will be
+  // needed for creating its neighbours).
+  typedef std::pair<SHyperedge *, std::size_t> QueueItem;
 
   class QueueItemOrderer
   {
@@ -49,12 +49,15 @@ private:
   typedef std::priority_queue<QueueItem, std::vector<QueueItem>,
           QueueItemOrderer> Queue;
 
-  SHyperedge *CreateHyperedge(const std::vector<int> &);
-  void CreateNeighbour(const std::vector<int> &);
-  void CreateNeighbours(const std::vector<int> &);
+  SHyperedge *CreateHyperedge(const int *);
+  void CreateNeighbour();
+  void CreateNeighbours(std::size_t);
 
   const SHyperedgeBundle &m_bundle;
-  CoordinateSet m_visited;
+  // Coordinates are (stack positions..., translation position).
+  CubeCoordinateSet m_visited;
+  // The coordinates of the neighbour being created.
+  std::vector<int> m_neighbour;
   Queue m_queue;
 };
 
@@ -1,9 +1,12 @@
 // -*- c++ -*-
 #pragma once
 
+#include <boost/bind.hpp>
+
 #include "moses/DecodeGraph.h"
 #include "moses/ForestInput.h"
 #include "moses/StaticData.h"
+#include "moses/ThreadPool.h"
 #include "moses/Syntax/BoundedPriorityContainer.h"
 #include "moses/Syntax/CubeQueue.h"
 #include "moses/Syntax/PHyperedge.h"
@@ -57,10 +60,7 @@ Manager<RuleMatcher>::Manager(ttasksptr const& ttask)
 template<typename RuleMatcher>
 void Manager<RuleMatcher>::Decode()
 {
-  // Get various pruning-related constants.
-  const std::size_t popLimit = options()->cube.pop_limit;
   const std::size_t ruleLimit = options()->syntax.rule_limit;
-  const std::size_t stackLimit = options()->search.stack_size;
 
   // Initialize the stacks.
   InitializeStacks();
@@ -68,9 +68,6 @@ void Manager<RuleMatcher>::Decode()
   // Initialize the rule matchers.
   InitializeRuleMatchers();
 
-  // Create a callback to process the PHyperedges produced by the rule matchers.
-  RuleMatcherCallback callback(m_stackMap, ruleLimit);
-
   // Create a glue rule synthesizer.
   GlueRuleSynthesizer glueRuleSynthesizer(*options(), *m_glueRuleTrie);
 
@@ -79,12 +76,12 @@ void Manager<RuleMatcher>::Decode()
   TopologicalSorter sorter;
   sorter.Sort(*m_forest, sortedVertices);
 
-  // Visit each vertex of the input forest in topological order.
+  // Collect the non-terminal vertices in topological order (after checking
+  // if the terminal vertices are OOVs).
+  VertexVec vertices;
   for (std::vector<const Forest::Vertex *>::const_iterator
        p = sortedVertices.begin(); p != sortedVertices.end(); ++p) {
     const Forest::Vertex &vertex = **p;
-
-    // Skip terminal vertices (after checking if they are OOVs).
     if (vertex.incoming.empty()) {
       if (vertex.pvertex.span.GetStartPos() > 0 &&
           vertex.pvertex.span.GetEndPos() < m_sentenceLength-1 &&
@@ -93,56 +90,197 @@ void Manager<RuleMatcher>::Decode()
       }
       continue;
     }
+    vertices.push_back(&vertex);
+  }
 
-    // Call the rule matchers to generate PHyperedges for this vertex and
-    // convert each one to a SHyperedgeBundle (via the callback).  The
-    // callback prunes the SHyperedgeBundles and keeps the best ones (up
-    // to ruleLimit).
-    callback.ClearContainer();
-    for (typename std::vector<boost::shared_ptr<RuleMatcher> >::iterator
-         q = m_mainRuleMatchers.begin(); q != m_mainRuleMatchers.end(); ++q) {
-      (*q)->EnumerateHyperedges(vertex, callback);
-    }
+  const std::size_t numSubTasks = options()->search.chart_subtasks;
+  if (numSubTasks > 1) {
+    DecodeByLevel(vertices, numSubTasks, glueRuleSynthesizer);
+    return;
+  }
 
-    // Retrieve the (pruned) set of SHyperedgeBundles from the callback.
-    const BoundedPriorityContainer<SHyperedgeBundle> &bundles =
-      callback.GetContainer();
+  // Create a callback to process the PHyperedges produced by the rule matchers.
+  RuleMatcherCallback callback(m_stackMap, ruleLimit);
 
-    // Check if any rules were matched.  If not then for each incoming
-    // hyperedge, synthesize a glue rule that is guaranteed to match.
-    if (bundles.Size() == 0) {
-      for (std::vector<Forest::Hyperedge *>::const_iterator p =
-             vertex.incoming.begin(); p != vertex.incoming.end(); ++p) {
-        glueRuleSynthesizer.SynthesizeRule(**p);
+  // Visit each vertex of the input forest in topological order.
+  for (VertexVec::const_iterator p = vertices.begin(); p != vertices.end();
+       ++p) {
+    DecodeVertex(**p, m_mainRuleMatchers, *m_glueRuleMatcher, callback,
+                 glueRuleSynthesizer);
+  }
+}
+
+// Decode the vertices in numSubTasks sub-tasks, which idle threads of the
+// pool can take over.  A vertex's level is one more than the highest level of
+// its tail vertices, so that the vertices of a level only depend on lower
+// levels and are decoded in parallel, each sub-task with its own rule
+// matchers and callback.  The glue rules are synthesized in the order of
+// Decode(): the vertices that need them get a level above the previous such
+// vertex.  The result doesn't depend on the number of sub-tasks.
+template<typename RuleMatcher>
+void Manager<RuleMatcher>::DecodeByLevel(
+  const VertexVec &vertices, std::size_t numSubTasks,
+  GlueRuleSynthesizer &glueRuleSynthesizer)
+{
+  const std::size_t ruleLimit = options()->syntax.rule_limit;
+
+  std::vector<RuleMatcherVec> mainRuleMatchers(numSubTasks);
+  std::vector<boost::shared_ptr<RuleMatcher> > glueRuleMatchers;
+  std::vector<boost::shared_ptr<RuleMatcherCallback> > callbacks;
+  for (std::size_t i = 0; i < numSubTasks; ++i) {
+    for (typename RuleMatcherVec::const_iterator p = m_mainRuleMatchers.begin();
+         p != m_mainRuleMatchers.end(); ++p) {
+      mainRuleMatchers[i].push_back(
+        boost::shared_ptr<RuleMatcher>(new RuleMatcher(**p)));
+    }
+    glueRuleMatchers.push_back(
+      boost::shared_ptr<RuleMatcher>(new RuleMatcher(*m_glueRuleMatcher)));
+    callbacks.push_back(boost::shared_ptr<RuleMatcherCallback>(
+                          new RuleMatcherCallback(m_stackMap, ruleLimit)));
+  }
+
+  std::vector<char> needsGlue(vertices.size(), 0);
+  std::vector<boost::shared_ptr<Task> > tasks;
+  for (std::size_t i = 0; i < numSubTasks; ++i) {
+    tasks.push_back(boost::shared_ptr<Task>(new FunctionTask(
+        boost::bind(&Manager<RuleMatcher>::FindGlueVertices, this, &vertices,
+                    i, numSubTasks, &mainRuleMatchers[i], &needsGlue))));
+  }
+  RunSubTasks(tasks);
+
+  boost::unordered_map<const Forest::Vertex *, std::size_t> levels;
+  std::vector<VertexVec> levelVertices;
+  std::size_t glueLevel = 0;
+  for (std::size_t i = 0; i < vertices.size(); ++i) {
+    const Forest::Vertex *vertex = vertices[i];
+    std::size_t level = 0;
+    for (std::vector<Forest::Hyperedge *>::const_iterator p =
+           vertex->incoming.begin(); p != vertex->incoming.end(); ++p) {
+      for (std::vector<Forest::Vertex *>::const_iterator q =
+             (*p)->tail.begin(); q != (*p)->tail.end(); ++q) {
+        boost::unordered_map<const Forest::Vertex *, std::size_t>::const_iterator
+        r = levels.find(*q);
+        if (r != levels.end()) {
+          level = std::max(level, r->second);
+        }
       }
-      m_glueRuleMatcher->EnumerateHyperedges(vertex, callback);
-      // FIXME This assertion occasionally fails -- why?
-      // assert(bundles.Size() == vertex.incoming.size());
     }
+    if (needsGlue[i]) {
+      level = std::max(level, glueLevel);
+      glueLevel = level + 1;
+    }
+    levels[vertex] = level + 1;
+    if (level >= levelVertices.size()) {
+      levelVertices.resize(level + 1);
+    }
+    levelVertices[level].push_back(vertex);
+  }
 
-    // Use cube pruning to extract SHyperedges from SHyperedgeBundles and
-    // collect the SHyperedges in a buffer.
-    CubeQueue cubeQueue(bundles.Begin(), bundles.End());
-    std::size_t count = 0;
-    std::vector<SHyperedge*> buffer;
-    while (count < popLimit && !cubeQueue.IsEmpty()) {
-      SHyperedge *hyperedge = cubeQueue.Pop();
-      // FIXME See corresponding code in S2T::Manager
-      // BEGIN{HACK}
-      hyperedge->head->pvertex = &(vertex.pvertex);
-      // END{HACK}
-      buffer.push_back(hyperedge);
-      ++count;
+  for (std::vector<VertexVec>::const_iterator p = levelVertices.begin();
+       p != levelVertices.end(); ++p) {
+    const std::size_t step = std::min(numSubTasks, p->size());
+    tasks.clear();
+    for (std::size_t i = 0; i < step; ++i) {
+      tasks.push_back(boost::shared_ptr<Task>(new FunctionTask(
+          boost::bind(&Manager<RuleMatcher>::DecodeVertices, this, &*p, i,
+                      step, &mainRuleMatchers[i], glueRuleMatchers[i].get(),
+                      callbacks[i].get(), &glueRuleSynthesizer))));
     }
+    RunSubTasks(tasks);
+  }
+}
 
-    // Recombine SVertices and sort into a stack.
-    SVertexStack &stack = m_stackMap[&(vertex.pvertex)];
-    RecombineAndSort(buffer, stack);
+// A vertex needs glue rules if no rule of the main rule tables matches it.
+// This doesn't depend on the stacks, so it is known before decoding.
+template<typename RuleMatcher>
+void Manager<RuleMatcher>::FindGlueVertices(
+  const VertexVec *vertices, std::size_t first, std::size_t step,
+  RuleMatcherVec *mainRuleMatchers, std::vector<char> *needsGlue)
+{
+  RuleMatcherCallback counter(m_stackMap, 0);
+  counter.SetCountOnly();
+  for (std::size_t i = first; i < vertices->size(); i += step) {
+    counter.ClearCount();
+    for (typename RuleMatcherVec::iterator p = mainRuleMatchers->begin();
+         p != mainRuleMatchers->end(); ++p) {
+      (*p)->EnumerateHyperedges(*(*vertices)[i], counter);
+    }
+    (*needsGlue)[i] = (counter.GetCount() == 0);
+  }
+}
+
+// Decode the given vertices first, first + step, ...
+template<typename RuleMatcher>
+void Manager<RuleMatcher>::DecodeVertices(
+  const VertexVec *vertices, std::size_t first, std::size_t step,
+  RuleMatcherVec *mainRuleMatchers, RuleMatcher *glueRuleMatcher,
+  RuleMatcherCallback *callback, GlueRuleSynthesizer *glueRuleSynthesizer)
+{
+  for (std::size_t i = first; i < vertices->size(); i += step) {
+    DecodeVertex(*(*vertices)[i], *mainRuleMatchers, *glueRuleMatcher,
+                 *callback, *glueRuleSynthesizer);
+  }
+}
 
-    // Prune stack.
-    if (stackLimit > 0 && stack.size() > stackLimit) {
-      stack.resize(stackLimit);
+template<typename RuleMatcher>
+void Manager<RuleMatcher>::DecodeVertex(
+  const Forest::Vertex &vertex, RuleMatcherVec &mainRuleMatchers,
+  RuleMatcher &glueRuleMatcher, RuleMatcherCallback &callback,
+  GlueRuleSynthesizer &glueRuleSynthesizer)
+{
+  // Get various pruning-related constants.
+  const std::size_t popLimit = options()->cube.pop_limit;
+  const std::size_t stackLimit = options()->search.stack_size;
+
+  // Call the rule matchers to generate PHyperedges for this vertex and
+  // convert each one to a SHyperedgeBundle (via the callback).  The
+  // callback prunes the SHyperedgeBundles and keeps the best ones (up
+  // to ruleLimit).
+  callback.ClearContainer();
+  for (typename RuleMatcherVec::iterator q = mainRuleMatchers.begin();
+       q != mainRuleMatchers.end(); ++q) {
+    (*q)->EnumerateHyperedges(vertex, callback);
+  }
+
+  // Retrieve the (pruned) set of SHyperedgeBundles from the callback.
+  const BoundedPriorityContainer<SHyperedgeBundle> &bundles =
+    callback.GetContainer();
+
+  // Check if any rules were matched.  If not then for each incoming
+  // hyperedge, synthesize a glue rule that is guaranteed to match.
+  if (bundles.Size() == 0) {
+    for (std::vector<Forest::Hyperedge *>::const_iterator p =
+           vertex.incoming.begin(); p != vertex.incoming.end(); ++p) {
+      glueRuleSynthesizer.SynthesizeRule(**p);
     }
+    glueRuleMatcher.EnumerateHyperedges(vertex, callback);
+    // FIXME This assertion occasionally fails -- why?
+    // assert(bundles.Size() == vertex.incoming.size());
+  }
+
+  // Use cube pruning to extract SHyperedges from SHyperedgeBundles and
+  // collect the SHyperedges in a buffer.
+  CubeQueue cubeQueue(bundles.Begin(), bundles.End());
+  std::size_t count = 0;
+  std::vector<SHyperedge*> buffer;
+  while (count < popLimit && !cubeQueue.IsEmpty()) {
+    SHyperedge *hyperedge = cubeQueue.Pop();
+    // FIXME See corresponding code in S2T::Manager
+    // BEGIN{HACK}
+    hyperedge->head->pvertex = &(vertex.pvertex);
+    // END{HACK}
+    buffer.push_back(hyperedge);
+    ++count;
+  }
+
+  // Recombine SVertices and sort into a stack.  The stack was created by
+  // InitializeStacks(): in DecodeByLevel() other sub-tasks read the map.
+  SVertexStack &stack = m_stackMap.find(&(vertex.pvertex))->second;
+  RecombineAndSort(buffer, stack);
+
+  // Prune stack.
+  if (stackLimit > 0 && stack.size() > stackLimit) {
+    stack.resize(stackLimit);
   }
 }
 
@@ -13,8 +13,10 @@
 #include "moses/Word.h"
 
 #include "Forest.h"
+#include "GlueRuleSynthesizer.h"
 #include "HyperTree.h"
 #include "PVertexToStackMap.h"
+#include "RuleMatcherCallback.h"
 
 namespace Moses
 {
@@ -44,6 +46,21 @@ public:
   void OutputDetailedTranslationReport(OutputCollector *collector) const;
 
 private:
+  typedef std::vector<boost::shared_ptr<RuleMatcher> > RuleMatcherVec;
+  typedef std::vector<const Forest::Vertex *> VertexVec;
+
+  void DecodeByLevel(const VertexVec &, std::size_t, GlueRuleSynthesizer &);
+
+  void FindGlueVertices(const VertexVec *, std::size_t, std::size_t,
+                        RuleMatcherVec *, std::vector<char> *);
+
+  void DecodeVertices(const VertexVec *, std::size_t, std::size_t,
+                      RuleMatcherVec *, RuleMatcher *, RuleMatcherCallback *,
+                      GlueRuleSynthesizer *);
+
+  void DecodeVertex(const Forest::Vertex &, RuleMatcherVec &, RuleMatcher &,
+                    RuleMatcherCallback &, GlueRuleSynthesizer &);
+
   const Forest::Vertex &FindRootNode(const Forest &);
 
   void InitializeRuleMatchers();
@@ -59,7 +76,7 @@ private:
   std::size_t m_sentenceLength;  // Includes <s> and </s>
   PVertexToStackMap m_stackMap;
   boost::shared_ptr<HyperTree> m_glueRuleTrie;
-  std::vector<boost::shared_ptr<RuleMatcher> > m_mainRuleMatchers;
+  RuleMatcherVec m_mainRuleMatchers;
   boost::shared_ptr<RuleMatcher> m_glueRuleMatcher;
 };
 
@@ -24,9 +24,15 @@ private:
 public:
   RuleMatcherCallback(const PVertexToStackMap &stackMap, std::size_t ruleLimit)
     : m_stackMap(stackMap)
-    , m_container(ruleLimit) {}
+    , m_container(ruleLimit)
+    , m_countOnly(false)
+    , m_count(0) {}
 
   void operator()(const PHyperedge &hyperedge) {
+    if (m_countOnly) {
+      ++m_count;
+      return;
+    }
     PHyperedgeToSHyperedgeBundle(hyperedge, m_stackMap, m_tmpBundle);
     float score = SHyperedgeBundleScorer::Score(m_tmpBundle);
     m_container.SwapIn(m_tmpBundle, score);
@@ -40,10 +46,26 @@ public:
     return m_container;
   }
 
+  // Only count the hyperedges, which needs no stacks for their tails (see
+  // F2S::Manager::FindGlueVertices()).
+  void SetCountOnly() {
+    m_countOnly = true;
+  }
+
+  std::size_t GetCount() const {
+    return m_count;
+  }
+
+  void ClearCount() {
+    m_count = 0;
+  }
+
 private:
   const PVertexToStackMap &m_stackMap;
   SHyperedgeBundle m_tmpBundle;
   BoundedPriorityContainer<SHyperedgeBundle> m_container;
+  bool m_countOnly;
+  std::size_t m_count;
 };
 
 }  // F2S
@@ -4,8 +4,11 @@
 #include <iostream>
 #include <sstream>
 
+#include <boost/bind.hpp>
+
 #include "moses/DecodeGraph.h"
 #include "moses/StaticData.h"
+#include "moses/ThreadPool.h"
 #include "moses/Syntax/BoundedPriorityContainer.h"
 #include "moses/Syntax/CubeQueue.h"
 #include "moses/Syntax/PHyperedge.h"
@@ -160,10 +163,7 @@ void Manager<Parser>::FindOovs(const PChart &pchart, boost::unordered_set<Word>
 template<typename Parser>
 void Manager<Parser>::Decode()
 {
-  // Get various pruning-related constants.
-  const std::size_t popLimit = options()->cube.pop_limit;
   const std::size_t ruleLimit = options()->syntax.rule_limit;
-  const std::size_t stackLimit = options()->search.stack_size;
 
   // Initialise the PChart and SChart.
   InitializeCharts();
@@ -171,83 +171,184 @@ void Manager<Parser>::Decode()
   // Initialize the parsers.
   InitializeParsers(m_pchart, ruleLimit);
 
+  const std::size_t numSubTasks = options()->search.chart_subtasks;
+  if (numSubTasks > 1) {
+    DecodeByWidth(numSubTasks);
+    return;
+  }
+
   // Create a callback to process the PHyperedges produced by the parsers.
-  typename Parser::CallbackType callback(m_schart, ruleLimit);
+  Callback callback(m_schart, ruleLimit);
 
   // Visit each cell of PChart in right-to-left depth-first order.
   std::size_t size = m_source.GetSize();
   for (int start = size-1; start >= 0; --start) {
     for (std::size_t width = 1; width <= size-start; ++width) {
       std::size_t end = start + width - 1;
+      DecodeSpan(Range(start, end), m_parsers, callback, NULL);
+    }
+  }
+}
 
-      //PChart::Cell &pcell = m_pchart.GetCell(start, end);
-      SChart::Cell &scell = m_schart.GetCell(start, end);
+// Decode the cells of each span width in numSubTasks sub-tasks, which idle
+// threads of the pool can take over.  The cells of a width only depend on
+// narrower cells, so each sub-task just needs its own copies of the parsers
+// and of the callback.  Sub-task i decodes the cells starting at i,
+// i + numSubTasks, ... of every width, so its parsers can keep what they
+// found from those starts.  The PVertices of a width are added to the PChart
+// once all of its sub-tasks are done, in the order of Decode(), and so the
+// result doesn't depend on the number of sub-tasks.
+template<typename Parser>
+void Manager<Parser>::DecodeByWidth(std::size_t numSubTasks)
+{
+  const std::size_t ruleLimit = options()->syntax.rule_limit;
+  const std::size_t size = m_source.GetSize();
+
+  std::vector<ParserVec> parsers(numSubTasks);
+  std::vector<boost::shared_ptr<Callback> > callbacks;
+  for (std::size_t i = 0; i < numSubTasks; ++i) {
+    for (typename ParserVec::const_iterator p = m_parsers.begin();
+         p != m_parsers.end(); ++p) {
+      boost::shared_ptr<Parser> parser(new Parser(**p));
+      parser->SetEnumerateByWidth();
+      parsers[i].push_back(parser);
+    }
+    callbacks.push_back(boost::shared_ptr<Callback>(
+                          new Callback(m_schart, ruleLimit)));
+  }
 
-      Range range(start, end);
+  for (std::size_t width = 1; width <= size; ++width) {
+    const std::size_t numCells = size - width + 1;
+    const std::size_t step = std::min(numSubTasks, numCells);
+    // The categories of each cell's hyperedges, in the order they were popped.
+    std::vector<std::vector<Word> > categories(numCells);
+    std::vector<boost::shared_ptr<Task> > tasks;
+    for (std::size_t i = 0; i < step; ++i) {
+      tasks.push_back(boost::shared_ptr<Task>(new FunctionTask(
+          boost::bind(&Manager<Parser>::DecodeSpans, this, width, i, step,
+                      &parsers[i], callbacks[i].get(), &categories))));
+    }
+    RunSubTasks(tasks);
+    AddPVertices(width, categories);
+  }
+}
 
-      // Call the parsers to generate PHyperedges for this span and convert
-      // each one to a SHyperedgeBundle (via the callback).  The callback
-      // prunes the SHyperedgeBundles and keeps the best ones (up to ruleLimit).
-      callback.InitForRange(range);
-      for (typename std::vector<boost::shared_ptr<Parser> >::iterator
-           p = m_parsers.begin(); p != m_parsers.end(); ++p) {
-        (*p)->EnumerateHyperedges(range, callback);
-      }
+// Decode the cells of the given width that start at first, first + step, ...
+template<typename Parser>
+void Manager<Parser>::DecodeSpans(
+  std::size_t width, std::size_t first, std::size_t step, ParserVec *parsers,
+  Callback *callback, std::vector<std::vector<Word> > *categories)
+{
+  const std::size_t size = m_source.GetSize();
+  for (std::size_t start = first; start + width <= size; start += step) {
+    DecodeSpan(Range(start, start + width - 1), *parsers, *callback,
+               &(*categories)[start]);
+  }
+}
 
-      // Retrieve the (pruned) set of SHyperedgeBundles from the callback.
-      const BoundedPriorityContainer<SHyperedgeBundle> &bundles =
-        callback.GetContainer();
-
-      // Use cube pruning to extract SHyperedges from SHyperedgeBundles.
-      // Collect the SHyperedges into buffers, one for each category.
-      CubeQueue cubeQueue(bundles.Begin(), bundles.End());
-      std::size_t count = 0;
-      typedef boost::unordered_map<Word, std::vector<SHyperedge*>,
-              SymbolHasher, SymbolEqualityPred > BufferMap;
-      BufferMap buffers;
-      while (count < popLimit && !cubeQueue.IsEmpty()) {
-        SHyperedge *hyperedge = cubeQueue.Pop();
-        // BEGIN{HACK}
-        // The way things currently work, the LHS of each hyperedge is not
-        // determined until just before the point of its creation, when a
-        // target phrase is selected from the list of possible phrases (which
-        // happens during cube pruning).  The cube pruning code doesn't (and
-        // shouldn't) know about the contents of PChart and so creation of
-        // the PVertex is deferred until this point.
-        const Word &lhs = hyperedge->label.translation->GetTargetLHS();
-        hyperedge->head->pvertex = &m_pchart.AddVertex(PVertex(range, lhs));
-        // END{HACK}
-        buffers[lhs].push_back(hyperedge);
-        ++count;
-      }
+// Decode a single cell.  If categories is non-NULL then the cell's PVertices
+// are not added to the PChart, which other sub-tasks are reading, but the
+// categories are recorded for AddPVertices().
+template<typename Parser>
+void Manager<Parser>::DecodeSpan(const Range &range, ParserVec &parsers,
+                                 Callback &callback,
+                                 std::vector<Word> *categories)
+{
+  // Get various pruning-related constants.
+  const std::size_t popLimit = options()->cube.pop_limit;
+  const std::size_t stackLimit = options()->search.stack_size;
 
-      // Recombine SVertices and sort into stacks.
-      for (BufferMap::const_iterator p = buffers.begin(); p != buffers.end();
-           ++p) {
-        const Word &category = p->first;
-        const std::vector<SHyperedge*> &buffer = p->second;
-        std::pair<SChart::Cell::NMap::Iterator, bool> ret =
-          scell.nonTerminalStacks.Insert(category, SVertexStack());
-        assert(ret.second);
-        SVertexStack &stack = ret.first->second;
-        RecombineAndSort(buffer, stack);
+  SChart::Cell &scell = m_schart.GetCell(range.GetStartPos(),
+                                         range.GetEndPos());
+
+  // Call the parsers to generate PHyperedges for this span and convert
+  // each one to a SHyperedgeBundle (via the callback).  The callback
+  // prunes the SHyperedgeBundles and keeps the best ones (up to ruleLimit).
+  callback.InitForRange(range);
+  for (typename ParserVec::iterator p = parsers.begin(); p != parsers.end();
+       ++p) {
+    (*p)->EnumerateHyperedges(range, callback);
+  }
+
+  // Retrieve the (pruned) set of SHyperedgeBundles from the callback.
+  const BoundedPriorityContainer<SHyperedgeBundle> &bundles =
+    callback.GetContainer();
+
+  // Use cube pruning to extract SHyperedges from SHyperedgeBundles.
+  // Collect the SHyperedges into buffers, one for each category.
+  CubeQueue cubeQueue(bundles.Begin(), bundles.End());
+  std::size_t count = 0;
+  typedef boost::unordered_map<Word, std::vector<SHyperedge*>,
+          SymbolHasher, SymbolEqualityPred > BufferMap;
+  BufferMap buffers;
+  while (count < popLimit && !cubeQueue.IsEmpty()) {
+    SHyperedge *hyperedge = cubeQueue.Pop();
+    // BEGIN{HACK}
+    // The way things currently work, the LHS of each hyperedge is not
+    // determined until just before the point of its creation, when a
+    // target phrase is selected from the list of possible phrases (which
+    // happens during cube pruning).  The cube pruning code doesn't (and
+    // shouldn't) know about the contents of PChart and so creation of
+    // the PVertex is deferred until this point.
+    const Word &lhs = hyperedge->label.translation->GetTargetLHS();
+    if (categories) {
+      if (buffers.find(lhs) == buffers.end()) {
+        categories->push_back(lhs);
       }
+    } else {
+      hyperedge->head->pvertex = &m_pchart.AddVertex(PVertex(range, lhs));
+    }
+    // END{HACK}
+    buffers[lhs].push_back(hyperedge);
+    ++count;
+  }
 
-      // Prune stacks.
-      if (stackLimit > 0) {
-        for (SChart::Cell::NMap::Iterator p = scell.nonTerminalStacks.Begin();
-             p != scell.nonTerminalStacks.End(); ++p) {
-          SVertexStack &stack = p->second;
-          if (stack.size() > stackLimit) {
-            stack.resize(stackLimit);
-          }
-        }
+  // Recombine SVertices and sort into stacks.
+  for (typename BufferMap::const_iterator p = buffers.begin();
+       p != buffers.end(); ++p) {
+    const Word &category = p->first;
+    const std::vector<SHyperedge*> &buffer = p->second;
+    std::pair<SChart::Cell::NMap::Iterator, bool> ret =
+      scell.nonTerminalStacks.Insert(category, SVertexStack());
+    assert(ret.second);
+    SVertexStack &stack = ret.first->second;
+    RecombineAndSort(buffer, stack);
+  }
+
+  // Prune stacks.
+  if (stackLimit > 0) {
+    for (SChart::Cell::NMap::Iterator p = scell.nonTerminalStacks.Begin();
+         p != scell.nonTerminalStacks.End(); ++p) {
+      SVertexStack &stack = p->second;
+      if (stack.size() > stackLimit) {
+        stack.resize(stackLimit);
       }
+    }
+  }
 
-      // Prune the PChart cell for this span by removing vertices for
-      // categories that don't occur in the SChart.
+  // Prune the PChart cell for this span by removing vertices for
+  // categories that don't occur in the SChart.
 // Note: see HACK above.  Pruning the chart isn't currently necessary.
 //      PrunePChart(scell, pcell);
+}
+
+// Add the PVertices of the cells of the given width to the PChart and point
+// the SVertices at them.
+template<typename Parser>
+void Manager<Parser>::AddPVertices(
+  std::size_t width, const std::vector<std::vector<Word> > &categories)
+{
+  for (std::size_t start = 0; start < categories.size(); ++start) {
+    const Range range(start, start + width - 1);
+    SChart::Cell &scell = m_schart.GetCell(start, start + width - 1);
+    for (std::vector<Word>::const_iterator p = categories[start].begin();
+         p != categories[start].end(); ++p) {
+      const PVertex &pvertex = m_pchart.AddVertex(PVertex(range, *p));
+      SVertexStack *stack = scell.nonTerminalStacks.Find(*p);
+      assert(stack);
+      for (SVertexStack::iterator q = stack->begin(); q != stack->end(); ++q) {
+        (*q)->pvertex = &pvertex;
+      }
     }
   }
 }
@@ -45,6 +45,19 @@ public:
   void OutputDetailedTranslationReport(OutputCollector *collector) const;
 
 private:
+  typedef std::vector<boost::shared_ptr<Parser> > ParserVec;
+  typedef typename Parser::CallbackType Callback;
+
+  void DecodeByWidth(std::size_t);
+
+  void DecodeSpans(std::size_t, std::size_t, std::size_t, ParserVec *,
+                   Callback *, std::vector<std::vector<Word> > *);
+
+  void DecodeSpan(const Range &, ParserVec &, Callback &,
+                  std::vector<Word> *);
+
+  void AddPVertices(std::size_t, const std::vector<std::vector<Word> > &);
+
   void FindOovs(const PChart &, boost::unordered_set<Word> &, std::size_t);
 
   void InitializeCharts();
@@ -58,7 +71,7 @@ private:
   PChart m_pchart;
   SChart m_schart;
   boost::shared_ptr<typename Parser::RuleTrie> m_oovRuleTrie;
-  std::vector<boost::shared_ptr<Parser> > m_parsers;
+  ParserVec m_parsers;
 };
 
 }  // S2T
@@ -10,6 +10,7 @@ namespace S2T
 {
 
 PChart::PChart(std::size_t width, bool maintainCompressedChart)
+  : m_compressedChart(NULL)
 {
   m_cells.resize(width);
   for (std::size_t i = 0; i < width; ++i) {
@@ -21,6 +21,13 @@ public:
   virtual ~Parser() {}
 
   virtual void EnumerateHyperedges(const Range &, Callback &) = 0;
+
+  // Enumerate the ranges width by width (see S2T::Manager::DecodeByWidth()):
+  // the ranges of a width can be enumerated in any order once the narrower
+  // ranges are done, but the ranges with the same start are always
+  // enumerated by the same parser.  A parser that doesn't depend on the
+  // order of ranges can ignore this.
+  virtual void SetEnumerateByWidth() {}
 protected:
   PChart &m_chart;
 };
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+
 #include "moses/Syntax/S2T/PChart.h"
 
 namespace Moses
@@ -17,6 +19,7 @@ RecursiveCYKPlusParser<Callback>::RecursiveCYKPlusParser(
   : Parser<Callback>(chart)
   , m_ruleTable(trie)
   , m_maxChartSpan(maxChartSpan)
+  , m_byWidth(false)
   , m_callback(NULL)
 {
   m_hyperedge.head = 0;
@@ -34,6 +37,19 @@ void RecursiveCYKPlusParser<Callback>::EnumerateHyperedges(
   m_maxEnd = std::min(Base::m_chart.GetWidth()-1, start+m_maxChartSpan-1);
   m_hyperedge.tail.clear();
 
+  if (m_byWidth) {
+    m_end = end;
+    if (end <= m_maxEnd) {
+      EnumerateHyperedgesByWidth(start, end);
+      return;
+    }
+    // Beyond the maximum chart span, only the search of this range can get
+    // there, and it doesn't extend anything.
+    GetTerminalExtension(rootNode, start, end);
+    GetNonTerminalExtensions(rootNode, start, end-1, end-1);
+    return;
+  }
+
   // Find all hyperedges where the first incoming vertex is a terminal covering
   // [start,end].
   GetTerminalExtension(rootNode, start, end);
@@ -93,31 +109,35 @@ void RecursiveCYKPlusParser<Callback>::GetTerminalExtension(
     return;
   }
 
-  const RuleTrie::Node::SymbolMap &terminals = node.GetTerminalMap();
-
   for (PChart::Cell::TMap::const_iterator p = vertexMap.begin();
        p != vertexMap.end(); ++p) {
-    const Word &terminal = p->first;
-    const PVertex &vertex = p->second;
-
-    // if node has small number of terminal edges, test word equality for each.
-    if (terminals.size() < 5) {
-      for (RuleTrie::Node::SymbolMap::const_iterator iter = terminals.begin();
-           iter != terminals.end(); ++iter) {
-        const Word &word = iter->first;
-        if (word == terminal) {
-          const RuleTrie::Node *child = & iter->second;
-          AddAndExtend(*child, end, vertex);
-          break;
-        }
-      }
-    } else { // else, do hash lookup
-      const RuleTrie::Node *child = node.GetChild(terminal);
-      if (child != NULL) {
-        AddAndExtend(*child, end, vertex);
+    const RuleTrie::Node *child = GetTerminalChild(node, p->first);
+    if (child != NULL) {
+      AddAndExtend(*child, end, p->second);
+    }
+  }
+}
+
+template<typename Callback>
+const RuleTrieCYKPlus::Node *RecursiveCYKPlusParser<Callback>::GetTerminalChild(
+  const RuleTrie::Node &node,
+  const Word &terminal) const
+{
+  const RuleTrie::Node::SymbolMap &terminals = node.GetTerminalMap();
+
+  // if node has small number of terminal edges, test word equality for each.
+  if (terminals.size() < 5) {
+    for (RuleTrie::Node::SymbolMap::const_iterator iter = terminals.begin();
+         iter != terminals.end(); ++iter) {
+      const Word &word = iter->first;
+      if (word == terminal) {
+        return &iter->second;
       }
     }
+    return NULL;
   }
+  // else, do hash lookup
+  return node.GetChild(terminal);
 }
 
 // If a (partial) rule matches, pass it to the callback (if non-unary and
@@ -133,7 +153,8 @@ void RecursiveCYKPlusParser<Callback>::AddAndExtend(
 
   // Add target phrase collection (except if rule is empty or unary).
   TargetPhraseCollection::shared_ptr tpc = node.GetTargetPhraseCollection();
-  if (!tpc->IsEmpty() && !IsNonLexicalUnary(m_hyperedge)) {
+  if (!tpc->IsEmpty() && !IsNonLexicalUnary(m_hyperedge) &&
+      (!m_byWidth || end == m_end)) {
     m_hyperedge.label.translations = tpc;
     (*m_callback)(m_hyperedge, end);
   }
@@ -154,6 +175,189 @@ void RecursiveCYKPlusParser<Callback>::AddAndExtend(
   m_hyperedge.tail.pop_back();
 }
 
+// In the normal mode, the searches of the narrower ranges with the same start
+// have already passed the hyperedges that end at end to the callback.  Pass
+// them on in the same order, but find them by extending the partial rules of
+// those searches by a vertex that ends at end.  The ranges with the same
+// start must be enumerated by the same parser, by increasing end.
+template<typename Callback>
+void RecursiveCYKPlusParser<Callback>::EnumerateHyperedgesByWidth(
+  std::size_t start,
+  std::size_t end)
+{
+  const RuleTrie::Node &rootNode = m_ruleTable.GetRootNode();
+  if (m_partialRules.size() < Base::m_chart.GetWidth()) {
+    m_partialRules.resize(Base::m_chart.GetWidth());
+  }
+  PartialRuleChart &chart = m_partialRules[start];
+  if (end == start) {
+    chart.rules.clear();
+    chart.rulesByNextPos.clear();
+    chart.rulesByNextPos.resize(m_maxEnd+2);
+  }
+  m_newRules.clear();
+
+  // The search of [start,end] in the normal mode: a first vertex that is a
+  // non-terminal covering [start,end-1], which is not a hyperedge on its own
+  // but can be extended by a vertex from end, or a terminal covering
+  // [start,end].
+  if (end > start) {
+    ExtendByNonTerminal(chart, rootNode, NO_PREFIX, start, end-1);
+    std::vector<std::size_t> &extendable = chart.rulesByNextPos[end];
+    extendable.insert(extendable.end(), m_newRules.begin(), m_newRules.end());
+    m_newRules.clear();
+  }
+  ExtendByTerminal(chart, rootNode, NO_PREFIX, start, end);
+
+  // Extend the partial rules of the narrower ranges.
+  for (std::size_t pos = start+1; pos <= end; ++pos) {
+    const std::vector<std::size_t> &prefixes = chart.rulesByNextPos[pos];
+    for (std::size_t i = 0; i < prefixes.size(); ++i) {
+      const RuleTrie::Node &node = *chart.rules[prefixes[i]].node;
+      if (!node.GetTerminalMap().empty()) {
+        ExtendByTerminal(chart, node, prefixes[i], pos, end);
+      }
+      if (!node.GetNonTerminalMap().empty()) {
+        ExtendByNonTerminal(chart, node, prefixes[i], pos, end);
+      }
+    }
+  }
+
+  std::stable_sort(m_newRules.begin(), m_newRules.end(),
+                   PartialRuleOrder(chart.rules));
+  for (std::vector<std::size_t>::const_iterator p = m_newRules.begin();
+       p != m_newRules.end(); ++p) {
+    const RuleTrie::Node &node = *chart.rules[*p].node;
+    TargetPhraseCollection::shared_ptr tpc = node.GetTargetPhraseCollection();
+    if (!tpc->IsEmpty()) {
+      // FIXME Sort out const-ness.
+      m_hyperedge.tail.clear();
+      for (std::size_t r = *p; r != NO_PREFIX; r = chart.rules[r].prefix) {
+        m_hyperedge.tail.push_back(const_cast<PVertex *>(chart.rules[r].vertex));
+      }
+      std::reverse(m_hyperedge.tail.begin(), m_hyperedge.tail.end());
+      m_hyperedge.label.translations = tpc;
+      (*m_callback)(m_hyperedge, end);
+    }
+    if (end < m_maxEnd && (!node.GetTerminalMap().empty() ||
+                           !node.GetNonTerminalMap().empty())) {
+      chart.rulesByNextPos[end+1].push_back(*p);
+    }
+  }
+}
+
+// Extend a partial rule (prefix, with node as its trie node) by a terminal
+// covering [start,end].
+template<typename Callback>
+void RecursiveCYKPlusParser<Callback>::ExtendByTerminal(
+  PartialRuleChart &chart,
+  const RuleTrie::Node &node,
+  std::size_t prefix,
+  std::size_t start,
+  std::size_t end)
+{
+  const PChart::Cell::TMap &vertexMap =
+    Base::m_chart.GetCell(start, end).terminalVertices;
+  std::size_t rank = 0;
+  for (PChart::Cell::TMap::const_iterator p = vertexMap.begin();
+       p != vertexMap.end(); ++p, ++rank) {
+    const RuleTrie::Node *child = GetTerminalChild(node, p->first);
+    if (child == NULL) {
+      continue;
+    }
+    // The search tries the terminals before the non-terminals, and the root
+    // is searched once per end.
+    if (prefix == NO_PREFIX) {
+      AddPartialRule(chart, *child, p->second, prefix, end, 0, rank);
+    } else {
+      AddPartialRule(chart, *child, p->second, prefix, 0, end, rank);
+    }
+  }
+}
+
+// Extend a partial rule (prefix, with node as its trie node) by a non-terminal
+// covering [start,end].
+template<typename Callback>
+void RecursiveCYKPlusParser<Callback>::ExtendByNonTerminal(
+  PartialRuleChart &chart,
+  const RuleTrie::Node &node,
+  std::size_t prefix,
+  std::size_t start,
+  std::size_t end)
+{
+  const RuleTrie::Node::SymbolMap &nonTermMap = node.GetNonTerminalMap();
+  const PChart::CompressedMatrix &matrix =
+    Base::m_chart.GetCompressedMatrix(start);
+  std::size_t edge = 0;
+  for (RuleTrie::Node::SymbolMap::const_iterator p = nonTermMap.begin();
+       p != nonTermMap.end(); ++p, ++edge) {
+    const std::vector<PChart::CompressedItem> &items =
+      matrix[p->first[0]->GetId()];
+    for (std::vector<PChart::CompressedItem>::const_iterator q = items.begin();
+         q != items.end(); ++q) {
+      if (q->end != end) {
+        continue;
+      }
+      // The search from the root that covers [start,end] with a non-terminal
+      // is the one of [start,end+1].
+      if (prefix == NO_PREFIX) {
+        AddPartialRule(chart, p->second, *(q->vertex), prefix, end+1, 1+edge, 0);
+      } else {
+        AddPartialRule(chart, p->second, *(q->vertex), prefix, 1, edge, end);
+      }
+    }
+  }
+}
+
+template<typename Callback>
+void RecursiveCYKPlusParser<Callback>::AddPartialRule(
+  PartialRuleChart &chart,
+  const RuleTrie::Node &node,
+  const PVertex &vertex,
+  std::size_t prefix,
+  std::size_t key0,
+  std::size_t key1,
+  std::size_t key2)
+{
+  PartialRule rule;
+  rule.node = &node;
+  rule.vertex = &vertex;
+  rule.prefix = prefix;
+  rule.depth = (prefix == NO_PREFIX) ? 1 : chart.rules[prefix].depth + 1;
+  rule.key[0] = key0;
+  rule.key[1] = key1;
+  rule.key[2] = key2;
+  m_newRules.push_back(chart.rules.size());
+  chart.rules.push_back(rule);
+}
+
+template<typename Callback>
+bool RecursiveCYKPlusParser<Callback>::PartialRuleOrder::operator()(
+  std::size_t a,
+  std::size_t b) const
+{
+  // Compare the ranks of the first vertices where the rules differ.  A rule
+  // comes after its prefixes.
+  std::size_t depthA = m_rules[a].depth;
+  std::size_t depthB = m_rules[b].depth;
+  const bool isShorter = depthA < depthB;
+  for (; depthA > depthB; --depthA) {
+    a = m_rules[a].prefix;
+  }
+  for (; depthB > depthA; --depthB) {
+    b = m_rules[b].prefix;
+  }
+  if (a == b) {
+    return isShorter;
+  }
+  while (m_rules[a].prefix != m_rules[b].prefix) {
+    a = m_rules[a].prefix;
+    b = m_rules[b].prefix;
+  }
+  return std::lexicographical_compare(m_rules[a].key, m_rules[a].key+3,
+                                      m_rules[b].key, m_rules[b].key+3);
+}
+
 template<typename Callback>
 bool RecursiveCYKPlusParser<Callback>::IsNonLexicalUnary(
   const PHyperedge &hyperedge) const
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "moses/Syntax/PHyperedge.h"
 #include "moses/Syntax/PVertex.h"
 #include "moses/Syntax/S2T/Parsers/Parser.h"
@@ -37,10 +39,17 @@ public:
 
   void EnumerateHyperedges(const Range &, Callback &);
 
+  void SetEnumerateByWidth() {
+    m_byWidth = true;
+  }
+
 private:
 
   void GetTerminalExtension(const RuleTrie::Node &, std::size_t, std::size_t);
 
+  const RuleTrie::Node *GetTerminalChild(const RuleTrie::Node &,
+                                         const Word &) const;
+
   void GetNonTerminalExtensions(const RuleTrie::Node &, std::size_t,
                                 std::size_t, std::size_t);
 
@@ -48,9 +57,62 @@ private:
 
   bool IsNonLexicalUnary(const PHyperedge &) const;
 
+  // By-width mode.  A partial rule is a node of the rule trie together with
+  // the vertices that lead to it from the start of the range.  The partial
+  // rules found from a start are kept, indexed by the position after their
+  // last vertex, and the search of [start,end] only extends them by a vertex
+  // that ends at end.
+  static const std::size_t NO_PREFIX = static_cast<std::size_t>(-1);
+
+  struct PartialRule {
+    const RuleTrie::Node *node;
+    const PVertex *vertex;
+    std::size_t prefix;  // NO_PREFIX if vertex is the first one
+    std::size_t depth;
+    // Rank among the extensions of the prefix, in the order that the
+    // recursive search visits them.
+    std::size_t key[3];
+  };
+
+  struct PartialRuleChart {
+    std::vector<PartialRule> rules;
+    std::vector<std::vector<std::size_t> > rulesByNextPos;
+  };
+
+  // Whether partial rule a is found before partial rule b by the recursive
+  // search.
+  class PartialRuleOrder
+  {
+  public:
+    PartialRuleOrder(const std::vector<PartialRule> &rules) : m_rules(rules) {}
+    bool operator()(std::size_t, std::size_t) const;
+  private:
+    const std::vector<PartialRule> &m_rules;
+  };
+
+  void EnumerateHyperedgesByWidth(std::size_t, std::size_t);
+
+  void ExtendByTerminal(PartialRuleChart &, const RuleTrie::Node &,
+                        std::size_t, std::size_t, std::size_t);
+
+  void ExtendByNonTerminal(PartialRuleChart &, const RuleTrie::Node &,
+                           std::size_t, std::size_t, std::size_t);
+
+  void AddPartialRule(PartialRuleChart &, const RuleTrie::Node &,
+                      const PVertex &, std::size_t, std::size_t, std::size_t,
+                      std::size_t);
+
   const RuleTrie &m_ruleTable;
   const std::size_t m_maxChartSpan;
   std::size_t m_maxEnd;
+  // In by-width mode, the end of the range: hyperedges are passed to the
+  // callback only if they end there.
+  std::size_t m_end;
+  bool m_byWidth;
+  // In by-width mode, the partial rules by start.
+  std::vector<PartialRuleChart> m_partialRules;
+  // The partial rules found by the current search.
+  std::vector<std::size_t> m_newRules;
   PHyperedge m_hyperedge;
   Callback *m_callback;
 };
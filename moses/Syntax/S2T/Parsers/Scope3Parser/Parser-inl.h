@@ -31,12 +31,6 @@ Scope3Parser<Callback>::Scope3Parser(PChart &chart, const RuleTrie &trie,
   Init();
 }
 
-template<typename Callback>
-Scope3Parser<Callback>::~Scope3Parser()
-{
-  delete m_patRoot;
-}
-
 template<typename Callback>
 void Scope3Parser<Callback>::
 EnumerateHyperedges(const Range &range, Callback &callback)
@@ -105,7 +99,7 @@ void Scope3Parser<Callback>::Init()
 
   // Build the pattern application trie (PAT) for this input sentence.
   const RuleTrie::Node &root = m_ruleTable.GetRootNode();
-  m_patRoot = new PatternApplicationTrie(-1, -1, root, 0, 0);
+  m_patRoot.reset(new PatternApplicationTrie(-1, -1, root, 0, 0));
   m_patRoot->Extend(root, -1, sentMap, false);
 
   // Generate per-span lists of PAT node pointers.
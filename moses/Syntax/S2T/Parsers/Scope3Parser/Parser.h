@@ -3,6 +3,8 @@
 #include <memory>
 #include <vector>
 
+#include <boost/shared_ptr.hpp>
+
 #include "moses/Syntax/S2T/Parsers/Parser.h"
 #include "moses/Syntax/S2T/RuleTrieScope3.h"
 #include "moses/Range.h"
@@ -39,7 +41,7 @@ public:
 
   Scope3Parser(PChart &, const RuleTrie &, std::size_t);
 
-  ~Scope3Parser();
+  ~Scope3Parser() {}
 
   void EnumerateHyperedges(const Range &, Callback &);
 
@@ -49,7 +51,8 @@ private:
   void FillSentenceMap(SentenceMap &);
   void RecordPatternApplicationSpans(const PatternApplicationTrie &);
 
-  PatternApplicationTrie *m_patRoot;
+  // Shared by the copies of the parser, which are made after Init().
+  boost::shared_ptr<PatternApplicationTrie> m_patRoot;
   std::vector<std::vector<bool> > m_quickCheckTable;
   const RuleTrie &m_ruleTable;
   const std::size_t m_maxChartSpan;
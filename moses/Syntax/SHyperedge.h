@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "moses/Phrase.h"
+#include "moses/SentenceArena.h"
 
 #include "SLabel.h"
 
@@ -13,7 +14,7 @@ namespace Syntax
 
 struct SVertex;
 
-struct SHyperedge {
+struct SHyperedge : public ArenaAllocated {
   SVertex *head;
   std::vector<SVertex*> tail;
   SLabel label;
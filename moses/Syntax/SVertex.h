@@ -2,6 +2,8 @@
 
 #include <vector>
 
+#include "moses/SentenceArena.h"
+
 namespace Moses
 {
 
@@ -17,7 +19,10 @@ struct SHyperedge;
 //
 // Important: a SVertex owns its incoming SHyperedge objects and its FFState
 // objects and will delete them on destruction.
-struct SVertex {
+//
+// Like the SHyperedges, SVertex objects are allocated from the sentence arena
+// (if there is one) since cube pruning creates and discards many of them.
+struct SVertex : public ArenaAllocated {
   ~SVertex();
 
   SHyperedge *best;
@@ -64,6 +64,8 @@ private:
 private:
   friend std::ostream& operator<<(std::ostream&, const TargetPhrase&);
   friend void swap(TargetPhrase &first, TargetPhrase &second);
+  friend class SnapshotWriter;
+  friend class SnapshotReader;
 
   float m_futureScore, m_estimatedScore;
   ScoreComponentCollection m_scoreBreakdown;
@@ -20,9 +20,15 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
 
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
 #include "ThreadPool.h"
 
 #ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#endif
 
 using namespace std;
 using namespace Moses;
@@ -30,35 +36,182 @@ using namespace Moses;
 namespace Moses
 {
 
+namespace
+{
+
+/** Counts down the sub-tasks of one RunSubTasks() call */
+class SubTaskGroup
+{
+public:
+  explicit SubTaskGroup(size_t numTasks) : m_remaining(numTasks), m_failed(false) {}
+
+  void Done(const std::string *error) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    if (error && !m_failed) {
+      m_failed = true;
+      m_error = *error;
+    }
+    if (--m_remaining == 0) {
+#ifdef WITH_THREADS
+      m_finished.notify_all();
+#endif
+    }
+  }
+
+  bool IsDone() {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    return m_remaining == 0;
+  }
+
+  void Wait() {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (m_remaining) m_finished.wait(lock);
+#endif
+    if (m_failed) {
+      throw runtime_error("Sub-task failed: " + m_error);
+    }
+  }
+
+private:
+  size_t m_remaining;
+  bool m_failed;
+  std::string m_error;
+#ifdef WITH_THREADS
+  boost::mutex m_mutex;
+  boost::condition_variable m_finished;
+#endif
+};
+
+/** Runs a sub-task and reports to its group, whichever thread runs it */
+class SubTask : public Task
+{
+public:
+  SubTask(boost::shared_ptr<Task> const& task, SubTaskGroup &group)
+    : m_task(task), m_group(group) {}
+
+  virtual void Run() {
+    try {
+      m_task->Run();
+    } catch (const std::exception &e) {
+      std::string error(e.what());
+      m_group.Done(&error);
+      return;
+    }
+    m_group.Done(NULL);
+  }
+
+private:
+  boost::shared_ptr<Task> m_task;
+  SubTaskGroup &m_group;
+};
+
+}
+
+#ifdef WITH_THREADS
+
+boost::thread_specific_ptr<ThreadPool::Worker> ThreadPool::s_worker(&ThreadPool::NoCleanup);
+
 ThreadPool::ThreadPool( size_t numThreads )
-  : m_stopped(false), m_stopping(false), m_queueLimit(0)
+  : m_nextSeq(0), m_stopped(false), m_stopping(false), m_queueLimit(0)
+  , m_signal(0), m_numIdle(0)
 {
+  m_queueOrder.longestFirst = false;
+  for (size_t i = 0; i < numThreads; ++i) {
+    m_workers.push_back(new Worker);
+    m_workers.back()->pool = this;
+  }
   for (size_t i = 0; i < numThreads; ++i) {
-    m_threads.create_thread(boost::bind(&ThreadPool::Execute,this));
+    m_threads.create_thread(boost::bind(&ThreadPool::Execute,this,i));
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  Stop();
+  for (size_t i = 0; i < m_workers.size(); ++i) {
+    delete m_workers[i];
   }
 }
 
-void ThreadPool::Execute()
+boost::shared_ptr<Task> ThreadPool::Worker::PopBack()
 {
-  do {
+  boost::shared_ptr<Task> task;
+  boost::mutex::scoped_lock lock(mutex);
+  if (!tasks.empty()) {
+    task = tasks.back();
+    tasks.pop_back();
+  }
+  return task;
+}
+
+boost::shared_ptr<Task> ThreadPool::Worker::PopFront()
+{
+  boost::shared_ptr<Task> task;
+  boost::mutex::scoped_lock lock(mutex);
+  if (!tasks.empty()) {
+    task = tasks.front();
+    tasks.pop_front();
+  }
+  return task;
+}
+
+boost::shared_ptr<Task> ThreadPool::Steal(size_t thief)
+{
+  boost::shared_ptr<Task> task;
+  for (size_t i = 1; i < m_workers.size() && !task; ++i) {
+    task = m_workers[(thief + i) % m_workers.size()]->PopFront();
+  }
+  return task;
+}
+
+void ThreadPool::Notify()
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  ++m_signal;
+  if (m_numIdle) m_threadNeeded.notify_all();
+}
+
+void ThreadPool::Execute(size_t id)
+{
+  s_worker.reset(m_workers[id]);
+  while (true) {
     boost::shared_ptr<Task> task;
+    size_t signal;
     {
       // Find a job to perform
       boost::mutex::scoped_lock lock(m_mutex);
-      if (m_tasks.empty() && !m_stopped) {
-        m_threadNeeded.wait(lock);
-      }
-      if (!m_stopped && !m_tasks.empty()) {
-        task = m_tasks.front();
-        m_tasks.pop();
+      if (m_stopped) break;
+      signal = m_signal;
+      if (!m_tasks.empty()) {
+        pop_heap(m_tasks.begin(), m_tasks.end(), m_queueOrder);
+        task = m_tasks.back().task;
+        m_tasks.pop_back();
+        m_threadAvailable.notify_all();
       }
     }
+    // otherwise help out with somebody's sub-tasks
+    if (!task) task = Steal(id);
+
     //Execute job
     if (task) {
       task->Run();
+      continue;
+    }
+
+    // nothing to do, sleep until work is added
+    boost::mutex::scoped_lock lock(m_mutex);
+    ++m_numIdle;
+    while (m_signal == signal && !m_stopped) {
+      m_threadNeeded.wait(lock);
     }
-    m_threadAvailable.notify_all();
-  } while (!m_stopped);
+    --m_numIdle;
+  }
+  s_worker.reset();
 }
 
 void ThreadPool::Submit(boost::shared_ptr<Task> task)
@@ -70,10 +223,23 @@ void ThreadPool::Submit(boost::shared_ptr<Task> task)
   while (m_queueLimit > 0 && m_tasks.size() >= m_queueLimit) {
     m_threadAvailable.wait(lock);
   }
-  m_tasks.push(task);
+  QueuedTask queued;
+  queued.task = task;
+  queued.cost = task->GetCost();
+  queued.seq = m_nextSeq++;
+  m_tasks.push_back(queued);
+  push_heap(m_tasks.begin(), m_tasks.end(), m_queueOrder);
+  ++m_signal;
   m_threadNeeded.notify_all();
 }
 
+void ThreadPool::SetLongestFirst(bool longestFirst)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_queueOrder.longestFirst = longestFirst;
+  make_heap(m_tasks.begin(), m_tasks.end(), m_queueOrder);
+}
+
 void ThreadPool::Stop(bool processRemainingJobs)
 {
   {
@@ -99,6 +265,42 @@ void ThreadPool::Stop(bool processRemainingJobs)
   m_threads.join_all();
 }
 
+void RunSubTasks(const std::vector<boost::shared_ptr<Task> > &tasks)
+{
+  ThreadPool::Worker *worker = ThreadPool::s_worker.get();
+  if (worker == NULL || tasks.size() < 2) {
+    for (size_t i = 0; i < tasks.size(); ++i) tasks[i]->Run();
+    return;
+  }
+
+  // push in reverse, so that the owner works from the first task on and
+  // thieves take the last ones
+  SubTaskGroup group(tasks.size());
+  {
+    boost::mutex::scoped_lock lock(worker->mutex);
+    for (size_t i = tasks.size(); i > 0; --i) {
+      worker->tasks.push_back(boost::shared_ptr<Task>(new SubTask(tasks[i - 1], group)));
+    }
+  }
+  worker->pool->Notify();
+
+  // only take work from our own deque: stolen work from another sentence
+  // could end up blocking this one
+  while (!group.IsDone()) {
+    boost::shared_ptr<Task> task = worker->PopBack();
+    if (!task) break;
+    task->Run();
+  }
+  group.Wait();
+}
+
+#else
+
+void RunSubTasks(const std::vector<boost::shared_ptr<Task> > &tasks)
+{
+  for (size_t i = 0; i < tasks.size(); ++i) tasks[i]->Run();
 }
+
 #endif //WITH_THREADS
 
+}
@@ -22,10 +22,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_ThreadPool_h
 #define moses_ThreadPool_h
 
+#include <deque>
 #include <iostream>
 #include <queue>
 #include <vector>
 
+#include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
 
 #ifdef WITH_THREADS
@@ -54,10 +56,47 @@ class Task
 public:
   virtual void Run() = 0;
   virtual ~Task() {}
+
+  /**
+   * Rough estimate of the amount of work in this task (e.g. the input
+   * length). Only used to order the queue if longest-first is enabled.
+   **/
+  virtual size_t GetCost() const {
+    return 0;
+  }
 };
 
+/** Task that calls a function object, e.g. the result of boost::bind() */
+class FunctionTask : public Task
+{
+public:
+  explicit FunctionTask(const boost::function<void()> &func) : m_func(func) {}
+
+  virtual void Run() {
+    m_func();
+  }
+
+private:
+  boost::function<void()> m_func;
+};
+
+/**
+ * Run a set of sub-tasks and return once all of them have finished.
+ * Called from within a ThreadPool job, the sub-tasks are put on the
+ * calling worker's deque, from where idle workers can steal them, while
+ * the caller works through the rest itself. Otherwise they are simply run
+ * one after the other.
+ **/
+void RunSubTasks(const std::vector<boost::shared_ptr<Task> > &tasks);
+
 #ifdef WITH_THREADS
 
+/**
+ * Work-stealing thread pool. Jobs submitted from outside go to a shared
+ * queue. Sub-tasks spawned by a running job (see RunSubTasks()) go to a
+ * deque owned by the worker thread: the owner takes them from the back,
+ * idle workers steal from the front.
+ **/
 class ThreadPool
 {
 public:
@@ -66,9 +105,7 @@ public:
    **/
   explicit ThreadPool(size_t numThreads);
 
-  ~ThreadPool() {
-    Stop();
-  }
+  ~ThreadPool();
 
   /**
    * Add a job to the threadpool.
@@ -88,13 +125,58 @@ public:
     m_queueLimit = limit;
   }
 
+  /**
+   * Start queued jobs with the highest Task::GetCost() first instead of in
+   * submission order, so that long sentences do not end up as stragglers
+   * at the end of a batch.
+   **/
+  void SetLongestFirst(bool longestFirst);
+
 private:
+  friend void RunSubTasks(const std::vector<boost::shared_ptr<Task> > &tasks);
+
+  struct QueuedTask {
+    boost::shared_ptr<Task> task;
+    size_t cost;
+    size_t seq;
+  };
+
+  /** heap order: lowest priority at the top of the std::*_heap functions */
+  struct QueueOrder {
+    bool longestFirst;
+    bool operator()(const QueuedTask &a, const QueuedTask &b) const {
+      if (longestFirst && a.cost != b.cost) return a.cost < b.cost;
+      return a.seq > b.seq;
+    }
+  };
+
+  /** per-thread deque of sub-tasks */
+  struct Worker {
+    ThreadPool *pool;
+    boost::mutex mutex;
+    std::deque<boost::shared_ptr<Task> > tasks;
+
+    boost::shared_ptr<Task> PopBack();
+    boost::shared_ptr<Task> PopFront();
+  };
+
   /**
    * The main loop executed by each thread.
    **/
-  void Execute();
+  void Execute(size_t id);
+
+  boost::shared_ptr<Task> Steal(size_t thief);
+  void Notify();
+
+  //! the worker the calling thread belongs to, if any
+  static boost::thread_specific_ptr<Worker> s_worker;
+  //! workers are owned by their ThreadPool, not by the thread
+  static void NoCleanup(Worker *) {}
 
-  std::queue<boost::shared_ptr<Task> > m_tasks;
+  std::vector<QueuedTask> m_tasks;
+  QueueOrder m_queueOrder;
+  size_t m_nextSeq;
+  std::vector<Worker*> m_workers;
   boost::thread_group m_threads;
   boost::mutex m_mutex;
   boost::condition_variable m_threadNeeded;
@@ -102,6 +184,8 @@ private:
   bool m_stopped;
   bool m_stopping;
   size_t m_queueLimit;
+  size_t m_signal; /**< bumped whenever work is added */
+  size_t m_numIdle;
 };
 
 class TestTask : public Task
@@ -0,0 +1,171 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+#include "ThreadPool.h"
+
+using namespace Moses;
+using namespace std;
+
+#ifdef WITH_THREADS
+
+namespace
+{
+
+class CountingTask : public Task
+{
+public:
+  CountingTask(size_t &counter, boost::mutex &mutex, size_t cost = 0)
+    : m_counter(counter), m_mutex(mutex), m_cost(cost) {}
+
+  virtual void Run() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    ++m_counter;
+  }
+
+  virtual size_t GetCost() const {
+    return m_cost;
+  }
+
+protected:
+  size_t &m_counter;
+  boost::mutex &m_mutex;
+  size_t m_cost;
+};
+
+class SplittingTask : public CountingTask
+{
+public:
+  SplittingTask(size_t &counter, boost::mutex &mutex, size_t numSubTasks)
+    : CountingTask(counter, mutex), m_numSubTasks(numSubTasks) {}
+
+  virtual void Run() {
+    vector<boost::shared_ptr<Task> > tasks;
+    for (size_t i = 0; i < m_numSubTasks; ++i) {
+      tasks.push_back(boost::shared_ptr<Task>(new CountingTask(m_counter, m_mutex)));
+    }
+    RunSubTasks(tasks);
+    CountingTask::Run();
+  }
+
+private:
+  size_t m_numSubTasks;
+};
+
+class RecordingTask : public Task
+{
+public:
+  RecordingTask(vector<size_t> &order, size_t cost) : m_order(order), m_cost(cost) {}
+
+  virtual void Run() {
+    m_order.push_back(m_cost);
+  }
+
+  virtual size_t GetCost() const {
+    return m_cost;
+  }
+
+private:
+  vector<size_t> &m_order;
+  size_t m_cost;
+};
+
+class BlockingTask : public Task
+{
+public:
+  explicit BlockingTask(boost::barrier &barrier) : m_barrier(barrier) {}
+
+  virtual void Run() {
+    m_barrier.wait();
+    m_barrier.wait();
+  }
+
+private:
+  boost::barrier &m_barrier;
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(thread_pool)
+
+BOOST_AUTO_TEST_CASE(runs_all_tasks)
+{
+  size_t counter = 0;
+  boost::mutex mutex;
+  {
+    ThreadPool pool(4);
+    for (size_t i = 0; i < 100; ++i) {
+      pool.Submit(boost::shared_ptr<Task>(new CountingTask(counter, mutex)));
+    }
+    pool.Stop(true);
+  }
+  BOOST_CHECK_EQUAL(counter, 100);
+}
+
+BOOST_AUTO_TEST_CASE(runs_all_sub_tasks)
+{
+  size_t counter = 0;
+  boost::mutex mutex;
+  {
+    ThreadPool pool(4);
+    for (size_t i = 0; i < 50; ++i) {
+      pool.Submit(boost::shared_ptr<Task>(new SplittingTask(counter, mutex, i % 10)));
+    }
+    pool.Stop(true);
+  }
+  // 50 parents with 0..9 sub-tasks each
+  BOOST_CHECK_EQUAL(counter, 50 + 5 * 45);
+}
+
+BOOST_AUTO_TEST_CASE(sub_tasks_outside_pool)
+{
+  size_t counter = 0;
+  boost::mutex mutex;
+  SplittingTask task(counter, mutex, 7);
+  task.Run();
+  BOOST_CHECK_EQUAL(counter, 8);
+}
+
+BOOST_AUTO_TEST_CASE(longest_first)
+{
+  vector<size_t> order;
+  boost::barrier barrier(2);
+  ThreadPool pool(1);
+  pool.SetLongestFirst(true);
+
+  // keep the only worker busy until everything is queued
+  pool.Submit(boost::shared_ptr<Task>(new BlockingTask(barrier)));
+  barrier.wait();
+  size_t costs[] = { 3, 120, 5, 5, 40 };
+  for (size_t i = 0; i < 5; ++i) {
+    pool.Submit(boost::shared_ptr<Task>(new RecordingTask(order, costs[i])));
+  }
+  barrier.wait();
+  pool.Stop(true);
+
+  size_t expected[] = { 120, 40, 5, 5, 3 };
+  BOOST_CHECK_EQUAL_COLLECTIONS(order.begin(), order.end(), expected, expected + 5);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
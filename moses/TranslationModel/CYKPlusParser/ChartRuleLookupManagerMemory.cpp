@@ -41,6 +41,7 @@ ChartRuleLookupManagerMemory::ChartRuleLookupManagerMemory(
   const PhraseDictionaryMemory &ruleTable)
   : ChartRuleLookupManagerCYKPlus(parser, cellColl)
   , m_ruleTable(ruleTable)
+  , m_compactTrie(ruleTable.GetCompactTrie())
   , m_softMatchingMap(StaticData::Instance().GetSoftMatches())
 {
 
@@ -57,6 +58,11 @@ void ChartRuleLookupManagerMemory::GetChartRuleCollection(
   ChartParserCallback &outColl)
 {
   const Range &range = inputPath.GetWordsRange();
+  if (IsLookupByWidth()) {
+    GetChartRuleCollectionByWidth(range, outColl);
+    return;
+  }
+
   size_t startPos = range.GetStartPos();
   size_t absEndPos = range.GetEndPos();
 
@@ -69,15 +75,13 @@ void ChartRuleLookupManagerMemory::GetChartRuleCollection(
   // create/update data structure to quickly look up all chart cells that match start position and label.
   UpdateCompressedMatrix(startPos, absEndPos, lastPos);
 
-  const PhraseDictionaryNodeMemory &rootNode = m_ruleTable.GetRootNode();
-
   // all rules starting with terminal
   if (startPos == absEndPos) {
-    GetTerminalExtension(&rootNode, startPos);
+    GetRootTerminalExtension(startPos);
   }
   // all rules starting with nonterminal
   else if (absEndPos > startPos) {
-    GetNonTerminalExtension(&rootNode, startPos);
+    GetRootNonTerminalExtension(startPos);
   }
 
   // copy temporarily stored rules to out collection
@@ -132,38 +136,101 @@ void ChartRuleLookupManagerMemory::UpdateCompressedMatrix(size_t startPos,
   cellMatrix.clear();
   cellMatrix.resize(numNonTerms);
   for (std::vector<size_t>::iterator p = endPosVec.begin(); p != endPosVec.end(); ++p) {
+    AddToCompressedMatrix(cellMatrix, startPos, *p);
+  }
+}
 
-    size_t endPos = *p;
-    // target non-terminal labels for the span
-    const ChartCellLabelSet &targetNonTerms = GetTargetLabelSet(startPos, endPos);
+// add the chart cell [startPos, endPos] to the compressed matrix of startPos
+void ChartRuleLookupManagerMemory::AddToCompressedMatrix(CompressedMatrix &cellMatrix,
+    size_t startPos,
+    size_t endPos)
+{
+  // target non-terminal labels for the span
+  const ChartCellLabelSet &targetNonTerms = GetTargetLabelSet(startPos, endPos);
 
-    if (targetNonTerms.GetSize() == 0) {
-      continue;
-    }
+  if (targetNonTerms.GetSize() == 0) {
+    return;
+  }
 
 #if !defined(UNLABELLED_SOURCE)
-    // source non-terminal labels for the span
-    const InputPath &inputPath = GetParser().GetInputPath(startPos, endPos);
+  // source non-terminal labels for the span
+  const InputPath &inputPath = GetParser().GetInputPath(startPos, endPos);
 
-    // can this ever be true? Moses seems to pad the non-terminal set of the input with [X]
-    if (inputPath.GetNonTerminalSet().size() == 0) {
-      continue;
-    }
+  // can this ever be true? Moses seems to pad the non-terminal set of the input with [X]
+  if (inputPath.GetNonTerminalSet().size() == 0) {
+    return;
+  }
 #endif
 
-    for (size_t i = 0; i < numNonTerms; i++) {
-      const ChartCellLabel *cellLabel = targetNonTerms.Find(i);
-      if (cellLabel != NULL) {
-        float score = cellLabel->GetBestScore(m_outColl);
-        cellMatrix[i].push_back(ChartCellCache(endPos, cellLabel, score));
-      }
+  size_t numNonTerms = cellMatrix.size();
+  for (size_t i = 0; i < numNonTerms; i++) {
+    const ChartCellLabel *cellLabel = targetNonTerms.Find(i);
+    if (cellLabel != NULL) {
+      float score = cellLabel->GetBestScore(m_outColl);
+      cellMatrix[i].push_back(ChartCellCache(endPos, cellLabel, score));
     }
   }
 }
 
+/* Look up the rules of one span without relying on the spans looked up
+ * before in the order of ChartManager::Decode(), so that the cells of one
+ * width can be decoded concurrently, with one lookup manager each. The
+ * spans of a start position are always looked up by the same lookup
+ * manager, which keeps the partial rules found from there.
+ */
+void ChartRuleLookupManagerMemory::GetChartRuleCollectionByWidth(
+  const Range &range,
+  ChartParserCallback &outColl)
+{
+  size_t startPos = range.GetStartPos();
+  size_t endPos = range.GetEndPos();
+  CompletedRuleCollection &rules = m_completedRules[endPos];
+
+  if (m_compactTrie) {
+    if (m_compactCharts.empty()) {
+      m_compactCharts.resize(m_completedRules.size());
+    }
+    m_compactCharts[startPos].GetChartRuleCollection(
+      *this, m_compactTrie->GetRootNode(), startPos, endPos,
+      m_softMatchingMap, outColl, rules);
+  } else {
+    if (m_memoryCharts.empty()) {
+      m_memoryCharts.resize(m_completedRules.size());
+    }
+    m_memoryCharts[startPos].GetChartRuleCollection(
+      *this, m_ruleTable.GetRootNode(), startPos, endPos,
+      m_softMatchingMap, outColl, rules);
+  }
+
+  for (vector<CompletedRule*>::const_iterator iter = rules.begin(); iter != rules.end(); ++iter) {
+    outColl.Add((*iter)->GetTPC(), (*iter)->GetStackVector(), range);
+  }
+
+  rules.Clear();
+}
+
+void ChartRuleLookupManagerMemory::GetRootTerminalExtension(size_t pos)
+{
+  if (m_compactTrie) {
+    GetTerminalExtension(&m_compactTrie->GetRootNode(), pos);
+  } else {
+    GetTerminalExtension(&m_ruleTable.GetRootNode(), pos);
+  }
+}
+
+void ChartRuleLookupManagerMemory::GetRootNonTerminalExtension(size_t startPos)
+{
+  if (m_compactTrie) {
+    GetNonTerminalExtension(&m_compactTrie->GetRootNode(), startPos);
+  } else {
+    GetNonTerminalExtension(&m_ruleTable.GetRootNode(), startPos);
+  }
+}
+
 // if a (partial) rule matches, add it to list completed rules (if non-unary and non-empty), and try find expansions that have this partial rule as prefix.
+template <class Node>
 void ChartRuleLookupManagerMemory::AddAndExtend(
-  const PhraseDictionaryNodeMemory *node,
+  const Node *node,
   size_t endPos)
 {
 
@@ -175,24 +242,22 @@ void ChartRuleLookupManagerMemory::AddAndExtend(
 
   // get all further extensions of rule (until reaching end of sentence or max-chart-span)
   if (endPos < m_lastPos) {
-    if (!node->GetTerminalMap().empty()) {
+    if (node->HasTerminals()) {
       GetTerminalExtension(node, endPos+1);
     }
-    if (!node->GetNonTerminalMap().empty()) {
+    if (node->HasNonTerminals()) {
       GetNonTerminalExtension(node, endPos+1);
     }
   }
 }
 
+namespace
+{
 
-// search all possible terminal extensions of a partial rule (pointed at by node) at a given position
-// recursively try to expand partial rules into full rules up to m_lastPos.
-void ChartRuleLookupManagerMemory::GetTerminalExtension(
+const PhraseDictionaryNodeMemory *FindTerminalChild(
   const PhraseDictionaryNodeMemory *node,
-  size_t pos)
+  const Word &sourceWord)
 {
-
-  const Word &sourceWord = GetSourceAt(pos).GetLabel();
   const PhraseDictionaryNodeMemory::TerminalMap & terminals = node->GetTerminalMap();
 
   // if node has small number of terminal edges, test word equality for each.
@@ -200,18 +265,35 @@ void ChartRuleLookupManagerMemory::GetTerminalExtension(
     for (PhraseDictionaryNodeMemory::TerminalMap::const_iterator iter = terminals.begin(); iter != terminals.end(); ++iter) {
       const Word & word = iter->first;
       if (TerminalEqualityPred()(word, sourceWord)) {
-        const PhraseDictionaryNodeMemory *child = & iter->second;
-        AddAndExtend(child, pos);
-        break;
+        return & iter->second;
       }
     }
+    return NULL;
   }
   // else, do hash lookup
-  else {
-    const PhraseDictionaryNodeMemory *child = node->GetChild(sourceWord);
-    if (child != NULL) {
-      AddAndExtend(child, pos);
-    }
+  return node->GetChild(sourceWord);
+}
+
+const CompactRuleTrie::Node *FindTerminalChild(
+  const CompactRuleTrie::Node *node,
+  const Word &sourceWord)
+{
+  return node->GetChild(sourceWord);
+}
+
+} // namespace
+
+// search all possible terminal extensions of a partial rule (pointed at by node) at a given position
+// recursively try to expand partial rules into full rules up to m_lastPos.
+template <class Node>
+void ChartRuleLookupManagerMemory::GetTerminalExtension(
+  const Node *node,
+  size_t pos)
+{
+  const Word &sourceWord = GetSourceAt(pos).GetLabel();
+  const Node *child = FindTerminalChild(node, sourceWord);
+  if (child != NULL) {
+    AddAndExtend(child, pos);
   }
 }
 
@@ -241,30 +323,64 @@ void ChartRuleLookupManagerMemory::GetNonTerminalExtension(
 #else
     const Word &targetNonTerm = p->first.second;
 #endif
-    const PhraseDictionaryNodeMemory *child = &p->second;
-    //soft matching of NTs
-    if (m_isSoftMatching && !m_softMatchingMap[targetNonTerm[0]->GetId()].empty()) {
-      const std::vector<Word>& softMatches = m_softMatchingMap[targetNonTerm[0]->GetId()];
-      for (std::vector<Word>::const_iterator softMatch = softMatches.begin(); softMatch != softMatches.end(); ++softMatch) {
-        const CompressedColumn &matches = compressedMatrix[(*softMatch)[0]->GetId()];
-        for (CompressedColumn::const_iterator match = matches.begin(); match != matches.end(); ++match) {
-          m_stackVec.back() = match->cellLabel;
-          m_stackScores.back() = match->score;
-          AddAndExtend(child, match->endPos);
-        }
-      }
-    } // end of soft matches lookup
+    ExtendNonTerminal(&p->second, targetNonTerm[0]->GetId(), compressedMatrix);
+  }
+  // remove last back pointer
+  m_stackVec.pop_back();
+  m_stackScores.pop_back();
+}
+
+// same as above, on the compact trie: the edges are in one block, so the
+// child of the next edge can be prefetched while this one is extended.
+void ChartRuleLookupManagerMemory::GetNonTerminalExtension(
+  const CompactRuleTrie::Node *node,
+  size_t startPos)
+{
+  const CompressedMatrix &compressedMatrix = m_compressedMatrixVec[startPos];
+
+  // make room for back pointer
+  m_stackVec.push_back(NULL);
+  m_stackScores.push_back(0);
 
-    const CompressedColumn &matches = compressedMatrix[targetNonTerm[0]->GetId()];
-    for (CompressedColumn::const_iterator match = matches.begin(); match != matches.end(); ++match) {
-      m_stackVec.back() = match->cellLabel;
-      m_stackScores.back() = match->score;
-      AddAndExtend(child, match->endPos);
+  const CompactRuleTrie::NonTerminalEdge *end = node->EndNonTerminals();
+  for (const CompactRuleTrie::NonTerminalEdge *p = node->BeginNonTerminals(); p != end; ++p) {
+    if (p + 1 != end) {
+      p[1].child->Prefetch();
     }
+    ExtendNonTerminal(p->child, p->targetNonTerm->GetId(), compressedMatrix);
   }
   // remove last back pointer
   m_stackVec.pop_back();
   m_stackScores.pop_back();
 }
 
+// extend a partial rule by a non-terminal with the label targetNonTermId,
+// once for every chart cell in compressedMatrix that it matches.
+template <class Node>
+void ChartRuleLookupManagerMemory::ExtendNonTerminal(
+  const Node *child,
+  size_t targetNonTermId,
+  const CompressedMatrix &compressedMatrix)
+{
+  //soft matching of NTs
+  if (m_isSoftMatching && !m_softMatchingMap[targetNonTermId].empty()) {
+    const std::vector<Word>& softMatches = m_softMatchingMap[targetNonTermId];
+    for (std::vector<Word>::const_iterator softMatch = softMatches.begin(); softMatch != softMatches.end(); ++softMatch) {
+      const CompressedColumn &matches = compressedMatrix[(*softMatch)[0]->GetId()];
+      for (CompressedColumn::const_iterator match = matches.begin(); match != matches.end(); ++match) {
+        m_stackVec.back() = match->cellLabel;
+        m_stackScores.back() = match->score;
+        AddAndExtend(child, match->endPos);
+      }
+    }
+  } // end of soft matches lookup
+
+  const CompressedColumn &matches = compressedMatrix[targetNonTermId];
+  for (CompressedColumn::const_iterator match = matches.begin(); match != matches.end(); ++match) {
+    m_stackVec.back() = match->cellLabel;
+    m_stackScores.back() = match->score;
+    AddAndExtend(child, match->endPos);
+  }
+}
+
 }  // namespace Moses
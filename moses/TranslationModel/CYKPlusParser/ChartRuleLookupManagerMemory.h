@@ -23,9 +23,11 @@
 
 #include "ChartRuleLookupManagerCYKPlus.h"
 #include "CompletedRuleCollection.h"
+#include "PartialRuleChart.h"
 #include "moses/NonTerminal.h"
 #include "moses/TranslationModel/PhraseDictionaryMemory.h"
 #include "moses/TranslationModel/PhraseDictionaryNodeMemory.h"
+#include "moses/TranslationModel/RuleTable/CompactRuleTrie.h"
 #include "moses/StackVec.h"
 
 namespace Moses
@@ -34,7 +36,10 @@ namespace Moses
 class ChartParserCallback;
 class Range;
 
-//! Implementation of ChartRuleLookupManager for in-memory rule tables.
+/** Implementation of ChartRuleLookupManager for in-memory rule tables.
+ *  Walks the compact copy of the rule trie if the table has one, the
+ *  original trie otherwise.
+ */
 class ChartRuleLookupManagerMemory : public ChartRuleLookupManagerCYKPlus
 {
 public:
@@ -53,25 +58,54 @@ public:
     size_t lastPos, // last position to consider if using lookahead
     ChartParserCallback &outColl);
 
+  virtual bool CanLookupByWidth() const {
+    return true;
+  }
+
 private:
 
+  void GetChartRuleCollectionByWidth(
+    const Range &range,
+    ChartParserCallback &outColl);
+
+  void GetRootTerminalExtension(size_t pos);
+
+  void GetRootNonTerminalExtension(size_t startPos);
+
+  template <class Node>
   void GetTerminalExtension(
-    const PhraseDictionaryNodeMemory *node,
+    const Node *node,
     size_t pos);
 
   void GetNonTerminalExtension(
     const PhraseDictionaryNodeMemory *node,
     size_t startPos);
 
+  void GetNonTerminalExtension(
+    const CompactRuleTrie::Node *node,
+    size_t startPos);
+
+  template <class Node>
+  void ExtendNonTerminal(
+    const Node *child,
+    size_t targetNonTermId,
+    const CompressedMatrix &compressedMatrix);
+
+  template <class Node>
   void AddAndExtend(
-    const PhraseDictionaryNodeMemory *node,
+    const Node *node,
     size_t endPos);
 
   void UpdateCompressedMatrix(size_t startPos,
                               size_t endPos,
                               size_t lastPos);
 
+  void AddToCompressedMatrix(CompressedMatrix &cellMatrix,
+                             size_t startPos,
+                             size_t endPos);
+
   const PhraseDictionaryMemory &m_ruleTable;
+  const CompactRuleTrie *m_compactTrie;
 
   // permissible soft nonterminal matches (target side)
   bool m_isSoftMatching;
@@ -90,6 +124,9 @@ private:
 
   std::vector<CompressedMatrix> m_compressedMatrixVec;
 
+  // partial rules by start position, when looking up by width
+  std::vector<PartialRuleChart<PhraseDictionaryNodeMemory> > m_memoryCharts;
+  std::vector<PartialRuleChart<CompactRuleTrie::Node> > m_compactCharts;
 
 };
 
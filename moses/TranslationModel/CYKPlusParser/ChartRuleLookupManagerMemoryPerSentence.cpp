@@ -57,6 +57,11 @@ void ChartRuleLookupManagerMemoryPerSentence::GetChartRuleCollection(
   ChartParserCallback &outColl)
 {
   const Range &range = inputPath.GetWordsRange();
+  if (IsLookupByWidth()) {
+    GetChartRuleCollectionByWidth(range, outColl);
+    return;
+  }
+
   size_t startPos = range.GetStartPos();
   size_t absEndPos = range.GetEndPos();
 
@@ -132,36 +137,68 @@ void ChartRuleLookupManagerMemoryPerSentence::UpdateCompressedMatrix(size_t star
   cellMatrix.clear();
   cellMatrix.resize(numNonTerms);
   for (std::vector<size_t>::iterator p = endPosVec.begin(); p != endPosVec.end(); ++p) {
+    AddToCompressedMatrix(cellMatrix, startPos, *p);
+  }
+}
 
-    size_t endPos = *p;
-    // target non-terminal labels for the span
-    const ChartCellLabelSet &targetNonTerms = GetTargetLabelSet(startPos, endPos);
+// add the chart cell [startPos, endPos] to the compressed matrix of startPos
+void ChartRuleLookupManagerMemoryPerSentence::AddToCompressedMatrix(CompressedMatrix &cellMatrix,
+    size_t startPos,
+    size_t endPos)
+{
+  // target non-terminal labels for the span
+  const ChartCellLabelSet &targetNonTerms = GetTargetLabelSet(startPos, endPos);
 
-    if (targetNonTerms.GetSize() == 0) {
-      continue;
-    }
+  if (targetNonTerms.GetSize() == 0) {
+    return;
+  }
 
 #if !defined(UNLABELLED_SOURCE)
-    // source non-terminal labels for the span
-    const InputPath &inputPath = GetParser().GetInputPath(startPos, endPos);
+  // source non-terminal labels for the span
+  const InputPath &inputPath = GetParser().GetInputPath(startPos, endPos);
 
-    // can this ever be true? Moses seems to pad the non-terminal set of the input with [X]
-    if (inputPath.GetNonTerminalSet().size() == 0) {
-      continue;
-    }
+  // can this ever be true? Moses seems to pad the non-terminal set of the input with [X]
+  if (inputPath.GetNonTerminalSet().size() == 0) {
+    return;
+  }
 #endif
 
-    for (size_t i = 0; i < numNonTerms; i++) {
-      const ChartCellLabel *cellLabel = targetNonTerms.Find(i);
-      if (cellLabel != NULL) {
-        float score = cellLabel->GetBestScore(m_outColl);
-        cellMatrix[i].push_back(ChartCellCache(endPos, cellLabel, score));
-      }
+  size_t numNonTerms = cellMatrix.size();
+  for (size_t i = 0; i < numNonTerms; i++) {
+    const ChartCellLabel *cellLabel = targetNonTerms.Find(i);
+    if (cellLabel != NULL) {
+      float score = cellLabel->GetBestScore(m_outColl);
+      cellMatrix[i].push_back(ChartCellCache(endPos, cellLabel, score));
     }
   }
 }
 
-// if a (partial) rule matches, add it to list completed rules (if non-unary and non-empty), and try find expansions that have this partial rule as prefix.
+/* Look up the rules of one span without relying on the spans looked up
+ * before in the order of ChartManager::Decode() (see
+ * ChartRuleLookupManagerMemory::GetChartRuleCollectionByWidth()).
+ */
+void ChartRuleLookupManagerMemoryPerSentence::GetChartRuleCollectionByWidth(
+  const Range &range,
+  ChartParserCallback &outColl)
+{
+  size_t startPos = range.GetStartPos();
+  size_t endPos = range.GetEndPos();
+  CompletedRuleCollection &rules = m_completedRules[endPos];
+
+  if (m_charts.empty()) {
+    m_charts.resize(m_completedRules.size());
+  }
+  const PhraseDictionaryNodeMemory &rootNode = m_ruleTable.GetRootNode(GetParser().GetTranslationId());
+  m_charts[startPos].GetChartRuleCollection(*this, rootNode, startPos, endPos,
+      m_softMatchingMap, outColl, rules);
+
+  for (vector<CompletedRule*>::const_iterator iter = rules.begin(); iter != rules.end(); ++iter) {
+    outColl.Add((*iter)->GetTPC(), (*iter)->GetStackVector(), range);
+  }
+
+  rules.Clear();
+}
+
 void ChartRuleLookupManagerMemoryPerSentence::AddAndExtend(
   const PhraseDictionaryNodeMemory *node,
   size_t endPos)
@@ -25,6 +25,7 @@
 
 #include "ChartRuleLookupManagerCYKPlus.h"
 #include "CompletedRuleCollection.h"
+#include "PartialRuleChart.h"
 #include "moses/NonTerminal.h"
 #include "moses/TranslationModel/PhraseDictionaryMemory.h"
 #include "moses/TranslationModel/PhraseDictionaryNodeMemory.h"
@@ -54,8 +55,16 @@ public:
     size_t lastPos, // last position to consider if using lookahead
     ChartParserCallback &outColl);
 
+  virtual bool CanLookupByWidth() const {
+    return true;
+  }
+
 private:
 
+  void GetChartRuleCollectionByWidth(
+    const Range &range,
+    ChartParserCallback &outColl);
+
   void GetTerminalExtension(
     const PhraseDictionaryNodeMemory *node,
     size_t pos);
@@ -72,6 +81,10 @@ private:
                               size_t endPos,
                               size_t lastPos);
 
+  void AddToCompressedMatrix(CompressedMatrix &cellMatrix,
+                             size_t startPos,
+                             size_t endPos);
+
   const PhraseDictionaryFuzzyMatch &m_ruleTable;
 
   // permissible soft nonterminal matches (target side)
@@ -91,6 +104,9 @@ private:
 
   std::vector<CompressedMatrix> m_compressedMatrixVec;
 
+  // partial rules by start position, when looking up by width
+  std::vector<PartialRuleChart<PhraseDictionaryNodeMemory> > m_charts;
+
 };
 
 }  // namespace Moses
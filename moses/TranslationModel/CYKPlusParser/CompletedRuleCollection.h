@@ -21,6 +21,7 @@
 #ifndef moses_CompletedRuleCollectionS_h
 #define moses_CompletedRuleCollectionS_h
 
+#include <limits>
 #include <vector>
 #include <numeric>
 
@@ -97,8 +98,10 @@ public:
     return m_collection.end();
   }
 
+  //! also forgets the pruning threshold, which belongs to the cleared rules
   void Clear() {
     RemoveAllInColl(m_collection);
+    m_scoreThreshold = std::numeric_limits<float>::infinity();
   }
 
   void Add(const TargetPhraseCollection &tpc,
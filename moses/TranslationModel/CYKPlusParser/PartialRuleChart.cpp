@@ -0,0 +1,283 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) 2011 University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#include <algorithm>
+
+#include "PartialRuleChart.h"
+#include "CompletedRuleCollection.h"
+
+#include "moses/ChartCellLabelSet.h"
+#include "moses/ChartParser.h"
+#include "moses/ChartRuleLookupManager.h"
+#include "moses/InputPath.h"
+#include "moses/TranslationModel/PhraseDictionaryNodeMemory.h"
+#include "moses/TranslationModel/RuleTable/CompactRuleTrie.h"
+
+using namespace std;
+
+namespace Moses
+{
+
+namespace
+{
+
+// the labels of the cell [startPos, endPos], or NULL if no rule can use it
+const ChartCellLabelSet *GetCellLabels(const ChartRuleLookupManager &lookup,
+                                       size_t startPos,
+                                       size_t endPos)
+{
+  const ChartCellLabelSet &labels = lookup.GetTargetLabelSet(startPos, endPos);
+  if (labels.GetSize() == 0) {
+    return NULL;
+  }
+#if !defined(UNLABELLED_SOURCE)
+  const InputPath &inputPath = lookup.GetParser().GetInputPath(startPos, endPos);
+  if (inputPath.GetNonTerminalSet().size() == 0) {
+    return NULL;
+  }
+#endif
+  return &labels;
+}
+
+} // namespace
+
+template <class Node>
+bool PartialRuleChart<Node>::ItemOrder::operator()(size_t a, size_t b) const
+{
+  const size_t origDepthA = m_items[a].depth;
+  const size_t origDepthB = m_items[b].depth;
+  size_t depthA = origDepthA;
+  size_t depthB = origDepthB;
+  while (depthA > depthB) {
+    a = m_items[a].parent;
+    --depthA;
+  }
+  while (depthB > depthA) {
+    b = m_items[b].parent;
+    --depthB;
+  }
+  if (a == b) {
+    // one is a prefix of the other
+    return origDepthA < origDepthB;
+  }
+  while (m_items[a].parent != m_items[b].parent) {
+    a = m_items[a].parent;
+    b = m_items[b].parent;
+  }
+  return lexicographical_compare(m_items[a].key, m_items[a].key + 3,
+                                 m_items[b].key, m_items[b].key + 3);
+}
+
+template <class Node>
+void PartialRuleChart<Node>::GetChartRuleCollection(
+  const ChartRuleLookupManager &lookup,
+  const Node &root,
+  size_t startPos,
+  size_t endPos,
+  const std::vector<std::vector<Word> > &softMatchingMap,
+  const ChartParserCallback &outColl,
+  CompletedRuleCollection &rules)
+{
+  m_softMatchingMap = &softMatchingMap;
+  m_outColl = &outColl;
+  m_newItems.clear();
+
+  if (startPos == endPos) {
+    // first span from this start position: rules starting with its word
+    m_startPos = startPos;
+    m_items.clear();
+    m_itemsByNextPos.clear();
+    const Word &sourceWord = lookup.GetSourceAt(startPos).GetLabel();
+    const Node *child = root.GetChild(sourceWord);
+    if (child != NULL) {
+      AddChild(child, NO_PARENT, 0, 0, 0, NULL, 0);
+    }
+  } else {
+    // rules starting with the cell [startPos, endPos-1], which has just
+    // been decoded. As unary rules they are not complete yet.
+    const ChartCellLabelSet *labels = GetCellLabels(lookup, startPos, endPos-1);
+    if (labels != NULL) {
+      ExtendNonTerminals(root, NO_PARENT, endPos-1, *labels, true);
+    }
+    m_itemsByNextPos.resize(endPos+1);
+    for (size_t i = 0; i < m_newItems.size(); ++i) {
+      m_itemsByNextPos[endPos].push_back(m_newItems[i]);
+    }
+    m_newItems.clear();
+
+    // extend every partial rule by the word at endPos or a cell ending there
+    for (size_t pos = startPos+1; pos <= endPos; ++pos) {
+      const std::vector<size_t> &items = m_itemsByNextPos[pos];
+      if (items.empty()) {
+        continue;
+      }
+      if (pos == endPos) {
+        const Word &sourceWord = lookup.GetSourceAt(pos).GetLabel();
+        for (size_t i = 0; i < items.size(); ++i) {
+          const Node *node = m_items[items[i]].node;
+          if (node->HasTerminals()) {
+            const Node *child = node->GetChild(sourceWord);
+            if (child != NULL) {
+              AddChild(child, items[i], 0, 0, 0, NULL, 0);
+            }
+          }
+        }
+      }
+      labels = GetCellLabels(lookup, pos, endPos);
+      if (labels != NULL) {
+        for (size_t i = 0; i < items.size(); ++i) {
+          const Node *node = m_items[items[i]].node;
+          if (node->HasNonTerminals()) {
+            ExtendNonTerminals(*node, items[i], endPos, *labels, false);
+          }
+        }
+      }
+    }
+  }
+
+  // add the complete rules in the order of the recursive lookup
+  std::vector<size_t> complete;
+  for (size_t i = 0; i < m_newItems.size(); ++i) {
+    if (!m_items[m_newItems[i]].node->GetTargetPhraseCollection()->IsEmpty()) {
+      complete.push_back(m_newItems[i]);
+    }
+  }
+  std::stable_sort(complete.begin(), complete.end(), ItemOrder(m_items));
+
+  for (size_t i = 0; i < complete.size(); ++i) {
+    m_stackVec.clear();
+    m_stackScores.clear();
+    for (size_t item = complete[i]; item != NO_PARENT; item = m_items[item].parent) {
+      if (m_items[item].cellLabel != NULL) {
+        m_stackVec.push_back(m_items[item].cellLabel);
+        m_stackScores.push_back(m_items[item].score);
+      }
+    }
+    std::reverse(m_stackVec.begin(), m_stackVec.end());
+    std::reverse(m_stackScores.begin(), m_stackScores.end());
+    const Node *node = m_items[complete[i]].node;
+    rules.Add(*node->GetTargetPhraseCollection(), m_stackVec, m_stackScores, outColl);
+  }
+
+  // keep the new partial rules that can be extended
+  m_itemsByNextPos.resize(endPos+2);
+  for (size_t i = 0; i < m_newItems.size(); ++i) {
+    const Node *node = m_items[m_newItems[i]].node;
+    if (node->HasTerminals() || node->HasNonTerminals()) {
+      m_itemsByNextPos[endPos+1].push_back(m_newItems[i]);
+    }
+  }
+}
+
+template <class Node>
+void PartialRuleChart<Node>::AddChild(const Node *child,
+                                      size_t parent,
+                                      int key0,
+                                      int key1,
+                                      int key2,
+                                      const ChartCellLabel *cellLabel,
+                                      float score)
+{
+  Item item;
+  item.node = child;
+  item.parent = parent;
+  item.depth = (parent == NO_PARENT) ? 1 : m_items[parent].depth + 1;
+  item.key[0] = key0;
+  item.key[1] = key1;
+  item.key[2] = key2;
+  item.cellLabel = cellLabel;
+  item.score = score;
+  m_newItems.push_back(m_items.size());
+  m_items.push_back(item);
+}
+
+// The recursive lookup tries the non-terminal edges of a node in order,
+// each with its soft matches first, and the cells of a label by end
+// position. At the root, each start cell is a separate lookup, in the
+// order of the end position.
+template <class Node>
+void PartialRuleChart<Node>::ExtendNonTerminal(const Node *child,
+    size_t parent,
+    size_t endPos,
+    const ChartCellLabelSet &labels,
+    size_t targetNonTermId,
+    int edge,
+    bool isRoot)
+{
+  const std::vector<Word> *softMatches = NULL;
+  if (!m_softMatchingMap->empty()) {
+    softMatches = &(*m_softMatchingMap)[targetNonTermId];
+  }
+  int numSoftMatches = softMatches ? softMatches->size() : 0;
+  for (int match = 0; match <= numSoftMatches; ++match) {
+    size_t labelId = (match < numSoftMatches) ? (*softMatches)[match][0]->GetId()
+                     : targetNonTermId;
+    const ChartCellLabel *cellLabel = labels.Find(labelId);
+    if (cellLabel == NULL) {
+      continue;
+    }
+    float score = cellLabel->GetBestScore(m_outColl);
+    if (isRoot) {
+      AddChild(child, parent, 1 + int(endPos - m_startPos), edge, match, cellLabel, score);
+    } else {
+      AddChild(child, parent, 1 + edge, match, int(endPos), cellLabel, score);
+    }
+  }
+}
+
+template <>
+void PartialRuleChart<PhraseDictionaryNodeMemory>::ExtendNonTerminals(
+  const PhraseDictionaryNodeMemory &node,
+  size_t parent,
+  size_t endPos,
+  const ChartCellLabelSet &labels,
+  bool isRoot)
+{
+  const PhraseDictionaryNodeMemory::NonTerminalMap &nonTermMap = node.GetNonTerminalMap();
+  PhraseDictionaryNodeMemory::NonTerminalMap::const_iterator p;
+  int edge = 0;
+  for (p = nonTermMap.begin(); p != nonTermMap.end(); ++p, ++edge) {
+#if defined(UNLABELLED_SOURCE)
+    const Word &targetNonTerm = p->first;
+#else
+    const Word &targetNonTerm = p->first.second;
+#endif
+    ExtendNonTerminal(&p->second, parent, endPos, labels, targetNonTerm[0]->GetId(), edge, isRoot);
+  }
+}
+
+template <>
+void PartialRuleChart<CompactRuleTrie::Node>::ExtendNonTerminals(
+  const CompactRuleTrie::Node &node,
+  size_t parent,
+  size_t endPos,
+  const ChartCellLabelSet &labels,
+  bool isRoot)
+{
+  const CompactRuleTrie::NonTerminalEdge *begin = node.BeginNonTerminals();
+  const CompactRuleTrie::NonTerminalEdge *end = node.EndNonTerminals();
+  for (const CompactRuleTrie::NonTerminalEdge *p = begin; p != end; ++p) {
+    ExtendNonTerminal(p->child, parent, endPos, labels, p->targetNonTerm->GetId(), int(p - begin), isRoot);
+  }
+}
+
+template class PartialRuleChart<PhraseDictionaryNodeMemory>;
+template class PartialRuleChart<CompactRuleTrie::Node>;
+
+}  // namespace Moses
@@ -0,0 +1,117 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) 2011 University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#pragma once
+
+#include <vector>
+
+#include "moses/StackVec.h"
+#include "moses/Word.h"
+
+namespace Moses
+{
+
+class ChartCellLabel;
+class ChartCellLabelSet;
+class ChartParserCallback;
+class ChartRuleLookupManager;
+struct CompletedRuleCollection;
+
+/** The partial rules found from one start position when the rules are
+ *  looked up width by width (ChartRuleLookupManager::IsLookupByWidth()).
+ *
+ *  A partial rule is a node of the rule trie together with the cells of its
+ *  non-terminals. Looking up the span [startPos, endPos] only extends the
+ *  partial rules of the narrower spans by the word at endPos or by a cell
+ *  ending at endPos, so every trie node is visited once per sentence, as
+ *  when the spans are looked up in the order of ChartManager::Decode().
+ *  The completed rules are added in the order that the recursive lookup
+ *  finds them in.
+ *
+ *  Node is PhraseDictionaryNodeMemory or CompactRuleTrie::Node.
+ */
+template <class Node>
+class PartialRuleChart
+{
+public:
+  PartialRuleChart()
+    : m_startPos(0)
+    , m_softMatchingMap(NULL)
+    , m_outColl(NULL) {}
+
+  /** add the rules of [startPos, endPos] to rules. The spans from startPos
+   *  must be looked up with increasing endPos, each once all narrower cells
+   *  are decoded */
+  void GetChartRuleCollection(const ChartRuleLookupManager &lookup,
+                              const Node &root,
+                              size_t startPos,
+                              size_t endPos,
+                              const std::vector<std::vector<Word> > &softMatchingMap,
+                              const ChartParserCallback &outColl,
+                              CompletedRuleCollection &rules);
+
+private:
+  static const size_t NO_PARENT = static_cast<size_t>(-1);
+
+  struct Item {
+    const Node *node;
+    size_t parent;
+    size_t depth;
+    //! rank among the children of the parent, in the order they are visited in
+    int key[3];
+    //! NULL for a terminal
+    const ChartCellLabel *cellLabel;
+    float score;
+  };
+
+  //! whether item a comes before item b in the recursive lookup
+  class ItemOrder
+  {
+  public:
+    ItemOrder(const std::vector<Item> &items) : m_items(items) {}
+    bool operator()(size_t a, size_t b) const;
+  private:
+    const std::vector<Item> &m_items;
+  };
+
+  void AddChild(const Node *child, size_t parent, int key0, int key1, int key2,
+                const ChartCellLabel *cellLabel, float score);
+
+  void ExtendNonTerminals(const Node &node, size_t parent, size_t endPos,
+                          const ChartCellLabelSet &labels, bool isRoot);
+
+  void ExtendNonTerminal(const Node *child, size_t parent, size_t endPos,
+                         const ChartCellLabelSet &labels, size_t targetNonTermId,
+                         int edge, bool isRoot);
+
+  size_t m_startPos;
+  const std::vector<std::vector<Word> > *m_softMatchingMap;
+  const ChartParserCallback *m_outColl;
+
+  std::vector<Item> m_items;
+  //! extendable items by the position after their last word
+  std::vector<std::vector<size_t> > m_itemsByNextPos;
+  //! items found by the current lookup
+  std::vector<size_t> m_newItems;
+
+  StackVec m_stackVec;
+  std::vector<float> m_stackScores;
+};
+
+}  // namespace Moses
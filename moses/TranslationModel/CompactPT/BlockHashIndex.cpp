@@ -135,6 +135,53 @@ size_t BlockHashIndex::operator[](char* key)
   return GetHash(key);
 }
 
+void BlockHashIndex::GetHashes(const std::vector<std::string>& keys,
+                               std::vector<size_t>& indices)
+{
+  indices.resize(keys.size());
+  std::vector<size_t> ranges(keys.size(), GetSize());
+
+  size_t next = 0;
+  for(size_t k = 0; k < keys.size(); k++) {
+    next = std::distance(m_landmarks.begin(),
+                         std::upper_bound(m_landmarks.begin() + next,
+                                          m_landmarks.end(), keys[k]));
+    if(next == 0)
+      continue;
+
+    size_t i = next - 1;
+    ranges[k] = i;
+#ifdef HAVE_CMPH
+    indices[k] = cmph_search((cmph_t*)m_hashes[i], keys[k].c_str(),
+                             (cmph_uint32) keys[k].size());
+#else
+    assert(0);
+    indices[k] = 0;
+#endif
+    m_arrays[i]->Prefetch(indices[k], m_orderBits + m_fingerPrintBits);
+  }
+
+  size_t last = GetSize();
+  for(size_t k = 0; k < keys.size(); k++) {
+    size_t i = ranges[k];
+    if(i == GetSize()) {
+      indices[k] = GetSize();
+      continue;
+    }
+    if(i != last) {
+      m_clocks[i] = clock();
+      last = i;
+    }
+
+    std::pair<size_t, size_t> orderPrint
+      = m_arrays[i]->Get(indices[k], m_orderBits, m_fingerPrintBits);
+    if(GetFprint(keys[k].c_str()) == orderPrint.second)
+      indices[k] = (1ul << m_orderBits) * i + orderPrint.first;
+    else
+      indices[k] = GetSize();
+  }
+}
+
 size_t BlockHashIndex::Save(std::string filename)
 {
   std::FILE* mphf = std::fopen(filename.c_str(), "w");
@@ -156,27 +203,54 @@ void BlockHashIndex::BeginSave(std::FILE * mphf)
 }
 
 void BlockHashIndex::SaveRange(size_t i)
+{
+  SaveRange(i, m_hashes[i], m_arrays[i]);
+}
+
+void BlockHashIndex::SaveRange(size_t i, void* hash, PairedPackedArray<>* array)
 {
 #ifdef HAVE_CMPH
   if(m_seekIndex.size() <= i)
     m_seekIndex.resize(i+1);
   m_seekIndex[i] = std::ftell(m_fileHandle) - m_fileHandleStart;
-  cmph_dump((cmph_t*)m_hashes[i], m_fileHandle);
-  m_arrays[i]->Save(m_fileHandle);
+  cmph_dump((cmph_t*)hash, m_fileHandle);
+  array->Save(m_fileHandle);
 #endif
 }
 
 void BlockHashIndex::SaveLastRange()
 {
 #ifdef WITH_THREADS
-  boost::mutex::scoped_lock lock(m_mutex);
+  boost::mutex::scoped_lock saveLock(m_saveMutex);
 #endif
 
-  while(!m_queue.empty() && m_lastSaved + 1 == -m_queue.top()) {
-    size_t current = -m_queue.top();
-    m_queue.pop();
-    SaveRange(current);
-    m_lastSaved = current;
+  // Collect the ranges that are next in order under m_mutex, but write
+  // them without it, so that the hashing threads do not wait for the disk.
+  std::vector<size_t> ready;
+  std::vector<void*> hashes;
+  std::vector<PairedPackedArray<>*> arrays;
+  {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    int last = m_lastSaved;
+    while(!m_queue.empty() && last + 1 == -m_queue.top()) {
+      last = -m_queue.top();
+      m_queue.pop();
+      ready.push_back(last);
+      hashes.push_back(m_hashes[last]);
+      arrays.push_back(m_arrays[last]);
+    }
+  }
+
+  for(size_t i = 0; i < ready.size(); i++)
+    SaveRange(ready[i], hashes[i], arrays[i]);
+
+  if(!ready.empty()) {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    m_lastSaved = ready.back();
   }
 }
 
@@ -211,6 +285,11 @@ void BlockHashIndex::WaitAll()
 {
   m_threadPool.Stop(true);
 }
+
+void BlockHashIndex::SetQueueLimit(size_t limit)
+{
+  m_threadPool.SetQueueLimit(limit);
+}
 #endif
 
 size_t BlockHashIndex::FinalizeSave()
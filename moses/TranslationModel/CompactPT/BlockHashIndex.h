@@ -74,6 +74,7 @@ private:
 #ifdef WITH_THREADS
   ThreadPool m_threadPool;
   boost::mutex m_mutex;
+  boost::mutex m_saveMutex;
 
   template <typename Keys>
   class HashTask : public Task
@@ -100,6 +101,8 @@ private:
   size_t GetFprint(const char* key) const;
   size_t GetHash(size_t i, const char* key);
 
+  void SaveRange(size_t i, void* hash, PairedPackedArray<>* array);
+
 public:
 #ifdef WITH_THREADS
   BlockHashIndex(size_t orderBits, size_t fingerPrintBits,
@@ -116,6 +119,13 @@ public:
   size_t operator[](std::string key);
   size_t operator[](char* key);
 
+  // GetHash() of many keys at once, sorted like the keys of the index
+  // (LC_ALL=C sort). The range of a key is searched for from the range of
+  // the key before it, and the entries of all keys are prefetched before
+  // the first one is read.
+  void GetHashes(const std::vector<std::string>& keys,
+                 std::vector<size_t>& indices);
+
   void BeginSave(std::FILE* mphf);
   void SaveRange(size_t i);
   void SaveLastRange();
@@ -123,6 +133,10 @@ public:
 
 #ifdef WITH_THREADS
   void WaitAll();
+
+  // Let AddRange() block while this many ranges wait to be hashed, so
+  // that the keys of pending ranges do not pile up in memory.
+  void SetQueueLimit(size_t limit);
 #endif
 
   void DropRange(size_t i);
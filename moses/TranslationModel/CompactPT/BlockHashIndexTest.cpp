@@ -0,0 +1,80 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#define BOOST_TEST_MODULE BlockHashIndexTest
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "moses/TranslationModel/CompactPT/BlockHashIndex.h"
+#include "util/string_stream.hh"
+
+using namespace Moses;
+using namespace std;
+
+namespace
+{
+
+string MakeKey(size_t id)
+{
+  util::StringStream key;
+  key << "key" << (id < 10 ? "00" : id < 100 ? "0" : "") << id;
+  return key.str();
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(hashes_match_single_lookups)
+{
+  // ranges of at most 16 keys, so that the keys are spread over many
+  BlockHashIndex index(4, 16);
+  for (size_t first = 0; first < 200; first += 2 * 16) {
+    vector<string> keys;
+    for (size_t id = first; id < min<size_t>(first + 2 * 16, 200); id += 2) {
+      keys.push_back(MakeKey(id));
+    }
+    index.AddRange(keys);
+  }
+#ifdef WITH_THREADS
+  index.WaitAll();
+#endif
+  BOOST_REQUIRE_EQUAL(100, index.GetSize());
+
+  // every other key is in the index, some sort before or after all of them
+  vector<string> queries;
+  queries.push_back("a");
+  for (size_t id = 0; id < 210; ++id) {
+    queries.push_back(MakeKey(id));
+  }
+  queries.push_back(MakeKey(199));
+  queries.push_back("z");
+  sort(queries.begin(), queries.end());
+
+  vector<size_t> indices;
+  index.GetHashes(queries, indices);
+  BOOST_REQUIRE_EQUAL(queries.size(), indices.size());
+  size_t found = 0;
+  for (size_t i = 0; i < queries.size(); ++i) {
+    BOOST_CHECK_EQUAL(index.GetHash(queries[i]), indices[i]);
+    if (indices[i] != index.GetSize()) ++found;
+  }
+  BOOST_CHECK_EQUAL(100, found);
+}
@@ -0,0 +1,64 @@
+// $Id$
+// vim:tabstop=2
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include "ConcurrentTargetPhraseCollectionCache.h"
+
+namespace Moses
+{
+
+void
+ConcurrentTargetPhraseCollectionCache::
+Cache(const Phrase &sourcePhrase, TargetPhraseVectorPtr tpv,
+      size_t bitsLeft, size_t maxRank)
+{
+  if(Touch(sourcePhrase))
+    return;
+
+  // copy outside of the lock
+  if(maxRank && tpv->size() > maxRank)
+    tpv.reset(new TargetPhraseVector(tpv->begin(), tpv->begin() + maxRank));
+  Insert(sourcePhrase, std::make_pair(tpv, bitsLeft));
+}
+
+std::pair<TargetPhraseVectorPtr, size_t>
+ConcurrentTargetPhraseCollectionCache::
+Retrieve(const Phrase &sourcePhrase)
+{
+  std::pair<TargetPhraseVectorPtr, size_t> value(TargetPhraseVectorPtr(), 0);
+  Base::Retrieve(sourcePhrase, value);
+  return value;
+}
+
+size_t
+TargetPhraseVectorBytes::
+Get(const Phrase &sourcePhrase, const TargetPhraseVector &tpv)
+{
+  // the vectors behind the phrases and scores
+  size_t bytes = 2 * sourcePhrase.GetSize() * sizeof(Word)
+                 + sizeof(TargetPhraseVector);
+  for(TargetPhraseVector::const_iterator it = tpv.begin(); it != tpv.end(); ++it) {
+    bytes += sizeof(TargetPhrase) + it->GetSize() * sizeof(Word)
+             + it->GetScoreBreakdown().Size() * sizeof(FValue);
+  }
+  return bytes;
+}
+
+}
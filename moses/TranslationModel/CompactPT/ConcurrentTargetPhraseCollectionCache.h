@@ -0,0 +1,83 @@
+// $Id$
+// vim:tabstop=2
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_ConcurrentTargetPhraseCollectionCache_h
+#define moses_ConcurrentTargetPhraseCollectionCache_h
+
+#include <utility>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "moses/ConcurrentClockCache.h"
+#include "moses/Phrase.h"
+#include "moses/TargetPhrase.h"
+
+namespace Moses
+{
+
+typedef std::vector<TargetPhrase> TargetPhraseVector;
+typedef boost::shared_ptr<TargetPhraseVector> TargetPhraseVectorPtr;
+
+//! memory behind a source phrase and its cached translations
+struct TargetPhraseVectorBytes {
+  size_t operator()(const Phrase &sourcePhrase,
+                    const std::pair<TargetPhraseVectorPtr, size_t> &value) const {
+    return Get(sourcePhrase, *value.first);
+  }
+  static size_t Get(const Phrase &sourcePhrase, const TargetPhraseVector &tpv);
+};
+
+/** Decoded target phrase collections, shared by all threads and kept across
+ * sentences, in about a given number of bytes. See ConcurrentClockCache.
+ * Cached collections are never modified, so they can be read by many
+ * threads at once.
+ */
+class ConcurrentTargetPhraseCollectionCache
+  : public ConcurrentClockCache<Phrase, std::pair<TargetPhraseVectorPtr, size_t>,
+    TargetPhraseVectorBytes>
+{
+  typedef ConcurrentClockCache<Phrase, std::pair<TargetPhraseVectorPtr, size_t>,
+          TargetPhraseVectorBytes> Base;
+
+public:
+  explicit ConcurrentTargetPhraseCollectionCache(size_t bytes, size_t shards = 64)
+    : Base(bytes, shards) {
+  }
+
+  /** cache translations of a source phrase, at most maxRank of them
+   *  (0: all). Nothing changes if the source phrase is cached already **/
+  void Cache(const Phrase &sourcePhrase, TargetPhraseVectorPtr tpv,
+             size_t bitsLeft = 0, size_t maxRank = 0);
+
+  /** cached translations of a source phrase and the number of bits left to
+   *  decode, or NULL **/
+  std::pair<TargetPhraseVectorPtr, size_t> Retrieve(const Phrase &sourcePhrase);
+
+  //! estimated memory taken by an entry
+  static size_t EstimateBytes(const Phrase &sourcePhrase, const TargetPhraseVector &tpv) {
+    return GetEntryBytes() + TargetPhraseVectorBytes::Get(sourcePhrase, tpv);
+  }
+};
+
+}
+
+#endif
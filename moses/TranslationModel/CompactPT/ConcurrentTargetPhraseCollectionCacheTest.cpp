@@ -0,0 +1,174 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#define BOOST_TEST_MODULE ConcurrentTargetPhraseCollectionCacheTest
+#include <boost/test/unit_test.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+
+#include "moses/FactorCollection.h"
+#include "moses/TranslationModel/CompactPT/ConcurrentTargetPhraseCollectionCache.h"
+#include "util/string_stream.hh"
+
+using namespace Moses;
+
+namespace
+{
+
+Phrase MakePhrase(size_t id, size_t length = 2)
+{
+  Phrase phrase;
+  for (size_t i = 0; i < length; ++i) {
+    util::StringStream str;
+    str << "w" << id << "_" << i;
+    phrase.AddWord().SetFactor(0, FactorCollection::Instance().AddFactor(str.str()));
+  }
+  return phrase;
+}
+
+// translations that can be recognised as those of source phrase id
+TargetPhraseVectorPtr MakeTranslations(size_t id, size_t count)
+{
+  TargetPhraseVectorPtr tpv(new TargetPhraseVector(count));
+  for (size_t i = 0; i < count; ++i) {
+    Phrase words = MakePhrase(id + i, 1);
+    (*tpv)[i].Append(words);
+  }
+  return tpv;
+}
+
+bool IsTranslationOf(const TargetPhraseVector &tpv, size_t id)
+{
+  for (size_t i = 0; i < tpv.size(); ++i) {
+    if (tpv[i].GetSize() != 1 || !(tpv[i].GetWord(0) == MakePhrase(id + i, 1).GetWord(0)))
+      return false;
+  }
+  return true;
+}
+
+BOOST_AUTO_TEST_CASE(cache_and_retrieve)
+{
+  ConcurrentTargetPhraseCollectionCache cache(1 << 20, 4);
+  BOOST_CHECK(!cache.Retrieve(MakePhrase(1)).first);
+
+  TargetPhraseVectorPtr tpv = MakeTranslations(1, 3);
+  cache.Cache(MakePhrase(1), tpv, 17);
+  std::pair<TargetPhraseVectorPtr, size_t> found = cache.Retrieve(MakePhrase(1));
+  BOOST_CHECK(found.first == tpv);
+  BOOST_CHECK_EQUAL(17, found.second);
+
+  // caching again leaves the first entry
+  cache.Cache(MakePhrase(1), MakeTranslations(1, 2), 0);
+  BOOST_CHECK(cache.Retrieve(MakePhrase(1)).first == tpv);
+
+  BOOST_CHECK_EQUAL(2, cache.GetHits());
+  BOOST_CHECK_EQUAL(1, cache.GetMisses());
+  BOOST_CHECK_EQUAL(1, cache.GetSize());
+  BOOST_CHECK_EQUAL(ConcurrentTargetPhraseCollectionCache::EstimateBytes(MakePhrase(1), *tpv),
+                    cache.GetBytes());
+}
+
+BOOST_AUTO_TEST_CASE(max_rank)
+{
+  ConcurrentTargetPhraseCollectionCache cache(1 << 20, 1);
+  TargetPhraseVectorPtr tpv = MakeTranslations(5, 10);
+  cache.Cache(MakePhrase(5), tpv, 0, 4);
+  TargetPhraseVectorPtr found = cache.Retrieve(MakePhrase(5)).first;
+  BOOST_REQUIRE(found);
+  BOOST_CHECK_EQUAL(4, found->size());
+  BOOST_CHECK(IsTranslationOf(*found, 5));
+  BOOST_CHECK_EQUAL(10, tpv->size());
+}
+
+BOOST_AUTO_TEST_CASE(memory_budget)
+{
+  size_t entryBytes = ConcurrentTargetPhraseCollectionCache::EstimateBytes(
+                        MakePhrase(0), *MakeTranslations(0, 5));
+  ConcurrentTargetPhraseCollectionCache cache(20 * entryBytes, 2);
+  for (size_t i = 0; i < 1000; ++i) {
+    cache.Cache(MakePhrase(i), MakeTranslations(i, 5));
+    BOOST_REQUIRE(cache.GetBytes() <= 20 * entryBytes);
+  }
+  BOOST_CHECK(cache.GetSize() > 0);
+  BOOST_CHECK_EQUAL(1000, cache.GetSize() + cache.GetEvictions());
+
+  // an entry larger than a shard is not cached
+  cache.Cache(MakePhrase(5000), MakeTranslations(5000, 100));
+  BOOST_CHECK(!cache.Retrieve(MakePhrase(5000)).first);
+}
+
+BOOST_AUTO_TEST_CASE(clock_keeps_retrieved_entries)
+{
+  size_t entryBytes = ConcurrentTargetPhraseCollectionCache::EstimateBytes(
+                        MakePhrase(0), *MakeTranslations(0, 1));
+  ConcurrentTargetPhraseCollectionCache cache(4 * entryBytes, 1);
+  for (size_t i = 0; i < 4; ++i) {
+    cache.Cache(MakePhrase(i), MakeTranslations(i, 1));
+  }
+  BOOST_CHECK(cache.Retrieve(MakePhrase(0)).first);
+
+  // phrase 0 gets a second chance, the first one not retrieved goes
+  cache.Cache(MakePhrase(4), MakeTranslations(4, 1));
+  BOOST_CHECK_EQUAL(1, cache.GetEvictions());
+  BOOST_CHECK(cache.Retrieve(MakePhrase(0)).first);
+  BOOST_CHECK(!cache.Retrieve(MakePhrase(1)).first);
+  BOOST_CHECK(cache.Retrieve(MakePhrase(4)).first);
+}
+
+#ifdef WITH_THREADS
+void Lookups(ConcurrentTargetPhraseCollectionCache &cache, size_t seed, bool &ok)
+{
+  size_t state = seed;
+  for (size_t i = 0; i < 20000; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    size_t id = (state >> 33) % 300;
+    TargetPhraseVectorPtr found = cache.Retrieve(MakePhrase(id)).first;
+    if (found) {
+      if (!IsTranslationOf(*found, id)) ok = false;
+    } else {
+      cache.Cache(MakePhrase(id), MakeTranslations(id, 1 + id % 5));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(threads)
+{
+  size_t entryBytes = ConcurrentTargetPhraseCollectionCache::EstimateBytes(
+                        MakePhrase(0), *MakeTranslations(0, 5));
+  ConcurrentTargetPhraseCollectionCache cache(100 * entryBytes, 8);
+  const size_t kThreads = 8;
+  bool ok[kThreads];
+  boost::thread_group group;
+  for (size_t t = 0; t < kThreads; ++t) {
+    ok[t] = true;
+    group.create_thread(boost::bind(Lookups, boost::ref(cache), t + 1, boost::ref(ok[t])));
+  }
+  group.join_all();
+  for (size_t t = 0; t < kThreads; ++t) {
+    BOOST_CHECK(ok[t]);
+  }
+  BOOST_CHECK_EQUAL(kThreads * 20000, cache.GetHits() + cache.GetMisses());
+  BOOST_CHECK(cache.GetBytes() <= 100 * entryBytes);
+}
+#endif
+
+}
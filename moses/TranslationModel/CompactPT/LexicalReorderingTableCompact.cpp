@@ -66,7 +66,6 @@ LexicalReorderingTableCompact::
 GetScore(const Phrase& f, const Phrase& e, const Phrase& c)
 {
   std::string key;
-  Scores scores;
 
   if(0 == c.GetSize())
     key = MakeKey(f, e, c);
@@ -77,21 +76,76 @@ GetScore(const Phrase& f, const Phrase& e, const Phrase& c)
     }
 
   size_t index = m_hash[key];
-  if(m_hash.GetSize() != index) {
-    std::string scoresString;
+  if(m_hash.GetSize() != index)
+    return DecodeScores(index);
+
+  return Scores();
+}
+
+void
+LexicalReorderingTableCompact::
+GetScoreBatch(const std::vector<PhrasePair>& pairs,
+              std::vector<Scores>& scores)
+{
+  std::vector<std::string> keys(pairs.size());
+  const Phrase* lastF = NULL;
+  std::string f;
+  for(size_t i = 0; i < pairs.size(); ++i) {
+    if(pairs[i].first != lastF) {
+      lastF = pairs[i].first;
+      f = Trim(lastF->GetStringRep(m_FactorsF));
+    }
+    keys[i] = MakeKey(f, Trim(pairs[i].second->GetStringRep(m_FactorsE)), "");
+  }
+
+  // hash the distinct keys in the order of the index, then fetch their
+  // scores before decoding any of them
+  std::vector<size_t> order = SortedOrder(keys);
+  std::vector<std::string> distinct;
+  std::vector<size_t> which(pairs.size());
+  for(size_t i = 0; i < order.size(); ++i) {
+    if(i == 0 || keys[order[i]] != distinct.back())
+      distinct.push_back(keys[order[i]]);
+    which[order[i]] = distinct.size() - 1;
+  }
+
+  std::vector<size_t> indices;
+  m_hash.GetHashes(distinct, indices);
+#ifdef __GNUC__
+  for(size_t i = 0; i < indices.size(); i++) {
+    if(indices[i] == m_hash.GetSize()) continue;
     if(m_inMemory)
-      scoresString = m_scoresMemory[index].str();
+      __builtin_prefetch(m_scoresMemory.begin(indices[i]));
     else
-      scoresString = m_scoresMapped[index].str();
+      __builtin_prefetch(m_scoresMapped.begin(indices[i]));
+  }
+#endif
 
-    BitWrapper<> bitStream(scoresString);
-    for(size_t i = 0; i < m_numScoreComponent; i++)
-      scores.push_back(m_scoreTrees[m_multipleScoreTrees ? i : 0]->Read(bitStream));
+  std::vector<Scores> distinctScores(distinct.size());
+  for(size_t i = 0; i < indices.size(); i++)
+    if(indices[i] != m_hash.GetSize())
+      distinctScores[i] = DecodeScores(indices[i]);
 
-    return scores;
-  }
+  scores.resize(pairs.size());
+  for(size_t i = 0; i < pairs.size(); ++i)
+    scores[i] = distinctScores[which[i]];
+}
 
-  return Scores();
+Scores
+LexicalReorderingTableCompact::
+DecodeScores(size_t index) const
+{
+  std::string scoresString;
+  if(m_inMemory)
+    scoresString = m_scoresMemory[index].str();
+  else
+    scoresString = m_scoresMapped[index].str();
+
+  Scores scores;
+  BitWrapper<> bitStream(scoresString);
+  for(size_t i = 0; i < m_numScoreComponent; i++)
+    scores.push_back(m_scoreTrees[m_multipleScoreTrees ? i : 0]->Read(bitStream));
+  return scores;
 }
 
 std::string
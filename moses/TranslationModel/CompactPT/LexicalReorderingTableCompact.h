@@ -57,6 +57,8 @@ private:
   std::string MakeKey(const Phrase& f, const Phrase& e, const Phrase& c) const;
   std::string MakeKey(const std::string& f, const std::string& e, const std::string& c) const;
 
+  Scores DecodeScores(size_t index) const;
+
 public:
   LexicalReorderingTableCompact(const std::string& filePath,
                                 const std::vector<FactorType>& f_factors,
@@ -74,6 +76,11 @@ public:
   std::vector<float>
   GetScore(const Phrase& f, const Phrase& e, const Phrase& c);
 
+  virtual
+  void
+  GetScoreBatch(const std::vector<PhrasePair>& pairs,
+                std::vector<Scores>& scores);
+
   static
   LexicalReorderingTable*
   CheckAndLoad(const std::string& filePath,
@@ -91,6 +91,13 @@ public:
     return out;
   }
 
+  // Hint that Get(i, bits) will be called soon
+  void Prefetch(size_t i, size_t bits) const {
+#ifdef __GNUC__
+    __builtin_prefetch(m_storage + (i * bits) / m_dataBits);
+#endif
+  }
+
   void Set(size_t i, T v, size_t bits) {
     size_t bitstart = (i * bits);
     size_t bitpos = bitstart;
@@ -198,7 +198,9 @@ TargetPhraseVectorPtr PhraseDecoder::CreateTargetPhraseCollection(const Phrase &
   TargetPhraseVectorPtr tpv(new TargetPhraseVector());
   size_t bitsLeft = 0;
 
-  if(m_coding == PREnc) {
+  // PREnc collections are cached per thread anyway, others only if the
+  // cache is shared
+  if(m_coding == PREnc || m_decodingCache.GetSharedCache()) {
     std::pair<TargetPhraseVectorPtr, size_t> cachedPhraseColl
     = m_decodingCache.Retrieve(sourcePhrase);
 
@@ -445,6 +447,9 @@ TargetPhraseVectorPtr PhraseDecoder::DecodeCollection(
   if(m_coding == PREnc && !extending) {
     bitsLeft = bitsLeft > 8 ? bitsLeft : 0;
     m_decodingCache.Cache(sourcePhrase, tpv, bitsLeft, m_maxRank);
+  } else if(m_decodingCache.GetSharedCache() && !extending) {
+    // complete collection
+    m_decodingCache.Cache(sourcePhrase, tpv);
   }
 
   return tpv;
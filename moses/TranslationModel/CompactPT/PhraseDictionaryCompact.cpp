@@ -50,6 +50,7 @@ PhraseDictionaryCompact::PhraseDictionaryCompact(const std::string &line)
   :PhraseDictionary(line, true)
   ,m_inMemory(true)//(s_inMemoryByDefault)
   ,m_useAlignmentInfo(true)
+  ,m_decodingCacheBytes(0)
   ,m_hash(10, 16)
   ,m_phraseDecoder(0)
 {
@@ -72,6 +73,8 @@ void PhraseDictionaryCompact::Load(AllOptions::ptr const& opts)
 
   m_phraseDecoder
   = new PhraseDecoder(*this, &m_input, &m_output, m_numScoreComponents);
+  if(m_decodingCacheBytes)
+    m_phraseDecoder->m_decodingCache.UseSharedCache(m_decodingCacheBytes);
 
   std::FILE* pFile = std::fopen(tFilePath.c_str() , "r");
 
@@ -97,6 +100,17 @@ void PhraseDictionaryCompact::Load(AllOptions::ptr const& opts)
                  "Not successfully loaded");
 }
 
+void
+PhraseDictionaryCompact::
+SetParameter(const std::string& key, const std::string& value)
+{
+  if (key == "decoding-cache-mb") {
+    m_decodingCacheBytes = Scan<size_t>(value) << 20;
+  } else {
+    PhraseDictionary::SetParameter(key, value);
+  }
+}
+
 TargetPhraseCollection::shared_ptr
 PhraseDictionaryCompact::
 GetTargetPhraseCollectionNonCacheLEGACY(const Phrase &sourcePhrase) const
@@ -180,6 +194,18 @@ CleanUpAfterSentenceProcessing(const InputType &source)
   m_sentenceCache->clear();
 
   ReduceCache();
+
+  const ConcurrentTargetPhraseCollectionCache *shared
+  = m_phraseDecoder->m_decodingCache.GetSharedCache();
+  if(shared) {
+    uint64_t hits = shared->GetHits();
+    uint64_t lookups = hits + shared->GetMisses();
+    VERBOSE(1, "Line " << source.GetTranslationId() << ": " << GetScoreProducerDescription()
+            << " decoding cache: " << hits << " of " << lookups << " lookups hit ("
+            << (lookups ? 100.0 * hits / lookups : 0.0) << "%) since start, "
+            << shared->GetSize() << " entries in " << (shared->GetBytes() >> 20) << " MB, "
+            << shared->GetEvictions() << " evicted" << endl);
+  }
 }
 
 bool PhraseDictionaryCompact::s_inMemoryByDefault = false;
@@ -20,12 +20,15 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
 #include <cstdio>
+#include <algorithm>
 
 #include "PhraseTableCreator.h"
 #include "ConsistentPhrases.h"
 #include "ThrowingFwrite.h"
 #include "util/file.hh"
 #include "util/exception.hh"
+#include "util/stream/chain.hh"
+#include "util/stream/line_input.hh"
 
 namespace Moses
 {
@@ -56,6 +59,7 @@ PhraseTableCreator::PhraseTableCreator(std::string inPath,
 #ifdef WITH_THREADS
                                        , size_t threads
 #endif
+                                       , size_t memoryBudget
                                       )
   : m_inPath(inPath), m_outPath(outPath), m_tempfilePath(tempfilePath),
     m_outFile(std::fopen(m_outPath.c_str(), "w")), m_numScoreComponent(numScoreComponent),
@@ -64,9 +68,10 @@ PhraseTableCreator::PhraseTableCreator(std::string inPath,
     m_useAlignmentInfo(useAlignmentInfo),
     m_multipleScoreTrees(multipleScoreTrees),
     m_quantize(quantize), m_maxRank(maxRank),
+    m_memoryBudget(memoryBudget),
 #ifdef WITH_THREADS
     m_threads(threads),
-    m_srcHash(m_orderBits, m_fingerPrintBits, 1),
+    m_srcHash(m_orderBits, m_fingerPrintBits, m_memoryBudget ? m_threads : 1),
     m_rnkHash(10, 24, m_threads),
 #else
     m_srcHash(m_orderBits, m_fingerPrintBits),
@@ -78,6 +83,13 @@ PhraseTableCreator::PhraseTableCreator(std::string inPath,
 {
   PrintInfo();
 
+#ifdef WITH_THREADS
+  if(m_memoryBudget) {
+    m_srcHash.SetQueueLimit(m_threads);
+    m_rnkHash.SetQueueLimit(m_threads);
+  }
+#endif
+
   AddTargetSymbolId(m_phraseStopSymbol);
 
   size_t cur_pass = 1;
@@ -183,6 +195,11 @@ void PhraseTableCreator::PrintInfo()
 #ifdef WITH_THREADS
   std::cerr << "\tRunning with " << m_threads << " threads" << std::endl;
 #endif
+  std::cerr << "\tMemory budget for streaming the phrase table: ";
+  if(m_memoryBudget)
+    std::cerr << m_memoryBudget << " MB" << std::endl;
+  else
+    std::cerr << "none (in-memory queues)" << std::endl;
   std::cerr << std::endl;
 }
 
@@ -313,6 +330,12 @@ void PhraseTableCreator::LoadLexicalTable(std::string filePath)
 
 void PhraseTableCreator::CreateRankHash()
 {
+  if(m_memoryBudget) {
+    StreamPass(RankingPass);
+    FlushRankedQueue(true);
+    return;
+  }
+
   InputFileStream inFile(m_inPath);
 
 #ifdef WITH_THREADS
@@ -342,6 +365,12 @@ inline std::string PhraseTableCreator::MakeSourceTargetKey(std::string &source,
 
 void PhraseTableCreator::EncodeTargetPhrases()
 {
+  if(m_memoryBudget) {
+    StreamPass(EncodingPass);
+    FlushEncodedQueue(true);
+    return;
+  }
+
   InputFileStream inFile(m_inPath);
 
 #ifdef WITH_THREADS
@@ -362,6 +391,12 @@ void PhraseTableCreator::EncodeTargetPhrases()
 
 void PhraseTableCreator::CompressTargetPhrases()
 {
+  if(m_memoryBudget) {
+    StreamPass(CompressionPass);
+    FlushCompressedQueue(true);
+    return;
+  }
+
 #ifdef WITH_THREADS
   boost::thread_group threads;
   for (size_t i = 0; i < m_threads; ++i) {
@@ -579,10 +614,10 @@ void PhraseTableCreator::EncodeTargetPhraseREnc(std::vector<std::string>& s,
         if(r < bestRank) {
           bestRank = r;
           bestSrcPos = *it;
-          bestDiff = abs(*it-i);
-        } else if(r == bestRank && unsigned(abs(*it-i)) < bestDiff) {
+          bestDiff = abs(int(*it) - int(i));
+        } else if(r == bestRank && unsigned(abs(int(*it) - int(i))) < bestDiff) {
           bestSrcPos = *it;
-          bestDiff = abs(*it-i);
+          bestDiff = abs(int(*it) - int(i));
         }
       }
     }
@@ -705,6 +740,49 @@ void PhraseTableCreator::EncodeAlignment(std::set<AlignPoint>& alignment,
   m_alignCounter.Increase(stop);
 }
 
+PackedItem PhraseTableCreator::RankLine(std::string& line, size_t lineNum)
+{
+  std::vector<std::string> tokens;
+  Moses::TokenizeMultiCharSeparator(tokens, line, m_separator);
+
+  for(std::vector<std::string>::iterator it = tokens.begin(); it != tokens.end(); it++)
+    *it = Moses::Trim(*it);
+
+  if(tokens.size() < 4) {
+    std::stringstream strme;
+    strme << "Error: It seems the following line has a wrong format:" << std::endl;
+    strme << "Line " << lineNum + 1 << ": " << line << std::endl;
+    UTIL_THROW2(strme.str());
+  }
+
+  if(tokens[3].size() <= 1 && m_coding != None) {
+    std::stringstream strme;
+    strme << "Error: It seems the following line contains no alignment information, " << std::endl;
+    strme << "but you are using ";
+    strme << (m_coding == PREnc ? "PREnc" : "REnc");
+    strme << " encoding which makes use of alignment data. " << std::endl;
+    strme << "Use -encoding None" << std::endl;
+    strme << "Line " << lineNum + 1 << ": " << line << std::endl;
+    UTIL_THROW2(strme.str());
+  }
+
+  std::vector<float> scores = Tokenize<float>(tokens[2]);
+  if(scores.size() != m_numScoreComponent) {
+    std::stringstream strme;
+    strme << "Error: It seems the following line has a wrong number of scores ("
+          << scores.size() << " != " << m_numScoreComponent << ") :" << std::endl;
+    strme << "Line " << lineNum + 1 << ": " << line << std::endl;
+    UTIL_THROW2(strme.str());
+  }
+
+  float sortScore = scores[m_sortScoreIndex];
+
+  std::string key1 = MakeSourceKey(tokens[0]);
+  std::string key2 = MakeSourceTargetKey(tokens[0], tokens[1]);
+
+  return PackedItem(lineNum, key1, key2, 0, sortScore);
+}
+
 std::string PhraseTableCreator::EncodeLine(std::vector<std::string>& tokens, size_t ownRank)
 {
   std::string sourcePhraseStr = tokens[0];
@@ -758,6 +836,41 @@ std::string PhraseTableCreator::EncodeLine(std::vector<std::string>& tokens, siz
   return encodedTargetPhrase.str();
 }
 
+PackedItem PhraseTableCreator::EncodeTextLine(std::string& line, size_t lineNum)
+{
+  std::vector<std::string> tokens;
+  Moses::TokenizeMultiCharSeparator(tokens, line, m_separator);
+
+  for(std::vector<std::string>::iterator it = tokens.begin(); it != tokens.end(); it++)
+    *it = Moses::Trim(*it);
+
+  if(tokens.size() < 3) {
+    std::stringstream strme;
+    strme << "Error: It seems the following line has a wrong format:" << std::endl;
+    strme << "Line " << lineNum + 1 << ": " << line << std::endl;
+    UTIL_THROW2(strme.str());
+  }
+
+  if(tokens.size() > 3 && tokens[3].size() <= 1 && m_coding != None) {
+    std::stringstream strme;
+    strme << "Error: It seems the following line contains no alignment information, " << std::endl;
+    strme << "but you are using ";
+    strme << (m_coding == PREnc ? "PREnc" : "REnc");
+    strme << " encoding which makes use of alignment data. " << std::endl;
+    strme << "Use -encoding None" << std::endl;
+    strme << "Line " << lineNum + 1 << ": " << line << std::endl;
+    UTIL_THROW2(strme.str());
+  }
+
+  size_t ownRank = 0;
+  if(m_coding == PREnc)
+    ownRank = m_ranks[lineNum];
+
+  std::string encodedLine = EncodeLine(tokens, ownRank);
+
+  return PackedItem(lineNum, tokens[0], encodedLine, ownRank);
+}
+
 std::string PhraseTableCreator::CompressEncodedCollection(std::string encodedCollection)
 {
   enum EncodeState {
@@ -1048,46 +1161,7 @@ void RankingTask::operator()()
 
   while(lines.size()) {
     for(size_t i = 0; i < lines.size(); i++) {
-      std::vector<std::string> tokens;
-      Moses::TokenizeMultiCharSeparator(tokens, lines[i], m_creator.m_separator);
-
-      for(std::vector<std::string>::iterator it = tokens.begin(); it != tokens.end(); it++)
-        *it = Moses::Trim(*it);
-
-      if(tokens.size() < 4) {
-        std::stringstream strme;
-        strme << "Error: It seems the following line has a wrong format:" << std::endl;
-        strme << "Line " << i << ": " << lines[i] << std::endl;
-        UTIL_THROW2(strme.str());
-      }
-
-      if(tokens[3].size() <= 1 && m_creator.m_coding != PhraseTableCreator::None) {
-        std::stringstream strme;
-        strme << "Error: It seems the following line contains no alignment information, " << std::endl;
-        strme << "but you are using ";
-        strme << (m_creator.m_coding == PhraseTableCreator::PREnc ? "PREnc" : "REnc");
-        strme << " encoding which makes use of alignment data. " << std::endl;
-        strme << "Use -encoding None" << std::endl;
-        strme << "Line " << i << ": " << lines[i] << std::endl;
-        UTIL_THROW2(strme.str());
-      }
-
-      std::vector<float> scores = Tokenize<float>(tokens[2]);
-      if(scores.size() != m_creator.m_numScoreComponent) {
-        std::stringstream strme;
-        strme << "Error: It seems the following line has a wrong number of scores ("
-              << scores.size() << " != " << m_creator.m_numScoreComponent << ") :" << std::endl;
-        strme << "Line " << i << ": " << lines[i] << std::endl;
-        UTIL_THROW2(strme.str());
-      }
-
-      float sortScore = scores[m_creator.m_sortScoreIndex];
-
-      std::string key1 = m_creator.MakeSourceKey(tokens[0]);
-      std::string key2 = m_creator.MakeSourceTargetKey(tokens[0], tokens[1]);
-
-      PackedItem packedItem(lineNum + i, key1, key2, 0, sortScore);
-      result.push_back(packedItem);
+      result.push_back(m_creator.RankLine(lines[i], lineNum + i));
     }
     lines.clear();
 
@@ -1148,38 +1222,7 @@ void EncodingTask::operator()()
 
   while(lines.size()) {
     for(size_t i = 0; i < lines.size(); i++) {
-      std::vector<std::string> tokens;
-      Moses::TokenizeMultiCharSeparator(tokens, lines[i], m_creator.m_separator);
-
-      for(std::vector<std::string>::iterator it = tokens.begin(); it != tokens.end(); it++)
-        *it = Moses::Trim(*it);
-
-      if(tokens.size() < 3) {
-        std::stringstream strme;
-        strme << "Error: It seems the following line has a wrong format:" << std::endl;
-        strme << "Line " << i << ": " << lines[i] << std::endl;
-        UTIL_THROW2(strme.str());
-      }
-
-      if(tokens.size() > 3 && tokens[3].size() <= 1 && m_creator.m_coding != PhraseTableCreator::None) {
-        std::stringstream strme;
-        strme << "Error: It seems the following line contains no alignment information, " << std::endl;
-        strme << "but you are using ";
-        strme << (m_creator.m_coding == PhraseTableCreator::PREnc ? "PREnc" : "REnc");
-        strme << " encoding which makes use of alignment data. " << std::endl;
-        strme << "Use -encoding None" << std::endl;
-        strme << "Line " << i << ": " << lines[i] << std::endl;
-        UTIL_THROW2(strme.str());
-      }
-
-      size_t ownRank = 0;
-      if(m_creator.m_coding == PhraseTableCreator::PREnc)
-        ownRank = m_creator.m_ranks[lineNum + i];
-
-      std::string encodedLine = m_creator.EncodeLine(tokens, ownRank);
-
-      PackedItem packedItem(lineNum + i, tokens[0], encodedLine, ownRank);
-      result.push_back(packedItem);
+      result.push_back(m_creator.EncodeTextLine(lines[i], lineNum + i));
     }
     lines.clear();
 
@@ -1251,6 +1294,209 @@ void CompressionTask::operator()()
 
 //****************************************************************************//
 
+namespace
+{
+
+// Lines of a block of the chain must fit into it
+const size_t kMinStreamBlockSize = 1ul << 20;
+
+// What the workers produced for one block of the chain
+struct StreamedBlock {
+  size_t firstLine;
+  std::vector<PackedItem> items;
+};
+
+// Counts the lines of the blocks in file order, so that the workers know the
+// number of the first line in each block.
+class LineNumberer
+{
+  std::vector<StreamedBlock>* m_slots;
+
+public:
+  LineNumberer(std::vector<StreamedBlock>& slots) : m_slots(&slots) {}
+
+  void Run(const util::stream::ChainPosition &position) {
+    size_t lines = 0;
+    size_t index = 0;
+    for(util::stream::Link block(position); block; ++block, ++index) {
+      (*m_slots)[index % m_slots->size()].firstLine = lines;
+      const char* begin = static_cast<const char*>(block->Get());
+      const char* end = static_cast<const char*>(block->ValidEnd());
+      lines += std::count(begin, end, '\n');
+      if(begin != end && *(end - 1) != '\n')
+        lines++;
+    }
+  }
+};
+
+}
+
+// Splits the encoded target phrase collections into ranges of about the block
+// size for the compression pass.
+class CollectionRangeReader
+{
+  PhraseTableCreator* m_creator;
+  size_t m_blockSize;
+
+public:
+  CollectionRangeReader(PhraseTableCreator& creator, size_t blockSize)
+    : m_creator(&creator), m_blockSize(blockSize) {}
+
+  void Run(const util::stream::ChainPosition &position) {
+    StringVectorTemp<unsigned char, unsigned long, MmapAllocator>& collections
+    = *m_creator->m_encodedTargetPhrases;
+
+    size_t next = 0;
+    for(util::stream::Link block(position); ; ++block) {
+      if(next == collections.size()) {
+        block.Poison();
+        return;
+      }
+      size_t* range = static_cast<size_t*>(block->Get());
+      range[0] = next;
+      size_t bytes = 0;
+      while(next < collections.size() && (next == range[0] || bytes < m_blockSize))
+        bytes += collections.length(next++);
+      range[1] = next;
+      block->SetValidSize(2 * sizeof(size_t));
+    }
+  }
+};
+
+// Handles every workers-th block of the chain and leaves the results in the
+// slot of the block.
+class StreamingWorker
+{
+  PhraseTableCreator* m_creator;
+  PhraseTableCreator::StreamingPass m_pass;
+  size_t m_worker;
+  size_t m_workers;
+  std::vector<StreamedBlock>* m_slots;
+
+public:
+  StreamingWorker(PhraseTableCreator& creator, PhraseTableCreator::StreamingPass pass,
+                  size_t worker, size_t workers, std::vector<StreamedBlock>& slots)
+    : m_creator(&creator), m_pass(pass), m_worker(worker), m_workers(workers),
+      m_slots(&slots) {}
+
+  void Run(const util::stream::ChainPosition &position) {
+    size_t index = 0;
+    for(util::stream::Link block(position); block; ++block, ++index) {
+      if(index % m_workers != m_worker)
+        continue;
+
+      StreamedBlock& slot = (*m_slots)[index % m_slots->size()];
+      slot.items.clear();
+
+      if(m_pass == PhraseTableCreator::CompressionPass) {
+        const size_t* range = static_cast<const size_t*>(block->Get());
+        for(size_t i = range[0]; i < range[1]; i++) {
+          std::string collection = (*m_creator->m_encodedTargetPhrases)[i];
+          std::string dummy;
+          slot.items.push_back(PackedItem(i, dummy,
+                                          m_creator->CompressEncodedCollection(collection), 0));
+        }
+        continue;
+      }
+
+      const char* it = static_cast<const char*>(block->Get());
+      const char* end = static_cast<const char*>(block->ValidEnd());
+      size_t lineNum = slot.firstLine;
+      while(it != end) {
+        const char* newline = std::find(it, end, '\n');
+        std::string line(it, newline);
+        it = (newline == end) ? end : newline + 1;
+
+        if(m_pass == PhraseTableCreator::RankingPass)
+          slot.items.push_back(m_creator->RankLine(line, lineNum++));
+        else
+          slot.items.push_back(m_creator->EncodeTextLine(line, lineNum++));
+      }
+    }
+  }
+};
+
+// Passes the results of the workers in file order to the creator, whose
+// queues thus never hold more than one item.
+class StreamingWriter
+{
+  PhraseTableCreator* m_creator;
+  PhraseTableCreator::StreamingPass m_pass;
+  std::vector<StreamedBlock>* m_slots;
+
+public:
+  StreamingWriter(PhraseTableCreator& creator, PhraseTableCreator::StreamingPass pass,
+                  std::vector<StreamedBlock>& slots)
+    : m_creator(&creator), m_pass(pass), m_slots(&slots) {}
+
+  void Run(const util::stream::ChainPosition &position) {
+    size_t index = 0;
+    for(util::stream::Link block(position); block; ++block, ++index) {
+      std::vector<PackedItem>& items = (*m_slots)[index % m_slots->size()].items;
+      for(std::vector<PackedItem>::iterator it = items.begin(); it != items.end(); it++) {
+        switch(m_pass) {
+        case PhraseTableCreator::RankingPass:
+          m_creator->AddRankedLine(*it);
+          m_creator->FlushRankedQueue();
+          break;
+        case PhraseTableCreator::EncodingPass:
+          m_creator->AddEncodedLine(*it);
+          m_creator->FlushEncodedQueue();
+          break;
+        case PhraseTableCreator::CompressionPass:
+          m_creator->AddCompressedCollection(*it);
+          m_creator->FlushCompressedQueue();
+          break;
+        }
+      }
+      items.clear();
+    }
+  }
+};
+
+void PhraseTableCreator::StreamPass(StreamingPass pass)
+{
+  size_t threads = 1;
+#ifdef WITH_THREADS
+  threads = std::max<size_t>(m_threads, 1);
+#endif
+
+  // Enough blocks that every worker has one to work on while the reader fills
+  // the next ones. The results for a block take up to about twice its size,
+  // hence a third of the budget goes to the blocks of the chain.
+  const size_t blockCount = 2 * threads + 2;
+  size_t blockSize = (m_memoryBudget << 20) / (3 * blockCount);
+  if(blockSize < kMinStreamBlockSize) {
+    std::cerr << "\tWarning: memory budget too small for " << threads
+              << " threads, using blocks of " << (kMinStreamBlockSize >> 20)
+              << " MB" << std::endl;
+    blockSize = kMinStreamBlockSize;
+  }
+
+  std::vector<StreamedBlock> slots(blockCount);
+
+  // The compression pass streams ranges of collection indices, the other
+  // passes the lines of the phrase table.
+  util::stream::ChainConfig config(1, blockCount, blockCount * blockSize);
+  if(pass == CompressionPass)
+    config = util::stream::ChainConfig(2 * sizeof(size_t), blockCount,
+                                       blockCount * 2 * sizeof(size_t));
+
+  util::stream::Chain chain(config);
+  if(pass == CompressionPass) {
+    chain >> CollectionRangeReader(*this, blockSize);
+  } else {
+    chain >> util::stream::LineInput(util::OpenReadOrThrow(m_inPath.c_str()));
+    chain >> LineNumberer(slots);
+  }
+  for(size_t i = 0; i < threads; i++)
+    chain >> StreamingWorker(*this, pass, i, threads, slots);
+  chain >> StreamingWriter(*this, pass, slots) >> util::stream::kRecycle;
+  chain.Wait();
+}
+
+//****************************************************************************//
+
 PackedItem::PackedItem(long line, std::string sourcePhrase,
                        std::string packedTargetPhrase, size_t rank,
                        float score)
@@ -198,6 +198,7 @@ private:
   bool m_multipleScoreTrees;
   size_t m_quantize;
   size_t m_maxRank;
+  size_t m_memoryBudget;
 
   static std::string m_phraseStopSymbol;
   static std::string m_separator;
@@ -320,7 +321,10 @@ private:
   void AddRankedLine(PackedItem& pi);
   void FlushRankedQueue(bool force = false);
 
+  PackedItem RankLine(std::string& line, size_t lineNum);
+
   std::string EncodeLine(std::vector<std::string>& tokens, size_t ownRank);
+  PackedItem EncodeTextLine(std::string& line, size_t lineNum);
   void AddEncodedLine(PackedItem& pi);
   void FlushEncodedQueue(bool force = false);
 
@@ -328,6 +332,12 @@ private:
   void AddCompressedCollection(PackedItem& pi);
   void FlushCompressedQueue(bool force = false);
 
+  // External-memory mode (m_memoryBudget > 0): the passes stream the input
+  // through a util::stream chain with a fixed number of blocks, which
+  // parallel workers process and a writer consumes in order.
+  enum StreamingPass { RankingPass, EncodingPass, CompressionPass };
+  void StreamPass(StreamingPass pass);
+
 public:
 
   PhraseTableCreator(std::string inPath,
@@ -346,6 +356,7 @@ public:
 #ifdef WITH_THREADS
                                    , size_t threads = 2
 #endif
+                     , size_t memoryBudget = 0
                     );
 
   ~PhraseTableCreator();
@@ -353,6 +364,9 @@ public:
   friend class RankingTask;
   friend class EncodingTask;
   friend class CompressionTask;
+  friend class StreamingWorker;
+  friend class StreamingWriter;
+  friend class CollectionRangeReader;
 };
 
 class RankingTask
@@ -32,19 +32,20 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "moses/Phrase.h"
 #include "moses/TargetPhraseCollection.h"
 
+// Avoid using new due to locking: TargetPhraseVector
+#include "ConcurrentTargetPhraseCollectionCache.h"
+
 namespace Moses
 {
 
-// Avoid using new due to locking
-typedef std::vector<TargetPhrase> TargetPhraseVector;
-typedef boost::shared_ptr<TargetPhraseVector> TargetPhraseVectorPtr;
-
-/** Implementation of Persistent Cache **/
+/** Implementation of Persistent Cache. Per thread, unless UseSharedCache()
+ *  is called, after which all threads use one shared cache **/
 class TargetPhraseCollectionCache
 {
 private:
   size_t m_max;
   float m_tolerance;
+  boost::shared_ptr<ConcurrentTargetPhraseCollectionCache> m_shared;
 
   struct LastUsed {
     clock_t m_clock;
@@ -93,9 +94,23 @@ public:
     return m_phraseCache->end();
   }
 
+  /** share one cache of about this many bytes between all threads **/
+  void UseSharedCache(size_t bytes) {
+    m_shared.reset(new ConcurrentTargetPhraseCollectionCache(bytes));
+  }
+
+  /** the shared cache, NULL if each thread has its own **/
+  const ConcurrentTargetPhraseCollectionCache *GetSharedCache() const {
+    return m_shared.get();
+  }
+
   /** retrieve translations for source phrase from persistent cache **/
   void Cache(const Phrase &sourcePhrase, TargetPhraseVectorPtr tpv,
              size_t bitsLeft = 0, size_t maxRank = 0) {
+    if(m_shared) {
+      m_shared->Cache(sourcePhrase, tpv, bitsLeft, maxRank);
+      return;
+    }
     if(!m_phraseCache.get())
       m_phraseCache.reset(new CacheMap());
     // check if source phrase is already in cache
@@ -116,6 +131,8 @@ public:
   }
 
   std::pair<TargetPhraseVectorPtr, size_t> Retrieve(const Phrase &sourcePhrase) {
+    if(m_shared)
+      return m_shared->Retrieve(sourcePhrase);
     if(!m_phraseCache.get())
       m_phraseCache.reset(new CacheMap());
     iterator it = m_phraseCache->find(sourcePhrase);
@@ -127,8 +144,10 @@ public:
       return std::make_pair(TargetPhraseVectorPtr(), 0);
   }
 
-  // if cache full, reduce
+  // if cache full, reduce. The shared cache makes room when caching
   void Prune() {
+    if(m_shared)
+      return;
     if(!m_phraseCache.get())
       m_phraseCache.reset(new CacheMap());
     if(m_phraseCache->size() > m_max * (1 + m_tolerance)) {
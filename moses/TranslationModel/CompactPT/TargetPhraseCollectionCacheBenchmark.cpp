@@ -0,0 +1,162 @@
+// Multi-threaded throughput benchmark for the decoding cache of
+// PhraseDictionaryCompact. Each thread looks up a Zipf-like stream of source
+// phrases, "decodes" the translations of those not cached (building a
+// TargetPhraseVector, the cost the cache saves) and caches them, pruning
+// after every sentence as the decoder does. Compares the cache kept per
+// thread with the one shared by all threads, at the same memory per thread.
+//
+// Usage: TargetPhraseCollectionCacheBenchmark [threads] [source phrases]
+//          [lookups per thread] [shared cache MB]
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+
+#include "moses/FactorCollection.h"
+#include "moses/TranslationModel/CompactPT/TargetPhraseCollectionCache.h"
+#include "util/string_stream.hh"
+#include "util/usage.hh"
+
+namespace Moses
+{
+namespace
+{
+
+const size_t kLookupsPerSentence = 200;
+const size_t kTranslations = 20;
+
+struct Setup {
+  std::vector<Phrase> phrases;
+  std::vector<const Factor*> words;
+  size_t lookups;
+};
+
+// phrase ranks skewed towards the frequent end
+size_t NextRank(size_t &state, size_t phrases)
+{
+  state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+  double u = static_cast<double>(state >> 11) / static_cast<double>(1ULL << 53);
+  return static_cast<size_t>(u * u * u * phrases);
+}
+
+// stands in for PhraseDecoder::DecodeCollection()
+TargetPhraseVectorPtr Decode(const Setup &setup, size_t rank)
+{
+  TargetPhraseVectorPtr tpv(new TargetPhraseVector(kTranslations));
+  size_t state = rank + 1;
+  for (size_t i = 0; i < kTranslations; ++i) {
+    for (size_t length = 1 + rank % 4; length; --length) {
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+      (*tpv)[i].AddWord().SetFactor(0, setup.words[(state >> 33) % setup.words.size()]);
+    }
+  }
+  return tpv;
+}
+
+struct Counts {
+  size_t decoded;
+  size_t checksum;
+};
+
+void Lookups(const Setup &setup, TargetPhraseCollectionCache &cache, size_t seed, Counts &counts)
+{
+  size_t state = seed;
+  counts.decoded = counts.checksum = 0;
+  for (size_t i = 0; i < setup.lookups; ++i) {
+    size_t rank = NextRank(state, setup.phrases.size());
+    const Phrase &source = setup.phrases[rank];
+    TargetPhraseVectorPtr tpv = cache.Retrieve(source).first;
+    if (!tpv) {
+      tpv = Decode(setup, rank);
+      cache.Cache(source, tpv);
+      ++counts.decoded;
+    }
+    counts.checksum += tpv->back().GetSize();
+    if (i % kLookupsPerSentence == kLookupsPerSentence - 1) cache.Prune();
+  }
+}
+
+double RunThreads(const Setup &setup, TargetPhraseCollectionCache &cache,
+                  size_t threads, std::vector<Counts> &counts)
+{
+  counts.resize(threads);
+  double start = util::WallTime();
+#ifdef WITH_THREADS
+  boost::thread_group group;
+  for (size_t t = 0; t < threads; ++t) {
+    group.create_thread(boost::bind(Lookups, boost::cref(setup), boost::ref(cache),
+                                    t + 1, boost::ref(counts[t])));
+  }
+  group.join_all();
+#else
+  Lookups(setup, cache, 1, counts[0]);
+#endif
+  return util::WallTime() - start;
+}
+
+void Report(const char *name, size_t threads, const Setup &setup, double time,
+            const std::vector<Counts> &counts)
+{
+  size_t decoded = 0;
+  for (size_t t = 0; t < counts.size(); ++t) decoded += counts[t].decoded;
+  double lookups = static_cast<double>(threads) * setup.lookups;
+  std::cout << name << " lookups/sec=" << lookups / time
+            << " decoded=" << decoded
+            << " hit rate=" << 100.0 * (lookups - decoded) / lookups << "%" << std::endl;
+}
+
+} // namespace
+} // namespace Moses
+
+int main(int argc, char *argv[])
+{
+  using namespace Moses;
+  size_t threads = argc > 1 ? std::atoi(argv[1]) : 8;
+  size_t phrases = argc > 2 ? std::atoi(argv[2]) : 100000;
+  Setup setup;
+  setup.lookups = argc > 3 ? std::atoi(argv[3]) : 500000;
+  size_t megabytes = argc > 4 ? std::atoi(argv[4]) : 0;
+#ifndef WITH_THREADS
+  threads = 1;
+#endif
+
+  for (size_t i = 0; i < 5000; ++i) {
+    util::StringStream str;
+    str << "target" << i;
+    setup.words.push_back(FactorCollection::Instance().AddFactor(str.str()));
+  }
+  for (size_t i = 0; i < phrases; ++i) {
+    Phrase phrase;
+    for (size_t length = 1 + i % 3; length; --length) {
+      util::StringStream str;
+      str << "source" << (i * 7 + length) % 20000;
+      phrase.AddWord().SetFactor(0, FactorCollection::Instance().AddFactor(str.str()));
+    }
+    setup.phrases.push_back(phrase);
+  }
+
+  // the per thread cache keeps up to 5000 entries; by default give the
+  // shared cache as much memory as all threads take together
+  TargetPhraseCollectionCache perThread;
+  std::vector<Counts> counts;
+  double perThreadTime = RunThreads(setup, perThread, threads, counts);
+  Report("per thread:", threads, setup, perThreadTime, counts);
+
+  size_t entryBytes = ConcurrentTargetPhraseCollectionCache::EstimateBytes(
+                        setup.phrases[0], *Decode(setup, 0));
+  size_t bytes = megabytes ? megabytes << 20 : threads * 5000 * entryBytes;
+  TargetPhraseCollectionCache shared;
+  shared.UseSharedCache(bytes);
+  double sharedTime = RunThreads(setup, shared, threads, counts);
+  Report("shared:    ", threads, setup, sharedTime, counts);
+  std::cout << "shared cache: " << (bytes >> 20) << " MB budget, "
+            << shared.GetSharedCache()->GetSize() << " entries, "
+            << shared.GetSharedCache()->GetEvictions() << " evicted" << std::endl;
+  return 0;
+}
@@ -34,6 +34,8 @@
 #include "moses/TranslationModel/RuleTable/Loader.h"
 #include "moses/TranslationModel/CYKPlusParser/ChartRuleLookupManagerMemory.h"
 #include "moses/InputPath.h"
+#include "moses/Snapshot.h"
+#include "util/usage.hh"
 
 using namespace std;
 
@@ -41,6 +43,7 @@ namespace Moses
 {
 PhraseDictionaryMemory::PhraseDictionaryMemory(const std::string &line)
   : RuleTableTrie(line)
+  , m_compact(false)
 {
   ReadParameters();
 
@@ -69,6 +72,16 @@ GetTargetPhraseCollectionLEGACY(const Phrase& sourceOrig) const
   // exactly like CreateTargetPhraseCollection, but don't create
   const size_t size = source.GetSize();
 
+  if (const CompactRuleTrie *trie = GetCompactTrie()) {
+    const CompactRuleTrie::Node *currNode = &trie->GetRootNode();
+    for (size_t pos = 0 ; pos < size ; ++pos) {
+      currNode = currNode->GetChild(source.GetWord(pos));
+      if (currNode == NULL)
+        return TargetPhraseCollection::shared_ptr();
+    }
+    return currNode->GetTargetPhraseCollection();
+  }
+
   const PhraseDictionaryNodeMemory *currNode = &m_collection;
   for (size_t pos = 0 ; pos < size ; ++pos) {
     const Word& word = source.GetWord(pos);
@@ -137,12 +150,186 @@ void PhraseDictionaryMemory::SortAndPrune()
   if (GetTableLimit()) {
     m_collection.Sort(GetTableLimit());
   }
+
+  if (m_compact) {
+    Compact();
+  }
+}
+
+void PhraseDictionaryMemory::Compact()
+{
+  double start = util::WallTime();
+  m_compactTrie.Build(m_collection);
+  // the target phrases are now owned by the compact trie
+  m_collection = PhraseDictionaryNodeMemory();
+  VERBOSE(2, GetScoreProducerDescription() << ": compacted " << m_compactTrie.GetNumNodes()
+          << " nodes into " << (m_compactTrie.GetMemoryUsage() >> 20) << " MB in "
+          << util::WallTime() - start << " seconds" << std::endl);
+}
+
+void PhraseDictionaryMemory::SetParameter(const std::string& key, const std::string& value)
+{
+  if (key == "compact") {
+    m_compact = Scan<bool>(value);
+  } else {
+    RuleTableTrie::SetParameter(key, value);
+  }
+}
+
+/* The trie is saved depth first, each node as its target phrases, then its
+ * terminal edges and its non-terminal edges, each followed by the node it
+ * leads to.  Both forms of the trie are saved the same way, and restored
+ * into the map-based form, which is compacted again if need be.  The edges
+ * are saved so that the restored maps are iterated over in the same order
+ * (see ReverseIterationOrder()).
+ */
+namespace
+{
+
+void WriteTargetPhrases(SnapshotWriter &snapshot, const TargetPhraseCollection &targetPhrases)
+{
+  snapshot.WriteInt(targetPhrases.GetSize());
+  for (TargetPhraseCollection::const_iterator p = targetPhrases.begin(); p != targetPhrases.end(); ++p) {
+    snapshot.WriteTargetPhrase(**p);
+  }
+}
+
+void WriteNode(SnapshotWriter &snapshot, const PhraseDictionaryNodeMemory &node)
+{
+  typedef PhraseDictionaryNodeMemory::TerminalMap TermMap;
+  typedef PhraseDictionaryNodeMemory::NonTerminalMap NonTermMap;
+
+  WriteTargetPhrases(snapshot, *node.GetTargetPhraseCollection());
+
+  const TermMap &terminals = node.GetTerminalMap();
+  const NonTermMap &nonTerms = node.GetNonTerminalMap();
+  snapshot.WriteInt(BucketCount(terminals));
+  snapshot.WriteInt(BucketCount(nonTerms));
+
+  std::vector<const TermMap::value_type*> termEntries = ReverseIterationOrder(terminals);
+  snapshot.WriteInt(termEntries.size());
+  for (size_t i = 0; i < termEntries.size(); ++i) {
+    snapshot.WriteWord(termEntries[i]->first);
+    WriteNode(snapshot, termEntries[i]->second);
+  }
+
+  std::vector<const NonTermMap::value_type*> nonTermEntries = ReverseIterationOrder(nonTerms);
+  snapshot.WriteInt(nonTermEntries.size());
+  for (size_t i = 0; i < nonTermEntries.size(); ++i) {
+#if defined(UNLABELLED_SOURCE)
+    snapshot.WriteWord(nonTermEntries[i]->first);
+#else
+    snapshot.WriteWord(nonTermEntries[i]->first.first);
+    snapshot.WriteWord(nonTermEntries[i]->first.second);
+#endif
+    WriteNode(snapshot, nonTermEntries[i]->second);
+  }
+}
+
+void WriteNonTerminal(SnapshotWriter &snapshot, const Factor *label)
+{
+  Word word(true);
+  word.SetFactor(0, label);
+  snapshot.WriteWord(word);
+}
+
+void WriteNode(SnapshotWriter &snapshot, const CompactRuleTrie::Node &node)
+{
+  WriteTargetPhrases(snapshot, *node.GetTargetPhraseCollection());
+
+  // the terminal edges are sorted by hash, the non-terminal ones are in the
+  // order of the original map, but its size is lost
+  snapshot.WriteInt(0);
+  snapshot.WriteInt(0);
+
+  snapshot.WriteInt(node.EndTerminals() - node.BeginTerminals());
+  for (const CompactRuleTrie::TerminalEdge *p = node.BeginTerminals(); p != node.EndTerminals(); ++p) {
+    snapshot.WriteWord(p->word);
+    WriteNode(snapshot, *p->child);
+  }
+
+  snapshot.WriteInt(node.EndNonTerminals() - node.BeginNonTerminals());
+  for (const CompactRuleTrie::NonTerminalEdge *p = node.EndNonTerminals(); p-- != node.BeginNonTerminals(); ) {
+#if !defined(UNLABELLED_SOURCE)
+    WriteNonTerminal(snapshot, p->sourceNonTerm);
+#endif
+    WriteNonTerminal(snapshot, p->targetNonTerm);
+    WriteNode(snapshot, *p->child);
+  }
+}
+
+void ReadNode(SnapshotReader &snapshot, PhraseDictionaryNodeMemory &node,
+              const PhraseDictionary *container)
+{
+  TargetPhraseCollection &targetPhrases = *node.GetTargetPhraseCollection();
+  for (uint64_t count = snapshot.ReadInt(); count; --count) {
+    targetPhrases.Add(snapshot.ReadTargetPhrase(container));
+  }
+
+  size_t terminalBuckets = snapshot.ReadInt();
+  size_t nonTerminalBuckets = snapshot.ReadInt();
+  node.Rehash(terminalBuckets, nonTerminalBuckets);
+
+  for (uint64_t count = snapshot.ReadInt(); count; --count) {
+    Word sourceTerm;
+    snapshot.ReadWord(sourceTerm);
+    ReadNode(snapshot, *node.GetOrCreateChild(sourceTerm), container);
+  }
+
+  for (uint64_t count = snapshot.ReadInt(); count; --count) {
+#if defined(UNLABELLED_SOURCE)
+    Word targetNonTerm;
+    snapshot.ReadWord(targetNonTerm);
+    ReadNode(snapshot, *node.GetOrCreateNonTerminalChild(targetNonTerm), container);
+#else
+    Word sourceNonTerm, targetNonTerm;
+    snapshot.ReadWord(sourceNonTerm);
+    snapshot.ReadWord(targetNonTerm);
+    ReadNode(snapshot, *node.GetOrCreateChild(sourceNonTerm, targetNonTerm), container);
+#endif
+  }
+}
+
+} // namespace
+
+bool PhraseDictionaryMemory::WriteSnapshot(SnapshotWriter &snapshot) const
+{
+  snapshot.WriteFileStamp(m_filePath);
+  snapshot.WriteInt(m_options->unk.word_deletion_enabled);
+  if (const CompactRuleTrie *trie = GetCompactTrie()) {
+    WriteNode(snapshot, trie->GetRootNode());
+  } else {
+    WriteNode(snapshot, m_collection);
+  }
+  return true;
+}
+
+bool PhraseDictionaryMemory::ReadSnapshot(AllOptions::ptr const& opts, SnapshotReader &snapshot)
+{
+  if (!snapshot.ReadFileStamp(m_filePath)
+      || snapshot.ReadInt() != opts->unk.word_deletion_enabled) {
+    return false;
+  }
+  m_options = opts;
+  SetFeaturesToApply();
+
+  // saved sorted and pruned
+  ReadNode(snapshot, m_collection, this);
+  if (m_compact) {
+    Compact();
+  }
+  return true;
 }
 
 void
 PhraseDictionaryMemory::
 GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const
 {
+  if (GetCompactTrie()) {
+    GetTargetPhraseCollectionBatchCompact(inputPathQueue);
+    return;
+  }
+
   InputPathList::const_iterator iter;
   for (iter = inputPathQueue.begin(); iter != inputPathQueue.end(); ++iter) {
     InputPath &inputPath = **iter;
@@ -178,6 +365,90 @@ GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const
   }
 }
 
+/* Same as above on the compact trie, a few input paths at a time. The
+ * queue is ordered by phrase length, so the paths next to each other
+ * usually extend different nodes: the edges of all the nodes of a batch are
+ * prefetched before any of them is searched, and the children found before
+ * their target phrases are fetched, so that the cache misses overlap.
+ */
+void
+PhraseDictionaryMemory::
+GetTargetPhraseCollectionBatchCompact(const InputPathList &inputPathQueue) const
+{
+  const size_t kBatchSize = 16;
+  const CompactRuleTrie::Node *prevNodes[kBatchSize];
+  const CompactRuleTrie::Node *nodes[kBatchSize];
+
+  const CompactRuleTrie::Node &rootNode = GetCompactTrie()->GetRootNode();
+
+  for (size_t begin = 0; begin < inputPathQueue.size(); ) {
+    // a path can't be in the same batch as the path it extends
+    size_t end = begin;
+    while (end < inputPathQueue.size() && end - begin < kBatchSize) {
+      const InputPath *prevPath = inputPathQueue[end]->GetPrevPath();
+      if (prevPath && std::find(inputPathQueue.begin() + begin, inputPathQueue.begin() + end, prevPath)
+          != inputPathQueue.begin() + end) {
+        break;
+      }
+      ++end;
+    }
+
+    for (size_t i = begin; i < end; ++i) {
+      InputPath &inputPath = *inputPathQueue[i];
+      const InputPath *prevPath = inputPath.GetPrevPath();
+      const CompactRuleTrie::Node *&prevPtNode = prevNodes[i - begin];
+
+      if (prevPath) {
+        prevPtNode = static_cast<const CompactRuleTrie::Node*>(prevPath->GetPtNode(*this));
+      } else {
+        // Starting subphrase.
+        assert(inputPath.GetPhrase().GetSize() == 1);
+        prevPtNode = &rootNode;
+      }
+
+      // backoff
+      if (!SatisfyBackoff(inputPath)) {
+        prevPtNode = NULL;
+        nodes[i - begin] = NULL;
+        continue;
+      }
+      if (prevPtNode) {
+        prevPtNode->Prefetch();
+      }
+    }
+
+    for (size_t i = begin; i < end; ++i) {
+      const CompactRuleTrie::Node *prevPtNode = prevNodes[i - begin];
+      const CompactRuleTrie::Node *&ptNode = nodes[i - begin];
+      ptNode = NULL;
+      if (prevPtNode) {
+        const Phrase &phrase = inputPathQueue[i]->GetPhrase();
+        Word lastWord = phrase.GetWord(phrase.GetSize() - 1);
+        lastWord.OnlyTheseFactors(m_inputFactors);
+
+        ptNode = prevPtNode->GetChild(lastWord);
+        if (ptNode) {
+          ptNode->Prefetch();
+        }
+      }
+    }
+
+    for (size_t i = begin; i < end; ++i) {
+      if (prevNodes[i - begin] == NULL) {
+        continue;
+      }
+      const CompactRuleTrie::Node *ptNode = nodes[i - begin];
+      TargetPhraseCollection::shared_ptr targetPhrases;
+      if (ptNode) {
+        targetPhrases = ptNode->GetTargetPhraseCollection();
+      }
+      inputPathQueue[i]->SetTargetPhrases(*this, targetPhrases, ptNode);
+    }
+
+    begin = end;
+  }
+}
+
 TO_STRING_BODY(PhraseDictionaryMemory);
 
 // friend
@@ -186,6 +457,21 @@ ostream& operator<<(ostream& out, const PhraseDictionaryMemory& phraseDict)
   typedef PhraseDictionaryNodeMemory::TerminalMap TermMap;
   typedef PhraseDictionaryNodeMemory::NonTerminalMap NonTermMap;
 
+  if (const CompactRuleTrie *trie = phraseDict.GetCompactTrie()) {
+    const CompactRuleTrie::Node &root = trie->GetRootNode();
+    for (const CompactRuleTrie::NonTerminalEdge *p = root.BeginNonTerminals(); p != root.EndNonTerminals(); ++p) {
+#if defined(UNLABELLED_SOURCE)
+      out << *p->targetNonTerm;
+#else
+      out << *p->sourceNonTerm;
+#endif
+    }
+    for (const CompactRuleTrie::TerminalEdge *p = root.BeginTerminals(); p != root.EndTerminals(); ++p) {
+      out << p->word;
+    }
+    return out;
+  }
+
   const PhraseDictionaryNodeMemory &coll = phraseDict.m_collection;
   for (NonTermMap::const_iterator p = coll.m_nonTermMap.begin(); p != coll.m_nonTermMap.end(); ++p) {
 #if defined(UNLABELLED_SOURCE)
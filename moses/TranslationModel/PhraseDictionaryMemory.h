@@ -24,6 +24,7 @@
 #include "moses/InputType.h"
 #include "moses/NonTerminal.h"
 #include "moses/TranslationModel/RuleTable/Trie.h"
+#include "moses/TranslationModel/RuleTable/CompactRuleTrie.h"
 
 namespace Moses
 {
@@ -31,6 +32,8 @@ class ChartParser;
 
 /** Implementation of a in-memory rule table in a trie.  Looking up a rule of
  * length n symbols requires n look-ups to find the TargetPhraseCollection.
+ * With compact=true, the trie is copied into a CompactRuleTrie once loaded,
+ * and the lookups walk the copy.
  */
 class PhraseDictionaryMemory : public RuleTableTrie
 {
@@ -39,7 +42,8 @@ class PhraseDictionaryMemory : public RuleTableTrie
 
 protected:
   PhraseDictionaryMemory(int type, const std::string &line)
-    : RuleTableTrie(line) {
+    : RuleTableTrie(line)
+    , m_compact(false) {
   }
 
 public:
@@ -49,6 +53,11 @@ public:
     return m_collection;
   }
 
+  //! NULL unless the table has been compacted
+  const CompactRuleTrie *GetCompactTrie() const {
+    return m_compactTrie.IsEmpty() ? NULL : &m_compactTrie;
+  }
+
   ChartRuleLookupManager*
   CreateRuleLookupManager(
     const ChartParser &,
@@ -62,6 +71,11 @@ public:
   void
   GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const;
 
+  void SetParameter(const std::string& key, const std::string& value);
+
+  bool WriteSnapshot(SnapshotWriter &snapshot) const;
+  bool ReadSnapshot(AllOptions::ptr const& opts, SnapshotReader &snapshot);
+
   TO_STRING();
 
 protected:
@@ -74,8 +88,14 @@ protected:
                   const Word *sourceLHS);
 
   void SortAndPrune();
+  void Compact();
+
+  void GetTargetPhraseCollectionBatchCompact(const InputPathList &inputPathQueue) const;
 
   PhraseDictionaryNodeMemory m_collection;
+
+  bool m_compact;
+  CompactRuleTrie m_compactTrie;
 };
 
 }  // namespace Moses
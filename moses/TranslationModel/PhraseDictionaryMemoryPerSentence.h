@@ -22,6 +22,11 @@ public:
 
   void InitializeForInput(ttasksptr const& ttask);
 
+  // the rules of the sentence are kept in m_coll
+  bool IsUsableInSubTasks() const {
+    return false;
+  }
+
   // for phrase-based model
   void GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const;
 
@@ -122,6 +122,14 @@ void PhraseDictionaryNodeMemory::Remove()
   m_targetPhraseCollection->Remove();
 }
 
+void PhraseDictionaryNodeMemory::Rehash(size_t terminalBuckets, size_t nonTerminalBuckets)
+{
+#if defined(BOOST_VERSION) && (BOOST_VERSION >= 104200)
+  m_sourceTermMap.rehash(terminalBuckets);
+  m_nonTermMap.rehash(nonTerminalBuckets);
+#endif
+}
+
 std::ostream& operator<<(std::ostream &out, const PhraseDictionaryNodeMemory &node)
 {
   out << node.GetTargetPhraseCollection();
@@ -140,6 +140,12 @@ public:
   bool IsLeaf() const {
     return m_sourceTermMap.empty() && m_nonTermMap.empty();
   }
+  bool HasTerminals() const {
+    return !m_sourceTermMap.empty();
+  }
+  bool HasNonTerminals() const {
+    return !m_nonTermMap.empty();
+  }
 
   void Prune(size_t tableLimit);
   void Sort(size_t tableLimit);
@@ -172,6 +178,9 @@ public:
 
   void Remove();
 
+  //! size the child maps for that many buckets, if they are hash maps
+  void Rehash(size_t terminalBuckets, size_t nonTerminalBuckets);
+
   TO_STRING();
 };
 
@@ -65,6 +65,11 @@ public:
   void InitializeForInput(ttasksptr const& ttask);
   void CleanUpAfterSentenceProcessing(InputType const& source);
 
+  // each thread opens the table in InitializeForInput()
+  bool IsUsableInSubTasks() const {
+    return false;
+  }
+
   virtual ChartRuleLookupManager *CreateRuleLookupManager(
     const ChartParser &,
     const ChartCellCollectionBase &,
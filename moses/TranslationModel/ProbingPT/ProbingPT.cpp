@@ -1,6 +1,7 @@
 // vim:tabstop=2
 #include "ProbingPT.h"
 #include "moses/StaticData.h"
+#include "moses/AlignmentInfoCollection.h"
 #include "moses/FactorCollection.h"
 #include "moses/TargetPhraseCollection.h"
 #include "moses/TranslationModel/CYKPlusParser/ChartRuleLookupManagerSkeleton.h"
@@ -41,31 +42,43 @@ void ProbingPT::Load(AllOptions::ptr const& opts)
     const string &wordStr = iterSource->second;
     const Factor *factor = FactorCollection::Instance().AddFactor(wordStr);
 
-    uint64_t probingId = iterSource->first;
-
-    SourceVocabMap::value_type entry(factor, probingId);
-    m_sourceVocabMap.insert(entry);
-
+    size_t factorId = factor->GetId();
+    if (factorId >= m_sourceVocab.size()) {
+      m_sourceVocab.resize(factorId + 1, m_unkId);
+    }
+    m_sourceVocab[factorId] = iterSource->first;
   }
 
   // target vocab
   const std::map<unsigned int, std::string> &probingVocab = m_engine->getVocab();
+  if (!probingVocab.empty()) {
+    m_targetVocab.resize(probingVocab.rbegin()->first + 1, NULL);
+  }
   std::map<unsigned int, std::string>::const_iterator iter;
   for (iter = probingVocab.begin(); iter != probingVocab.end(); ++iter) {
     const string &wordStr = iter->second;
-    const Factor *factor = FactorCollection::Instance().AddFactor(wordStr);
-
-    unsigned int probingId = iter->first;
-
-    TargetVocabMap::value_type entry(factor, probingId);
-    m_vocabMap.insert(entry);
+    m_targetVocab[iter->first] = FactorCollection::Instance().AddFactor(wordStr);
+  }
 
+  // alignments
+  const std::map<unsigned int, std::vector<unsigned char> > &probingAligns = m_engine->getAlignments();
+  if (!probingAligns.empty()) {
+    m_aligns.resize(probingAligns.rbegin()->first + 1, NULL);
+  }
+  std::map<unsigned int, std::vector<unsigned char> >::const_iterator iterAlign;
+  for (iterAlign = probingAligns.begin(); iterAlign != probingAligns.end(); ++iterAlign) {
+    m_aligns[iterAlign->first] = AlignmentInfoCollection::Instance().Add(iterAlign->second);
   }
 }
 
 void ProbingPT::InitializeForInput(ttasksptr const& ttask)
 {
-  ReduceCache();
+  if (m_maxCacheSize) {
+    ReduceCache();
+  } else {
+    // no persistent cache. Only reuse lookups within a sentence
+    GetCache().clear();
+  }
 }
 
 void ProbingPT::GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const
@@ -81,12 +94,20 @@ void ProbingPT::GetTargetPhraseCollectionBatch(const InputPathList &inputPathQue
       continue;
     }
 
-    TargetPhraseCollection::shared_ptr tpColl = CreateTargetPhrase(sourcePhrase);
-
-    // add target phrase to phrase-table cache
+    TargetPhraseCollection::shared_ptr tpColl;
     size_t hash = hash_value(sourcePhrase);
-    std::pair<TargetPhraseCollection::shared_ptr , clock_t> value(tpColl, clock());
-    cache[hash] = value;
+    CacheColl::iterator iterCache = cache.find(hash);
+    if (iterCache != cache.end()) {
+      // looked up before, in this or an earlier sentence
+      iterCache->second.second = clock();
+      tpColl = iterCache->second.first;
+    } else {
+      tpColl = CreateTargetPhrase(sourcePhrase);
+
+      // add target phrase to phrase-table cache
+      std::pair<TargetPhraseCollection::shared_ptr , clock_t> value(tpColl, clock());
+      cache[hash] = value;
+    }
 
     inputPath.SetTargetPhrases(*this, tpColl, NULL);
   }
@@ -125,20 +146,17 @@ TargetPhraseCollection::shared_ptr ProbingPT::CreateTargetPhrase(const Phrase &s
     return tpColl;
   }
 
-  std::pair<bool, std::vector<target_text> > query_result;
-
-  //Actual lookup
-  query_result = m_engine->query(probingSource);
-
-  if (query_result.first) {
-    //m_engine->printTargetInfo(query_result.second);
+  //Actual lookup. The target phrases are decoded straight from the mmapped table
+  const unsigned char *begin, *end;
+  if (m_engine->query(&probingSource[0], probingSource.size(), begin, end)) {
     tpColl.reset(new TargetPhraseCollection());
 
-    const std::vector<target_text> &probingTargetPhrases = query_result.second;
-    for (size_t i = 0; i < probingTargetPhrases.size(); ++i) {
-      const target_text &probingTargetPhrase = probingTargetPhrases[i];
-      TargetPhrase *tp = CreateTargetPhrase(sourcePhrase, probingTargetPhrase);
-
+    target_text_reader reader(begin, end, m_engine->getNumScores());
+    std::vector<unsigned int> probingPhrase;
+    std::vector<float> scores(m_engine->getNumScores());
+    unsigned int alignId;
+    while (reader.next(probingPhrase, scores.empty() ? NULL : &scores[0], alignId)) {
+      TargetPhrase *tp = CreateTargetPhrase(sourcePhrase, probingPhrase, scores, alignId);
       tpColl->Add(tp);
     }
 
@@ -148,10 +166,14 @@ TargetPhraseCollection::shared_ptr ProbingPT::CreateTargetPhrase(const Phrase &s
   return tpColl;
 }
 
-TargetPhrase *ProbingPT::CreateTargetPhrase(const Phrase &sourcePhrase, const target_text &probingTargetPhrase) const
+TargetPhrase *ProbingPT::CreateTargetPhrase(const Phrase &sourcePhrase,
+    const std::vector<unsigned int> &probingPhrase,
+    const std::vector<float> &probingScores,
+    unsigned int alignId) const
 {
-  const std::vector<unsigned int> &probingPhrase = probingTargetPhrase.target_phrase;
   size_t size = probingPhrase.size();
+  UTIL_THROW_IF2(alignId >= m_aligns.size() || m_aligns[alignId] == NULL,
+                 "Unknown alignment id " << alignId);
 
   TargetPhrase *tp = new TargetPhrase(this);
 
@@ -159,26 +181,19 @@ TargetPhrase *ProbingPT::CreateTargetPhrase(const Phrase &sourcePhrase, const ta
   for (size_t i = 0; i < size; ++i) {
     uint64_t probingId = probingPhrase[i];
     const Factor *factor = GetTargetFactor(probingId);
-    assert(factor);
+    UTIL_THROW_IF2(factor == NULL, "Unknown target word id " << probingId);
 
     Word &word = tp->AddWord();
     word.SetFactor(m_output[0], factor);
   }
 
   // score for this phrase table
-  vector<float> scores = probingTargetPhrase.prob;
-  std::transform(scores.begin(), scores.end(), scores.begin(),TransformScore);
+  vector<float> scores(probingScores.size());
+  std::transform(probingScores.begin(), probingScores.end(), scores.begin(), TransformScore);
   tp->GetScoreBreakdown().PlusEquals(this, scores);
 
   // alignment
-  /*
-  const std::vector<unsigned char> &alignments = probingTargetPhrase.word_all1;
-
-  AlignmentInfo &aligns = tp->GetAlignTerm();
-  for (size_t i = 0; i < alignS.size(); i += 2 ) {
-    aligns.Add((size_t) alignments[i], (size_t) alignments[i+1]);
-  }
-  */
+  tp->SetAlignTerm(m_aligns[alignId]);
 
   // score of all other ff when this rule is being loaded
   tp->EvaluateInIsolation(sourcePhrase, GetFeaturesToApply());
@@ -187,10 +202,8 @@ TargetPhrase *ProbingPT::CreateTargetPhrase(const Phrase &sourcePhrase, const ta
 
 const Factor *ProbingPT::GetTargetFactor(uint64_t probingId) const
 {
-  TargetVocabMap::right_map::const_iterator iter;
-  iter = m_vocabMap.right.find(probingId);
-  if (iter != m_vocabMap.right.end()) {
-    return iter->second;
+  if (probingId < m_targetVocab.size()) {
+    return m_targetVocab[probingId];
   } else {
     // not in mapping. Must be UNK
     return NULL;
@@ -199,10 +212,9 @@ const Factor *ProbingPT::GetTargetFactor(uint64_t probingId) const
 
 uint64_t ProbingPT::GetSourceProbingId(const Factor *factor) const
 {
-  SourceVocabMap::left_map::const_iterator iter;
-  iter = m_sourceVocabMap.left.find(factor);
-  if (iter != m_sourceVocabMap.left.end()) {
-    return iter->second;
+  size_t factorId = factor->GetId();
+  if (factorId < m_sourceVocab.size()) {
+    return m_sourceVocab[factorId];
   } else {
     // not in mapping. Must be UNK
     return m_unkId;
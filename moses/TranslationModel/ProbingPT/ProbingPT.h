@@ -1,11 +1,9 @@
 
 #pragma once
 
-#include <boost/bimap.hpp>
 #include "../PhraseDictionary.h"
 
 class QueryEngine;
-class target_text;
 
 namespace Moses
 {
@@ -40,14 +38,20 @@ public:
 protected:
   QueryEngine *m_engine;
 
-  typedef boost::bimap<const Factor *, uint64_t> SourceVocabMap;
-  mutable SourceVocabMap m_sourceVocabMap;
+  // probing ids of the source words, indexed by Factor::GetId(). m_unkId if not in the pt
+  std::vector<uint64_t> m_sourceVocab;
 
-  typedef boost::bimap<const Factor *, unsigned int> TargetVocabMap;
-  mutable TargetVocabMap m_vocabMap;
+  // target words, indexed by probing id. Interned once when loading
+  std::vector<const Factor *> m_targetVocab;
+
+  // word alignments, indexed by alignment id. Interned once when loading
+  std::vector<const AlignmentInfo *> m_aligns;
 
   TargetPhraseCollection::shared_ptr CreateTargetPhrase(const Phrase &sourcePhrase) const;
-  TargetPhrase *CreateTargetPhrase(const Phrase &sourcePhrase, const target_text &probingTargetPhrase) const;
+  TargetPhrase *CreateTargetPhrase(const Phrase &sourcePhrase,
+                                   const std::vector<unsigned int> &probingPhrase,
+                                   const std::vector<float> &scores,
+                                   unsigned int alignId) const;
   const Factor *GetTargetFactor(uint64_t probingId) const;
   uint64_t GetSourceProbingId(const Factor *factor) const;
 
@@ -37,6 +37,22 @@ Huffman::Huffman (const char * filepath)
   std::cerr << uniq_lines << std::endl;
 }
 
+Huffman::Huffman () : uniq_lines(0)
+{
+}
+
+void Huffman::merge_counts(const Huffman &other)
+{
+  for (std::map<std::string, unsigned int>::const_iterator it = other.target_phrase_words.begin();
+       it != other.target_phrase_words.end(); it++) {
+    target_phrase_words[it->first] += it->second;
+  }
+  for (std::map<std::vector<unsigned char>, unsigned int>::const_iterator it = other.word_all1.begin();
+       it != other.word_all1.end(); it++) {
+    word_all1[it->first] += it->second;
+  }
+}
+
 void Huffman::count_elements(line_text linein)
 {
   //For target phrase:
@@ -138,12 +154,12 @@ void Huffman::serialize_maps(const char * dirname)
   os2.close();
 }
 
-std::vector<unsigned char> Huffman::full_encode_line(line_text line)
+std::vector<unsigned char> Huffman::full_encode_line(line_text line) const
 {
   return vbyte_encode_line((encode_line(line)));
 }
 
-std::vector<unsigned int> Huffman::encode_line(line_text line)
+std::vector<unsigned int> Huffman::encode_line(line_text line) const
 {
   std::vector<unsigned int> retvector;
 
@@ -4,6 +4,7 @@
 #include "hash.hh"
 #include "line_splitter.hh"
 #include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -48,15 +49,20 @@ class Huffman
 
 public:
   Huffman (const char *);
+  Huffman (); //Empty counts, to be filled with count_elements
   void count_elements (line_text line);
+  void merge_counts (const Huffman &other); //Adds the element counts of other
+  void set_uniq_lines (unsigned long lines) {
+    uniq_lines = lines;
+  }
   void assign_values();
   void serialize_maps(const char * dirname);
   void produce_lookups();
 
-  std::vector<unsigned int> encode_line(line_text line);
+  std::vector<unsigned int> encode_line(line_text line) const;
 
   //encode line + variable byte ontop
-  std::vector<unsigned char> full_encode_line(line_text line);
+  std::vector<unsigned char> full_encode_line(line_text line) const;
 
   //Getters
   const std::map<unsigned int, std::string> get_target_lookup_map() const {
@@ -110,3 +116,54 @@ std::vector<unsigned char> vbyte_encode_line(std::vector<unsigned int> line);
 inline std::vector<unsigned char> vbyte_encode(unsigned int num);
 std::vector<unsigned int> vbyte_decode_line(std::vector<unsigned char> line);
 inline unsigned int bytes_to_int(std::vector<unsigned char> number);
+
+//Decodes the target phrases of one entry in place, straight from the variable byte encoded
+//bytes (normally inside the mmapped binary file). Unlike full_decode_line it neither copies
+//the bytes nor builds intermediate vectors, and it leaves the words as vocabulary ids so
+//that the caller can resolve them through a flat table.
+class target_text_reader
+{
+  const unsigned char * it;
+  const unsigned char * end;
+  int num_scores;
+
+  inline unsigned int read_number() {
+    unsigned int retvalue = 0;
+    unsigned char shift = 0;
+    while (it != end) {
+      unsigned char byte = *it++;
+      retvalue |= (byte & 0x7f) << shift;
+      if ((byte >> 7) != 1) {
+        break;
+      }
+      shift += 7;
+    }
+    return retvalue;
+  }
+
+public:
+  target_text_reader(const unsigned char * begin, const unsigned char * end_, int num_scores_)
+    : it(begin), end(end_), num_scores(num_scores_) {}
+
+  //Reads the next target phrase of the entry: its word ids go to words (which is cleared
+  //first), its num_scores scores to scores and its alignment id to word_all1.
+  //Returns false when there are no more target phrases.
+  bool next(std::vector<unsigned int> &words, float * scores, unsigned int &word_all1) {
+    if (it == end) {
+      return false;
+    }
+    words.clear();
+    for (unsigned int num = read_number(); num != 0; num = read_number()) {
+      words.push_back(num);
+    }
+    //Scores are stored as the bits of the floats and may be zero, so read exactly num_scores
+    for (int i = 0; i < num_scores; i++) {
+      unsigned int bits = read_number();
+      std::memcpy(&scores[i], &bits, sizeof(float));
+    }
+    read_number(); //zero after the scores
+    word_all1 = read_number();
+    read_number(); //zero ending the target phrase
+    return true;
+  }
+};
@@ -126,6 +126,25 @@ std::pair<bool, std::vector<target_text> > QueryEngine::query(std::vector<uint64
 
 }
 
+bool QueryEngine::query(const uint64_t * source_phrase, size_t size,
+                        const unsigned char *& begin, const unsigned char *& end) const
+{
+  //Same key as the other query functions
+  uint64_t key = 0;
+  for (size_t i = 0; i < size; i++) {
+    key += (source_phrase[i] << i);
+  }
+
+  const Entry * entry;
+  if (!table.Find(key, entry)) {
+    return false;
+  }
+
+  begin = binary_mmaped + entry -> GetValue();
+  end = begin + entry -> bytes_toread;
+  return true;
+}
+
 std::pair<bool, std::vector<target_text> > QueryEngine::query(StringPiece source_phrase)
 {
   bool found;
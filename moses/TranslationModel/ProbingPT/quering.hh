@@ -31,6 +31,10 @@ public:
   ~QueryEngine();
   std::pair<bool, std::vector<target_text> > query(StringPiece source_phrase);
   std::pair<bool, std::vector<target_text> > query(std::vector<uint64_t> source_phrase);
+  //Zero-copy lookup: on success [begin, end) are the encoded target phrases of the source
+  //phrase inside the mmapped binary file, to be decoded with a target_text_reader.
+  bool query(const uint64_t * source_phrase, size_t size,
+             const unsigned char *& begin, const unsigned char *& end) const;
   void printTargetInfo(std::vector<target_text> target_phrases);
   const std::map<unsigned int, std::string> getVocab() const {
     return decoder.get_target_lookup_map();
@@ -40,6 +44,15 @@ public:
     return source_vocabids;
   }
 
+  //Word alignments by alignment id, as source target pairs
+  const std::map<unsigned int, std::vector<unsigned char> > getAlignments() const {
+    return decoder.get_word_all1_lookup_map();
+  }
+
+  int getNumScores() const {
+    return num_scores;
+  }
+
 };
 
 
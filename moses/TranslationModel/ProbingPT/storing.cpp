@@ -1,5 +1,12 @@
 #include "storing.hh"
 
+#include "util/stream/chain.hh"
+#include "util/stream/line_input.hh"
+
+#include <algorithm>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/ref.hpp>
+
 BinaryFileWriter::BinaryFileWriter (std::string basepath) : os ((basepath + "/binfile.dat").c_str(), std::ios::binary)
 {
   binfile.reserve(10000); //Reserve part of the vector to avoid realocation
@@ -10,10 +17,11 @@ BinaryFileWriter::BinaryFileWriter (std::string basepath) : os ((basepath + "/bi
 
 void BinaryFileWriter::write (std::vector<unsigned char> * bytes)
 {
-  binfile.insert(it, bytes->begin(), bytes->end()); //Insert the bytes
+  //Insert the bytes. The insertion may reallocate, so only use iterators taken after it
+  binfile.insert(binfile.end(), bytes->begin(), bytes->end());
   //Keep track of the offsets
-  it += bytes->size();
-  dist_from_start = distance(binfile.begin(),it);
+  it = binfile.end();
+  dist_from_start = binfile.size();
   //Flush the vector to disk every once in a while so that we don't consume too much ram
   if (dist_from_start > 9000) {
     flush();
@@ -38,110 +46,330 @@ BinaryFileWriter::~BinaryFileWriter ()
   binfile.clear();
 }
 
-void createProbingPT(const char * phrasetable_path, const char * target_path,
-                     const char * num_scores, const char * is_reordering)
+namespace
 {
-  //Get basepath and create directory if missing
-  std::string basepath(target_path);
-  mkdir(basepath.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
 
-  //Set up huffman and serialize decoder maps.
-  Huffman huffmanEncoder(phrasetable_path); //initialize
-  huffmanEncoder.assign_values();
-  huffmanEncoder.produce_lookups();
-  huffmanEncoder.serialize_maps(target_path);
+//The phrase table is read twice, in blocks of whole lines, through a util::stream chain:
+//LineInput -> parallel workers -> a last worker that sees the results in file order.
+//Each of the parallel workers handles every threads-th block and passes the others on,
+//so that they work on different blocks at the same time. Their results for a block go to
+//a slot that the last worker consumes in order. Memory is bounded by the number of blocks.
+const std::size_t kBlockSize = 8 << 20;
 
-  //Get uniq lines:
-  unsigned long uniq_entries = huffmanEncoder.getUniqLines();
+//Splits a block of whole lines like FilePiece::ReadLine: without the newline and a
+//carriage return before it
+class BlockLines
+{
+  const char * it;
+  const char * end;
 
-  //Source phrase vocabids
-  std::map<uint64_t, std::string> source_vocabids;
+public:
+  BlockLines(const util::stream::Block &block)
+    : it(static_cast<const char *>(block.Get())), end(static_cast<const char *>(block.ValidEnd())) {}
 
-  //Read the file
-  util::FilePiece filein(phrasetable_path);
+  bool next(StringPiece &line) {
+    if (it == end) {
+      return false;
+    }
+    const char * newline = std::find(it, end, '\n');
+    if (newline == end) {
+      //Last line of the file, without a newline
+      line = StringPiece(it, end - it);
+      it = end;
+    } else {
+      const char * line_end = (newline > it && *(newline - 1) == '\r') ? newline - 1 : newline;
+      line = StringPiece(it, line_end - it);
+      it = newline + 1;
+    }
+    return true;
+  }
+};
 
-  //Init the probing hash table
-  size_t size = Table::Size(uniq_entries, 1.2);
-  char * mem = new char[size];
-  memset(mem, 0, size);
-  Table table(mem, size);
+//First pass: what the counting workers found in a block
+struct CountedBlock {
+  bool empty;
+  std::string first_source;
+  std::string last_source;
+  unsigned long changes; //Lines after the first with another source phrase than the line before
+};
 
-  BinaryFileWriter binfile(basepath); //Init the binary file writer.
+class CountWorker
+{
+  std::size_t worker;
+  std::size_t workers;
+  std::vector<CountedBlock> * slots;
+  Huffman * counts;
 
-  line_text prev_line; //Check if the source phrase of the previous line is the same
+public:
+  CountWorker(std::size_t worker_, std::size_t workers_, std::vector<CountedBlock> &slots_, Huffman &counts_)
+    : worker(worker_), workers(workers_), slots(&slots_), counts(&counts_) {}
 
-  //Keep track of the size of each group of target phrases
-  uint64_t entrystartidx = 0;
-  //uint64_t line_num = 0;
+  void Run(const util::stream::ChainPosition &position) {
+    std::size_t index = 0;
+    for (util::stream::Link block(position); block; ++block, ++index) {
+      if (index % workers != worker) continue;
+      CountedBlock &slot = (*slots)[index % slots->size()];
+      slot.empty = true;
+      slot.changes = 0;
 
+      BlockLines lines(*block);
+      StringPiece text, prev_source;
+      while (lines.next(text)) {
+        line_text line = splitLine(text);
+        counts->count_elements(line);
+        if (slot.empty) {
+          slot.first_source = line.source_phrase.as_string();
+          slot.empty = false;
+        } else if (line.source_phrase != prev_source) {
+          slot.changes++;
+        }
+        prev_source = line.source_phrase;
+      }
+      if (!slot.empty) {
+        slot.last_source = prev_source.as_string();
+      }
+    }
+  }
+};
 
-  //Read everything and processs
-  while(true) {
-    try {
-      //Process line read
-      line_text line;
-      line = splitLine(filein.ReadLine());
-      //Add source phrases to vocabularyIDs
-      add_to_map(&source_vocabids, line.source_phrase);
+//Counts the unique source phrases from the blocks in file order, like Huffman(const char *)
+class CountTally
+{
+  std::vector<CountedBlock> * slots;
+  std::string prev_source;
 
-      if ((binfile.dist_from_start + binfile.extra_counter) == 0) {
-        prev_line = line; //For the first iteration assume the previous line is
-      } //The same as this one.
+public:
+  unsigned long uniq_lines;
 
-      if (line.source_phrase != prev_line.source_phrase) {
+  CountTally(std::vector<CountedBlock> &slots_) : slots(&slots_), uniq_lines(0) {}
 
-        //Create a new entry even
+  void Run(const util::stream::ChainPosition &position) {
+    std::size_t index = 0;
+    for (util::stream::Link block(position); block; ++block, ++index) {
+      const CountedBlock &slot = (*slots)[index % slots->size()];
+      if (slot.empty) continue;
+      if (slot.first_source != prev_source) {
+        uniq_lines++;
+      }
+      uniq_lines += slot.changes;
+      prev_source = slot.last_source;
+    }
+  }
+};
 
-        //Create an entry for the previous source phrase:
-        Entry pesho;
-        pesho.value = entrystartidx;
-        //The key is the sum of hashes of individual words bitshifted by their position in the phrase.
-        //Probably not entirerly correct, but fast and seems to work fine in practise.
-        pesho.key = 0;
-        std::vector<uint64_t> vocabid_source = getVocabIDs(prev_line.source_phrase);
-        for (int i = 0; i < vocabid_source.size(); i++) {
-          pesho.key += (vocabid_source[i] << i);
-        }
-        pesho.bytes_toread = binfile.dist_from_start + binfile.extra_counter - entrystartidx;
+//Second pass: the encoded lines of a block
+struct EncodedLine {
+  bool new_source; //Another source phrase than the line before. Set by the writer for the first line
+  uint64_t key; //Hash table key of the source phrase, if new_source
+  unsigned int size; //Encoded bytes
+};
 
-        //Put into table
-        table.Insert(pesho);
+struct EncodedBlock {
+  std::vector<unsigned char> bytes;
+  std::vector<EncodedLine> lines;
+  std::string first_source;
+  std::string last_source;
+  std::map<uint64_t, std::string> source_vocabids;
+};
 
-        entrystartidx = binfile.dist_from_start + binfile.extra_counter; //Designate start idx for new entry
+class EncodeWorker
+{
+  std::size_t worker;
+  std::size_t workers;
+  std::vector<EncodedBlock> * slots;
+  const Huffman * encoder;
 
-        //Encode a line and write it to disk.
-        std::vector<unsigned char> encoded_line = huffmanEncoder.full_encode_line(line);
-        binfile.write(&encoded_line);
+public:
+  EncodeWorker(std::size_t worker_, std::size_t workers_, std::vector<EncodedBlock> &slots_, const Huffman &encoder_)
+    : worker(worker_), workers(workers_), slots(&slots_), encoder(&encoder_) {}
 
-        //Set prevLine
-        prev_line = line;
+  void Run(const util::stream::ChainPosition &position) {
+    std::size_t index = 0;
+    for (util::stream::Link block(position); block; ++block, ++index) {
+      if (index % workers != worker) continue;
+      EncodedBlock &slot = (*slots)[index % slots->size()];
+      slot.bytes.clear();
+      slot.lines.clear();
+      slot.source_vocabids.clear();
 
-      } else {
-        //If we still have the same line, just append to it:
-        std::vector<unsigned char> encoded_line = huffmanEncoder.full_encode_line(line);
-        binfile.write(&encoded_line);
+      BlockLines lines(*block);
+      StringPiece text, prev_source;
+      while (lines.next(text)) {
+        line_text line = splitLine(text);
+        EncodedLine encoded;
+        encoded.new_source = slot.lines.empty() || line.source_phrase != prev_source;
+        encoded.key = 0;
+        if (encoded.new_source) {
+          if (slot.lines.empty()) {
+            slot.first_source = line.source_phrase.as_string();
+          }
+          //Same key as the serial builder: hashes of the words shifted by their position
+          util::TokenIter<util::SingleCharacter> it(line.source_phrase, util::SingleCharacter(' '));
+          for (int i = 0; it; it++, i++) {
+            uint64_t vocabid = getHash(*it);
+            slot.source_vocabids.insert(std::pair<uint64_t, std::string>(vocabid, it->as_string()));
+            encoded.key += (vocabid << i);
+          }
+        }
+        std::vector<unsigned char> encoded_line = encoder->full_encode_line(line);
+        encoded.size = encoded_line.size();
+        slot.bytes.insert(slot.bytes.end(), encoded_line.begin(), encoded_line.end());
+        slot.lines.push_back(encoded);
+        prev_source = line.source_phrase;
       }
+      slot.last_source = prev_source.as_string();
+    }
+  }
+};
+
+//Writes the encoded blocks in file order and inserts an entry into the hash table for
+//each run of lines with the same source phrase
+class EncodeWriter
+{
+  std::vector<EncodedBlock> * slots;
+  BinaryFileWriter * binfile;
+  Table * table;
+  std::map<uint64_t, std::string> * source_vocabids;
 
-    } catch (util::EndOfFileException e) {
-      std::cerr << "Reading phrase table finished, writing remaining files to disk." << std::endl;
-      binfile.flush();
-
-      //After the final entry is constructed we need to add it to the phrase_table
-      //Create an entry for the previous source phrase:
-      Entry pesho;
-      pesho.value = entrystartidx;
-      //The key is the sum of hashes of individual words. Probably not entirerly correct, but fast
-      pesho.key = 0;
-      std::vector<uint64_t> vocabid_source = getVocabIDs(prev_line.source_phrase);
-      for (int i = 0; i < vocabid_source.size(); i++) {
-        pesho.key += (vocabid_source[i] << i);
+public:
+  EncodeWriter(std::vector<EncodedBlock> &slots_, BinaryFileWriter &binfile_, Table &table_,
+               std::map<uint64_t, std::string> &source_vocabids_)
+    : slots(&slots_), binfile(&binfile_), table(&table_), source_vocabids(&source_vocabids_) {}
+
+  void Run(const util::stream::ChainPosition &position) {
+    bool started = false;
+    std::string prev_source;
+    Entry entry;
+    entry.key = 0;
+    entry.value = 0;
+    uint64_t offset = 0;
+
+    std::size_t index = 0;
+    for (util::stream::Link block(position); block; ++block, ++index) {
+      EncodedBlock &slot = (*slots)[index % slots->size()];
+      if (slot.lines.empty()) continue;
+      if (started) {
+        slot.lines.front().new_source = slot.first_source != prev_source;
+      }
+
+      for (std::vector<EncodedLine>::const_iterator line = slot.lines.begin(); line != slot.lines.end(); ++line) {
+        if (line->new_source) {
+          if (started) {
+            entry.bytes_toread = offset - entry.value;
+            table->Insert(entry);
+          }
+          entry.key = line->key;
+          entry.value = offset;
+          started = true;
+        }
+        offset += line->size;
       }
-      pesho.bytes_toread = binfile.dist_from_start + binfile.extra_counter - entrystartidx;
-      //Put into table
-      table.Insert(pesho);
+      binfile->write(&slot.bytes);
 
-      break;
+      //Insert in file order: for colliding hashes the first word is kept, as in add_to_map
+      source_vocabids->insert(slot.source_vocabids.begin(), slot.source_vocabids.end());
+
+      prev_source = slot.last_source;
     }
+
+    //The entry of the last source phrase
+    entry.bytes_toread = offset - entry.value;
+    table->Insert(entry);
+  }
+};
+
+//Starts reading the phrase table into the blocks of chain, with a progress bar
+void StartReading(util::stream::Chain &chain, const char * phrasetable_path)
+{
+  util::scoped_fd fd(util::OpenReadOrThrow(phrasetable_path));
+  uint64_t file_size = util::SizeFile(fd.get());
+  if (file_size != util::kBadSize) {
+    chain.ActivateProgress();
+    chain.SetProgressTarget(file_size);
+  }
+  chain >> util::stream::LineInput(fd.release());
+}
+
+}
+
+void createProbingPT(const char * phrasetable_path, const char * target_path,
+                     const char * num_scores, const char * is_reordering, std::size_t threads)
+{
+  //Get basepath and create directory if missing
+  std::string basepath(target_path);
+  mkdir(basepath.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+
+  threads = std::max<std::size_t>(threads, 1);
+  //Enough blocks that every worker has one to work on while the reader fills the next ones
+  const std::size_t block_count = 2 * threads + 2;
+  const util::stream::ChainConfig config(1, block_count, block_count * kBlockSize);
+
+  //First pass: count the elements for the huffman codes and the unique source phrases
+  std::cerr << "Counting elements of " << phrasetable_path << " in " << threads << " threads." << std::endl;
+  Huffman huffmanEncoder;
+  {
+    std::vector<CountedBlock> slots(block_count);
+    boost::ptr_vector<Huffman> counts;
+    std::vector<CountWorker> workers;
+    for (std::size_t i = 0; i < threads; ++i) {
+      counts.push_back(new Huffman());
+      workers.push_back(CountWorker(i, threads, slots, counts.back()));
+    }
+    CountTally tally(slots);
+
+    util::stream::Chain chain(config);
+    StartReading(chain, phrasetable_path);
+    for (std::size_t i = 0; i < threads; ++i) {
+      chain >> boost::ref(workers[i]);
+    }
+    chain >> boost::ref(tally) >> util::stream::kRecycle;
+    chain.Wait();
+
+    for (std::size_t i = 0; i < threads; ++i) {
+      huffmanEncoder.merge_counts(counts[i]);
+    }
+    huffmanEncoder.set_uniq_lines(tally.uniq_lines);
+    std::cerr << "Unique entries counted: " << tally.uniq_lines << std::endl;
+  }
+
+  //Set up huffman and serialize decoder maps.
+  huffmanEncoder.assign_values();
+  huffmanEncoder.produce_lookups();
+  huffmanEncoder.serialize_maps(target_path);
+
+  //Get uniq lines:
+  unsigned long uniq_entries = huffmanEncoder.getUniqLines();
+
+  //Source phrase vocabids
+  std::map<uint64_t, std::string> source_vocabids;
+
+  //Init the probing hash table
+  size_t size = Table::Size(uniq_entries, 1.2);
+  char * mem = new char[size];
+  memset(mem, 0, size);
+  Table table(mem, size);
+
+  //Second pass: encode the lines and write them out
+  std::cerr << "Encoding " << phrasetable_path << " in " << threads << " threads." << std::endl;
+  {
+    BinaryFileWriter binfile(basepath); //Init the binary file writer.
+    std::vector<EncodedBlock> slots(block_count);
+    std::vector<EncodeWorker> workers;
+    for (std::size_t i = 0; i < threads; ++i) {
+      workers.push_back(EncodeWorker(i, threads, slots, huffmanEncoder));
+    }
+    EncodeWriter writer(slots, binfile, table, source_vocabids);
+
+    util::stream::Chain chain(config);
+    StartReading(chain, phrasetable_path);
+    for (std::size_t i = 0; i < threads; ++i) {
+      chain >> boost::ref(workers[i]);
+    }
+    chain >> boost::ref(writer) >> util::stream::kRecycle;
+    chain.Wait();
+
+    std::cerr << "Reading phrase table finished, writing remaining files to disk." << std::endl;
+    binfile.flush();
   }
 
   serialize_table(mem, size, (basepath + "/probing_hash.dat").c_str());
@@ -14,8 +14,10 @@
 #include "vocabid.hh"
 #define API_VERSION 3
 
+//Binarizes the phrase table in a pipeline of threads workers. The output does not depend
+//on the number of threads.
 void createProbingPT(const char * phrasetable_path, const char * target_path,
-                     const char * num_scores, const char * is_reordering);
+                     const char * num_scores, const char * is_reordering, std::size_t threads = 1);
 
 class BinaryFileWriter
 {
@@ -0,0 +1,164 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#include "CompactRuleTrie.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "moses/Terminal.h"
+#include "moses/TranslationModel/PhraseDictionaryNodeMemory.h"
+#include "util/exception.hh"
+
+namespace Moses
+{
+
+namespace
+{
+
+typedef PhraseDictionaryNodeMemory::TerminalMap TerminalMap;
+typedef PhraseDictionaryNodeMemory::NonTerminalMap NonTerminalMap;
+typedef std::pair<size_t, const TerminalMap::value_type*> HashedTerminal;
+
+bool HashOrder(const HashedTerminal &a, const HashedTerminal &b)
+{
+  return a.first < b.first;
+}
+
+void Count(const PhraseDictionaryNodeMemory &node, size_t &nodes,
+           size_t &terminals, size_t &nonTerminals)
+{
+  ++nodes;
+  terminals += node.GetTerminalMap().size();
+  nonTerminals += node.GetNonTerminalMap().size();
+  for (TerminalMap::const_iterator p = node.GetTerminalMap().begin(); p != node.GetTerminalMap().end(); ++p) {
+    Count(p->second, nodes, terminals, nonTerminals);
+  }
+  for (NonTerminalMap::const_iterator p = node.GetNonTerminalMap().begin(); p != node.GetNonTerminalMap().end(); ++p) {
+    Count(p->second, nodes, terminals, nonTerminals);
+  }
+}
+
+template <class T> T *Begin(std::vector<T> &vec)
+{
+  return vec.empty() ? NULL : &vec[0];
+}
+
+} // namespace
+
+const CompactRuleTrie::Node *CompactRuleTrie::Node::GetChild(const Word &sourceTerm) const
+{
+  UTIL_THROW_IF2(sourceTerm.IsNonTerminal(),
+                 "Not a terminal: " << sourceTerm);
+
+  size_t hash = TerminalHasher()(sourceTerm);
+  const size_t *end = m_terminalHashes + m_numTerminals;
+  for (const size_t *p = std::lower_bound(m_terminalHashes, end, hash); p != end && *p == hash; ++p) {
+    const TerminalEdge &edge = m_terminals[p - m_terminalHashes];
+    if (TerminalEqualityPred()(edge.word, sourceTerm)) {
+      return edge.child;
+    }
+  }
+  return NULL;
+}
+
+void CompactRuleTrie::Build(const PhraseDictionaryNodeMemory &root)
+{
+  Clear();
+
+  // sized up front: the edges point into m_nodes
+  size_t numNodes = 0, numTerminals = 0, numNonTerminals = 0;
+  Count(root, numNodes, numTerminals, numNonTerminals);
+  m_nodes.resize(numNodes);
+  m_terminalHashes.resize(numTerminals);
+  m_terminals.resize(numTerminals);
+  m_nonTerminals.resize(numNonTerminals);
+  m_targetPhraseCollections.resize(numNodes);
+
+  // breadth first. sources[i] is the original of m_nodes[i]
+  std::vector<const PhraseDictionaryNodeMemory*> sources(numNodes);
+  sources[0] = &root;
+  size_t nextNode = 1, nextTerminal = 0, nextNonTerminal = 0;
+  std::vector<HashedTerminal> terminals;
+
+  for (size_t i = 0; i < numNodes; ++i) {
+    const PhraseDictionaryNodeMemory &source = *sources[i];
+    Node &node = m_nodes[i];
+
+    m_targetPhraseCollections[i] = source.GetTargetPhraseCollection();
+    node.m_targetPhraseCollection = &m_targetPhraseCollections[i];
+
+    const TerminalMap &termMap = source.GetTerminalMap();
+    terminals.clear();
+    for (TerminalMap::const_iterator p = termMap.begin(); p != termMap.end(); ++p) {
+      terminals.push_back(HashedTerminal(TerminalHasher()(p->first), &*p));
+    }
+    std::sort(terminals.begin(), terminals.end(), HashOrder);
+
+    node.m_terminalHashes = Begin(m_terminalHashes) + nextTerminal;
+    node.m_terminals = Begin(m_terminals) + nextTerminal;
+    node.m_numTerminals = terminals.size();
+    for (size_t k = 0; k < terminals.size(); ++k, ++nextTerminal) {
+      m_terminalHashes[nextTerminal] = terminals[k].first;
+      TerminalEdge &edge = m_terminals[nextTerminal];
+      edge.word = terminals[k].second->first;
+      edge.child = &m_nodes[nextNode];
+      sources[nextNode++] = &terminals[k].second->second;
+    }
+
+    const NonTerminalMap &nonTermMap = source.GetNonTerminalMap();
+    node.m_nonTerminals = Begin(m_nonTerminals) + nextNonTerminal;
+    node.m_numNonTerminals = nonTermMap.size();
+    for (NonTerminalMap::const_iterator p = nonTermMap.begin(); p != nonTermMap.end(); ++p, ++nextNonTerminal) {
+      NonTerminalEdge &edge = m_nonTerminals[nextNonTerminal];
+#if defined(UNLABELLED_SOURCE)
+      edge.targetNonTerm = p->first[0];
+#else
+      edge.sourceNonTerm = p->first.first[0];
+      edge.targetNonTerm = p->first.second[0];
+#endif
+      edge.child = &m_nodes[nextNode];
+      sources[nextNode++] = &p->second;
+    }
+  }
+
+  UTIL_THROW_IF2(nextNode != numNodes || nextTerminal != numTerminals
+                 || nextNonTerminal != numNonTerminals,
+                 "Rule trie changed while it was copied");
+}
+
+void CompactRuleTrie::Clear()
+{
+  std::vector<Node>().swap(m_nodes);
+  std::vector<size_t>().swap(m_terminalHashes);
+  std::vector<TerminalEdge>().swap(m_terminals);
+  std::vector<NonTerminalEdge>().swap(m_nonTerminals);
+  std::vector<TargetPhraseCollection::shared_ptr>().swap(m_targetPhraseCollections);
+}
+
+size_t CompactRuleTrie::GetMemoryUsage() const
+{
+  return m_nodes.size() * sizeof(Node)
+         + m_terminalHashes.size() * sizeof(size_t)
+         + m_terminals.size() * sizeof(TerminalEdge)
+         + m_nonTerminals.size() * sizeof(NonTerminalEdge)
+         + m_targetPhraseCollections.size() * sizeof(TargetPhraseCollection::shared_ptr);
+}
+
+}  // namespace Moses
@@ -0,0 +1,145 @@
+/***********************************************************************
+ Moses - statistical machine translation system
+ Copyright (C) 2006-2011 University of Edinburgh
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+
+#include "moses/TargetPhraseCollection.h"
+#include "moses/Word.h"
+
+namespace Moses
+{
+
+class Factor;
+class PhraseDictionaryNodeMemory;
+
+/** Read-only copy of a PhraseDictionaryNodeMemory trie, built once the rule
+ *  table has been loaded (PhraseDictionaryMemory's compact=true).
+ *
+ *  The nodes are kept in one array in breadth-first order, so the children
+ *  of a node are next to each other, and the edges of each node are flat
+ *  blocks: the terminal edges sorted by hash, with the hashes in an array of
+ *  their own for the search, and the non-terminal edges in the iteration
+ *  order of the original trie, so that rules are found in the same order.
+ *  The target phrase collections are shared with the original trie, which
+ *  can be released after the copy is built.
+ */
+class CompactRuleTrie
+{
+public:
+  class Node;
+
+  struct TerminalEdge {
+    Word word;
+    const Node *child;
+  };
+
+  //! Non-terminal labels are compared on their first factor only
+  struct NonTerminalEdge {
+#if !defined(UNLABELLED_SOURCE)
+    const Factor *sourceNonTerm;
+#endif
+    const Factor *targetNonTerm;
+    const Node *child;
+  };
+
+  class Node
+  {
+  public:
+    bool IsLeaf() const {
+      return m_numTerminals == 0 && m_numNonTerminals == 0;
+    }
+    bool HasTerminals() const {
+      return m_numTerminals != 0;
+    }
+    bool HasNonTerminals() const {
+      return m_numNonTerminals != 0;
+    }
+
+    const Node *GetChild(const Word &sourceTerm) const;
+
+    const TerminalEdge *BeginTerminals() const {
+      return m_terminals;
+    }
+    const TerminalEdge *EndTerminals() const {
+      return m_terminals + m_numTerminals;
+    }
+    const NonTerminalEdge *BeginNonTerminals() const {
+      return m_nonTerminals;
+    }
+    const NonTerminalEdge *EndNonTerminals() const {
+      return m_nonTerminals + m_numNonTerminals;
+    }
+
+    const TargetPhraseCollection::shared_ptr &GetTargetPhraseCollection() const {
+      return *m_targetPhraseCollection;
+    }
+
+    // Hint that GetChild() or GetTargetPhraseCollection() will be called
+    // soon, so that the cache misses of several walks overlap.
+    void Prefetch() const {
+#ifdef __GNUC__
+      __builtin_prefetch(m_terminalHashes);
+      __builtin_prefetch(m_targetPhraseCollection->get());
+#endif
+    }
+
+  private:
+    friend class CompactRuleTrie;
+
+    const size_t *m_terminalHashes;
+    const TerminalEdge *m_terminals;
+    const NonTerminalEdge *m_nonTerminals;
+    const TargetPhraseCollection::shared_ptr *m_targetPhraseCollection;
+    uint32_t m_numTerminals, m_numNonTerminals;
+  };
+
+  CompactRuleTrie() {}
+
+  //! Replace the contents with a copy of the trie below root
+  void Build(const PhraseDictionaryNodeMemory &root);
+  void Clear();
+
+  bool IsEmpty() const {
+    return m_nodes.empty();
+  }
+  const Node &GetRootNode() const {
+    return m_nodes.front();
+  }
+  size_t GetNumNodes() const {
+    return m_nodes.size();
+  }
+  //! Bytes taken by the trie itself, not counting the target phrases
+  size_t GetMemoryUsage() const;
+
+private:
+  CompactRuleTrie(const CompactRuleTrie &);
+  CompactRuleTrie &operator=(const CompactRuleTrie &);
+
+  std::vector<Node> m_nodes;
+  std::vector<size_t> m_terminalHashes;
+  std::vector<TerminalEdge> m_terminals;
+  std::vector<NonTerminalEdge> m_nonTerminals;
+  std::vector<TargetPhraseCollection::shared_ptr> m_targetPhraseCollections;
+};
+
+}  // namespace Moses
@@ -20,6 +20,7 @@
 #include "LoaderStandard.h"
 
 #include <fstream>
+#include <memory>
 #include <string>
 #include <iterator>
 #include <algorithm>
@@ -27,6 +28,8 @@
 #include <sys/stat.h>
 #include <cstdlib>
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/ref.hpp>
 #include "Trie.h"
 #include "moses/FactorCollection.h"
 #include "moses/Word.h"
@@ -41,6 +44,9 @@
 #include "util/tokenize_piece.hh"
 #include "util/double-conversion/double-conversion.h"
 #include "util/exception.hh"
+#include "util/file.hh"
+#include "util/stream/chain.hh"
+#include "util/stream/line_input.hh"
 
 using namespace std;
 using namespace boost::algorithm;
@@ -140,6 +146,169 @@ void ReformatHieroRule(const string &lineOrig, string &out)
   out = ret.str();
 }
 
+namespace
+{
+
+/** Parses the lines of a rule table into target phrases, with buffers that
+ *  are reused from line to line.  Each loading thread has its own.
+ */
+class RuleParser
+{
+public:
+  RuleParser(AllOptions const& opts, FormatType format
+             , const std::vector<FactorType> &input
+             , const std::vector<FactorType> &output
+             , const RuleTableTrie &ruleTable)
+    : m_opts(opts)
+    , m_format(format)
+    , m_input(input)
+    , m_output(output)
+    , m_ruleTable(ruleTable)
+    , m_converter(double_conversion::StringToDoubleConverter::NO_FLAGS, NAN, NAN, "inf", "nan")
+    , m_internScores(false)
+    , m_internTarget(&ruleTable) {
+  }
+
+  /* Returns false if the line is skipped.  Otherwise, sourcePhrase (which
+   * must be empty), targetPhrase and sourceLHS are set and the caller owns
+   * the last two.  Errors do not mention the line: the caller adds it.
+   */
+  bool Parse(StringPiece line, Phrase &sourcePhrase, TargetPhrase *&targetPhrase, Word *&sourceLHS);
+
+  /* Creates the factors and sparse feature names of the line in the order
+   * that Parse() creates them, without building the rule.
+   */
+  void Intern(StringPiece line);
+
+private:
+  AllOptions const& m_opts;
+  FormatType m_format;
+  const std::vector<FactorType> &m_input;
+  const std::vector<FactorType> &m_output;
+  const RuleTableTrie &m_ruleTable;
+
+  // reused variables
+  vector<float> m_scoreVector;
+  std::string m_hieroBefore, m_hieroAfter;
+  double_conversion::StringToDoubleConverter m_converter;
+  // only used by Intern()
+  Phrase m_internPhrase;
+  ScoreComponentCollection m_internScores;
+  TargetPhrase m_internTarget;
+};
+
+bool RuleParser::Parse(StringPiece line, Phrase &sourcePhrase, TargetPhrase *&targetPhrase, Word *&sourceLHS)
+{
+  if (m_format == HieroFormat) { // inefficiently reformat line
+    m_hieroBefore.assign(line.data(), line.size());
+    ReformatHieroRule(m_hieroBefore, m_hieroAfter);
+    line = m_hieroAfter;
+  }
+
+  util::TokenIter<util::MultiCharacter> pipes(line, "|||");
+  StringPiece sourcePhraseString(*pipes);
+  StringPiece targetPhraseString(*++pipes);
+  StringPiece scoreString(*++pipes);
+
+  StringPiece alignString;
+  if (++pipes) {
+    StringPiece temp(*pipes);
+    alignString = temp;
+  }
+
+  bool isLHSEmpty = (sourcePhraseString.find_first_not_of(" \t", 0) == string::npos);
+  if (isLHSEmpty && !m_opts.unk.word_deletion_enabled) {
+    return false;
+  }
+
+  m_scoreVector.clear();
+  for (util::TokenIter<util::AnyCharacter, true> s(scoreString, " \t"); s; ++s) {
+    int processed;
+    float score = m_converter.StringToFloat(s->data(), s->length(), &processed);
+    UTIL_THROW_IF2(isnan(score), "Bad score " << *s);
+    m_scoreVector.push_back(FloorScore(TransformScore(score)));
+  }
+  const size_t numScoreComponents = m_ruleTable.GetNumScoreComponents();
+  if (m_scoreVector.size() != numScoreComponents) {
+    UTIL_THROW2("Size of scoreVector != number (" << m_scoreVector.size() << "!="
+                << numScoreComponents << ") of score components");
+  }
+
+  // parse source & find pt node
+
+  // constituent labels
+  sourceLHS = NULL;
+  Word *targetLHS;
+
+  // create target phrase obj, owned here until it is complete
+  std::auto_ptr<TargetPhrase> target(new TargetPhrase(&m_ruleTable));
+  target->CreateFromString(Output, m_output, targetPhraseString, &targetLHS);
+  // source
+  sourcePhrase.CreateFromString(Input, m_input, sourcePhraseString, &sourceLHS);
+
+  // rest of target phrase
+  target->SetAlignmentInfo(alignString);
+  target->SetTargetLHS(targetLHS);
+
+  ++pipes;  // skip over counts field
+
+  if (++pipes) {
+    StringPiece sparseString(*pipes);
+    target->SetSparseScore(&m_ruleTable, sparseString);
+  }
+
+  if (++pipes) {
+    StringPiece propertiesString(*pipes);
+    target->SetProperties(propertiesString);
+  }
+
+  target->GetScoreBreakdown().Assign(&m_ruleTable, m_scoreVector);
+  target->EvaluateInIsolation(sourcePhrase, m_ruleTable.GetFeaturesToApply());
+  targetPhrase = target.release();
+  return true;
+}
+
+void RuleParser::Intern(StringPiece line)
+{
+  if (m_format == HieroFormat) {
+    m_hieroBefore.assign(line.data(), line.size());
+    ReformatHieroRule(m_hieroBefore, m_hieroAfter);
+    line = m_hieroAfter;
+  }
+
+  util::TokenIter<util::MultiCharacter> pipes(line, "|||");
+  StringPiece sourcePhraseString(*pipes);
+  StringPiece targetPhraseString(*++pipes);
+  ++pipes;  // scores
+  ++pipes;  // alignment
+
+  bool isLHSEmpty = (sourcePhraseString.find_first_not_of(" \t", 0) == string::npos);
+  if (isLHSEmpty && !m_opts.unk.word_deletion_enabled) {
+    return;
+  }
+
+  Word *lhs;
+  m_internPhrase.Clear();
+  m_internPhrase.CreateFromString(Output, m_output, targetPhraseString, &lhs);
+  delete lhs;
+  m_internPhrase.Clear();
+  m_internPhrase.CreateFromString(Input, m_input, sourcePhraseString, &lhs);
+  delete lhs;
+
+  ++pipes;  // counts
+
+  if (++pipes) {
+    m_internScores.Assign(&m_ruleTable, pipes->as_string());
+    m_internScores.ZeroAll();
+  }
+
+  if (++pipes) {
+    m_internTarget.SetProperties(*pipes);
+  }
+}
+
+} // namespace
+
 bool RuleTableLoaderStandard::Load(AllOptions const& opts, FormatType format
                                    , const std::vector<FactorType> &input
                                    , const std::vector<FactorType> &output
@@ -149,21 +318,22 @@ bool RuleTableLoaderStandard::Load(AllOptions const& opts, FormatType format
 {
   PrintUserTime(string("Start loading text phrase table. ") + (format==MosesFormat?"Moses":"Hiero") + " format");
 
+  if (ruleTable.GetLoadThreads() > 1) {
+    LoadParallel(opts, format, input, output, inFile, ruleTable);
+    SortAndPrune(ruleTable);
+    return true;
+  }
+
   // const StaticData &staticData = StaticData::Instance();
 
-  string lineOrig;
   size_t count = 0;
 
   std::ostream *progress = NULL;
   IFVERBOSE(1) progress = &std::cerr;
   util::FilePiece in(inFile.c_str(), progress);
 
-  // reused variables
-  vector<float> scoreVector;
+  RuleParser parser(opts, format, input, output, ruleTable);
   StringPiece line;
-  std::string hiero_before, hiero_after;
-
-  double_conversion::StringToDoubleConverter converter(double_conversion::StringToDoubleConverter::NO_FLAGS, NAN, NAN, "inf", "nan");
 
   while(true) {
     try {
@@ -171,90 +341,248 @@ bool RuleTableLoaderStandard::Load(AllOptions const& opts, FormatType format
     } catch (const util::EndOfFileException &e) {
       break;
     }
+    ++count;
 
-    if (format == HieroFormat) { // inefficiently reformat line
-      hiero_before.assign(line.data(), line.size());
-      ReformatHieroRule(hiero_before, hiero_after);
-      line = hiero_after;
-    }
-
-    util::TokenIter<util::MultiCharacter> pipes(line, "|||");
-    StringPiece sourcePhraseString(*pipes);
-    StringPiece targetPhraseString(*++pipes);
-    StringPiece scoreString(*++pipes);
-
-    StringPiece alignString;
-    if (++pipes) {
-      StringPiece temp(*pipes);
-      alignString = temp;
+    Phrase sourcePhrase;
+    TargetPhrase *targetPhrase;
+    Word *sourceLHS;
+    try {
+      if (!parser.Parse(line, sourcePhrase, targetPhrase, sourceLHS)) {
+        TRACE_ERR( ruleTable.GetFilePath() << ":" << count << ": pt entry contains empty target, skipping\n");
+        continue;
+      }
+    } catch (const util::Exception &e) {
+      UTIL_THROW2(ruleTable.GetFilePath() << ":" << count << ": " << e.what());
     }
 
-    bool isLHSEmpty = (sourcePhraseString.find_first_not_of(" \t", 0) == string::npos);
-    if (isLHSEmpty && !opts.unk.word_deletion_enabled) {
-      TRACE_ERR( ruleTable.GetFilePath() << ":" << count << ": pt entry contains empty target, skipping\n");
-      continue;
-    }
+    AddRule(ruleTable, sourcePhrase, targetPhrase, sourceLHS);
+  }
 
-    scoreVector.clear();
-    for (util::TokenIter<util::AnyCharacter, true> s(scoreString, " \t"); s; ++s) {
-      int processed;
-      float score = converter.StringToFloat(s->data(), s->length(), &processed);
-      UTIL_THROW_IF2(isnan(score), "Bad score " << *s << " on line " << count);
-      scoreVector.push_back(FloorScore(TransformScore(score)));
-    }
-    const size_t numScoreComponents = ruleTable.GetNumScoreComponents();
-    if (scoreVector.size() != numScoreComponents) {
-      UTIL_THROW2("Size of scoreVector != number (" << scoreVector.size() << "!="
-                  << numScoreComponents << ") of score components on line " << count);
-    }
+  // sort and prune each target phrase collection
+  SortAndPrune(ruleTable);
 
-    // parse source & find pt node
+  return true;
+}
 
-    // constituent labels
-    Word *sourceLHS = NULL;
-    Word *targetLHS;
+void RuleTableLoaderStandard::AddRule(RuleTableTrie &ruleTable,
+                                      const Phrase &sourcePhrase,
+                                      TargetPhrase *targetPhrase,
+                                      Word *sourceLHS)
+{
+  TargetPhraseCollection::shared_ptr phraseColl
+  = GetOrCreateTargetPhraseCollection(ruleTable, sourcePhrase,
+                                      *targetPhrase, sourceLHS);
+  phraseColl->Add(targetPhrase);
 
-    // create target phrase obj
-    TargetPhrase *targetPhrase = new TargetPhrase(&ruleTable);
-    targetPhrase->CreateFromString(Output, output, targetPhraseString, &targetLHS);
-    // source
-    Phrase sourcePhrase;
-    sourcePhrase.CreateFromString(Input, input, sourcePhraseString, &sourceLHS);
+  // not implemented correctly in memory pt. just delete it for now
+  delete sourceLHS;
+}
 
-    // rest of target phrase
-    targetPhrase->SetAlignmentInfo(alignString);
-    targetPhrase->SetTargetLHS(targetLHS);
+namespace
+{
 
-    ++pipes;  // skip over counts field
+/* The rule table is read in blocks of whole lines through a util::stream
+ * chain: LineInput -> Interner -> parse workers -> RuleInserter.  The
+ * interner creates the factors and sparse feature names of each block in
+ * file order before any worker gets to it, so their ids (and with them the
+ * order of non-terminals and sparse features) are the same as with one
+ * thread.  Each of the parse workers handles every threads-th block and
+ * passes the others on, so that they work on different blocks at the same
+ * time.  The rules of a block go to a slot that the inserter consumes in
+ * file order, so that the table is the same as with one thread.  The trie
+ * is only touched by the inserter.
+ * Sparse feature names that feature functions create in
+ * EvaluateInIsolation() are still created by the workers as they get to
+ * them.
+ */
+const std::size_t kBlockSize = 1 << 20;
+
+// like FilePiece::ReadLine: without the newline and a carriage return before it
+StringPiece NextLine(const char *&it, const char *end)
+{
+  const char *newline = std::find(it, end, '\n');
+  const char *lineEnd = (newline != end && newline > it && newline[-1] == '\r') ? newline - 1 : newline;
+  StringPiece line(it, lineEnd - it);
+  it = newline == end ? end : newline + 1;
+  return line;
+}
 
-    if (++pipes) {
-      StringPiece sparseString(*pipes);
-      targetPhrase->SetSparseScore(&ruleTable, sparseString);
+struct ParsedRule {
+  Phrase sourcePhrase;
+  TargetPhrase *targetPhrase;
+  Word *sourceLHS;
+};
+
+struct ParsedBlock {
+  // only the first size elements of rules are valid, the others are reused
+  std::vector<ParsedRule> rules;
+  size_t size;
+  size_t numLines;
+  // lines, counted from 1 in the block, with an empty source phrase
+  std::vector<size_t> skipped;
+  // the first error in the block, if any. No rules are parsed after it
+  size_t errorLine;
+  std::string error;
+};
+
+class ParseWorker
+{
+public:
+  ParseWorker(size_t worker, size_t workers, std::vector<ParsedBlock> &slots, RuleParser *parser)
+    : m_worker(worker), m_workers(workers), m_slots(&slots), m_parser(parser) {}
+
+  void Run(const util::stream::ChainPosition &position) {
+    size_t index = 0;
+    for (util::stream::Link block(position); block; ++block, ++index) {
+      if (index % m_workers != m_worker) continue;
+      ParsedBlock &slot = (*m_slots)[index % m_slots->size()];
+      slot.size = 0;
+      slot.numLines = 0;
+      slot.skipped.clear();
+      slot.error.clear();
+
+      const char *it = static_cast<const char*>(block->Get());
+      const char *end = static_cast<const char*>(block->ValidEnd());
+      while (it != end) {
+        StringPiece line = NextLine(it, end);
+        ++slot.numLines;
+
+        if (slot.size == slot.rules.size()) {
+          slot.rules.resize(slot.size + 1);
+        }
+        ParsedRule &rule = slot.rules[slot.size];
+        rule.sourcePhrase.Clear();
+        try {
+          if (!m_parser->Parse(line, rule.sourcePhrase, rule.targetPhrase, rule.sourceLHS)) {
+            slot.skipped.push_back(slot.numLines);
+            continue;
+          }
+        } catch (const std::exception &e) {
+          slot.errorLine = slot.numLines;
+          slot.error = e.what();
+          break;
+        }
+        ++slot.size;
+      }
     }
+  }
+
+private:
+  size_t m_worker;
+  size_t m_workers;
+  std::vector<ParsedBlock> *m_slots;
+  RuleParser *m_parser;
+};
 
-    if (++pipes) {
-      StringPiece propertiesString(*pipes);
-      targetPhrase->SetProperties(propertiesString);
+class Interner
+{
+public:
+  explicit Interner(RuleParser *parser) : m_parser(parser) {}
+
+  void Run(const util::stream::ChainPosition &position) {
+    for (util::stream::Link block(position); block; ++block) {
+      const char *it = static_cast<const char*>(block->Get());
+      const char *end = static_cast<const char*>(block->ValidEnd());
+      while (it != end) {
+        try {
+          m_parser->Intern(NextLine(it, end));
+        } catch (const std::exception &) {
+          // the worker that parses the line reports the error
+        }
+      }
     }
+  }
 
-    targetPhrase->GetScoreBreakdown().Assign(&ruleTable, scoreVector);
-    targetPhrase->EvaluateInIsolation(sourcePhrase, ruleTable.GetFeaturesToApply());
+private:
+  RuleParser *m_parser;
+};
 
-    TargetPhraseCollection::shared_ptr phraseColl
-    = GetOrCreateTargetPhraseCollection(ruleTable, sourcePhrase,
-                                        *targetPhrase, sourceLHS);
-    phraseColl->Add(targetPhrase);
+} // namespace
 
-    // not implemented correctly in memory pt. just delete it for now
-    delete sourceLHS;
+// Adds the parsed rules to the table in file order, and finds the first error
+class RuleTableLoaderStandard::RuleInserter
+{
+public:
+  RuleInserter(RuleTableLoaderStandard &loader, RuleTableTrie &ruleTable, std::vector<ParsedBlock> &slots)
+    : m_loader(&loader), m_ruleTable(&ruleTable), m_slots(&slots), m_errorLine(0) {}
+
+  void Run(const util::stream::ChainPosition &position) {
+    size_t lines = 0;
+    size_t index = 0;
+    for (util::stream::Link block(position); block; ++block, ++index) {
+      ParsedBlock &slot = (*m_slots)[index % m_slots->size()];
+      for (size_t i = 0; i < slot.size; ++i) {
+        ParsedRule &rule = slot.rules[i];
+        if (m_error.empty()) {
+          m_loader->AddRule(*m_ruleTable, rule.sourcePhrase, rule.targetPhrase, rule.sourceLHS);
+        } else {
+          delete rule.targetPhrase;
+          delete rule.sourceLHS;
+        }
+      }
+      if (m_error.empty()) {
+        for (size_t i = 0; i < slot.skipped.size(); ++i) {
+          TRACE_ERR( m_ruleTable->GetFilePath() << ":" << lines + slot.skipped[i] << ": pt entry contains empty target, skipping\n");
+        }
+        if (!slot.error.empty()) {
+          m_errorLine = lines + slot.errorLine;
+          m_error = slot.error;
+        }
+      }
+      lines += slot.numLines;
+    }
+  }
 
-    count++;
+  void ThrowIfError() const {
+    UTIL_THROW_IF2(!m_error.empty(), m_ruleTable->GetFilePath() << ":" << m_errorLine << ": " << m_error);
   }
 
-  // sort and prune each target phrase collection
-  SortAndPrune(ruleTable);
+private:
+  RuleTableLoaderStandard *m_loader;
+  RuleTableTrie *m_ruleTable;
+  std::vector<ParsedBlock> *m_slots;
+  size_t m_errorLine;
+  std::string m_error;
+};
+
+void RuleTableLoaderStandard::LoadParallel(AllOptions const& opts, FormatType format
+    , const std::vector<FactorType> &input
+    , const std::vector<FactorType> &output
+    , const std::string &inFile
+    , RuleTableTrie &ruleTable)
+{
+  const size_t threads = ruleTable.GetLoadThreads();
+  // enough blocks that every worker has one to work on while the reader fills the next ones
+  const size_t blockCount = 2 * threads + 2;
+  std::vector<ParsedBlock> slots(blockCount);
+
+  boost::ptr_vector<RuleParser> parsers;
+  std::vector<ParseWorker> workers;
+  for (size_t i = 0; i < threads; ++i) {
+    parsers.push_back(new RuleParser(opts, format, input, output, ruleTable));
+    workers.push_back(ParseWorker(i, threads, slots, &parsers.back()));
+  }
+  RuleParser internParser(opts, format, input, output, ruleTable);
+  Interner interner(&internParser);
+  RuleInserter inserter(*this, ruleTable, slots);
+
+  util::scoped_fd fd(util::OpenReadOrThrow(inFile.c_str()));
+  util::stream::Chain chain(util::stream::ChainConfig(1, blockCount, blockCount * kBlockSize));
+  IFVERBOSE(1) {
+    uint64_t fileSize = util::SizeFile(fd.get());
+    if (fileSize != util::kBadSize) {
+      chain.ActivateProgress();
+      chain.SetProgressTarget(fileSize);
+    }
+  }
+  chain >> util::stream::LineInput(fd.release()) >> boost::ref(interner);
+  for (size_t i = 0; i < threads; ++i) {
+    chain >> boost::ref(workers[i]);
+  }
+  chain >> boost::ref(inserter) >> util::stream::kRecycle;
+  chain.Wait();
 
-  return true;
+  inserter.ThrowIfError();
 }
 
 }
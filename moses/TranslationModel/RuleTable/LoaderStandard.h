@@ -24,7 +24,10 @@
 namespace Moses
 {
 
-//! Loader to load Moses-formatted SCFG rules from a text file
+/** Loader to load Moses-formatted SCFG rules from a text file.  If the rule
+ *  table has load-threads > 1, the rules are parsed on that many threads
+ *  and added to the table in file order by one more.
+ */
 class RuleTableLoaderStandard : public RuleTableLoader
 {
 protected:
@@ -43,6 +46,22 @@ public:
             const std::string &inFile,
             size_t tableLimit,
             RuleTableTrie &);
+
+private:
+  class RuleInserter;
+
+  void LoadParallel(AllOptions const& opts,
+                    FormatType format,
+                    const std::vector<FactorType> &input,
+                    const std::vector<FactorType> &output,
+                    const std::string &inFile,
+                    RuleTableTrie &);
+
+  //! Takes ownership of targetPhrase and sourceLHS
+  void AddRule(RuleTableTrie &ruleTable,
+               const Phrase &sourcePhrase,
+               TargetPhrase *targetPhrase,
+               Word *sourceLHS);
 };
 
 }  // namespace Moses
@@ -58,6 +58,7 @@ void PhraseDictionaryALSuffixArray::InitializeForInput(ttasksptr const& ttask)
 void PhraseDictionaryALSuffixArray::CleanUpAfterSentenceProcessing(const InputType &source)
 {
   m_collection.Remove();
+  m_compactTrie.Clear();
 }
 
 }
@@ -24,6 +24,10 @@ class PhraseDictionaryALSuffixArray : public PhraseDictionaryMemory
 public:
   PhraseDictionaryALSuffixArray(const std::string &line);
   void Load(AllOptions::ptr const& opts);
+  // the rules are loaded per sentence, there's nothing to save
+  bool WriteSnapshot(SnapshotWriter &/*snapshot*/) const {
+    return false;
+  }
   void InitializeForInput(ttasksptr const& ttask);
   void CleanUpAfterSentenceProcessing(const InputType& source);
 
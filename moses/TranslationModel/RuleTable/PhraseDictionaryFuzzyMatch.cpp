@@ -28,6 +28,7 @@
 #include <dirent.h>
 
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <iterator>
 #include <algorithm>
@@ -83,6 +84,8 @@ namespace Moses
 PhraseDictionaryFuzzyMatch::PhraseDictionaryFuzzyMatch(const std::string &line)
   :PhraseDictionary(line, true)
   ,m_config(3)
+  ,m_inMemory(false)
+  ,m_matchThreads(1)
   ,m_FuzzyMatchWrapper(NULL)
 {
   ReadParameters();
@@ -99,6 +102,7 @@ void PhraseDictionaryFuzzyMatch::Load(AllOptions::ptr const& opts)
   SetFeaturesToApply();
 
   m_FuzzyMatchWrapper = new tmmt::FuzzyMatchWrapper(m_config[0], m_config[1], m_config[2]);
+  m_FuzzyMatchWrapper->SetMatchThreads(m_matchThreads);
 }
 
 ChartRuleLookupManager *PhraseDictionaryFuzzyMatch::CreateRuleLookupManager(
@@ -119,6 +123,10 @@ SetParameter(const std::string& key, const std::string& value)
     m_config[1] = value;
   } else if (key == "alignment") {
     m_config[2] = value;
+  } else if (key == "in-memory") {
+    m_inMemory = Scan<bool>(value);
+  } else if (key == "match-threads") {
+    m_matchThreads = std::max<size_t>(Scan<size_t>(value), 1);
   } else {
     PhraseDictionary::SetParameter(key, value);
   }
@@ -175,6 +183,29 @@ int removedirectoryrecursively(const char *dirname)
 }
 
 void PhraseDictionaryFuzzyMatch::InitializeForInput(ttasksptr const& ttask)
+{
+  long translationId = ttask->GetSource()->GetTranslationId();
+
+  // populate with rules for this sentence
+  PhraseDictionaryNodeMemory *rootNode;
+  {
+#ifdef WITH_THREADS
+    boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
+#endif
+    rootNode = &m_collection[translationId];
+  }
+
+  if (m_inMemory) {
+    ExtractRules(ttask, *rootNode);
+  } else {
+    LoadExtractedRules(ttask, *rootNode);
+  }
+
+  // sort and prune each target phrase collection
+  SortAndPrune(*rootNode);
+}
+
+void PhraseDictionaryFuzzyMatch::LoadExtractedRules(ttasksptr const& ttask, PhraseDictionaryNodeMemory &rootNode)
 {
   InputType const& inputSentence = *ttask->GetSource();
 #if defined __MINGW32__
@@ -201,8 +232,6 @@ void PhraseDictionaryFuzzyMatch::InitializeForInput(ttasksptr const& ttask)
   long translationId = inputSentence.GetTranslationId();
   string ptFileName = m_FuzzyMatchWrapper->Extract(translationId, dirNameStr);
 
-  // populate with rules for this sentence
-  PhraseDictionaryNodeMemory &rootNode = m_collection[translationId];
   FormatType format = MosesFormat;
 
   // data from file
@@ -211,9 +240,6 @@ void PhraseDictionaryFuzzyMatch::InitializeForInput(ttasksptr const& ttask)
   // copied from class LoaderStandard
   PrintUserTime("Start loading fuzzy-match phrase model");
 
-  const StaticData &staticData = StaticData::Instance();
-
-
   string lineOrig;
   size_t count = 0;
 
@@ -232,7 +258,7 @@ void PhraseDictionaryFuzzyMatch::InitializeForInput(ttasksptr const& ttask)
 
     TokenizeMultiCharSeparator(tokens, *line , "|||" );
 
-    if (tokens.size() != 4 && tokens.size() != 5) {
+    if (tokens.size() < 4) {
       UTIL_THROW2("Syntax error at " << ptFileName << ":" << count);
     }
 
@@ -257,36 +283,7 @@ void PhraseDictionaryFuzzyMatch::InitializeForInput(ttasksptr const& ttask)
     UTIL_THROW_IF2(scoreVector.size() != numScoreComponents,
                    "Number of scores incorrectly specified");
 
-    // parse source & find pt node
-
-    // constituent labels
-    Word *sourceLHS;
-    Word *targetLHS;
-
-    // source
-    Phrase sourcePhrase( 0);
-    sourcePhrase.CreateFromString(Input, m_input, sourcePhraseString, &sourceLHS);
-
-    // create target phrase obj
-    TargetPhrase *targetPhrase = new TargetPhrase(this);
-    targetPhrase->CreateFromString(Output, m_output, targetPhraseString, &targetLHS);
-
-    // rest of target phrase
-    targetPhrase->SetAlignmentInfo(alignString);
-    targetPhrase->SetTargetLHS(targetLHS);
-    //targetPhrase->SetDebugOutput(string("New Format pt ") + line);
-
-    // component score, for n-best output
-    std::transform(scoreVector.begin(),scoreVector.end(),scoreVector.begin(),TransformScore);
-    std::transform(scoreVector.begin(),scoreVector.end(),scoreVector.begin(),FloorScore);
-
-    targetPhrase->GetScoreBreakdown().Assign(this, scoreVector);
-    targetPhrase->EvaluateInIsolation(sourcePhrase, GetFeaturesToApply());
-
-    TargetPhraseCollection::shared_ptr phraseColl
-    = GetOrCreateTargetPhraseCollection(rootNode, sourcePhrase,
-                                        *targetPhrase, sourceLHS);
-    phraseColl->Add(targetPhrase);
+    AddRule(rootNode, sourcePhraseString, targetPhraseString, scoreVector, alignString);
 
     count++;
 
@@ -298,12 +295,70 @@ void PhraseDictionaryFuzzyMatch::InitializeForInput(ttasksptr const& ttask)
 
   }
 
-  // sort and prune each target phrase collection
-  SortAndPrune(rootNode);
-
   //removedirectoryrecursively(dirName);
 }
 
+void PhraseDictionaryFuzzyMatch::ExtractRules(ttasksptr const& ttask, PhraseDictionaryNodeMemory &rootNode)
+{
+  InputType const& inputSentence = *ttask->GetSource();
+
+  std::ostringstream input;
+  for (size_t i = 1; i < inputSentence.GetSize() - 1; ++i) {
+    input << inputSentence.GetWord(i);
+  }
+
+  vector<tmmt::FuzzyMatchWrapper::ExtractedRule> rules;
+  m_FuzzyMatchWrapper->ExtractRules(inputSentence.GetTranslationId(), input.str(), rules);
+
+  const size_t numScoreComponents = GetNumScoreComponents();
+  for (size_t i = 0; i < rules.size(); ++i) {
+    tmmt::FuzzyMatchWrapper::ExtractedRule &rule = rules[i];
+    UTIL_THROW_IF2(rule.scores.size() != numScoreComponents,
+                   "Size of scoreVector != number (" << rule.scores.size() << "!="
+                   << numScoreComponents << ") of score components of extracted rules");
+
+    AddRule(rootNode, rule.source, rule.target, rule.scores, rule.alignment);
+  }
+}
+
+void PhraseDictionaryFuzzyMatch::AddRule(PhraseDictionaryNodeMemory &rootNode
+    , const string &sourcePhraseString
+    , const string &targetPhraseString
+    , vector<float> &scoreVector
+    , const string &alignString)
+{
+  // parse source & find pt node
+
+  // constituent labels
+  Word *sourceLHS;
+  Word *targetLHS;
+
+  // source
+  Phrase sourcePhrase( 0);
+  sourcePhrase.CreateFromString(Input, m_input, sourcePhraseString, &sourceLHS);
+
+  // create target phrase obj
+  TargetPhrase *targetPhrase = new TargetPhrase(this);
+  targetPhrase->CreateFromString(Output, m_output, targetPhraseString, &targetLHS);
+
+  // rest of target phrase
+  targetPhrase->SetAlignmentInfo(alignString);
+  targetPhrase->SetTargetLHS(targetLHS);
+  //targetPhrase->SetDebugOutput(string("New Format pt ") + line);
+
+  // component score, for n-best output
+  std::transform(scoreVector.begin(),scoreVector.end(),scoreVector.begin(),TransformScore);
+  std::transform(scoreVector.begin(),scoreVector.end(),scoreVector.begin(),FloorScore);
+
+  targetPhrase->GetScoreBreakdown().Assign(this, scoreVector);
+  targetPhrase->EvaluateInIsolation(sourcePhrase, GetFeaturesToApply());
+
+  TargetPhraseCollection::shared_ptr phraseColl
+  = GetOrCreateTargetPhraseCollection(rootNode, sourcePhrase,
+                                      *targetPhrase, sourceLHS);
+  phraseColl->Add(targetPhrase);
+}
+
 TargetPhraseCollection::shared_ptr
 PhraseDictionaryFuzzyMatch::
 GetOrCreateTargetPhraseCollection(PhraseDictionaryNodeMemory &rootNode
@@ -372,11 +427,17 @@ void PhraseDictionaryFuzzyMatch::SortAndPrune(PhraseDictionaryNodeMemory &rootNo
 
 void PhraseDictionaryFuzzyMatch::CleanUpAfterSentenceProcessing(const InputType &source)
 {
+#ifdef WITH_THREADS
+  boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
+#endif
   m_collection.erase(source.GetTranslationId());
 }
 
 const PhraseDictionaryNodeMemory &PhraseDictionaryFuzzyMatch::GetRootNode(long translationId) const
 {
+#ifdef WITH_THREADS
+  boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
+#endif
   std::map<long, PhraseDictionaryNodeMemory>::const_iterator iter = m_collection.find(translationId);
   UTIL_THROW_IF2(iter == m_collection.end(),
                  "Couldn't find root node for input: " << translationId);
@@ -385,6 +446,9 @@ const PhraseDictionaryNodeMemory &PhraseDictionaryFuzzyMatch::GetRootNode(long t
 PhraseDictionaryNodeMemory &PhraseDictionaryFuzzyMatch::GetRootNode(const InputType &source)
 {
   long transId = source.GetTranslationId();
+#ifdef WITH_THREADS
+  boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
+#endif
   std::map<long, PhraseDictionaryNodeMemory>::iterator iter = m_collection.find(transId);
   UTIL_THROW_IF2(iter == m_collection.end(),
                  "Couldn't find root node for input: " << transId);
@@ -20,6 +20,10 @@
 
 #pragma once
 
+#ifdef WITH_THREADS
+#include <boost/thread/shared_mutex.hpp>
+#endif
+
 #include "Trie.h"
 #include "moses/TranslationModel/PhraseDictionary.h"
 #include "moses/InputType.h"
@@ -35,6 +39,13 @@ class ChartParser;
 
 /** Implementation of a SCFG rule table in a trie.  Looking up a rule of
  * length n symbols requires n look-ups to find the TargetPhraseCollection.
+ *
+ * The trie of each input sentence holds the rules extracted from its fuzzy
+ * matches in a translation memory. By default, they are scored with the
+ * training scripts in a temporary directory, and loaded from there; with
+ * in-memory=true, they are scored and added to the trie directly.
+ * With match-threads=N, the TM sentences that match an input are scored in
+ * N sub-tasks, which idle decoder threads can pick up.
  */
 class PhraseDictionaryFuzzyMatch : public PhraseDictionary
 {
@@ -71,14 +82,30 @@ protected:
       , const TargetPhrase &target
       , const Word *sourceLHS);
 
+  void AddRule(PhraseDictionaryNodeMemory &rootNode
+               , const std::string &sourcePhraseString
+               , const std::string &targetPhraseString
+               , std::vector<float> &scoreVector
+               , const std::string &alignString);
+
+  void LoadExtractedRules(ttasksptr const& ttask, PhraseDictionaryNodeMemory &rootNode);
+  void ExtractRules(ttasksptr const& ttask, PhraseDictionaryNodeMemory &rootNode);
+
   void SortAndPrune(PhraseDictionaryNodeMemory &rootNode);
   PhraseDictionaryNodeMemory &GetRootNode(const InputType &source);
 
   std::map<long, PhraseDictionaryNodeMemory> m_collection;
   std::vector<std::string> m_config;
+  bool m_inMemory;
+  size_t m_matchThreads;
 
   tmmt::FuzzyMatchWrapper *m_FuzzyMatchWrapper;
 
+#ifdef WITH_THREADS
+  //! guards m_collection, which all threads add their input to
+  mutable boost::shared_mutex m_accessLock;
+#endif
+
 };
 
 }  // namespace Moses
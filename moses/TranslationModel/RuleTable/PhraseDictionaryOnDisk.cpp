@@ -51,6 +51,14 @@ void PhraseDictionaryOnDisk::Load(AllOptions::ptr const& opts)
 {
   m_options = opts;
   SetFeaturesToApply();
+
+  if (OnDiskPt::OnDiskWrapper::GetVersion(m_filePath)
+      == (uint64_t) OnDiskPt::OnDiskWrapper::MAPPED_VERSION_NUM) {
+    OnDiskPt::OnDiskWrapper *obj = new OnDiskPt::OnDiskWrapper();
+    obj->BeginLoad(m_filePath);
+    CheckCompatibility(*obj);
+    m_sharedImplementation.reset(obj);
+  }
 }
 
 ChartRuleLookupManager *PhraseDictionaryOnDisk::CreateRuleLookupManager(
@@ -66,6 +74,9 @@ ChartRuleLookupManager *PhraseDictionaryOnDisk::CreateRuleLookupManager(
 
 OnDiskPt::OnDiskWrapper &PhraseDictionaryOnDisk::GetImplementation()
 {
+  if (m_sharedImplementation)
+    return *m_sharedImplementation;
+
   OnDiskPt::OnDiskWrapper* dict;
   dict = m_implementation.get();
   UTIL_THROW_IF2(dict == NULL, "Dictionary object not yet created for this thread");
@@ -74,6 +85,9 @@ OnDiskPt::OnDiskWrapper &PhraseDictionaryOnDisk::GetImplementation()
 
 const OnDiskPt::OnDiskWrapper &PhraseDictionaryOnDisk::GetImplementation() const
 {
+  if (m_sharedImplementation)
+    return *m_sharedImplementation;
+
   OnDiskPt::OnDiskWrapper* dict;
   dict = m_implementation.get();
   UTIL_THROW_IF2(dict == NULL, "Dictionary object not yet created for this thread");
@@ -82,29 +96,38 @@ const OnDiskPt::OnDiskWrapper &PhraseDictionaryOnDisk::GetImplementation() const
 
 void PhraseDictionaryOnDisk::InitializeForInput(ttasksptr const& ttask)
 {
-  InputType const& source = *ttask->GetSource();
   ReduceCache();
 
+  // the mapped table is read in place, nothing to set up
+  if (m_sharedImplementation)
+    return;
+
   OnDiskPt::OnDiskWrapper *obj = new OnDiskPt::OnDiskWrapper();
   obj->BeginLoad(m_filePath);
+  CheckCompatibility(*obj);
 
-  UTIL_THROW_IF2(obj->GetMisc("Version") != OnDiskPt::OnDiskWrapper::VERSION_NUM,
-                 "On-disk phrase table is version " <<  obj->GetMisc("Version")
-                 << ". It is not compatible with version " << OnDiskPt::OnDiskWrapper::VERSION_NUM);
+  m_implementation.reset(obj);
+}
 
-  UTIL_THROW_IF2(obj->GetMisc("NumSourceFactors") != m_input.size(),
-                 "On-disk phrase table has " <<  obj->GetMisc("NumSourceFactors") << " source factors."
+void PhraseDictionaryOnDisk::CheckCompatibility(const OnDiskPt::OnDiskWrapper &wrapper) const
+{
+  UTIL_THROW_IF2(wrapper.GetMisc("Version") != OnDiskPt::OnDiskWrapper::VERSION_NUM
+                 && wrapper.GetMisc("Version") != OnDiskPt::OnDiskWrapper::MAPPED_VERSION_NUM,
+                 "On-disk phrase table is version " <<  wrapper.GetMisc("Version")
+                 << ". It is not compatible with version " << OnDiskPt::OnDiskWrapper::VERSION_NUM
+                 << " or " << OnDiskPt::OnDiskWrapper::MAPPED_VERSION_NUM);
+
+  UTIL_THROW_IF2(wrapper.GetMisc("NumSourceFactors") != m_input.size(),
+                 "On-disk phrase table has " <<  wrapper.GetMisc("NumSourceFactors") << " source factors."
                  << ". The ini file specified " << m_input.size() << " source factors");
 
-  UTIL_THROW_IF2(obj->GetMisc("NumTargetFactors") != m_output.size(),
-                 "On-disk phrase table has " <<  obj->GetMisc("NumTargetFactors") << " target factors."
+  UTIL_THROW_IF2(wrapper.GetMisc("NumTargetFactors") != m_output.size(),
+                 "On-disk phrase table has " <<  wrapper.GetMisc("NumTargetFactors") << " target factors."
                  << ". The ini file specified " << m_output.size() << " target factors");
 
-  UTIL_THROW_IF2(obj->GetMisc("NumScores") != m_numScoreComponents,
-                 "On-disk phrase table has " <<  obj->GetMisc("NumScores") << " scores."
+  UTIL_THROW_IF2(wrapper.GetMisc("NumScores") != m_numScoreComponents,
+                 "On-disk phrase table has " <<  wrapper.GetMisc("NumScores") << " scores."
                  << ". The ini file specified " << m_numScoreComponents << " scores");
-
-  m_implementation.reset(obj);
 }
 
 void PhraseDictionaryOnDisk::GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const
@@ -34,6 +34,7 @@
 #else
 #include <boost/scoped_ptr.hpp>
 #endif
+#include <boost/shared_ptr.hpp>
 
 namespace Moses
 {
@@ -56,11 +57,14 @@ protected:
 #else
   boost::scoped_ptr<OnDiskPt::OnDiskWrapper> m_implementation;
 #endif
+  // tables in the mapped format are loaded once and read by all threads
+  boost::shared_ptr<OnDiskPt::OnDiskWrapper> m_sharedImplementation;
 
   size_t m_maxSpanDefault, m_maxSpanLabelled;
 
   OnDiskPt::OnDiskWrapper &GetImplementation();
   const OnDiskPt::OnDiskWrapper &GetImplementation() const;
+  void CheckCompatibility(const OnDiskPt::OnDiskWrapper &wrapper) const;
 
   void GetTargetPhraseCollectionBatch(InputPath &inputPath) const;
 
@@ -76,6 +80,11 @@ public:
     std::size_t);
 
   virtual void InitializeForInput(ttasksptr const& ttask);
+
+  // unless the table is mapped, each thread opens it in InitializeForInput()
+  bool IsUsableInSubTasks() const {
+    return m_sharedImplementation.get() != NULL;
+  }
   void GetTargetPhraseCollectionBatch(const InputPathList &inputPathQueue) const;
 
   TargetPhraseCollection::shared_ptr
@@ -17,6 +17,7 @@
  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 
+#include <algorithm>
 #include <vector>
 #include "moses/InputFileStream.h"
 #include "moses/Util.h"
@@ -51,4 +52,13 @@ void RuleTableTrie::Load(AllOptions::ptr const& opts)
   }
 }
 
+void RuleTableTrie::SetParameter(const std::string& key, const std::string& value)
+{
+  if (key == "load-threads") {
+    m_loadThreads = std::max<size_t>(Scan<size_t>(value), 1);
+  } else {
+    PhraseDictionary::SetParameter(key, value);
+  }
+}
+
 }  // namespace Moses
@@ -41,13 +41,21 @@ class RuleTableTrie : public PhraseDictionary
 {
 public:
   RuleTableTrie(const std::string &line)
-    : PhraseDictionary(line, true) {
+    : PhraseDictionary(line, true)
+    , m_loadThreads(1) {
   }
 
   virtual ~RuleTableTrie();
 
   void Load(AllOptions::ptr const& opts);
 
+  void SetParameter(const std::string& key, const std::string& value);
+
+  //! Number of threads that parse a text rule table while it is loaded
+  size_t GetLoadThreads() const {
+    return m_loadThreads;
+  }
+
 private:
   friend class RuleTableLoader;
 
@@ -58,6 +66,7 @@ private:
 
   virtual void SortAndPrune() = 0;
 
+  size_t m_loadThreads;
 };
 
 }  // namespace Moses
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include "EditDistance.h"
+
+using namespace std;
+
+namespace tmmt
+{
+
+namespace
+{
+
+/* One 64 row block of a column of the edit distance matrix, advanced by
+ one text symbol (Myers 1999, Fig. 9). Pv and Mv are the positive and
+ negative vertical deltas of the block, eq the rows that match the symbol,
+ hin the horizontal delta coming in at the top, and high the bit of the last
+ row. Returns the horizontal delta going out at the last row. */
+inline int advance_block(uint64_t &Pv, uint64_t &Mv, uint64_t eq, int hin, uint64_t high)
+{
+  uint64_t Xv = eq | Mv;
+  if (hin < 0)
+    eq |= 1;
+  uint64_t Xh = (((eq & Pv) + Pv) ^ Pv) | eq;
+  uint64_t Ph = Mv | ~(Xh | Pv);
+  uint64_t Mh = Pv & Xh;
+
+  int hout = 0;
+  if (Ph & high)
+    hout = 1;
+  else if (Mh & high)
+    hout = -1;
+
+  Ph <<= 1;
+  Mh <<= 1;
+  if (hin < 0)
+    Mh |= 1;
+  else if (hin > 0)
+    Ph |= 1;
+  Pv = Mh | ~(Xv | Ph);
+  Mv = Ph & Xv;
+  return hout;
+}
+
+}
+
+WordEditDistance::WordEditDistance(const vector< WORD_ID > &input)
+  :m_length(input.size())
+  ,m_blocks((input.size() + 63) / 64)
+{
+  for (size_t i = 0; i < input.size(); ++i) {
+    boost::unordered_map< WORD_ID, size_t >::iterator iter = m_index.find(input[i]);
+    if (iter == m_index.end()) {
+      iter = m_index.insert(make_pair(input[i], m_counts.size())).first;
+      m_counts.push_back(0);
+      m_masks.resize(m_masks.size() + m_blocks, 0);
+    }
+    m_masks[iter->second * m_blocks + i / 64] |= uint64_t(1) << (i % 64);
+    ++m_counts[iter->second];
+  }
+}
+
+unsigned int WordEditDistance::Distance(const vector< WORD_ID > &tm) const
+{
+  if (m_length == 0)
+    return tm.size();
+
+  const uint64_t high = uint64_t(1) << ((m_length - 1) % 64);
+  vector< uint64_t > Pv(m_blocks, ~uint64_t(0)), Mv(m_blocks, 0);
+  unsigned int score = m_length;
+
+  for (size_t j = 0; j < tm.size(); ++j) {
+    boost::unordered_map< WORD_ID, size_t >::const_iterator iter = m_index.find(tm[j]);
+    const uint64_t *eq = (iter == m_index.end()) ? NULL : &m_masks[iter->second * m_blocks];
+
+    // the first row of the matrix grows by 1 per word
+    int h = 1;
+    for (size_t b = 0; b < m_blocks; ++b) {
+      h = advance_block(Pv[b], Mv[b], eq ? eq[b] : 0, h,
+                        b + 1 == m_blocks ? high : uint64_t(1) << 63);
+    }
+    score += h;
+  }
+  return score;
+}
+
+unsigned int WordEditDistance::LowerBound(const vector< WORD_ID > &tm) const
+{
+  vector< unsigned int > used(m_counts.size(), 0);
+  size_t common = 0;
+  for (size_t j = 0; j < tm.size(); ++j) {
+    boost::unordered_map< WORD_ID, size_t >::const_iterator iter = m_index.find(tm[j]);
+    if (iter != m_index.end() && used[iter->second] < m_counts[iter->second]) {
+      ++used[iter->second];
+      ++common;
+    }
+  }
+  return max(m_length, tm.size()) - common;
+}
+
+unsigned int letter_edit_distance(const string &a, const string &b)
+{
+  if (a.empty())
+    return b.size();
+
+  if (a.size() <= 64) {
+    uint64_t peq[256] = { 0 };
+    for (size_t i = 0; i < a.size(); ++i) {
+      peq[(unsigned char) a[i]] |= uint64_t(1) << i;
+    }
+
+    const uint64_t high = uint64_t(1) << (a.size() - 1);
+    uint64_t Pv = ~uint64_t(0), Mv = 0;
+    unsigned int score = a.size();
+    for (size_t j = 0; j < b.size(); ++j) {
+      score += advance_block(Pv, Mv, peq[(unsigned char) b[j]], 1, high);
+    }
+    return score;
+  }
+
+  // longer words, with one row of the matrix
+  vector< unsigned int > row(b.size() + 1);
+  for (size_t j = 0; j <= b.size(); ++j) {
+    row[j] = j;
+  }
+  for (size_t i = 1; i <= a.size(); ++i) {
+    unsigned int diag = row[0];
+    row[0] = i;
+    for (size_t j = 1; j <= b.size(); ++j) {
+      unsigned int cost = min(row[j], row[j - 1]) + 1;
+      cost = min(cost, diag + (a[i - 1] == b[j - 1] ? 0 : 1));
+      diag = row[j];
+      row[j] = cost;
+    }
+  }
+  return row[b.size()];
+}
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+#include <stdint.h>
+
+#include "Vocabulary.h"
+
+namespace tmmt
+{
+
+/** Word edit distance of TM sentences to one input sentence (insertions,
+ * deletions and substitutions all cost 1), with Myers' bit-parallel
+ * algorithm in the block form of Hyyrö: a TM sentence of n words takes
+ * n * ceil(m/64) steps of a few word operations for an input of m words.
+ * The bit masks of the input are built once, in the constructor.
+ */
+class WordEditDistance
+{
+public:
+  explicit WordEditDistance(const std::vector< WORD_ID > &input);
+
+  unsigned int Distance(const std::vector< WORD_ID > &tm) const;
+
+  /** lower bound of Distance(): the words of the longer sentence that the
+   * shorter one lacks, counting repeated words (the bag distance) */
+  unsigned int LowerBound(const std::vector< WORD_ID > &tm) const;
+
+private:
+  size_t m_length;
+  size_t m_blocks;
+  //! input word -> its index into m_masks and m_counts
+  boost::unordered_map< WORD_ID, size_t > m_index;
+  //! for each input word, m_blocks masks of its positions in the input
+  std::vector< uint64_t > m_masks;
+  //! for each input word, how often it is in the input
+  std::vector< unsigned int > m_counts;
+};
+
+/** letter edit distance of two words, e.g. 'their' to 'there' is 2; bit
+ * parallel if the first word has at most 64 bytes */
+unsigned int letter_edit_distance(const std::string &a, const std::string &b);
+
+}
@@ -0,0 +1,144 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2015- University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "moses/TranslationModel/fuzzy-match/EditDistance.h"
+#include "util/random.hh"
+
+using namespace tmmt;
+using namespace std;
+
+namespace
+{
+
+template <class Sequence>
+unsigned int DynamicProgramming(const Sequence &a, const Sequence &b)
+{
+  vector< vector< unsigned int > > cost(a.size() + 1, vector< unsigned int >(b.size() + 1));
+  for (size_t i = 0; i <= a.size(); ++i) cost[i][0] = i;
+  for (size_t j = 0; j <= b.size(); ++j) cost[0][j] = j;
+  for (size_t i = 1; i <= a.size(); ++i) {
+    for (size_t j = 1; j <= b.size(); ++j) {
+      cost[i][j] = min(min(cost[i-1][j], cost[i][j-1]) + 1,
+                       cost[i-1][j-1] + (a[i-1] == b[j-1] ? 0 : 1));
+    }
+  }
+  return cost[a.size()][b.size()];
+}
+
+vector< WORD_ID > RandomSentence(size_t length, WORD_ID vocabulary)
+{
+  vector< WORD_ID > sentence;
+  for (size_t i = 0; i < length; ++i) {
+    sentence.push_back(util::rand_excl(vocabulary));
+  }
+  return sentence;
+}
+
+//! a few words of sentence replaced, dropped or added
+vector< WORD_ID > Edit(vector< WORD_ID > sentence, size_t edits, WORD_ID vocabulary)
+{
+  for (size_t i = 0; i < edits; ++i) {
+    size_t pos = util::rand_excl(sentence.size() + 1);
+    switch (util::rand_excl(3)) {
+    case 0:
+      if (pos < sentence.size()) sentence[pos] = util::rand_excl(vocabulary);
+      break;
+    case 1:
+      if (pos < sentence.size()) sentence.erase(sentence.begin() + pos);
+      break;
+    default:
+      sentence.insert(sentence.begin() + pos, util::rand_excl(vocabulary));
+    }
+  }
+  return sentence;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(fuzzy_match)
+
+BOOST_AUTO_TEST_CASE(word_edit_distance)
+{
+  util::rand_init(42);
+  // lengths across the 64 word blocks
+  const size_t lengths[] = { 0, 1, 5, 20, 63, 64, 65, 130 };
+  for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l) {
+    for (size_t k = 0; k < 20; ++k) {
+      vector< WORD_ID > input = RandomSentence(lengths[l], 10);
+      WordEditDistance distance(input);
+
+      vector< WORD_ID > tm = (k % 2) ? Edit(input, k, 10) : RandomSentence(util::rand_excl(lengths[l] + 10), 10);
+      unsigned int expected = DynamicProgramming(input, tm);
+      BOOST_CHECK_EQUAL(expected, distance.Distance(tm));
+      BOOST_CHECK(distance.LowerBound(tm) <= expected);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(word_edit_distance_bound)
+{
+  vector< WORD_ID > input, tm;
+  // a b a c
+  input.push_back(0);
+  input.push_back(1);
+  input.push_back(0);
+  input.push_back(2);
+  // b a a a d
+  tm.push_back(1);
+  tm.push_back(0);
+  tm.push_back(0);
+  tm.push_back(0);
+  tm.push_back(3);
+  WordEditDistance distance(input);
+  // a, a and b are shared, the third a and d are not
+  BOOST_CHECK_EQUAL(2, distance.LowerBound(tm));
+  BOOST_CHECK_EQUAL(DynamicProgramming(input, tm), distance.Distance(tm));
+  BOOST_CHECK_EQUAL(4, distance.Distance(vector< WORD_ID >()));
+}
+
+BOOST_AUTO_TEST_CASE(letter_distance)
+{
+  BOOST_CHECK_EQUAL(2, letter_edit_distance("their", "there"));
+  BOOST_CHECK_EQUAL(0, letter_edit_distance("same", "same"));
+  BOOST_CHECK_EQUAL(3, letter_edit_distance("", "abc"));
+  BOOST_CHECK_EQUAL(3, letter_edit_distance("abc", ""));
+
+  util::rand_init(7);
+  const size_t lengths[] = { 1, 8, 64, 65, 100 };
+  for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l) {
+    for (size_t k = 0; k < 20; ++k) {
+      string a, b;
+      for (size_t i = 0; i < lengths[l]; ++i) a += char('a' + util::rand_excl(4));
+      size_t lengthB = util::rand_excl(lengths[l] + 5);
+      for (size_t i = 0; i < lengthB; ++i) b += char('a' + util::rand_excl(4));
+      BOOST_CHECK_EQUAL(DynamicProgramming(a, b), letter_edit_distance(a, b));
+      // bytes above 127 too
+      a[0] = char(200);
+      BOOST_CHECK_EQUAL(DynamicProgramming(a, b), letter_edit_distance(a, b));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -7,10 +7,14 @@
 //
 
 #include <iostream>
+#include <boost/bind.hpp>
+#include <boost/functional/hash.hpp>
 #include "FuzzyMatchWrapper.h"
+#include "EditDistance.h"
 #include "SentenceAlignment.h"
 #include "Match.h"
 #include "create_xml.h"
+#include "moses/ThreadPool.h"
 #include "moses/Util.h"
 #include "moses/StaticData.h"
 #include "util/file.hh"
@@ -30,6 +34,7 @@ FuzzyMatchWrapper::FuzzyMatchWrapper(const std::string &sourcePath, const std::s
   ,multiple_flag(true)
   ,multiple_slack(0)
   ,multiple_max(100)
+  ,m_matchThreads(1)
 {
   cerr << "creating suffix array" << endl;
   suffixArray = new tmmt::SuffixArray( sourcePath );
@@ -86,10 +91,75 @@ string FuzzyMatchWrapper::Extract(long translationId, const string &dirNameStr)
   return fuzzyMatchFile + ".pt.gz";
 }
 
-string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, const string &dirNameStr)
+void FuzzyMatchWrapper::ExtractRules(long translationId, const string &input, vector<ExtractedRule> &rules)
 {
-  const std::vector< std::vector< WORD_ID > > &source = suffixArray->GetCorpus();
+  WordIndex wordIndex;
+
+  vector< WORD_ID > inputIds = GetVocabulary().Tokenize( input.c_str() );
+  vector< TMMatch > matches;
+  MatchTM(wordIndex, translationId, inputIds, matches);
+
+  string inputStr;
+  for (size_t pos = 0; pos < inputIds.size(); ++pos) {
+    inputStr += GetVocabulary().GetWord(inputIds[pos]) + " ";
+  }
+
+  // count the rules like score and consolidate do with the extract files:
+  // rules are the same if their source, target and non-terminal alignment
+  // are, and the most frequent word alignment of a rule is kept
+  typedef map< vector< string >, map< string, float > > RuleCounts;
+  RuleCounts ruleCounts;
+  map< string, float > sourceCounts, targetCounts;
+
+  for (size_t i = 0; i < matches.size(); ++i) {
+    const TMMatch &match = matches[i];
+    CreateXMLRetValues ret = createXML(i + 1, match.source, inputStr, match.target,
+                                       match.alignment, match.path + "X");
+
+    vector< string > key(3);
+    key[0] = ret.ruleS + " [X]";
+    key[1] = ret.ruleT + " [X]";
+
+    vector< string > sourceToks = Moses::Tokenize(ret.ruleS);
+    vector< string > alignToks = Moses::Tokenize(ret.ruleAlignment);
+    for (size_t j = 0; j < alignToks.size(); ++j) {
+      size_t sourcePos = Moses::Scan<size_t>(alignToks[j].substr(0, alignToks[j].find('-')));
+      if (sourcePos < sourceToks.size() && sourceToks[sourcePos] == "[X][X]") {
+        key[2] += alignToks[j] + " ";
+      }
+    }
+
+    float count = match.count;
+    ruleCounts[key][ret.ruleAlignment] += count;
+    sourceCounts[key[0]] += count;
+    targetCounts[key[1]] += count;
+  }
+
+  for (RuleCounts::const_iterator iter = ruleCounts.begin(); iter != ruleCounts.end(); ++iter) {
+    const vector< string > &key = iter->first;
+    const map< string, float > &alignments = iter->second;
+
+    float count = 0;
+    map< string, float >::const_iterator bestAlignment = alignments.begin();
+    for (map< string, float >::const_iterator align = alignments.begin(); align != alignments.end(); ++align) {
+      count += align->second;
+      if (align->second > bestAlignment->second) {
+        bestAlignment = align;
+      }
+    }
+
+    rules.push_back(ExtractedRule());
+    ExtractedRule &rule = rules.back();
+    rule.source = key[0];
+    rule.target = key[1];
+    rule.alignment = bestAlignment->first;
+    rule.scores.push_back(count / targetCounts[key[1]]);
+    rule.scores.push_back(count / sourceCounts[key[0]]);
+  }
+}
 
+string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, const string &dirNameStr)
+{
   string inputPath = dirNameStr + "/in";
   string fuzzyMatchFile = dirNameStr + "/fuzzyMatchFile";
   ofstream fuzzyMatchStream(fuzzyMatchFile.c_str());
@@ -100,13 +170,43 @@ string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, co
   assert(input.size() == 1);
   size_t sentenceInd = 0;
 
+  vector< TMMatch > matches;
+  MatchTM(wordIndex, translationId, input[sentenceInd], matches);
+
+  string inputStr;
+  for (size_t pos = 0; pos < input[sentenceInd].size(); ++pos) {
+    inputStr += GetVocabulary().GetWord(input[sentenceInd][pos]) + " ";
+  }
+
+  for (size_t i = 0; i < matches.size(); ++i) {
+    const TMMatch &match = matches[i];
+    fuzzyMatchStream
+        << sentenceInd << endl
+        << match.cost << endl
+        << match.source << endl
+        << inputStr << endl
+        << match.target << endl
+        << match.alignment << endl
+        << match.path << endl
+        << match.count << endl;
+  }
+
+  fuzzyMatchStream.close();
+
+  return fuzzyMatchFile;
+}
+
+void FuzzyMatchWrapper::MatchTM(WordIndex &wordIndex, long translationId, const vector< WORD_ID > &input, vector< TMMatch > &matches)
+{
+  const std::vector< std::vector< WORD_ID > > &source = suffixArray->GetCorpus();
+
   clock_t start_clock = clock();
   // if (i % 10 == 0) cerr << ".";
 
   // establish some basic statistics
 
   // int input_length = compute_length( input[i] );
-  int input_length = input[sentenceInd].size();
+  int input_length = input.size();
   int best_cost = input_length * (100-min_match) / 100 + 1;
 
   int match_count = 0; // how many substring matches to be considered
@@ -114,15 +214,15 @@ string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, co
 
   // find match ranges in suffix array
   vector< vector< pair< SuffixArray::INDEX, SuffixArray::INDEX > > > match_range;
-  for(int start=0; start<input[sentenceInd].size(); start++) {
+  for(int start=0; start<input.size(); start++) {
     SuffixArray::INDEX prior_first_match = 0;
     SuffixArray::INDEX prior_last_match = suffixArray->GetSize()-1;
     vector< string > substring;
     bool stillMatched = true;
     vector< pair< SuffixArray::INDEX, SuffixArray::INDEX > > matchedAtThisStart;
     //cerr << "start: " << start;
-    for(size_t word=start; stillMatched && word<input[sentenceInd].size(); word++) {
-      substring.push_back( GetVocabulary().GetWord( input[sentenceInd][word] ) );
+    for(size_t word=start; stillMatched && word<input.size(); word++) {
+      substring.push_back( GetVocabulary().GetWord( input[word] ) );
 
       // only look up, if needed (i.e. no unnecessary short gram lookups)
       //				if (! word-start+1 <= short_match_max_length( input_length ) )
@@ -149,14 +249,14 @@ string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, co
   map< int, int > sentence_match_word_count;
 
   // go through all matches, longest first
-  for(int length = input[sentenceInd].size(); length >= 1; length--) {
+  for(int length = input.size(); length >= 1; length--) {
     // do not create matches, if these are handled by the short match function
     if (length <= short_match_max_length( input_length ) ) {
       continue;
     }
 
     unsigned int count = 0;
-    for(int start = 0; start <= input[sentenceInd].size() - length; start++) {
+    for(int start = 0; start <= input.size() - length; start++) {
       if (match_range[start].size() >= length) {
         pair< SuffixArray::INDEX, SuffixArray::INDEX > &range = match_range[start][length-1];
         // cerr << " (" << range.first << "," << range.second << ")";
@@ -244,67 +344,71 @@ string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, co
   int tm_count_word_match2 = 0;
   int pruned_match_count = 0;
   if (short_match_max_length( input_length )) {
-    init_short_matches(wordIndex, translationId, input[sentenceInd] );
+    init_short_matches(wordIndex, translationId, input );
   }
   vector< int > best_tm;
-  typedef map< int, vector< Match > >::iterator I;
+  typedef map< int, vector< Match > >::const_iterator I;
 
   clock_t clock_validation_sum = 0;
 
-  for(I tm=sentence_match.begin(); tm!=sentence_match.end(); tm++) {
-    int tmID = tm->first;
-    int tm_length = suffixArray->GetSentenceLength(tmID);
-    vector< Match > &match = tm->second;
-    add_short_matches(wordIndex, translationId, match, source[tmID], input_length, best_cost );
-
-    //cerr << "match in sentence " << tmID << ": " << match.size() << " [" << tm_length << "]" << endl;
-
-    // quick look: how many words are matched
-    int words_matched = 0;
-    for(size_t m=0; m<match.size(); m++) {
-
-      if (match[m].min_cost <= best_cost) // makes no difference
-        words_matched += match[m].input_end - match[m].input_start + 1;
+  // the candidates are scored one at a time, against the best cost so far,
+  // or with more than one thread in chunks against the best cost at the
+  // start of the chunk. Candidates that passed the filters are scored again
+  // if an earlier candidate lowered the best cost, so the result is the same.
+  WordEditDistance distance( input );
+  CandidateBatch batch;
+  batch.wordIndex = &wordIndex;
+  batch.translationId = translationId;
+  batch.distance = &distance;
+  batch.input = &input;
+  batch.step = m_matchThreads;
+  const size_t chunk_size = (m_matchThreads > 1) ? m_matchThreads * 16 : 1;
+
+  I tm = sentence_match.begin();
+  while (tm != sentence_match.end()) {
+    batch.candidates.clear();
+    for(; tm!=sentence_match.end() && batch.candidates.size() < chunk_size; tm++) {
+      batch.candidates.push_back( make_pair( tm->first, &tm->second ) );
     }
-    if (max(input_length,tm_length) - words_matched > best_cost) {
-      if (length_filter_flag) continue;
-    }
-    tm_count_word_match++;
+    batch.best_cost = best_cost;
+    batch.scores.resize( batch.candidates.size() );
 
-    // prune, check again how many words are matched
-    vector< Match > pruned = prune_matches( match, best_cost );
-    words_matched = 0;
-    for(size_t p=0; p<pruned.size(); p++) {
-      words_matched += pruned[p].input_end - pruned[p].input_start + 1;
-    }
-    if (max(input_length,tm_length) - words_matched > best_cost) {
-      if (length_filter_flag) continue;
+    size_t num_tasks = min( m_matchThreads, batch.candidates.size() );
+    if (num_tasks == 1) {
+      ScoreBatch( batch, 0 );
+    } else {
+      vector< boost::shared_ptr< Moses::Task > > tasks;
+      for (size_t offset = 0; offset < num_tasks; ++offset) {
+        boost::function<void()> f = boost::bind( &FuzzyMatchWrapper::ScoreBatch, this, boost::ref( batch ), offset );
+        tasks.push_back( boost::shared_ptr< Moses::Task >( new Moses::FunctionTask( f ) ) );
+      }
+      Moses::RunSubTasks( tasks );
     }
-    tm_count_word_match2++;
-
-    pruned_match_count += pruned.size();
-    int prior_best_cost = best_cost;
-    int cost;
 
-    clock_t clock_validation_start = clock();
-    if (! parse_flag ||
-        pruned.size()>=10) { // to prevent worst cases
-      string path;
-      cost = sed( input[sentenceInd], source[tmID], path, false );
-      if (cost <  best_cost) {
-        best_cost = cost;
+    for(size_t c=0; c<batch.candidates.size(); c++) {
+      int tmID = batch.candidates[c].first;
+      CandidateScore score = batch.scores[c];
+      if (score.filters > 0 && score.prior_best_cost != best_cost) {
+        score = ScoreCandidate( wordIndex, translationId, distance, input, tmID, *batch.candidates[c].second, best_cost );
       }
-    }
 
-    else {
-      cost = parse_matches( pruned, input_length, tm_length, best_cost );
-      if (prior_best_cost != best_cost) {
-        best_tm.clear();
+      if (score.filters < 1) continue;
+      tm_count_word_match++;
+      if (score.filters < 2) continue;
+      tm_count_word_match2++;
+
+      pruned_match_count += score.pruned;
+      clock_validation_sum += score.clock;
+      if (score.best_cost < best_cost) {
+        // only a lower cost from parsing drops the earlier best matches
+        if (score.parsed) {
+          best_tm.clear();
+        }
+        best_cost = score.best_cost;
+      }
+      if (score.cost == best_cost) {
+        best_tm.push_back( tmID );
       }
-    }
-    clock_validation_sum += clock() - clock_validation_start;
-    if (cost == best_cost) {
-      best_tm.push_back( tmID );
     }
   }
   cerr << "reduced best cost from " << old_best_cost << " to " << best_cost << endl;
@@ -315,21 +419,16 @@ string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, co
 
   cerr << "pruned matches: " << ((float)pruned_match_count/(float)tm_count_word_match2) << endl;
 
-  // create xml and extract files
-  string inputStr, sourceStr;
-  for (size_t pos = 0; pos < input_length; ++pos) {
-    inputStr += GetVocabulary().GetWord(input[sentenceInd][pos]) + " ";
-  }
-
+  // collect what goes into the extract files
   // do not try to find the best ... report multiple matches
   if (multiple_flag) {
     for(size_t si=0; si<best_tm.size(); si++) {
       int s = best_tm[si];
       string path;
-      sed( input[sentenceInd], source[s], path, true );
+      sed( input, source[s], path, true );
       const vector<WORD_ID> &sourceSentence = source[s];
       vector<SentenceAlignment> &targets = targetAndAlignment[s];
-      create_extract(sentenceInd, best_cost, sourceSentence, targets, inputStr, path, fuzzyMatchStream);
+      create_extract(best_cost, sourceSentence, targets, path, matches);
 
     }
   } // if (multiple_flag)
@@ -340,11 +439,16 @@ string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, co
     int best_match = -1;
     unsigned int best_letter_cost;
     if (lsed_flag) {
-      best_letter_cost = compute_length( input[sentenceInd] ) * min_match / 100 + 1;
+      unsigned int input_letters = compute_length( input );
+      best_letter_cost = input_letters * min_match / 100 + 1;
       for(size_t si=0; si<best_tm.size(); si++) {
         int s = best_tm[si];
+        // letters that one sentence has more than the other are not matched
+        unsigned int source_letters = compute_length( source[s] );
+        if (max( input_letters, source_letters ) - min( input_letters, source_letters ) >= best_letter_cost)
+          continue;
         string path;
-        unsigned int letter_cost = sed( input[sentenceInd], source[s], path, true );
+        unsigned int letter_cost = sed( input, source[s], path, true );
         if (letter_cost < best_letter_cost) {
           best_letter_cost = letter_cost;
           best_path = path;
@@ -356,7 +460,7 @@ string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, co
     else {
       if (best_tm.size() > 0) {
         string path;
-        sed( input[sentenceInd], source[best_tm[0]], path, false );
+        sed( input, source[best_tm[0]], path, false );
         best_path = path;
         best_match = best_tm[0];
       }
@@ -368,7 +472,7 @@ string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, co
          << " (validation: " << (1000 * (clock_validation_sum) / CLOCKS_PER_SEC) << ")"
          << " )" << endl;
     if (lsed_flag) {
-      //cout << best_letter_cost << "/" << compute_length( input[sentenceInd] ) << " (";
+      //cout << best_letter_cost << "/" << compute_length( input ) << " (";
     }
     //cout << best_cost <<"/" << input_length;
     if (lsed_flag) {
@@ -384,13 +488,9 @@ string FuzzyMatchWrapper::ExtractTM(WordIndex &wordIndex, long translationId, co
     // creat xml & extracts
     const vector<WORD_ID> &sourceSentence = source[best_match];
     vector<SentenceAlignment> &targets = targetAndAlignment[best_match];
-    create_extract(sentenceInd, best_cost, sourceSentence, targets, inputStr, best_path, fuzzyMatchStream);
+    create_extract(best_cost, sourceSentence, targets, best_path, matches);
 
   } // else if (multiple_flag)
-
-  fuzzyMatchStream.close();
-
-  return fuzzyMatchFile;
 }
 
 void FuzzyMatchWrapper::load_corpus( const std::string &fileName, vector< vector< WORD_ID > > &corpus )
@@ -511,13 +611,19 @@ void FuzzyMatchWrapper::load_alignment(const std::string &fileName, vector< vect
   }
 }
 
+FuzzyMatchWrapper::LSEDShard &FuzzyMatchWrapper::GetLSEDShard(const std::pair< WORD_ID, WORD_ID > &key) const
+{
+  return m_lsed[ boost::hash_value( key ) % LSED_SHARDS ];
+}
+
 bool FuzzyMatchWrapper::GetLSEDCache(const std::pair< WORD_ID, WORD_ID > &key, unsigned int &value) const
 {
+  LSEDShard &shard = GetLSEDShard( key );
 #ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_accessLock);
+  boost::mutex::scoped_lock lock(shard.mutex);
 #endif
-  map< pair< WORD_ID, WORD_ID >, unsigned int >::const_iterator lookup = m_lsed.find( key );
-  if (lookup != m_lsed.end()) {
+  boost::unordered_map< pair< WORD_ID, WORD_ID >, unsigned int >::const_iterator lookup = shard.cache.find( key );
+  if (lookup != shard.cache.end()) {
     value = lookup->second;
     return true;
   }
@@ -527,10 +633,11 @@ bool FuzzyMatchWrapper::GetLSEDCache(const std::pair< WORD_ID, WORD_ID > &key, u
 
 void FuzzyMatchWrapper::SetLSEDCache(const std::pair< WORD_ID, WORD_ID > &key, const unsigned int &value)
 {
+  LSEDShard &shard = GetLSEDShard( key );
 #ifdef WITH_THREADS
-  boost::unique_lock<boost::shared_mutex> lock(m_accessLock);
+  boost::mutex::scoped_lock lock(shard.mutex);
 #endif
-  m_lsed[ key ] = value;
+  shard.cache[ key ] = value;
 }
 
 /* Letter string edit distance, e.g. sub 'their' to 'there' costs 2 */
@@ -548,39 +655,7 @@ unsigned int FuzzyMatchWrapper::letter_sed( WORD_ID aIdx, WORD_ID bIdx )
   // get surface strings for word indices
   const string &a = GetVocabulary().GetWord( aIdx );
   const string &b = GetVocabulary().GetWord( bIdx );
-
-  // initialize cost matrix
-  unsigned int **cost  = (unsigned int**) calloc( sizeof( unsigned int*  ), a.size()+1 );
-  for( unsigned int i=0; i<=a.size(); i++ ) {
-    cost[i] = (unsigned int*) calloc( sizeof(unsigned int), b.size()+1 );
-    cost[i][0] = i;
-  }
-  for( unsigned int j=0; j<=b.size(); j++ ) {
-    cost[0][j] = j;
-  }
-
-  // core string edit distance loop
-  for( unsigned int i=1; i<=a.size(); i++ ) {
-    for( unsigned int j=1; j<=b.size(); j++ ) {
-
-      unsigned int ins = cost[i-1][j] + 1;
-      unsigned int del = cost[i][j-1] + 1;
-      bool match = (a.substr(i-1,1).compare( b.substr(j-1,1) ) == 0);
-      unsigned int diag = cost[i-1][j-1] + (match ? 0 : 1);
-
-      unsigned int min = (ins < del) ? ins : del;
-      min = (diag < min) ? diag : min;
-
-      cost[i][j] = min;
-    }
-  }
-
-  // clear out memory
-  unsigned int final = cost[a.size()][b.size()];
-  for( unsigned int i=0; i<=a.size(); i++ ) {
-    free( cost[i] );
-  }
-  free( cost );
+  unsigned int final = letter_edit_distance( a, b );
 
   // cache and return result
   SetLSEDCache(pIdx, final);
@@ -635,7 +710,7 @@ unsigned int FuzzyMatchWrapper::sed( const vector< WORD_ID > &a, const vector< W
       if (use_letter_sed) {
         ins += GetVocabulary().GetWord( a[i-1] ).size();
         del += GetVocabulary().GetWord( b[j-1] ).size();
-        match = letter_sed( a[i-1], b[j-1] );
+        match = ( a[i-1] == b[j-1] ) ? 0 : letter_sed( a[i-1], b[j-1] );
       } else {
         ins++;
         del++;
@@ -999,8 +1074,87 @@ int FuzzyMatchWrapper::parse_matches( vector< Match > &match, int input_length,
   return this_best_cost;
 }
 
+/* cost of a candidate TM sentence: its word edit distance to the input,
+ or the parse of its matches, if it passes the length filters */
 
-void FuzzyMatchWrapper::create_extract(int sentenceInd, int cost, const vector< WORD_ID > &sourceSentence, const vector<SentenceAlignment> &targets, const string &inputStr, const string  &path, ofstream &outputFile)
+FuzzyMatchWrapper::CandidateScore FuzzyMatchWrapper::ScoreCandidate(WordIndex &wordIndex, long translationId, const WordEditDistance &distance, const vector< WORD_ID > &input, int tmID, const vector< Match > &candidate, int best_cost )
+{
+  CandidateScore score;
+  score.prior_best_cost = best_cost;
+  score.best_cost = best_cost;
+  score.filters = 0;
+  score.pruned = 0;
+  score.cost = 0;
+  score.parsed = false;
+  score.clock = 0;
+
+  const vector< WORD_ID > &tm = suffixArray->GetCorpus()[ tmID ];
+  int input_length = input.size();
+  int tm_length = tm.size();
+
+  // words that one sentence has and the other has not are edits; neither
+  // the edit distance nor the parse of the matches can be cheaper
+  if ((int) distance.LowerBound( tm ) > best_cost) {
+    return score;
+  }
+
+  vector< Match > match = candidate;
+  add_short_matches(wordIndex, translationId, match, tm, input_length, best_cost );
+
+  //cerr << "match in sentence " << tmID << ": " << match.size() << " [" << tm_length << "]" << endl;
+
+  // quick look: how many words are matched
+  int words_matched = 0;
+  for(size_t m=0; m<match.size(); m++) {
+
+    if (match[m].min_cost <= best_cost) // makes no difference
+      words_matched += match[m].input_end - match[m].input_start + 1;
+  }
+  if (max(input_length,tm_length) - words_matched > best_cost) {
+    if (length_filter_flag) return score;
+  }
+  score.filters++;
+
+  // prune, check again how many words are matched
+  vector< Match > pruned = prune_matches( match, best_cost );
+  words_matched = 0;
+  for(size_t p=0; p<pruned.size(); p++) {
+    words_matched += pruned[p].input_end - pruned[p].input_start + 1;
+  }
+  if (max(input_length,tm_length) - words_matched > best_cost) {
+    if (length_filter_flag) return score;
+  }
+  score.filters++;
+  score.pruned = pruned.size();
+
+  clock_t clock_validation_start = clock();
+  if (! parse_flag ||
+      pruned.size()>=10) { // to prevent worst cases
+    score.cost = distance.Distance( tm );
+    if (score.cost < best_cost) {
+      score.best_cost = score.cost;
+    }
+  }
+
+  else {
+    score.cost = parse_matches( pruned, input_length, tm_length, score.best_cost );
+    score.parsed = true;
+  }
+  score.clock = clock() - clock_validation_start;
+  return score;
+}
+
+/* score every step-th candidate of a batch, from offset on */
+
+void FuzzyMatchWrapper::ScoreBatch(CandidateBatch &batch, size_t offset)
+{
+  for (size_t c = offset; c < batch.candidates.size(); c += batch.step) {
+    batch.scores[c] = ScoreCandidate( *batch.wordIndex, batch.translationId, *batch.distance, *batch.input,
+                                      batch.candidates[c].first, *batch.candidates[c].second, batch.best_cost );
+  }
+}
+
+void FuzzyMatchWrapper::create_extract(int cost, const vector< WORD_ID > &sourceSentence, const vector<SentenceAlignment> &targets, const string  &path, vector< TMMatch > &matches)
 {
   string sourceStr;
   for (size_t pos = 0; pos < sourceSentence.size(); ++pos) {
@@ -1010,19 +1164,15 @@ void FuzzyMatchWrapper::create_extract(int sentenceInd, int cost, const vector<
 
   for (size_t targetInd = 0; targetInd < targets.size(); ++targetInd) {
     const SentenceAlignment &sentenceAlignment = targets[targetInd];
-    string targetStr = sentenceAlignment.getTargetString(GetVocabulary());
-    string alignStr = sentenceAlignment.getAlignmentString();
-
-    outputFile
-        << sentenceInd << endl
-        << cost << endl
-        << sourceStr << endl
-        << inputStr << endl
-        << targetStr << endl
-        << alignStr << endl
-        << path << endl
-        << sentenceAlignment.count << endl;
 
+    TMMatch match;
+    match.cost = cost;
+    match.source = sourceStr;
+    match.target = sentenceAlignment.getTargetString(GetVocabulary());
+    match.alignment = sentenceAlignment.getAlignmentString();
+    match.path = path;
+    match.count = sentenceAlignment.count;
+    matches.push_back(match);
   }
 }
 
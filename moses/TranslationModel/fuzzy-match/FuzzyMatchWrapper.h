@@ -10,11 +10,13 @@
 #define moses_FuzzyMatchWrapper_h
 
 #ifdef WITH_THREADS
-#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/mutex.hpp>
 #endif
 
+#include <ctime>
 #include <fstream>
 #include <string>
+#include <boost/unordered_map.hpp>
 #include "SuffixArray.h"
 #include "Vocabulary.h"
 #include "Match.h"
@@ -24,6 +26,7 @@ namespace tmmt
 {
 class Match;
 struct SentenceAlignment;
+class WordEditDistance;
 
 class FuzzyMatchWrapper
 {
@@ -32,6 +35,24 @@ public:
 
   std::string Extract(long translationId, const std::string &dirNameStr);
 
+  /** a rule extracted from the fuzzy matches of an input sentence, scored
+   * like train-model.perl -score-options "--NoLex" does: p(f|e) p(e|f) */
+  struct ExtractedRule {
+    std::string source;
+    std::string target;
+    std::string alignment;
+    std::vector<float> scores;
+  };
+
+  //! the rules of Extract(), without temporary files or external programs
+  void ExtractRules(long translationId, const std::string &input, std::vector<ExtractedRule> &rules);
+
+  /** score the candidate TM sentences of an input in this many sub-tasks,
+   * which idle decoder threads can pick up (see Moses::RunSubTasks()) */
+  void SetMatchThreads(size_t threads) {
+    m_matchThreads = threads ? threads : 1;
+  }
+
 protected:
   // tm-mt
   std::vector< std::vector< tmmt::SentenceAlignment > > targetAndAlignment;
@@ -48,12 +69,50 @@ protected:
 
   typedef std::map< WORD_ID,std::vector< int > > WordIndex;
 
-  // global cache for word pairs
-  std::map< std::pair< WORD_ID, WORD_ID >, unsigned int > m_lsed;
+  //! a TM target of a best match, as written to the fuzzy match file
+  struct TMMatch {
+    int cost;
+    std::string source;
+    std::string target;
+    std::string alignment;
+    std::string path;
+    int count;
+  };
+
+  //! a candidate TM sentence, scored against the best cost so far
+  struct CandidateScore {
+    int prior_best_cost; // best cost it was scored against
+    int best_cost; // lowered, if the candidate is better
+    int filters; // how many of the two word match filters it passed
+    size_t pruned; // matches left after pruning
+    int cost;
+    bool parsed; // cost from parse_matches(), rather than the edit distance
+    clock_t clock; // time of the cost computation
+  };
+
+  //! candidates that are scored against the same best cost
+  struct CandidateBatch {
+    WordIndex *wordIndex;
+    long translationId;
+    const WordEditDistance *distance;
+    const std::vector< WORD_ID > *input;
+    std::vector< std::pair< int, const std::vector< Match > * > > candidates;
+    int best_cost;
+    size_t step;
+    std::vector< CandidateScore > scores;
+  };
+
+  size_t m_matchThreads;
+
+  // global cache for word pairs, in shards with a lock each
+  static const size_t LSED_SHARDS = 64;
+  struct LSEDShard {
+    boost::unordered_map< std::pair< WORD_ID, WORD_ID >, unsigned int > cache;
 #ifdef WITH_THREADS
-  //reader-writer lock
-  mutable boost::shared_mutex m_accessLock;
+    boost::mutex mutex;
 #endif
+  };
+  mutable LSEDShard m_lsed[LSED_SHARDS];
 
   void load_corpus( const std::string &fileName, std::vector< std::vector< tmmt::WORD_ID > > &corpus );
   void load_target( const std::string &fileName, std::vector< std::vector< tmmt::SentenceAlignment > > &corpus);
@@ -73,14 +132,18 @@ protected:
   void add_short_matches(WordIndex &wordIndex, long translationId, std::vector< Match > &match, const std::vector< WORD_ID > &tm, int input_length, int best_cost );
   std::vector< Match > prune_matches( const std::vector< Match > &match, int best_cost );
   int parse_matches( std::vector< Match > &match, int input_length, int tm_length, int &best_cost );
+  CandidateScore ScoreCandidate(WordIndex &wordIndex, long translationId, const WordEditDistance &distance, const std::vector< WORD_ID > &input, int tmID, const std::vector< Match > &candidate, int best_cost );
+  void ScoreBatch(CandidateBatch &batch, size_t offset);
 
-  void create_extract(int sentenceInd, int cost, const std::vector< WORD_ID > &sourceSentence, const std::vector<SentenceAlignment> &targets, const std::string &inputStr, const std::string  &path, std::ofstream &outputFile);
+  void create_extract(int cost, const std::vector< WORD_ID > &sourceSentence, const std::vector<SentenceAlignment> &targets, const std::string  &path, std::vector< TMMatch > &matches);
 
   std::string ExtractTM(WordIndex &wordIndex, long translationId, const std::string &inputPath);
+  void MatchTM(WordIndex &wordIndex, long translationId, const std::vector< WORD_ID > &input, std::vector< TMMatch > &matches);
   Vocabulary &GetVocabulary() {
     return suffixArray->GetVocabulary();
   }
 
+  LSEDShard &GetLSEDShard(const std::pair< WORD_ID, WORD_ID > &key) const;
   bool GetLSEDCache(const std::pair< WORD_ID, WORD_ID > &key, unsigned int &value) const;
   void SetLSEDCache(const std::pair< WORD_ID, WORD_ID > &key, const unsigned int &value);
 
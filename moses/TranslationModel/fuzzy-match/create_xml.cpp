@@ -6,6 +6,7 @@
 #include <string>
 #include "moses/Util.h"
 #include "Alignments.h"
+#include "create_xml.h"
 
 using namespace std;
 using namespace Moses;
@@ -17,14 +18,6 @@ inline const std::string TrimInternal(const std::string& str, const std::string
   return res.erase(0, res.find_first_not_of(dropChars));
 }
 
-class CreateXMLRetValues
-{
-public:
-  string frame, ruleS, ruleT, ruleAlignment, ruleAlignmentInv;
-};
-
-CreateXMLRetValues createXML(int ruleCount, const string &source, const string &input, const string &target, const string &align, const string &path );
-
 void create_xml(const string &inPath)
 {
   ifstream inStrme(inPath.c_str());
@@ -335,7 +328,7 @@ CreateXMLRetValues createXML(int ruleCount, const string &source, const string &
     const string &alignPoint = ruleAlignmentToks[i];
     vector<string> toks = Tokenize(alignPoint, "-");
     assert(toks.size() == 2);
-    ret.ruleAlignmentInv += toks[1] + "-" +toks[0];
+    ret.ruleAlignmentInv += toks[1] + "-" + toks[0] + " ";
   }
   ret.ruleAlignmentInv = TrimInternal(ret.ruleAlignmentInv);
 
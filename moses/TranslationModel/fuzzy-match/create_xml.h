@@ -2,4 +2,14 @@
 
 #include <string>
 
+class CreateXMLRetValues
+{
+public:
+  std::string frame, ruleS, ruleT, ruleAlignment, ruleAlignmentInv;
+};
+
 void create_xml(const std::string &inPath);
+
+/** the rule (and xml frame) for the input, from a TM sentence pair matched
+ * to it and the edit path between the TM source and the input */
+CreateXMLRetValues createXML(int ruleCount, const std::string &source, const std::string &input, const std::string &target, const std::string &align, const std::string &path );
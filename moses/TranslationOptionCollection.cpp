@@ -41,7 +41,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "TranslationTask.h"
 #include "util/exception.hh"
 
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
+#include <boost/function.hpp>
 using namespace std;
 
 namespace Moses
@@ -345,28 +347,31 @@ CreateTranslationOptions()
   // length of the sentence
   const size_t size = m_source.GetSize();
 
+  // long sentences: one sub-task per start position, which idle decoder
+  // threads can pick up. Each sub-task only writes to m_collection[sPos].
+  size_t const minLength = m_ttask.lock()->options()->search.subtask_min_length;
+  bool const useSubTasks = (minLength && size >= minLength
+                            && m_source.GetType() == SentenceInput);
+
   // loop over all decoding graphs, each generates translation options
   for (size_t gidx = 0 ; gidx < decodeGraphList.size() ; gidx++) {
     if (decodeGraphList.size() > 1)
       VERBOSE(3,"Creating translation options from decoding graph " << gidx << endl);
 
     const DecodeGraph& dg = *decodeGraphList[gidx];
-    size_t backoff = dg.GetBackoff();
-    // iterate over spans
-    for (size_t sPos = 0 ; sPos < size; sPos++) {
-      size_t maxSize = size - sPos; // don't go over end of sentence
-      // size_t maxSizePhrase = StaticData::Instance().GetMaxPhraseLength();
-      maxSize = std::min(maxSize, m_max_phrase_length);
-
-      for (size_t ePos = sPos ; ePos < sPos + maxSize ; ePos++) {
-        if (gidx && backoff &&
-            (ePos-sPos+1 <= backoff || // size exceeds backoff limit (HUH? UG) or ...
-             m_collection[sPos][ePos-sPos].size() > 0)) {
-          VERBOSE(3,"No backoff to graph " << gidx << " for span [" << sPos << ";" << ePos << "]" << endl);
-          continue;
-        }
-        CreateTranslationOptionsForRange(dg, sPos, ePos, true, gidx);
+    if (useSubTasks) {
+      vector<boost::shared_ptr<Task> > tasks;
+      for (size_t sPos = 0 ; sPos < size; sPos++) {
+        boost::function<void()> f
+        = boost::bind(&TranslationOptionCollection::CreateTranslationOptionsForStartPos,
+                      this, boost::cref(dg), sPos, gidx);
+        tasks.push_back(boost::shared_ptr<Task>(new FunctionTask(f)));
       }
+      RunSubTasks(tasks);
+    } else {
+      // iterate over spans
+      for (size_t sPos = 0 ; sPos < size; sPos++)
+        CreateTranslationOptionsForStartPos(dg, sPos, gidx);
     }
   }
   ProcessUnknownWord();
@@ -379,6 +384,28 @@ CreateTranslationOptions()
 }
 
 
+/** Create the translation options of all spans starting at sPos
+ * from one decoding graph.
+ */
+void
+TranslationOptionCollection::
+CreateTranslationOptionsForStartPos(const DecodeGraph& dg, size_t sPos, size_t gidx)
+{
+  size_t backoff = dg.GetBackoff();
+  size_t maxSize = m_source.GetSize() - sPos; // don't go over end of sentence
+  maxSize = std::min(maxSize, m_max_phrase_length);
+
+  for (size_t ePos = sPos ; ePos < sPos + maxSize ; ePos++) {
+    if (gidx && backoff &&
+        (ePos-sPos+1 <= backoff || // size exceeds backoff limit (HUH? UG) or ...
+         m_collection[sPos][ePos-sPos].size() > 0)) {
+      VERBOSE(3,"No backoff to graph " << gidx << " for span [" << sPos << ";" << ePos << "]" << endl);
+      continue;
+    }
+    CreateTranslationOptionsForRange(dg, sPos, ePos, true, gidx);
+  }
+}
+
 bool
 TranslationOptionCollection::
 CreateTranslationOptionsForRange
@@ -614,14 +641,22 @@ void
 TranslationOptionCollection::
 CacheLexReordering()
 {
+  // all options of the sentence, span by span, so that each table is
+  // looked up with one batch
   size_t const stop = m_source.GetSize();
+  std::vector<TranslationOption*> tos;
   typedef StatefulFeatureFunction sfFF;
   BOOST_FOREACH(sfFF const* ff, sfFF::GetStatefulFeatureFunctions()) {
     if (typeid(*ff) != typeid(LexicalReordering)) continue;
     LexicalReordering const& lr = static_cast<const LexicalReordering&>(*ff);
-    for (size_t s = 0 ; s < stop ; s++)
-      BOOST_FOREACH(TranslationOptionList& tol, m_collection[s])
-      lr.SetCache(tol);
+    if (tos.empty()) {
+      for (size_t s = 0 ; s < stop ; s++) {
+        BOOST_FOREACH(TranslationOptionList& tol, m_collection[s]) {
+          tos.insert(tos.end(), tol.begin(), tol.end());
+        }
+      }
+    }
+    lr.SetCache(tos);
   }
 }
 
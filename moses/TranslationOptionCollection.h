@@ -115,6 +115,9 @@ protected:
 
   void GetTargetPhraseCollectionBatch();
 
+  void CreateTranslationOptionsForStartPos(const DecodeGraph &decodeGraph,
+      size_t startPos, size_t graphInd);
+
   bool CreateTranslationOptionsForRange(
     const DecodeGraph &decodeGraph
     , size_t startPos
@@ -9,6 +9,7 @@
 #include "moses/InputType.h"
 #include "moses/OutputCollector.h"
 #include "moses/Incremental.h"
+#include "moses/SentenceArena.h"
 #include "mbr.h"
 
 #include "moses/Syntax/F2S/RuleMatcherCallback.h"
@@ -132,6 +133,13 @@ TranslationTask
   return manager;
 }
 
+size_t
+TranslationTask::
+GetCost() const
+{
+  return m_source ? m_source->GetSize() : 0;
+}
+
 AllOptions::ptr const&
 TranslationTask::
 options() const
@@ -185,6 +193,10 @@ void TranslationTask::Run()
   Timer initTime;
   initTime.start();
 
+  // search-time objects are carved from this arena and released in one go
+  // when Run() returns; must outlive the manager declared below
+  SentenceArena::Scope arena(m_options->search.sentence_arena);
+
   boost::shared_ptr<BaseManager> manager = SetupManager(m_options->search.algo);
 
   VERBOSE(1, "Line " << translationId << ": Initialize search took "
@@ -248,6 +260,11 @@ void TranslationTask::Run()
 
   // report additional statistics
   manager->CalcDecoderStatistics();
+  if (arena.Get()) {
+    VERBOSE(2, "Line " << translationId << ": Sentence arena: "
+            << arena.Get()->GetNumAllocations() << " allocations, "
+            << arena.Get()->GetBytesReserved() << " bytes reserved" << endl);
+  }
   VERBOSE(1, "Line " << translationId << ": Additional reporting took "
           << additionalReportingTime << " seconds total" << endl);
   VERBOSE(1, "Line " << translationId << ": Translation took "
@@ -104,6 +104,9 @@ public:
    * gets called by main function implemented at end of this source file */
   virtual void Run();
 
+  /** input length, so that long sentences can be started first */
+  virtual size_t GetCost() const;
+
   boost::shared_ptr<Moses::InputType>
   GetSource() const {
     return m_source;
@@ -153,6 +153,12 @@ enum SearchAlgorithm {
   DefaultSearchAlgorithm = 777 // means: use StaticData.m_searchAlgorithm
 };
 
+//! how HypothesisStackNormal chooses stack size and beam
+enum StackPruning {
+  StaticStackPruning = 0,  // fixed stack size and beam threshold
+  AdaptiveStackPruning = 1 // scaled by how flat the scores in a stack are
+};
+
 enum SourceLabelOverlap {
   SourceLabelOverlapAdd = 0,
   SourceLabelOverlapReplace = 1,
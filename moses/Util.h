@@ -144,6 +144,18 @@ inline SearchAlgorithm Scan<SearchAlgorithm>(const std::string &input)
   return (SearchAlgorithm) Scan<size_t>(input);
 }
 
+template<>
+inline StackPruning Scan<StackPruning>(const std::string &input)
+{
+  StackPruning ret;
+  if (input == "static" || input == "0") ret = StaticStackPruning;
+  else if (input == "adaptive" || input == "1") ret = AdaptiveStackPruning;
+  else {
+    UTIL_THROW2("Unknown stack pruning policy " << input);
+  }
+  return ret;
+}
+
 template<>
 inline S2TParsingAlgorithm Scan<S2TParsingAlgorithm>(const std::string &input)
 {
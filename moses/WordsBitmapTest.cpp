@@ -147,6 +147,63 @@ BOOST_AUTO_TEST_CASE(positions)
 
 }
 
+BOOST_AUTO_TEST_CASE(word_boundaries)
+{
+  // longer than the inline storage, ranges crossing 64-bit words
+  Bitmap wbm(300);
+  Bitmap wbm2(wbm, Range(0, 69));
+  BOOST_CHECK_EQUAL(wbm2.GetFirstGapPos(), 70);
+  BOOST_CHECK_EQUAL(wbm2.GetNumWordsCovered(), 70);
+  BOOST_CHECK(wbm2.Overlap(Range(69, 130)));
+  BOOST_CHECK(!wbm2.Overlap(Range(70, 299)));
+
+  Bitmap wbm3(wbm2, Range(200, 260));
+  BOOST_CHECK_EQUAL(wbm3.GetLastPos(), 260);
+  BOOST_CHECK_EQUAL(wbm3.GetLastGapPos(), 299);
+  BOOST_CHECK_EQUAL(wbm3.GetEdgeToTheLeftOf(150), 70);
+  BOOST_CHECK_EQUAL(wbm3.GetEdgeToTheLeftOf(60), 60);
+  BOOST_CHECK_EQUAL(wbm3.GetEdgeToTheRightOf(100), 199);
+  BOOST_CHECK_EQUAL(wbm3.GetEdgeToTheRightOf(270), 299);
+
+  Bitmap wbm4(wbm3, Range(70, 199));
+  BOOST_CHECK_EQUAL(wbm4.GetFirstGapPos(), 261);
+  BOOST_CHECK(wbm4 != wbm3);
+  BOOST_CHECK(Bitmap(wbm4) == wbm4);
+  BOOST_CHECK_EQUAL(Bitmap(wbm4).hash(), wbm4.hash());
+}
+
+BOOST_AUTO_TEST_CASE(ids)
+{
+  // compare against a position by position computation of the ids
+  Bitmap wbm(40);
+  wbm.SetValue(0, true);
+  wbm.SetValue(3, true);
+  wbm.SetValue(6, true);
+  for (size_t startPos = 1; startPos < 12; ++startPos) {
+    for (size_t endPos = startPos; endPos < 12; ++endPos) {
+      if (wbm.Overlap(Range(startPos, endPos))) continue;
+
+      size_t start = wbm.GetFirstGapPos();
+      size_t end = wbm.GetLastPos();
+      if (start == startPos) start = endPos + 1;
+      if (end < endPos) end = endPos;
+      WordsBitmapID id = 0;
+      for (size_t pos = end; pos > start; pos--) {
+        id = id * 2 + (wbm.GetValue(pos) || (startPos <= pos && pos <= endPos));
+      }
+      BOOST_CHECK_EQUAL(wbm.GetIDPlus(startPos, endPos), id + (1 << 16) * start);
+
+      Bitmap next(wbm, Range(startPos, endPos));
+      start = next.GetFirstGapPos();
+      end = next.GetLastPos();
+      id = 0;
+      for (size_t pos = end; pos > start; pos--) {
+        id = id * 2 + next.GetValue(pos);
+      }
+      BOOST_CHECK_EQUAL(next.GetID(), id + (1 << 16) * start);
+    }
+  }
+}
 
 BOOST_AUTO_TEST_SUITE_END()
 
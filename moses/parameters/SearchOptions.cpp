@@ -13,9 +13,19 @@ namespace Moses
     , max_phrase_length(DEFAULT_MAX_PHRASE_LENGTH)
     , max_trans_opt_per_cov(DEFAULT_MAX_TRANS_OPT_SIZE)
     , max_partial_trans_opt(DEFAULT_MAX_PART_TRANS_OPT_SIZE)
+    , subtask_min_length(0)
+    , stack_subtasks(0)
+    , chart_subtasks(0)
     , beam_width(DEFAULT_BEAM_WIDTH)
+    , stack_pruning(StaticStackPruning)
+    , adaptive_stack_min(0)
+    , adaptive_stack_max(0)
+    , heuristic_early_stopping(false)
     , timeout(0)
     , consensus(false)
+    , sentence_arena(false)
+    , lazy_score_breakdown(false)
+    , eval_batch_size(0)
     , early_discarding_threshold(DEFAULT_EARLY_DISCARDING_THRESHOLD)
     , trans_opt_threshold(DEFAULT_TRANSLATION_OPTION_THRESHOLD)
   { }
@@ -47,9 +57,20 @@ namespace Moses
                        DEFAULT_MAX_TRANS_OPT_SIZE);
     param.SetParameter(max_partial_trans_opt, "max-partial-trans-opt", 
                        DEFAULT_MAX_PART_TRANS_OPT_SIZE);
+    param.SetParameter(subtask_min_length, "threads-subtask-min-length", size_t(0));
+    param.SetParameter(stack_subtasks, "threads-stack-subtasks", size_t(0));
+    param.SetParameter(chart_subtasks, "threads-chart-subtasks", size_t(0));
 
     param.SetParameter(consensus, "consensus-decoding", false);
     param.SetParameter(disable_discarding, "disable-discarding", false);
+    param.SetParameter(sentence_arena, "sentence-arena", false);
+    param.SetParameter(lazy_score_breakdown, "lazy-score-breakdown", false);
+    param.SetParameter(eval_batch_size, "eval-batch-size", size_t(0));
+
+    param.SetParameter(stack_pruning, "stack-pruning", StaticStackPruning);
+    param.SetParameter(adaptive_stack_min, "adaptive-stack-min", stack_size / 4);
+    param.SetParameter(adaptive_stack_max, "adaptive-stack-max", 2 * stack_size);
+    param.SetParameter(heuristic_early_stopping, "heuristic-early-stopping", false);
     
     // transformation to log of a few scores
     beam_width = TransformScore(beam_width);
@@ -21,13 +21,45 @@ namespace Moses
     size_t max_phrase_length;
     size_t max_trans_opt_per_cov; 
     size_t max_partial_trans_opt;
+    // split translation option collection for inputs of at least this
+    // many words into sub-tasks for idle threads (0 = never)
+    size_t subtask_min_length;
+    // expand the hypotheses of one stack in this many sub-tasks,
+    // merged in a fixed order (0 = sequential expansion)
+    size_t stack_subtasks;
+    // chart decoding: decode the cells of one span width in this many
+    // sub-tasks (0 = cell by cell, in the sequential order)
+    size_t chart_subtasks;
     // beam search
     float beam_width;
 
+    // stack pruning policy: with adaptive pruning, the size (and beam)
+    // of each stack lies between adaptive_stack_min and
+    // adaptive_stack_max, depending on how flat its scores are
+    StackPruning stack_pruning;
+    size_t adaptive_stack_min; // default stack_size / 4
+    size_t adaptive_stack_max; // default 2 * stack_size
+    // stop once the future scores of the remaining stacks are below the
+    // best complete hypothesis. Future costs are not admissible, so this
+    // is a heuristic that can change the output.
+    bool heuristic_early_stopping;
+
     int timeout;
     int segment_timeout;
 
     bool consensus; //! Use Consensus decoding  (DeNero et al 2009)
+
+    // allocate hypotheses, FF states and score breakdowns from a
+    // per-sentence arena (see SentenceArena.h)
+    bool sentence_arena;
+
+    // keep only the weighted score of hypotheses during search and
+    // recompute the score breakdown for hypotheses that are output
+    bool lazy_score_breakdown;
+
+    // evaluate new hypotheses in batches of this size, one feature
+    // function at a time (0 = one hypothesis at a time)
+    size_t eval_batch_size;
     
     // reordering options
     // bool  reorderingConstraint; //! use additional reordering constraints
@@ -0,0 +1,731 @@
+/***********************************************************************
+  Moses - factored phrase-based language decoder
+  Copyright (C) 2012- University of Edinburgh
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ***********************************************************************/
+
+#include "extract-score/ExtractScore.h"
+#include "extract-score/PhrasePairRecord.h"
+#include "extract-score/RankedVocabulary.h"
+#include "extract-score/RecordWriter.h"
+
+#define  BOOST_TEST_MODULE MosesTrainingExtractScore
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+
+#include "util/exception.hh"
+#include "util/stream/chain.hh"
+#include "util/stream/config.hh"
+#include "util/stream/sort.hh"
+#include "util/stream/stream.hh"
+
+using namespace MosesTraining::ExtractScore;
+using namespace std;
+
+namespace
+{
+
+// Words that sort differently as "word " than as they are ("a\x01" comes
+// before "a"), that share a prefix with each other or with the separator, or
+// that sort after it.
+const char *const kWords[] = {
+  "a", "a\x01", "a!", "a|", "ab", "abc", "b", "B", "0", "1", "10", "|", "||",
+  "||||", "|||a", "}", "~", "\xc3\xa9", "NULL"
+};
+const size_t kNumWords = sizeof(kWords) / sizeof(kWords[0]);
+
+typedef vector<uint8_t> Record;
+
+// A directory for the files of a test, removed with everything in it.
+class TempDir
+{
+public:
+  TempDir()
+    : m_path(boost::filesystem::temp_directory_path() /
+             boost::filesystem::unique_path("extract-score-test-%%%%-%%%%")) {
+    boost::filesystem::create_directory(m_path);
+  }
+
+  ~TempDir() {
+    boost::filesystem::remove_all(m_path);
+  }
+
+  string File(const string &name) const {
+    return (m_path / name).string();
+  }
+
+private:
+  boost::filesystem::path m_path;
+};
+
+void MakeVocabulary(RankedVocabulary &vocab)
+{
+  for (size_t i = 0; i < kNumWords; ++i) {
+    vocab.Insert(kWords[i]);
+  }
+  vocab.Finalize();
+}
+
+void AppendPhrase(const RankedVocabulary &vocab, const uint32_t *ids,
+                  size_t size, string &line)
+{
+  for (size_t i = 0; i < size; ++i) {
+    if (i) {
+      line += " ";
+    }
+    line += vocab.GetWord(ids[i]);
+  }
+}
+
+// The line of the extract file that a record stands for.
+string ToLine(const RecordLayout &layout, const Record &record,
+              const RankedVocabulary &firstVocab,
+              const RankedVocabulary &secondVocab, bool firstIsTarget)
+{
+  const void *r = &record[0];
+  const size_t firstSize = layout.GetFirstSize(r);
+  const size_t secondSize = layout.GetSecondSize(r);
+  string line;
+  AppendPhrase(firstVocab, layout.First(r), firstSize, line);
+  line += " ||| ";
+  AppendPhrase(secondVocab, layout.Second(r), secondSize, line);
+  line += " |||";
+  // extract lists the points by target word
+  const size_t targetSize = firstIsTarget ? firstSize : secondSize;
+  const size_t sourceSize = firstIsTarget ? secondSize : firstSize;
+  for (size_t t = 0; t < targetSize; ++t) {
+    for (size_t s = 0; s < sourceSize; ++s) {
+      const size_t firstPos = firstIsTarget ? t : s;
+      const size_t secondPos = firstIsTarget ? s : t;
+      if (layout.IsAligned(r, firstPos, secondPos)) {
+        ostringstream point;
+        point << " " << firstPos << "-" << secondPos;
+        line += point.str();
+      }
+    }
+  }
+  return line;
+}
+
+Record MakeRecord(const RecordLayout &layout, const vector<uint32_t> &first,
+                  const vector<uint32_t> &second,
+                  const vector<pair<size_t, size_t> > &points, float count)
+{
+  Record record(layout.GetSize());
+  layout.Set(&record[0], &first[0], first.size(), &second[0], second.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    layout.SetAligned(&record[0], points[i].first, points[i].second);
+  }
+  *layout.Header(&record[0]) = count;
+  return record;
+}
+
+// Looks up the words of a phrase written with spaces.
+vector<uint32_t> Ids(const RankedVocabulary &vocab, const string &phrase)
+{
+  vector<uint32_t> ids;
+  istringstream words(phrase);
+  string word;
+  while (words >> word) {
+    RankedVocabulary::IdType id;
+    BOOST_REQUIRE(vocab.Find(word, id));
+    ids.push_back(id);
+  }
+  return ids;
+}
+
+class RandomRecords
+{
+public:
+  RandomRecords(const RecordLayout &layout, const RankedVocabulary &firstVocab,
+                const RankedVocabulary &secondVocab)
+    : m_layout(layout)
+    , m_firstVocab(firstVocab)
+    , m_secondVocab(secondVocab)
+    , m_generator(42) {}
+
+  // Short phrases from a small vocabulary, so that many records share their
+  // phrases or a prefix of them, some copies with another alignment and some
+  // plain duplicates.
+  void Generate(size_t n, vector<Record> &records) {
+    while (records.size() < n) {
+      const size_t kind = Uniform(0, 3);
+      if (kind == 0 && !records.empty()) {
+        records.push_back(records[Uniform(0, records.size() - 1)]);
+        continue;
+      }
+      vector<uint32_t> first, second;
+      if (kind == 1 && !records.empty()) {
+        const Record &other = records[Uniform(0, records.size() - 1)];
+        const void *r = &other[0];
+        first.assign(m_layout.First(r), m_layout.First(r) + m_layout.GetFirstSize(r));
+        second.assign(m_layout.Second(r), m_layout.Second(r) + m_layout.GetSecondSize(r));
+      } else {
+        RandomPhrase(m_firstVocab, first);
+        RandomPhrase(m_secondVocab, second);
+      }
+      vector<pair<size_t, size_t> > points;
+      for (size_t i = 0; i < first.size(); ++i) {
+        for (size_t j = 0; j < second.size(); ++j) {
+          if (Uniform(0, 3) == 0) {
+            points.push_back(make_pair(i, j));
+          }
+        }
+      }
+      records.push_back(MakeRecord(m_layout, first, second, points, 1));
+    }
+  }
+
+private:
+  size_t Uniform(size_t min, size_t max) {
+    boost::random::uniform_int_distribution<size_t> dist(min, max);
+    return dist(m_generator);
+  }
+
+  void RandomPhrase(const RankedVocabulary &vocab, vector<uint32_t> &phrase) {
+    // mostly short, sometimes long enough for two-digit positions
+    const size_t maxLength = Uniform(0, 3) ? 3 : m_layout.GetMaxLength();
+    phrase.resize(Uniform(1, maxLength));
+    for (size_t i = 0; i < phrase.size(); ++i) {
+      // any word but the separator
+      phrase[i] = Uniform(0, vocab.GetSize() - 2);
+      if (phrase[i] >= vocab.GetSeparator()) {
+        ++phrase[i];
+      }
+    }
+  }
+
+  const RecordLayout &m_layout;
+  const RankedVocabulary &m_firstVocab;
+  const RankedVocabulary &m_secondVocab;
+  boost::random::mt19937 m_generator;
+};
+
+int Sign(int x)
+{
+  return (x > 0) - (x < 0);
+}
+
+// Orders the indices of records.
+class IndexOrder
+{
+public:
+  IndexOrder(const PhrasePairOrder &order, const vector<Record> &records)
+    : m_order(order)
+    , m_records(records) {}
+
+  bool operator()(size_t a, size_t b) const {
+    return m_order(&m_records[a][0], &m_records[b][0]);
+  }
+
+private:
+  const PhrasePairOrder &m_order;
+  const vector<Record> &m_records;
+};
+
+// Compare() agrees with the byte order of the lines, and sorting the records
+// puts the lines in the order LC_ALL=C sort does.
+void CheckOrder(const RecordLayout &layout, const vector<Record> &records,
+                const RankedVocabulary &firstVocab,
+                const RankedVocabulary &secondVocab, bool firstIsTarget)
+{
+  const PhrasePairOrder order(layout, firstVocab.GetSeparator(),
+                              secondVocab.GetSeparator(), firstIsTarget);
+
+  vector<string> lines;
+  for (size_t i = 0; i < records.size(); ++i) {
+    lines.push_back(ToLine(layout, records[i], firstVocab, secondVocab,
+                           firstIsTarget));
+  }
+  for (size_t i = 0; i < records.size(); ++i) {
+    for (size_t j = 0; j < records.size(); ++j) {
+      const int cmp = order.Compare(&records[i][0], &records[j][0]);
+      if (cmp != Sign(lines[i].compare(lines[j]))) {
+        BOOST_ERROR("Compare(" << lines[i] << ", " << lines[j] << ") = " << cmp);
+      }
+    }
+  }
+
+  vector<size_t> sorted;
+  for (size_t i = 0; i < records.size(); ++i) {
+    sorted.push_back(i);
+  }
+  sort(sorted.begin(), sorted.end(), IndexOrder(order, records));
+  vector<string> sortedLines;
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    sortedLines.push_back(lines[sorted[i]]);
+  }
+  sort(lines.begin(), lines.end());
+  BOOST_CHECK(sortedLines == lines);
+}
+
+// Copies the records of each block that reaches the end of a chain.
+class CollectBlocks
+{
+public:
+  CollectBlocks(size_t recordSize, vector<vector<Record> > &blocks)
+    : m_recordSize(recordSize)
+    , m_blocks(&blocks) {}
+
+  void Run(const util::stream::ChainPosition &position) {
+    for (util::stream::Link link(position); link; ++link) {
+      m_blocks->push_back(vector<Record>());
+      const uint8_t *begin = static_cast<const uint8_t*>(link->Get());
+      const uint8_t *end = begin + link->ValidSize();
+      for (const uint8_t *r = begin; r != end; r += m_recordSize) {
+        m_blocks->back().push_back(Record(r, r + m_recordSize));
+      }
+    }
+  }
+
+private:
+  size_t m_recordSize;
+  vector<vector<Record> > *m_blocks;
+};
+
+// Total count by record key.
+typedef map<Record, float> Counts;
+
+void AddCount(const RecordLayout &layout, const Record &record, Counts &counts)
+{
+  const Record key(record.begin() + layout.GetKeyOffset(), record.end());
+  counts[key] += *layout.Header(&record[0]);
+}
+
+void WriteFile(const string &path, const char *text)
+{
+  ofstream out(path.c_str());
+  out << text;
+}
+
+string ReadFile(const string &path)
+{
+  ifstream in(path.c_str());
+  ostringstream text;
+  text << in.rdbuf();
+  return text.str();
+}
+
+// A small corpus with repeated phrase pairs, some with different alignments,
+// unaligned words and a word that sorts after the separator, and the phrase
+// table built for it by
+//   extract e f a extract 7
+//   score extract.sorted lex.f2e half.f2e
+//   score extract.inv.sorted lex.e2f half.e2f --Inverse
+//   consolidate half.f2e half.e2f.sorted table
+// with the extract files and half.e2f sorted by LC_ALL=C sort.
+const char *const kTarget =
+  "the house is small\n"
+  "the house is ~big\n"
+  "a small house\n"
+  "the house\n"
+  "a very small house\n"
+  "the house is small\n"
+  "the house\n";
+
+const char *const kSource =
+  "das haus ist klein\n"
+  "das haus ist gro\xc3\x9f\n"
+  "ein kleines haus\n"
+  "das haus\n"
+  "ein sehr kleines haus\n"
+  "das haus ist klein\n"
+  "das haus\n";
+
+const char *const kAlignment =
+  "0-0 1-1 2-2 3-3\n"
+  "0-0 1-1 2-2 3-3\n"
+  "0-0 1-1 2-2\n"
+  "0-0 1-1\n"
+  "0-0 2-2 3-3\n"
+  "0-0 1-1 2-2 2-3 3-3\n"
+  "0-0 0-1 1-1\n";
+
+const char *const kLexF2E =
+  "the das 0.8\n"
+  "house das 0.1\n"
+  "house haus 0.9\n"
+  "is ist 1\n"
+  "small klein 0.7\n"
+  "small kleines 0.6\n"
+  "~big gro\xc3\x9f 1\n"
+  "a ein 1\n"
+  "the NULL 0.2\n"
+  "very NULL 0.3\n"
+  "very sehr 0.9\n";
+
+const char *const kLexE2F =
+  "das the 0.9\n"
+  "haus house 0.8\n"
+  "ist is 1\n"
+  "klein small 0.5\n"
+  "kleines small 0.5\n"
+  "gro\xc3\x9f ~big 1\n"
+  "ein a 1\n"
+  "NULL the 0.1\n"
+  "sehr NULL 0.4\n"
+  "sehr very 0.8\n";
+
+// The phrase table of the usual pipeline on the files above, written as e,
+// f, a, lex.f2e and lex.e2f:
+//   extract e f a extract 7
+//   LC_ALL=C sort extract > extract.sorted
+//   LC_ALL=C sort extract.inv > extract.inv.sorted
+//   score extract.sorted lex.f2e half.f2e
+//   score extract.inv.sorted lex.e2f half.e2f --Inverse
+//   LC_ALL=C sort half.e2f > half.e2f.sorted
+//   consolidate half.f2e half.e2f.sorted table
+const char *const kTable =
+  "das haus ist gro\xc3\x9f ||| the house is ~big ||| 1 0.72 1 0.72 ||| 0-0 1-1 2-2 3-3 ||| 1 1 1 ||| |||\n"
+  "das haus ist klein ||| the house is small ||| 1 0.36 1 0.504 ||| 0-0 1-1 2-2 3-3 ||| 2 2 2 ||| |||\n"
+  "das haus ist ||| the house is ||| 1 0.72 1 0.72 ||| 0-0 1-1 2-2 ||| 2 2 2 ||| |||\n"
+  "das haus ||| the house ||| 1 0.72 1 0.72 ||| 0-0 1-1 ||| 5 5 5 ||| |||\n"
+  "das ||| the ||| 1 0.9 1 0.8 ||| 0-0 ||| 4 4 4 ||| |||\n"
+  "ein kleines haus ||| a small house ||| 1 0.4 1 0.54 ||| 0-0 1-1 2-2 ||| 1 1 1 ||| |||\n"
+  "ein kleines ||| a small ||| 1 0.5 1 0.6 ||| 0-0 1-1 ||| 1 1 1 ||| |||\n"
+  "ein sehr kleines haus ||| a very small house ||| 1 0.16 1 0.162 ||| 0-0 2-2 3-3 ||| 1 1 1 ||| |||\n"
+  "ein sehr kleines ||| a very small ||| 1 0.2 1 0.18 ||| 0-0 2-2 ||| 1 1 1 ||| |||\n"
+  "ein sehr ||| a very ||| 0.5 0.4 0.5 0.3 ||| 0-0 ||| 2 2 1 ||| |||\n"
+  "ein sehr ||| a ||| 0.333333 0.4 0.5 1 ||| 0-0 ||| 3 2 1 ||| |||\n"
+  "ein ||| a very ||| 0.5 1 0.333333 0.3 ||| 0-0 ||| 2 3 1 ||| |||\n"
+  "ein ||| a ||| 0.666667 1 0.666667 1 ||| 0-0 ||| 3 3 2 ||| |||\n"
+  "gro\xc3\x9f ||| ~big ||| 1 1 1 1 ||| 0-0 ||| 1 1 1 ||| |||\n"
+  "haus ist gro\xc3\x9f ||| house is ~big ||| 1 0.8 1 0.9 ||| 0-0 1-1 2-2 ||| 1 1 1 ||| |||\n"
+  "haus ist klein ||| house is small ||| 1 0.4 1 0.63 ||| 0-0 1-1 2-2 ||| 2 2 2 ||| |||\n"
+  "haus ist ||| house is ||| 1 0.8 1 0.9 ||| 0-0 1-1 ||| 2 2 2 ||| |||\n"
+  "haus ||| house ||| 1 0.8 1 0.9 ||| 0-0 ||| 6 6 6 ||| |||\n"
+  "ist gro\xc3\x9f ||| is ~big ||| 1 1 1 1 ||| 0-0 1-1 ||| 1 1 1 ||| |||\n"
+  "ist klein ||| is small ||| 1 0.5 1 0.7 ||| 0-0 1-1 ||| 2 2 2 ||| |||\n"
+  "ist ||| is ||| 1 1 1 1 ||| 0-0 ||| 2 2 2 ||| |||\n"
+  "klein ||| small ||| 0.25 0.5 1 0.7 ||| 0-0 ||| 4 1 1 ||| |||\n"
+  "kleines haus ||| small house ||| 0.666667 0.4 0.666667 0.54 ||| 0-0 1-1 ||| 3 3 2 ||| |||\n"
+  "kleines haus ||| very small house ||| 0.5 0.4 0.333333 0.162 ||| 0-1 1-2 ||| 2 3 1 ||| |||\n"
+  "kleines ||| small ||| 0.5 0.5 0.666667 0.6 ||| 0-0 ||| 4 3 2 ||| |||\n"
+  "kleines ||| very small ||| 0.5 0.5 0.333333 0.18 ||| 0-1 ||| 2 3 1 ||| |||\n"
+  "sehr kleines haus ||| small house ||| 0.333333 0.16 0.5 0.54 ||| 1-0 2-1 ||| 3 2 1 ||| |||\n"
+  "sehr kleines haus ||| very small house ||| 0.5 0.16 0.5 0.162 ||| 1-1 2-2 ||| 2 2 1 ||| |||\n"
+  "sehr kleines ||| small ||| 0.25 0.2 0.5 0.6 ||| 1-0 ||| 4 2 1 ||| |||\n"
+  "sehr kleines ||| very small ||| 0.5 0.2 0.5 0.18 ||| 1-1 ||| 2 2 1 ||| |||\n";
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(ranked_vocabulary_c_locale_order)
+{
+  RankedVocabulary vocab;
+  MakeVocabulary(vocab);
+  BOOST_REQUIRE_EQUAL(vocab.GetSize(), kNumWords + 1);
+  BOOST_CHECK_EQUAL(vocab.GetWord(vocab.GetSeparator()), RankedVocabulary::kSeparator);
+
+  RankedVocabulary::IdType id;
+  BOOST_CHECK(!vocab.Find("c", id));
+
+  // Ids are the ranks of "word " in byte order.
+  vector<string> words(kWords, kWords + kNumWords);
+  words.push_back(RankedVocabulary::kSeparator);
+  for (size_t i = 0; i < words.size(); ++i) {
+    RankedVocabulary::IdType a;
+    BOOST_REQUIRE(vocab.Find(words[i], a));
+    BOOST_CHECK_EQUAL(vocab.GetWord(a), words[i]);
+    for (size_t j = 0; j < words.size(); ++j) {
+      RankedVocabulary::IdType b;
+      BOOST_REQUIRE(vocab.Find(words[j], b));
+      if ((a < b) != (words[i] + " " < words[j] + " ")) {
+        BOOST_ERROR("\"" << words[i] << "\" and \"" << words[j]
+                    << "\" ranked " << a << " and " << b);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(phrase_pair_order_cases)
+{
+  RankedVocabulary vocab;
+  MakeVocabulary(vocab);
+  const RecordLayout layout(12, 1, true);
+  const PhrasePairOrder order(layout, vocab.GetSeparator(),
+                              vocab.GetSeparator(), false);
+  vector<pair<size_t, size_t> > none;
+  vector<pair<size_t, size_t> > first, second;
+
+  // "a ||| b |||" < "a b ||| b |||" < "a ~ ||| b |||" as '|' is between 'b'
+  // and '~'
+  const Record shorter = MakeRecord(layout, Ids(vocab, "a"), Ids(vocab, "b"), none, 1);
+  const Record before = MakeRecord(layout, Ids(vocab, "a b"), Ids(vocab, "b"), none, 1);
+  const Record after = MakeRecord(layout, Ids(vocab, "a ~"), Ids(vocab, "b"), none, 1);
+  BOOST_CHECK_EQUAL(order.Compare(&before[0], &shorter[0]), -1);
+  BOOST_CHECK_EQUAL(order.Compare(&shorter[0], &after[0]), -1);
+  BOOST_CHECK_EQUAL(order.Compare(&before[0], &after[0]), -1);
+
+  // same for the second phrase
+  const Record secondAfter = MakeRecord(layout, Ids(vocab, "a"), Ids(vocab, "b |||a"), none, 1);
+  BOOST_CHECK_EQUAL(order.Compare(&shorter[0], &secondAfter[0]), -1);
+
+  // " 1-10" < " 1-2"
+  const vector<uint32_t> longPhrase = Ids(vocab, "a a a a a a a a a a a");
+  first.push_back(make_pair(1, 10));
+  second.push_back(make_pair(1, 2));
+  Record a = MakeRecord(layout, longPhrase, longPhrase, first, 1);
+  Record b = MakeRecord(layout, longPhrase, longPhrase, second, 1);
+  BOOST_CHECK_EQUAL(order.Compare(&a[0], &b[0]), -1);
+  BOOST_CHECK_EQUAL(order.Compare(&b[0], &a[0]), 1);
+
+  // " 1-0" < " 10-0"
+  first.assign(1, make_pair(1, 0));
+  second.assign(1, make_pair(10, 0));
+  a = MakeRecord(layout, longPhrase, longPhrase, first, 1);
+  b = MakeRecord(layout, longPhrase, longPhrase, second, 1);
+  BOOST_CHECK_EQUAL(order.Compare(&a[0], &b[0]), -1);
+
+  // " 0-0" < " 0-0 1-1", and the counts do not matter
+  first.assign(1, make_pair(0, 0));
+  second = first;
+  second.push_back(make_pair(1, 1));
+  a = MakeRecord(layout, longPhrase, longPhrase, first, 1);
+  b = MakeRecord(layout, longPhrase, longPhrase, second, 1);
+  BOOST_CHECK_EQUAL(order.Compare(&a[0], &b[0]), -1);
+  b = MakeRecord(layout, longPhrase, longPhrase, first, 5);
+  BOOST_CHECK_EQUAL(order.Compare(&a[0], &b[0]), 0);
+
+  // Points are listed by target word, the second phrase in the direct order
+  // and the first one in the inverse order: " 1-0 0-1" > " 0-1 1-1" but
+  // " 0-1 1-0" < " 0-1 1-1".
+  first.assign(1, make_pair(1, 0));
+  first.push_back(make_pair(0, 1));
+  second.assign(1, make_pair(0, 1));
+  second.push_back(make_pair(1, 1));
+  a = MakeRecord(layout, Ids(vocab, "a b"), Ids(vocab, "a b"), first, 1);
+  b = MakeRecord(layout, Ids(vocab, "a b"), Ids(vocab, "a b"), second, 1);
+  BOOST_CHECK_EQUAL(order.Compare(&a[0], &b[0]), 1);
+  const PhrasePairOrder inverseOrder(layout, vocab.GetSeparator(),
+                                     vocab.GetSeparator(), true);
+  BOOST_CHECK_EQUAL(inverseOrder.Compare(&a[0], &b[0]), -1);
+}
+
+BOOST_AUTO_TEST_CASE(phrase_pair_order_sorts_like_text)
+{
+  // Different words on the two sides, so the separators differ, too.
+  RankedVocabulary firstVocab, secondVocab;
+  MakeVocabulary(firstVocab);
+  for (size_t i = 0; i < kNumWords; i += 2) {
+    secondVocab.Insert(kWords[i]);
+  }
+  secondVocab.Finalize();
+  BOOST_REQUIRE(firstVocab.GetSeparator() != secondVocab.GetSeparator());
+
+  const RecordLayout layout(12, 1, true);
+  vector<Record> records;
+  RandomRecords random(layout, firstVocab, secondVocab);
+  random.Generate(400, records);
+
+  CheckOrder(layout, records, firstVocab, secondVocab, false);
+  CheckOrder(layout, records, firstVocab, secondVocab, true);
+}
+
+BOOST_AUTO_TEST_CASE(combine_counts)
+{
+  RankedVocabulary vocab;
+  MakeVocabulary(vocab);
+  const RecordLayout layout(4, 1, true);
+  const PhrasePairOrder order(layout, vocab.GetSeparator(),
+                              vocab.GetSeparator(), false);
+  const CombineCounts combine(layout);
+  vector<pair<size_t, size_t> > points(1, make_pair(0, 0));
+
+  Record into = MakeRecord(layout, Ids(vocab, "a b"), Ids(vocab, "b"), points, 2);
+  const Record same = MakeRecord(layout, Ids(vocab, "a b"), Ids(vocab, "b"), points, 3);
+  BOOST_CHECK(combine(&into[0], &same[0], order));
+  BOOST_CHECK_EQUAL(*layout.Header(&into[0]), 5);
+
+  points.push_back(make_pair(1, 0));
+  const Record otherAlignment = MakeRecord(layout, Ids(vocab, "a b"), Ids(vocab, "b"), points, 1);
+  const Record otherPhrase = MakeRecord(layout, Ids(vocab, "a"), Ids(vocab, "b"), points, 1);
+  BOOST_CHECK(!combine(&into[0], &otherAlignment[0], order));
+  BOOST_CHECK(!combine(&into[0], &otherPhrase[0], order));
+  BOOST_CHECK_EQUAL(*layout.Header(&into[0]), 5);
+}
+
+BOOST_AUTO_TEST_CASE(record_writer_combines_duplicates)
+{
+  RankedVocabulary vocab;
+  MakeVocabulary(vocab);
+  const RecordLayout layout(4, 1, true);
+  vector<Record> records;
+  RandomRecords random(layout, vocab, vocab);
+  random.Generate(20, records);
+
+  // Small blocks of 16 records, so that duplicates fall into the same block
+  // and into different ones.
+  const util::stream::ChainConfig config(layout.GetSize(), 2,
+                                         32 * layout.GetSize());
+  vector<Record> added;
+  Counts expected;
+  vector<vector<Record> > blocks;
+  {
+    util::stream::Chain chain(config);
+    const util::stream::ChainPosition position = chain.Add();
+    chain >> CollectBlocks(layout.GetSize(), blocks) >> util::stream::kRecycle;
+    RecordWriter writer(layout, position);
+    for (size_t i = 0; i < 500; ++i) {
+      Record record = records[(i * 7 + i / 13) % records.size()];
+      *layout.Header(&record[0]) = i % 3 + 1;
+      writer.Add(&record[0]);
+      AddCount(layout, record, expected);
+    }
+    writer.Finish();
+    chain.Wait();
+  }
+
+  // No record is repeated within a block, nothing is lost and a block is only
+  // passed on when full.
+  Counts counts;
+  size_t numRecords = 0;
+  BOOST_REQUIRE(blocks.size() > 1);
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    if (i + 1 < blocks.size()) {
+      BOOST_CHECK_EQUAL(blocks[i].size(), size_t(16));
+    }
+    Counts inBlock;
+    for (size_t j = 0; j < blocks[i].size(); ++j) {
+      AddCount(layout, blocks[i][j], inBlock);
+      AddCount(layout, blocks[i][j], counts);
+    }
+    BOOST_CHECK_EQUAL(inBlock.size(), blocks[i].size());
+    numRecords += blocks[i].size();
+  }
+  BOOST_CHECK(numRecords < 500);
+  BOOST_CHECK(counts == expected);
+}
+
+BOOST_AUTO_TEST_CASE(sort_combines_counts)
+{
+  RankedVocabulary vocab;
+  MakeVocabulary(vocab);
+  const RecordLayout layout(12, 1, true);
+  const PhrasePairOrder order(layout, vocab.GetSeparator(),
+                              vocab.GetSeparator(), false);
+  vector<Record> records;
+  RandomRecords random(layout, vocab, vocab);
+  random.Generate(2000, records);
+
+  TempDir dir;
+  util::stream::SortConfig sortConfig;
+  sortConfig.temp_prefix = dir.File("sort");
+  sortConfig.buffer_size = 16 * layout.GetSize();
+  sortConfig.total_memory = 256 * layout.GetSize();
+  const util::stream::ChainConfig config(layout.GetSize(), 2,
+                                         128 * layout.GetSize());
+
+  Counts expected;
+  util::stream::Chain chain(config);
+  const util::stream::ChainPosition position = chain.Add();
+  util::stream::Sort<PhrasePairOrder, CombineCounts> sorter(
+    chain, sortConfig, order, CombineCounts(layout));
+  {
+    RecordWriter writer(layout, position);
+    for (size_t i = 0; i < records.size(); ++i) {
+      writer.Add(&records[i][0]);
+      AddCount(layout, records[i], expected);
+    }
+  }
+  chain.Wait();
+
+  // Each record comes out once, in order, with its total count.
+  util::stream::Chain sorted(config);
+  sorter.Output(sorted);
+  util::stream::Stream stream;
+  sorted >> stream >> util::stream::kRecycle;
+  Counts counts;
+  Record previous;
+  for (; stream; ++stream) {
+    const Record record(static_cast<const uint8_t*>(stream.Get()),
+                        static_cast<const uint8_t*>(stream.Get()) + layout.GetSize());
+    if (!previous.empty()) {
+      BOOST_CHECK(order(&previous[0], &record[0]));
+    }
+    AddCount(layout, record, counts);
+    previous = record;
+  }
+  BOOST_CHECK(counts == expected);
+}
+
+BOOST_AUTO_TEST_CASE(extract_score_matches_pipeline)
+{
+  TempDir dir;
+  WriteFile(dir.File("e"), kTarget);
+  WriteFile(dir.File("f"), kSource);
+  WriteFile(dir.File("a"), kAlignment);
+  WriteFile(dir.File("lex.f2e"), kLexF2E);
+  WriteFile(dir.File("lex.e2f"), kLexE2F);
+
+  const char *threads[] = { "1", "2" };
+  for (size_t i = 0; i < 2; ++i) {
+    const string tempPrefix = dir.File("tmp");
+    const string target = dir.File("e");
+    const string source = dir.File("f");
+    const string alignment = dir.File("a");
+    const string lexF2E = dir.File("lex.f2e");
+    const string lexE2F = dir.File("lex.e2f");
+    const string table = dir.File("table");
+    const char *argv[] = {
+      "extract-score", "--Memory", "10M", "--TempPrefix", tempPrefix.c_str(),
+      "--Threads", threads[i], target.c_str(), source.c_str(),
+      alignment.c_str(), lexF2E.c_str(), lexE2F.c_str(), table.c_str()
+    };
+    ExtractScore tool;
+    BOOST_REQUIRE_EQUAL(tool.Main(sizeof(argv) / sizeof(argv[0]),
+                                  const_cast<char**>(argv)), 0);
+    BOOST_CHECK_EQUAL(ReadFile(table), kTable);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(extract_score_rejects_short_files)
+{
+  TempDir dir;
+  WriteFile(dir.File("e"), kTarget);
+  WriteFile(dir.File("f"), kSource);
+  WriteFile(dir.File("lex.f2e"), kLexF2E);
+  WriteFile(dir.File("lex.e2f"), kLexE2F);
+  // the last sentence pair has no alignment
+  const string alignment(kAlignment);
+  WriteFile(dir.File("a"),
+            alignment.substr(0, alignment.rfind('\n', alignment.size() - 2) + 1).c_str());
+
+  const string tempPrefix = dir.File("tmp");
+  const string target = dir.File("e");
+  const string source = dir.File("f");
+  const string alignmentFile = dir.File("a");
+  const string lexF2E = dir.File("lex.f2e");
+  const string lexE2F = dir.File("lex.e2f");
+  const string table = dir.File("table");
+  const char *argv[] = {
+    "extract-score", "--Memory", "10M", "--TempPrefix", tempPrefix.c_str(),
+    "--Threads", "2", target.c_str(), source.c_str(),
+    alignmentFile.c_str(), lexF2E.c_str(), lexE2F.c_str(), table.c_str()
+  };
+  ExtractScore tool;
+  BOOST_CHECK_THROW(tool.Main(sizeof(argv) / sizeof(argv[0]),
+                              const_cast<char**>(argv)), util::Exception);
+}
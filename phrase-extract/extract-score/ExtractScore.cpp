@@ -0,0 +1,417 @@
+#include "ExtractScore.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "moses/ThreadPool.h"
+#include "util/exception.hh"
+#include "util/stream/chain.hh"
+#include "util/stream/config.hh"
+#include "util/stream/sort.hh"
+#include "util/stream/stream.hh"
+#include "util/usage.hh"
+
+#include "InputFileStream.h"
+#include "OutputFileStream.h"
+#include "SentenceAlignmentWithSyntax.h"
+
+#include "InverseScorer.h"
+#include "LexicalTable.h"
+#include "PhrasePairExtractor.h"
+#include "PhrasePairGroup.h"
+#include "PhrasePairRecord.h"
+#include "PhraseTableWriter.h"
+#include "RecordWriter.h"
+
+namespace MosesTraining
+{
+namespace ExtractScore
+{
+
+namespace
+{
+
+// number of sentence pairs per extraction task
+const std::size_t kBatchSize = 200;
+
+bool SamePhrasePair(const RecordLayout &layoutA, const void *a,
+                    const RecordLayout &layoutB, const void *b)
+{
+  const std::size_t firstSize = layoutA.GetFirstSize(a);
+  const std::size_t secondSize = layoutA.GetSecondSize(a);
+  return firstSize == layoutB.GetFirstSize(b) &&
+         secondSize == layoutB.GetSecondSize(b) &&
+         std::equal(layoutA.First(a), layoutA.First(a) + firstSize,
+                    layoutB.First(b)) &&
+         std::equal(layoutA.Second(a), layoutA.Second(a) + secondSize,
+                    layoutB.Second(b));
+}
+
+}  // namespace
+
+int ExtractScore::Main(int argc, char *argv[])
+{
+  // Process command-line options.
+  ProcessOptions(argc, argv, m_options);
+
+  // Open the input and output files.
+  Moses::InputFileStream targetStream(m_options.targetFile);
+  Moses::InputFileStream sourceStream(m_options.sourceFile);
+  Moses::InputFileStream alignmentStream(m_options.alignmentFile);
+  Moses::InputFileStream lexStreamF2E(m_options.lexFileF2E);
+  Moses::InputFileStream lexStreamE2F(m_options.lexFileE2F);
+  Moses::OutputFileStream outStream;
+  OpenOutputFileOrDie(m_options.tableFile, outStream);
+
+  // Collect the vocabularies and load the lexical tables, keeping only the
+  // entries for words of the corpus.
+  ReadVocabularies();
+  LexicalTable lexTableF2E(m_sourceVocab, m_targetVocab);
+  LexicalTable lexTableE2F(m_targetVocab, m_sourceVocab);
+  lexTableF2E.Load(lexStreamF2E);
+  lexTableE2F.Load(lexStreamE2F);
+
+  // Memory.  The blocks of the chains that feed the sorts are the runs the
+  // sorts write out, so they get the most: with few enough runs for a single
+  // lazy merge, every record is written and read back only once.  The lazy
+  // merges of two sorts run at the same time at the end.
+  const std::size_t memory = util::ParseSize(m_options.memory);
+  const std::size_t writeChainMemory = memory / 4;
+  const std::size_t readChainMemory = memory / 16;
+  util::stream::SortConfig sortConfig;
+  sortConfig.temp_prefix = m_options.tempPrefix;
+  sortConfig.buffer_size = memory / 64;
+  sortConfig.total_memory = memory * 3 / 8;
+
+  const RecordLayout layout(m_options.maxPhraseLength, 1, true);
+  const RecordLayout scoreLayout(m_options.maxPhraseLength,
+                                 InverseScorer::kScoreFloats, false);
+  const util::stream::ChainConfig writeConfig(layout.GetSize(), 2,
+      writeChainMemory);
+  const util::stream::ChainConfig readConfig(layout.GetSize(), 2,
+      readChainMemory);
+  const util::stream::ChainConfig scoreWriteConfig(scoreLayout.GetSize(), 2,
+      writeChainMemory);
+  const util::stream::ChainConfig scoreReadConfig(scoreLayout.GetSize(), 2,
+      readChainMemory);
+
+  const RankedVocabulary::IdType sourceSeparator = m_sourceVocab.GetSeparator();
+  const RankedVocabulary::IdType targetSeparator = m_targetVocab.GetSeparator();
+  const PhrasePairOrder directOrder(layout, sourceSeparator, targetSeparator,
+                                    false);
+  const PhrasePairOrder inverseOrder(layout, targetSeparator, sourceSeparator,
+                                     true);
+
+  // Extract the phrase pairs and sort them, in extract file order, as they
+  // come: direct ones with the source phrase first and inverse ones with the
+  // target phrase first.
+  util::stream::Chain directChain(writeConfig);
+  util::stream::Chain inverseChain(writeConfig);
+  const util::stream::ChainPosition directPosition = directChain.Add();
+  const util::stream::ChainPosition inversePosition = inverseChain.Add();
+  util::stream::Sort<PhrasePairOrder, CombineCounts> directSort(
+    directChain, sortConfig, directOrder, CombineCounts(layout));
+  util::stream::Sort<PhrasePairOrder, CombineCounts> inverseSort(
+    inverseChain, sortConfig, inverseOrder, CombineCounts(layout));
+  int missingLine = 0;
+  {
+    RecordWriter directWriter(layout, directPosition);
+    RecordWriter inverseWriter(layout, inversePosition);
+    boost::mutex writerMutex;
+    const PhrasePairExtractor extractor(m_sourceVocab, m_targetVocab, layout,
+                                        m_options.maxPhraseLength);
+#ifdef WITH_THREADS
+    Moses::ThreadPool pool(m_options.threads);
+    pool.SetQueueLimit(2 * m_options.threads);
+#endif
+    std::vector<SentencePair> batch;
+    int lineNum = 0;
+    bool more = true;
+    while (more) {
+      SentencePair pair;
+      more = static_cast<bool>(std::getline(targetStream, pair.target));
+      if (more) {
+        if (++lineNum % 10000 == 0) {
+          std::cerr << "." << std::flush;
+        }
+        if (!std::getline(sourceStream, pair.source) ||
+            !std::getline(alignmentStream, pair.alignment)) {
+          // stop reading, but let the chains finish before failing
+          missingLine = lineNum;
+          more = false;
+        } else {
+          pair.lineNum = lineNum;
+          batch.push_back(pair);
+        }
+      }
+      if (batch.size() == kBatchSize || (!more && !batch.empty())) {
+        boost::shared_ptr<ExtractTask> task(
+          new ExtractTask(extractor, batch, directWriter, inverseWriter,
+                          layout.GetSize(), writerMutex));
+#ifdef WITH_THREADS
+        pool.Submit(task);
+#else
+        task->Run();
+#endif
+      }
+    }
+    std::cerr << std::endl;
+#ifdef WITH_THREADS
+    pool.Stop(true);
+#endif
+    directWriter.Finish();
+    inverseWriter.Finish();
+  }
+  directChain.Wait();
+  inverseChain.Wait();
+  UTIL_THROW_IF2(missingLine, "Source or alignment file ends before line "
+                 << missingLine << " of the target file");
+
+  // Score the inverse phrase pairs and sort the scores in the order of the
+  // direct phrase pairs.
+  util::stream::Chain scoreChain(scoreWriteConfig);
+  const util::stream::ChainPosition scorePosition = scoreChain.Add();
+  util::stream::Sort<PhrasePairOrder> scoreSort(
+    scoreChain, sortConfig,
+    PhrasePairOrder(scoreLayout, sourceSeparator, targetSeparator, false));
+  {
+    util::stream::Chain inverseSorted(readConfig);
+    inverseSort.Output(inverseSorted);
+    inverseSorted >> InverseScorer(m_options, layout, scoreLayout, lexTableE2F,
+                                   scorePosition) >> util::stream::kRecycle;
+    inverseSorted.Wait();
+  }
+  scoreChain.Wait();
+
+  // Score the direct phrase pairs and write the table, reading the inverse
+  // scores alongside.
+  util::stream::Chain directSorted(readConfig);
+  util::stream::Chain scoreSorted(scoreReadConfig);
+  directSort.Output(directSorted);
+  scoreSort.Output(scoreSorted);
+  util::stream::Stream directStream;
+  util::stream::Stream scoreStream;
+  directSorted >> directStream >> util::stream::kRecycle;
+  scoreSorted >> scoreStream >> util::stream::kRecycle;
+
+  PhrasePairGroup group(layout);
+  PhraseTableWriter writer(m_options, outStream, m_sourceVocab, m_targetVocab,
+                           lexTableF2E);
+  while (group.Read(directStream)) {
+    for (std::size_t i = 0; i < group.GetSize(); ++i) {
+      if (group.GetCount(i) < m_options.minCount) {
+        continue;
+      }
+      const void *record = group.GetRecord(i);
+      UTIL_THROW_IF2(!scoreStream ||
+                     !SamePhrasePair(layout, record, scoreLayout,
+                                     scoreStream.Get()),
+                     "Inverse scores are out of step with the phrase pairs");
+      writer.WriteLine(layout, record, group.GetTotalCount(), scoreLayout,
+                       scoreStream.Get());
+      ++scoreStream;
+    }
+  }
+  UTIL_THROW_IF2(scoreStream, "Inverse scores left over");
+
+  outStream.Close();
+  return 0;
+}
+
+void ExtractScore::ReadVocabularies()
+{
+  Moses::InputFileStream targetStream(m_options.targetFile);
+  Moses::InputFileStream sourceStream(m_options.sourceFile);
+
+  // Tokenize as extract does, stripping XML markup from the target side.
+  std::set<std::string> targetLabelCollection, sourceLabelCollection;
+  std::map<std::string, int> targetTopLabelCollection, sourceTopLabelCollection;
+  SentenceAlignmentWithSyntax sentence(
+    targetLabelCollection, sourceLabelCollection,
+    targetTopLabelCollection, sourceTopLabelCollection, true, false);
+
+  std::string target, source;
+  int lineNum = 0;
+  while (std::getline(targetStream, target)) {
+    ++lineNum;
+    UTIL_THROW_IF2(!std::getline(sourceStream, source),
+                   "Source file ends before line " << lineNum
+                   << " of the target file");
+    if (sentence.processTargetSentence(target.c_str(), lineNum, false)) {
+      for (std::size_t i = 0; i < sentence.target.size(); ++i) {
+        m_targetVocab.Insert(sentence.target[i]);
+      }
+    }
+    sentence.processSourceSentence(source.c_str(), lineNum, false);
+    for (std::size_t i = 0; i < sentence.source.size(); ++i) {
+      m_sourceVocab.Insert(sentence.source[i]);
+    }
+  }
+
+  // Unaligned words are explained by NULL.
+  m_sourceVocab.Insert("NULL");
+  m_targetVocab.Insert("NULL");
+  m_sourceVocab.Finalize();
+  m_targetVocab.Finalize();
+}
+
+void ExtractScore::ProcessOptions(int argc, char *argv[],
+                                  Options &options) const
+{
+  namespace po = boost::program_options;
+  namespace cls = boost::program_options::command_line_style;
+
+  // Construct the 'top' of the usage message: the bit that comes before the
+  // options list.
+  std::ostringstream usageTop;
+  usageTop << "Usage: " << name()
+           << " [OPTION]... TARGET SOURCE ALIGNMENT LEX.F2E LEX.E2F TABLE\n\n"
+           << "Phrase table builder: extract, score and consolidate in one "
+           << "multi-threaded pass\n\n"
+           << "Options";
+
+  // Construct the 'bottom' of the usage message.
+  std::ostringstream usageBottom;
+  usageBottom << "\nThe table is the same as the one built by extract, sort,\n"
+              << "score, score --Inverse and consolidate with the\n"
+              << "corresponding options.";
+
+  // Declare the command line options that are visible to the user.
+  po::options_description visible(usageTop.str());
+  visible.add_options()
+  ("help",
+   "print this help message and exit")
+  ("LogProb",
+   "output log probabilities")
+  ("LowCountFeature",
+   "include the low count feature")
+  ("MaxPhraseLength",
+   po::value(&options.maxPhraseLength)->
+   default_value(options.maxPhraseLength),
+   "maximum phrase length")
+  ("Memory",
+   po::value(&options.memory)->default_value(options.memory),
+   "memory for sorting, e.g. 500M or 4G")
+  ("MinCount",
+   po::value(&options.minCount)->default_value(options.minCount),
+   "filter out phrase pairs with frequency < arg")
+  ("NoWordAlignment",
+   "do not output word alignments")
+  ("OnlyDirect",
+   "only include the direct translation scores p(e|f)")
+  ("PhraseCount",
+   "include the phrase count feature")
+  ("TempPrefix",
+   po::value(&options.tempPrefix)->default_value(options.tempPrefix),
+   "prefix of temporary files")
+  ("Threads",
+   po::value(&options.threads)->default_value(options.threads),
+   "number of extraction threads")
+  ;
+
+  // Declare the command line options that are hidden from the user
+  // (these are used as positional options).
+  po::options_description hidden("Hidden options");
+  hidden.add_options()
+  ("TargetFile",
+   po::value(&options.targetFile),
+   "target corpus")
+  ("SourceFile",
+   po::value(&options.sourceFile),
+   "source corpus")
+  ("AlignmentFile",
+   po::value(&options.alignmentFile),
+   "word alignment")
+  ("LexFileF2E",
+   po::value(&options.lexFileF2E),
+   "lexical probability file p(e|f)")
+  ("LexFileE2F",
+   po::value(&options.lexFileE2F),
+   "lexical probability file p(f|e)")
+  ("TableFile",
+   po::value(&options.tableFile),
+   "output file")
+  ;
+
+  // Compose the full set of command-line options.
+  po::options_description cmdLineOptions;
+  cmdLineOptions.add(visible).add(hidden);
+
+  // Register the positional options.
+  po::positional_options_description p;
+  p.add("TargetFile", 1);
+  p.add("SourceFile", 1);
+  p.add("AlignmentFile", 1);
+  p.add("LexFileF2E", 1);
+  p.add("LexFileE2F", 1);
+  p.add("TableFile", 1);
+
+  // Process the command-line.
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv).style(MosesOptionStyle()).
+              options(cmdLineOptions).positional(p).run(), vm);
+    po::notify(vm);
+  } catch (const std::exception &e) {
+    std::ostringstream msg;
+    msg << e.what() << "\n\n" << visible << usageBottom.str();
+    Error(msg.str());
+  }
+
+  if (vm.count("help")) {
+    std::cout << visible << usageBottom.str() << std::endl;
+    std::exit(0);
+  }
+
+  // Check all positional options were given.
+  if (!vm.count("TargetFile") ||
+      !vm.count("SourceFile") ||
+      !vm.count("AlignmentFile") ||
+      !vm.count("LexFileF2E") ||
+      !vm.count("LexFileE2F") ||
+      !vm.count("TableFile")) {
+    std::cerr << visible << usageBottom.str() << std::endl;
+    std::exit(1);
+  }
+
+  // Process Boolean options.
+  if (vm.count("LogProb")) {
+    options.logProb = true;
+  }
+  if (vm.count("LowCountFeature")) {
+    options.lowCountFeature = true;
+  }
+  if (vm.count("NoWordAlignment")) {
+    options.noWordAlignment = true;
+  }
+  if (vm.count("OnlyDirect")) {
+    options.onlyDirect = true;
+  }
+  if (vm.count("PhraseCount")) {
+    options.phraseCount = true;
+  }
+
+  // Check the values.
+  if (options.maxPhraseLength < 1 || options.maxPhraseLength > 255) {
+    Error("MaxPhraseLength must be between 1 and 255");
+  }
+  if (options.threads < 1) {
+    Error("Threads must be at least 1");
+  }
+
+  // account for rounding, as score does
+  options.minCount -= 0.00001;
+}
+
+}  // namespace ExtractScore
+}  // namespace MosesTraining
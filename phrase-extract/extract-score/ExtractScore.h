@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+
+#include "syntax-common/tool.h"
+
+#include "Options.h"
+#include "RankedVocabulary.h"
+
+namespace MosesTraining
+{
+namespace ExtractScore
+{
+
+// Builds a phrase table from a word-aligned parallel corpus in one process,
+// doing the work of extract, sort, score (direct and inverse), sort and
+// consolidate.  Phrase pairs go through util::stream sorts as fixed-size
+// binary records instead of through text files, and the table is written in
+// a single streaming pass over the sorted records.
+class ExtractScore : public Syntax::Tool
+{
+public:
+  ExtractScore() : Tool("extract-score") {}
+
+  virtual int Main(int argc, char *argv[]);
+
+private:
+  void ProcessOptions(int, char *[], Options &) const;
+
+  //! Collects the words of both sides of the corpus, tokenized as extract
+  //! does, and assigns their ids.
+  void ReadVocabularies();
+
+  Options m_options;
+  RankedVocabulary m_sourceVocab;
+  RankedVocabulary m_targetVocab;
+};
+
+}  // namespace ExtractScore
+}  // namespace MosesTraining
@@ -0,0 +1,39 @@
+#include "InverseScorer.h"
+
+#include "util/stream/stream.hh"
+
+#include "PhrasePairGroup.h"
+
+namespace MosesTraining
+{
+namespace ExtractScore
+{
+
+void InverseScorer::Run(const util::stream::ChainPosition &position)
+{
+  util::stream::Stream in(position);
+  util::stream::Stream out(m_scorePosition);
+  PhrasePairGroup group(m_inverseLayout);
+  while (group.Read(in)) {
+    for (std::size_t i = 0; i < group.GetSize(); ++i) {
+      if (group.GetCount(i) < m_options.minCount) {
+        continue;
+      }
+      const void *record = group.GetRecord(i);
+      m_scoreLayout.Set(out.Get(),
+                        m_inverseLayout.Second(record),
+                        m_inverseLayout.GetSecondSize(record),
+                        m_inverseLayout.First(record),
+                        m_inverseLayout.GetFirstSize(record));
+      float *scores = m_scoreLayout.Header(out.Get());
+      scores[0] = group.GetTotalCount();
+      scores[1] = group.GetCount(i);
+      scores[2] = MaybeLog(m_lexTable.Score(m_inverseLayout, record));
+      ++out;
+    }
+  }
+  out.Poison();
+}
+
+}  // namespace ExtractScore
+}  // namespace MosesTraining
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cmath>
+
+#include "util/stream/chain.hh"
+
+#include "LexicalTable.h"
+#include "Options.h"
+#include "PhrasePairRecord.h"
+
+namespace MosesTraining
+{
+namespace ExtractScore
+{
+
+// Scores the sorted inverse phrase pairs (target phrase first) and passes on
+// what the phrase table needs of them -- the target phrase count, the phrase
+// pair count and the inverse lexical weight -- as records with the source
+// phrase first, ready to be sorted in the order of the direct phrase pairs.
+// This is the work of score --Inverse and of the sort of its output.
+//
+// Runs as a step of the chain that reads the sorted inverse phrase pairs.
+class InverseScorer
+{
+public:
+  //! The records of the score chain hold the three values in their header.
+  static const std::size_t kScoreFloats = 3;
+
+  InverseScorer(const Options &options, const RecordLayout &inverseLayout,
+                const RecordLayout &scoreLayout, const LexicalTable &lexTable,
+                const util::stream::ChainPosition &scorePosition)
+    : m_options(options)
+    , m_inverseLayout(inverseLayout)
+    , m_scoreLayout(scoreLayout)
+    , m_lexTable(lexTable)
+    , m_scorePosition(scorePosition) {}
+
+  void Run(const util::stream::ChainPosition &position);
+
+private:
+  // as score's MaybeLog
+  float MaybeLog(float a) const {
+    return m_options.logProb ? std::log(static_cast<double>(a)) : a;
+  }
+
+  const Options &m_options;
+  const RecordLayout m_inverseLayout;
+  const RecordLayout m_scoreLayout;
+  const LexicalTable &m_lexTable;
+  util::stream::ChainPosition m_scorePosition;
+};
+
+}  // namespace ExtractScore
+}  // namespace MosesTraining
@@ -0,0 +1,88 @@
+#include "LexicalTable.h"
+
+#include <cstdlib>
+#include <iostream>
+
+#include "util/exception.hh"
+#include "util/tokenize_piece.hh"
+
+namespace MosesTraining
+{
+namespace ExtractScore
+{
+
+LexicalTable::LexicalTable(const RankedVocabulary &firstVocab,
+                           const RankedVocabulary &secondVocab)
+  : m_firstVocab(firstVocab)
+  , m_secondVocab(secondVocab)
+{
+  UTIL_THROW_IF2(!m_firstVocab.Find("NULL", m_null),
+                 "NULL is missing from the vocabulary");
+}
+
+void LexicalTable::Load(std::istream &input)
+{
+  const util::AnyCharacter delimiter(" \t");
+
+  std::string line;
+  int i = 0;
+  while (getline(input, line)) {
+    ++i;
+    if (i%100000 == 0) {
+      std::cerr << ".";
+    }
+
+    std::string tokens[3];
+    std::size_t numTokens = 0;
+    for (util::TokenIter<util::AnyCharacter, true> it(line, delimiter); it;
+         ++it, ++numTokens) {
+      if (numTokens < 3) {
+        it->CopyToString(&tokens[numTokens]);
+      }
+    }
+    if (numTokens != 3) {
+      std::cerr << "line " << i << " of the lexical table has wrong number "
+                << "of tokens, skipping:" << std::endl << line << std::endl;
+      continue;
+    }
+
+    // Entries for words that are not in the corpus are never looked up.
+    RankedVocabulary::IdType secondId, firstId;
+    if (!m_secondVocab.Find(tokens[0], secondId) ||
+        !m_firstVocab.Find(tokens[1], firstId)) {
+      continue;
+    }
+    m_table[Key(firstId, secondId)] = std::atof(tokens[2].c_str());
+  }
+  std::cerr << std::endl;
+}
+
+double LexicalTable::Score(const RecordLayout &layout,
+                           const void *record) const
+{
+  const uint32_t *first = layout.First(record);
+  const uint32_t *second = layout.Second(record);
+  const std::size_t firstSize = layout.GetFirstSize(record);
+  const std::size_t secondSize = layout.GetSecondSize(record);
+
+  double lexScore = 1.0;
+  for (std::size_t j = 0; j < secondSize; ++j) {
+    if (!layout.IsAligned(record, j)) {
+      lexScore *= PermissiveLookup(m_null, second[j]);
+      continue;
+    }
+    double thisWordScore = 0;
+    std::size_t numAligned = 0;
+    for (std::size_t i = 0; i < firstSize; ++i) {
+      if (layout.IsAligned(record, i, j)) {
+        thisWordScore += PermissiveLookup(first[i], second[j]);
+        ++numAligned;
+      }
+    }
+    lexScore *= thisWordScore / static_cast<double>(numAligned);
+  }
+  return lexScore;
+}
+
+}  // namespace ExtractScore
+}  // namespace MosesTraining
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <istream>
+
+#include <boost/unordered_map.hpp>
+
+#include "PhrasePairRecord.h"
+#include "RankedVocabulary.h"
+
+namespace MosesTraining
+{
+namespace ExtractScore
+{
+
+// Lexical translation probabilities p(second word | first word) as score
+// reads them from lex.f2e or lex.e2f, keyed by the ids of the two
+// vocabularies.  Entries for words that do not occur in the corpus are
+// dropped since no phrase pair can look them up.
+class LexicalTable
+{
+public:
+  LexicalTable(const RankedVocabulary &firstVocab,
+               const RankedVocabulary &secondVocab);
+
+  //! Reads lines "second first probability".
+  void Load(std::istream &input);
+
+  //! The probability of second given first, or 1 if there is none.
+  double PermissiveLookup(RankedVocabulary::IdType first,
+                          RankedVocabulary::IdType second) const {
+    Map::const_iterator p = m_table.find(Key(first, second));
+    return p == m_table.end() ? 1.0 : p->second;
+  }
+
+  //! The lexical weight of a phrase pair under its alignment, computed as
+  //! score does: unaligned words of the second phrase are explained by NULL.
+  double Score(const RecordLayout &layout, const void *record) const;
+
+private:
+  typedef boost::unordered_map<uint64_t, double> Map;
+
+  static uint64_t Key(RankedVocabulary::IdType first,
+                      RankedVocabulary::IdType second) {
+    return (static_cast<uint64_t>(first) << 32) | second;
+  }
+
+  // the null word of the first vocabulary
+  RankedVocabulary::IdType m_null;
+  const RankedVocabulary &m_firstVocab;
+  const RankedVocabulary &m_secondVocab;
+  Map m_table;
+};
+
+}  // namespace ExtractScore
+}  // namespace MosesTraining
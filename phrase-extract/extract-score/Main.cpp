@@ -0,0 +1,7 @@
+#include "ExtractScore.h"
+
+int main(int argc, char *argv[])
+{
+  MosesTraining::ExtractScore::ExtractScore tool;
+  return tool.Main(argc, argv);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+
+namespace MosesTraining
+{
+namespace ExtractScore
+{
+
+struct Options {
+public:
+  Options()
+    : logProb(false)
+    , lowCountFeature(false)
+    , maxPhraseLength(7)
+    , memory("1G")
+    , minCount(0.0f)
+    , noWordAlignment(false)
+    , onlyDirect(false)
+    , phraseCount(false)
+    , tempPrefix("/tmp/")
+    , threads(1) {}
+
+  // Positional options
+  std::string targetFile;
+  std::string sourceFile;
+  std::string alignmentFile;
+  std::string lexFileF2E;
+  std::string lexFileE2F;
+  std::string tableFile;
+
+  // All other options
+  bool logProb;
+  bool lowCountFeature;
+  int maxPhraseLength;
+  std::string memory;
+  float minCount;
+  bool noWordAlignment;
+  bool onlyDirect;
+  bool phraseCount;
+  std::string tempPrefix;
+  int threads;
+};
+
+}  // namespace ExtractScore
+}  // namespace MosesTraining
@@ -0,0 +1,177 @@
+#include "PhrasePairExtractor.h"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <set>
+
+#include "util/exception.hh"
+
+#include "SentenceAlignmentWithSyntax.h"
+
+namespace MosesTraining
+{
+namespace ExtractScore
+{
+
+PhrasePairExtractor::PhrasePairExtractor(const RankedVocabulary &sourceVocab,
+    const RankedVocabulary &targetVocab,
+    const RecordLayout &layout,
+    int maxPhraseLength)
+  : m_sourceVocab(sourceVocab)
+  , m_targetVocab(targetVocab)
+  , m_layout(layout)
+  , m_maxPhraseLength(maxPhraseLength)
+{
+  UTIL_THROW_IF2(maxPhraseLength <= 0 ||
+                 static_cast<std::size_t>(maxPhraseLength) > layout.GetMaxLength(),
+                 "Phrase length limit does not fit the record layout");
+}
+
+bool PhrasePairExtractor::Extract(const SentencePair &pair,
+                                  std::vector<uint8_t> &direct,
+                                  std::vector<uint8_t> &inverse) const
+{
+  // The target side may carry XML markup, which extract strips.
+  std::set<std::string> targetLabelCollection, sourceLabelCollection;
+  std::map<std::string, int> targetTopLabelCollection, sourceTopLabelCollection;
+  SentenceAlignmentWithSyntax sentence(
+    targetLabelCollection, sourceLabelCollection,
+    targetTopLabelCollection, sourceTopLabelCollection, true, false);
+  if (!sentence.create(pair.target.c_str(), pair.source.c_str(),
+                       pair.alignment.c_str(), "", pair.lineNum, false)) {
+    return false;
+  }
+
+  std::vector<uint32_t> sourceIds, targetIds;
+  Lookup(m_sourceVocab, sentence.source, sourceIds);
+  Lookup(m_targetVocab, sentence.target, targetIds);
+
+  const int countE = sentence.target.size();
+  const int countF = sentence.source.size();
+  std::vector<int> usedF;
+
+  // Target phrases grow one word at a time, so the source words they are
+  // aligned to are accumulated rather than recounted for every span.
+  for (int startE = 0; startE < countE; ++startE) {
+    int minF = std::numeric_limits<int>::max();
+    int maxF = -1;
+    usedF = sentence.alignedCountS;
+    for (int endE = startE;
+         endE < countE && endE < startE + m_maxPhraseLength; ++endE) {
+      const std::vector<int> &alignedToE = sentence.alignedToT[endE];
+      for (std::size_t i = 0; i < alignedToE.size(); ++i) {
+        const int fi = alignedToE[i];
+        minF = std::min(minF, fi);
+        maxF = std::max(maxF, fi);
+        --usedF[fi];
+      }
+
+      // aligned to any source words at all, source phrase within limits
+      if (maxF < 0 || maxF - minF >= m_maxPhraseLength) {
+        continue;
+      }
+
+      // check if source words are aligned to out of bound target words
+      bool outOfBounds = false;
+      for (int fi = minF; fi <= maxF && !outOfBounds; ++fi) {
+        outOfBounds = usedF[fi] > 0;
+      }
+      if (outOfBounds) {
+        continue;
+      }
+
+      // start point of source phrase may retreat over unaligned
+      for (int startF = minF;
+           startF >= 0 && startF > maxF - m_maxPhraseLength &&
+           (startF == minF || sentence.alignedCountS[startF] == 0);
+           --startF) {
+        // end point of source phrase may advance over unaligned
+        for (int endF = maxF;
+             endF < countF && endF < startF + m_maxPhraseLength &&
+             (endF == maxF || sentence.alignedCountS[endF] == 0);
+             ++endF) {
+          AddPhrasePair(sentence, sourceIds, targetIds, startE, endE,
+                        startF, endF, direct, inverse);
+        }
+      }
+    }
+  }
+  return true;
+}
+
+void PhrasePairExtractor::AddPhrasePair(const SentenceAlignment &sentence,
+                                        const std::vector<uint32_t> &sourceIds,
+                                        const std::vector<uint32_t> &targetIds,
+                                        int startE, int endE,
+                                        int startF, int endF,
+                                        std::vector<uint8_t> &direct,
+                                        std::vector<uint8_t> &inverse) const
+{
+  const std::size_t recordSize = m_layout.GetSize();
+  direct.resize(direct.size() + recordSize);
+  inverse.resize(inverse.size() + recordSize);
+  void *directRecord = &direct[direct.size() - recordSize];
+  void *inverseRecord = &inverse[inverse.size() - recordSize];
+
+  m_layout.Set(directRecord, &sourceIds[startF], endF - startF + 1,
+               &targetIds[startE], endE - startE + 1);
+  m_layout.Set(inverseRecord, &targetIds[startE], endE - startE + 1,
+               &sourceIds[startF], endF - startF + 1);
+  *m_layout.Header(directRecord) = 1.0f;
+  *m_layout.Header(inverseRecord) = 1.0f;
+
+  for (int ei = startE; ei <= endE; ++ei) {
+    const std::vector<int> &alignedToE = sentence.alignedToT[ei];
+    for (std::size_t i = 0; i < alignedToE.size(); ++i) {
+      const int fi = alignedToE[i];
+      m_layout.SetAligned(directRecord, fi - startF, ei - startE);
+      m_layout.SetAligned(inverseRecord, ei - startE, fi - startF);
+    }
+  }
+}
+
+void PhrasePairExtractor::Lookup(const RankedVocabulary &vocab,
+                                 const std::vector<std::string> &words,
+                                 std::vector<uint32_t> &ids) const
+{
+  ids.resize(words.size());
+  for (std::size_t i = 0; i < words.size(); ++i) {
+    UTIL_THROW_IF2(!vocab.Find(words[i], ids[i]),
+                   "Word '" << words[i] << "' is missing from the vocabulary");
+  }
+}
+
+ExtractTask::ExtractTask(const PhrasePairExtractor &extractor,
+                         std::vector<SentencePair> &batch,
+                         RecordWriter &directWriter,
+                         RecordWriter &inverseWriter,
+                         std::size_t recordSize,
+                         boost::mutex &writerMutex)
+  : m_extractor(extractor)
+  , m_directWriter(directWriter)
+  , m_inverseWriter(inverseWriter)
+  , m_recordSize(recordSize)
+  , m_writerMutex(writerMutex)
+{
+  m_batch.swap(batch);
+}
+
+void ExtractTask::Run()
+{
+  std::vector<uint8_t> direct, inverse;
+  for (std::size_t i = 0; i < m_batch.size(); ++i) {
+    m_extractor.Extract(m_batch[i], direct, inverse);
+  }
+
+  boost::mutex::scoped_lock lock(m_writerMutex);
+  for (std::size_t offset = 0; offset < direct.size(); offset += m_recordSize) {
+    m_directWriter.Add(&direct[offset]);
+  }
+  for (std::size_t offset = 0; offset < inverse.size(); offset += m_recordSize) {
+    m_inverseWriter.Add(&inverse[offset]);
+  }
+}
+
+}  // namespace ExtractScore
+}  // namespace MosesTraining
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include <stdint.h>
+
+#include "moses/ThreadPool.h"
+
+#include "SentenceAlignment.h"
+
+#include "PhrasePairRecord.h"
+#include "RankedVocabulary.h"
+#include "RecordWriter.h"
+
+namespace MosesTraining
+{
+namespace ExtractScore
+{
+
+// One line of each of the target, source and alignment files.
+struct SentencePair {
+  std::string target;
+  std::string source;
+  std::string alignment;
+  int lineNum;
+};
+
+// Extracts the phrase pairs of a sentence pair that are consistent with its
+// word alignment, exactly as extract does without any of its options, and
+// writes them as records: direct ones with the source phrase first, inverse
+// ones with the target phrase first.
+class PhrasePairExtractor
+{
+public:
+  PhrasePairExtractor(const RankedVocabulary &sourceVocab,
+                      const RankedVocabulary &targetVocab,
+                      const RecordLayout &layout, int maxPhraseLength);
+
+  //! Appends the records to the buffers, returns false if the sentence pair
+  //! is rejected (extract skips it, too).
+  bool Extract(const SentencePair &, std::vector<uint8_t> &direct,
+               std::vector<uint8_t> &inverse) const;
+
+private:
+  void AddPhrasePair(const SentenceAlignment &,
+                     const std::vector<uint32_t> &sourceIds,
+                     const std::vector<uint32_t> &targetIds,
+                     int startE, int endE, int startF, int endF,
+                     std::vector<uint8_t> &direct,
+                     std::vector<uint8_t> &inverse) const;
+
+  void Lookup(const RankedVocabulary &, const std::vector<std::string> &,
+              std::vector<uint32_t> &) const;
+
+  const RankedVocabulary &m_sourceVocab;
+  const RankedVocabulary &m_targetVocab;
+  const RecordLayout m_layout;
+  const int m_maxPhraseLength;
+};
+
+// Extracts the phrase pairs of a batch of sentence pairs and hands them to
+// the writers of the two sort chains.  The writers are shared by all tasks,
+// so they are only used while holding the mutex.
+class ExtractTask : public Moses::Task
+{
+public:
+  //! Takes the batch's sentence pairs, leaving it empty.
+  ExtractTask(const PhrasePairExtractor &, std::vector<SentencePair> &batch,
+              RecordWriter &directWriter, RecordWriter &inverseWriter,
+              std::size_t recordSize, boost::mutex &writerMutex);
+
+  void Run();
+
+private:
+  const PhrasePairExtractor &m_extractor;
+  std::vector<SentencePair> m_batch;
+  RecordWriter &m_directWriter;
+  RecordWriter &m_inverseWriter;
+  const std::size_t m_recordSize;
+  boost::mutex &m_writerMutex;
+};
+
+}  // namespace ExtractScore
+}  // namespace MosesTraining
@@ -0,0 +1,116 @@
+#include "PhrasePairGroup.h"
+
+#include <cstring>
+
+namespace MosesTraining
+{
+namespace ExtractScore
+{
+
+namespace
+{
+
+// Compares the alignments of two records of the same phrase pair the way
+// score compares its ALIGNMENT type: a vector over the words of the second
+// phrase of sets of positions in the first phrase.
+int CompareAlignmentSets(const RecordLayout &layout, const void *a,
+                         const void *b)
+{
+  const std::size_t firstSize = layout.GetFirstSize(a);
+  const std::size_t secondSize = layout.GetSecondSize(a);
+  for (std::size_t j = 0; j < secondSize; ++j) {
+    for (std::size_t i = 0; i < firstSize; ++i) {
+      const bool inA = layout.IsAligned(a, i, j);
+      if (inA == layout.IsAligned(b, i, j)) {
+        continue;
+      }
+      // The set with the smaller element is smaller, unless the other set
+      // has no more elements and is a prefix of it.
+      const void *other = inA ? b : a;
+      bool otherHasMore = false;
+      for (std::size_t k = i + 1; k < firstSize && !otherHasMore; ++k) {
+        otherHasMore = layout.IsAligned(other, k, j);
+      }
+      return (inA == otherHasMore) ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+
+PhrasePairGroup::PhrasePairGroup(const RecordLayout &layout)
+  : m_layout(layout)
+  , m_totalCount(0.0f)
+  , m_pairCount(0.0f)
+  , m_current(layout.GetSize())
+  , m_currentCount(0.0f)
+  , m_best(layout.GetSize())
+  , m_bestCount(0.0f)
+{
+}
+
+bool PhrasePairGroup::Read(util::stream::Stream &stream)
+{
+  m_records.clear();
+  m_counts.clear();
+  m_totalCount = 0.0f;
+  if (!stream) {
+    return false;
+  }
+
+  BeginPhrasePair(stream.Get());
+  for (++stream; stream; ++stream) {
+    const void *record = stream.Get();
+    const float count = *m_layout.Header(record);
+    if (!m_layout.SamePhrases(record, &m_current[0])) {
+      if (!m_layout.SameFirst(record, &m_current[0])) {
+        break;
+      }
+      EndPhrasePair();
+      BeginPhrasePair(record);
+      continue;
+    }
+    m_pairCount += count;
+    // The sort only combines equal records while merging, so the same
+    // alignment can still come in several records.
+    if (m_layout.SameAlignment(record, &m_current[0])) {
+      m_currentCount += count;
+    } else {
+      EndAlignment();
+      std::memcpy(&m_current[0], record, m_layout.GetSize());
+      m_currentCount = count;
+    }
+  }
+  EndPhrasePair();
+  return true;
+}
+
+void PhrasePairGroup::BeginPhrasePair(const void *record)
+{
+  std::memcpy(&m_current[0], record, m_layout.GetSize());
+  m_currentCount = m_pairCount = *m_layout.Header(record);
+  m_bestCount = -1.0f;
+}
+
+void PhrasePairGroup::EndPhrasePair()
+{
+  EndAlignment();
+  m_records.insert(m_records.end(), m_best.begin(), m_best.end());
+  m_counts.push_back(m_pairCount);
+  m_totalCount += m_pairCount;
+}
+
+void PhrasePairGroup::EndAlignment()
+{
+  // the most frequent alignment, ties going to the greater one
+  if (m_currentCount > m_bestCount ||
+      (m_currentCount == m_bestCount &&
+       CompareAlignmentSets(m_layout, &m_current[0], &m_best[0]) > 0)) {
+    m_best = m_current;
+    m_bestCount = m_currentCount;
+  }
+}
+
+}  // namespace ExtractScore
+}  // namespace MosesTraining
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+
+#include <stdint.h>
+
+#include "util/stream/stream.hh"
+
+#include "PhrasePairRecord.h"
+
+namespace MosesTraining
+{
+namespace ExtractScore
+{
+
+// The distinct phrase pairs that share a first phrase, read from a stream of
+// sorted records.  Records of the same phrase pair are summed up and each
+// pair keeps its most frequent word alignment, which is what score does with
+// the lines of a sorted extract file.
+class PhrasePairGroup
+{
+public:
+  explicit PhrasePairGroup(const RecordLayout &layout);
+
+  //! Reads the next group, returns false at the end of the stream.
+  bool Read(util::stream::Stream &stream);
+
+  std::size_t GetSize() const {
+    return m_counts.size();
+  }
+
+  float GetTotalCount() const {
+    return m_totalCount;
+  }
+
+  float GetCount(std::size_t i) const {
+    return m_counts[i];
+  }
+
+  //! The i-th phrase pair, with its best word alignment.
+  const void *GetRecord(std::size_t i) const {
+    return &m_records[i * m_layout.GetSize()];
+  }
+
+private:
+  void BeginPhrasePair(const void *record);
+  void EndPhrasePair();
+  void EndAlignment();
+
+  const RecordLayout m_layout;
+  std::vector<uint8_t> m_records;
+  std::vector<float> m_counts;
+  float m_totalCount;
+
+  // the phrase pair being read
+  float m_pairCount;
+  std::vector<uint8_t> m_current;
+  float m_currentCount;
+  std::vector<uint8_t> m_best;
+  float m_bestCount;
+};
+
+}  // namespace ExtractScore
+}  // namespace MosesTraining
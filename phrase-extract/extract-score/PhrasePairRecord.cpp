@@ -0,0 +1,191 @@
+#include "PhrasePairRecord.h"
+
+#include <algorithm>
+
+#include "util/exception.hh"
+
+namespace MosesTraining
+{
+namespace ExtractScore
+{
+
+RecordLayout::RecordLayout(std::size_t maxLength, std::size_t headerFloats,
+                           bool alignment)
+  : m_maxLength(maxLength)
+  , m_rowBytes(alignment ? (maxLength + 7) / 8 : 0)
+{
+  UTIL_THROW_IF2(maxLength == 0 || maxLength > 255,
+                 "Phrase length limit must be between 1 and 255");
+  m_sizesOffset = headerFloats * sizeof(float);
+  m_firstOffset = m_sizesOffset + 4;
+  m_secondOffset = m_firstOffset + maxLength * sizeof(uint32_t);
+  m_alignmentOffset = m_secondOffset + maxLength * sizeof(uint32_t);
+  m_size = m_alignmentOffset + maxLength * m_rowBytes;
+  // keep the floats and ids of the next record aligned
+  m_size = (m_size + 3) / 4 * 4;
+}
+
+void RecordLayout::Set(void *record,
+                       const uint32_t *first, std::size_t firstSize,
+                       const uint32_t *second, std::size_t secondSize) const
+{
+  uint8_t *bytes = static_cast<uint8_t*>(record);
+  std::memset(bytes, 0, m_size);
+  bytes[m_sizesOffset] = firstSize;
+  bytes[m_sizesOffset + 1] = secondSize;
+  std::memcpy(bytes + m_firstOffset, first, firstSize * sizeof(uint32_t));
+  std::memcpy(bytes + m_secondOffset, second, secondSize * sizeof(uint32_t));
+}
+
+bool RecordLayout::IsAligned(const void *record, std::size_t secondPos) const
+{
+  const uint8_t *row = Row(record, secondPos);
+  for (std::size_t i = 0; i < m_rowBytes; ++i) {
+    if (row[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool RecordLayout::SameFirst(const void *a, const void *b) const
+{
+  const std::size_t size = GetFirstSize(a);
+  return size == GetFirstSize(b) &&
+         std::equal(First(a), First(a) + size, First(b));
+}
+
+namespace
+{
+
+int ComparePhrase(const uint32_t *a, std::size_t aSize,
+                  const uint32_t *b, std::size_t bSize, uint32_t separator)
+{
+  const std::size_t common = std::min(aSize, bSize);
+  for (std::size_t i = 0; i < common; ++i) {
+    if (a[i] != b[i]) {
+      return a[i] < b[i] ? -1 : 1;
+    }
+  }
+  if (aSize == bSize) {
+    return 0;
+  }
+  // the shorter phrase is followed by the separator in the extract line
+  const uint32_t nextA = aSize > common ? a[common] : separator;
+  const uint32_t nextB = bSize > common ? b[common] : separator;
+  return nextA < nextB ? -1 : 1;
+}
+
+// Walks the alignment points of a record in the order extract writes them.
+class AlignmentPoints
+{
+public:
+  AlignmentPoints(const RecordLayout &layout, const void *record,
+                  bool firstIsTarget)
+    : m_layout(layout)
+    , m_record(record)
+    , m_firstIsTarget(firstIsTarget)
+    , m_outerSize(firstIsTarget ? layout.GetFirstSize(record)
+                  : layout.GetSecondSize(record))
+    , m_innerSize(firstIsTarget ? layout.GetSecondSize(record)
+                  : layout.GetFirstSize(record))
+    , m_outer(0)
+    , m_inner(0) {}
+
+  //! Finds the next point, returns false after the last one.
+  bool Next(std::size_t &firstPos, std::size_t &secondPos) {
+    for (; m_outer < m_outerSize; ++m_outer, m_inner = 0) {
+      while (m_inner < m_innerSize) {
+        firstPos = m_firstIsTarget ? m_outer : m_inner;
+        secondPos = m_firstIsTarget ? m_inner : m_outer;
+        ++m_inner;
+        if (m_layout.IsAligned(m_record, firstPos, secondPos)) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+private:
+  const RecordLayout &m_layout;
+  const void *m_record;
+  const bool m_firstIsTarget;
+  const std::size_t m_outerSize;
+  const std::size_t m_innerSize;
+  std::size_t m_outer;
+  std::size_t m_inner;
+};
+
+// Writes " x-y" backwards from end, returns the start.
+char *PrintPoint(std::size_t x, std::size_t y, char *end)
+{
+  do {
+    *--end = '0' + y % 10;
+    y /= 10;
+  } while (y);
+  *--end = '-';
+  do {
+    *--end = '0' + x % 10;
+    x /= 10;
+  } while (x);
+  *--end = ' ';
+  return end;
+}
+
+}  // namespace
+
+int PhrasePairOrder::ComparePhrases(const void *a, const void *b) const
+{
+  int cmp = ComparePhrase(m_layout.First(a), m_layout.GetFirstSize(a),
+                          m_layout.First(b), m_layout.GetFirstSize(b),
+                          m_firstSeparator);
+  if (cmp != 0) {
+    return cmp;
+  }
+  return ComparePhrase(m_layout.Second(a), m_layout.GetSecondSize(a),
+                       m_layout.Second(b), m_layout.GetSecondSize(b),
+                       m_secondSeparator);
+}
+
+int PhrasePairOrder::Compare(const void *a, const void *b) const
+{
+  const int cmp = ComparePhrases(a, b);
+  if (cmp != 0 || !m_layout.HasAlignment() || m_layout.SameAlignment(a, b)) {
+    return cmp;
+  }
+  return CompareAlignments(a, b);
+}
+
+int PhrasePairOrder::CompareAlignments(const void *a, const void *b) const
+{
+  // As long as the points are the same so is the text; the first different
+  // point decides, a point whose text is a prefix of the other's being
+  // followed by a space or the end of the line.
+  AlignmentPoints pointsA(m_layout, a, m_firstIsTarget);
+  AlignmentPoints pointsB(m_layout, b, m_firstIsTarget);
+  std::size_t xA, yA, xB, yB;
+  while (true) {
+    const bool moreA = pointsA.Next(xA, yA);
+    const bool moreB = pointsB.Next(xB, yB);
+    if (!moreA || !moreB) {
+      return moreA == moreB ? 0 : (moreA ? 1 : -1);
+    }
+    if (xA == xB && yA == yB) {
+      continue;
+    }
+    char bufA[32], bufB[32];
+    const char *textA = PrintPoint(xA, yA, bufA + sizeof(bufA));
+    const char *textB = PrintPoint(xB, yB, bufB + sizeof(bufB));
+    const std::size_t sizeA = bufA + sizeof(bufA) - textA;
+    const std::size_t sizeB = bufB + sizeof(bufB) - textB;
+    const int cmp = std::memcmp(textA, textB, std::min(sizeA, sizeB));
+    if (cmp != 0) {
+      return cmp < 0 ? -1 : 1;
+    }
+    return sizeA < sizeB ? -1 : 1;
+  }
+}
+
+}  // namespace ExtractScore
+}  // namespace MosesTraining
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+#include <stdint.h>
+
+namespace MosesTraining
+{
+namespace ExtractScore
+{
+
+// Layout of the fixed-size binary records that stand in for the lines of the
+// extract files as phrase pairs go through the sorts:
+//
+//   float    header[headerFloats]         counts and scores
+//   uint8_t  first size, second size, two bytes of padding
+//   uint32_t first phrase[maxLength]      vocabulary ids (ranks)
+//   uint32_t second phrase[maxLength]
+//   uint8_t  alignment[maxLength][rows]   optional, one bit row per word of
+//                                         the second phrase
+//
+// Unused slots are zero, so two records hold the same phrase pair (and word
+// alignment) if and only if their bytes after the header are equal.
+class RecordLayout
+{
+public:
+  RecordLayout(std::size_t maxLength, std::size_t headerFloats, bool alignment);
+
+  std::size_t GetSize() const {
+    return m_size;
+  }
+
+  std::size_t GetMaxLength() const {
+    return m_maxLength;
+  }
+
+  bool HasAlignment() const {
+    return m_rowBytes != 0;
+  }
+
+  //! Offset of the part of a record that identifies it (all but the header).
+  std::size_t GetKeyOffset() const {
+    return m_sizesOffset;
+  }
+
+  float *Header(void *record) const {
+    return static_cast<float*>(record);
+  }
+
+  const float *Header(const void *record) const {
+    return static_cast<const float*>(record);
+  }
+
+  std::size_t GetFirstSize(const void *record) const {
+    return Bytes(record)[m_sizesOffset];
+  }
+
+  std::size_t GetSecondSize(const void *record) const {
+    return Bytes(record)[m_sizesOffset + 1];
+  }
+
+  const uint32_t *First(const void *record) const {
+    return reinterpret_cast<const uint32_t*>(Bytes(record) + m_firstOffset);
+  }
+
+  const uint32_t *Second(const void *record) const {
+    return reinterpret_cast<const uint32_t*>(Bytes(record) + m_secondOffset);
+  }
+
+  //! Zeroes the record and sets both phrases.
+  void Set(void *record,
+           const uint32_t *first, std::size_t firstSize,
+           const uint32_t *second, std::size_t secondSize) const;
+
+  void SetAligned(void *record, std::size_t firstPos,
+                  std::size_t secondPos) const {
+    Row(record, secondPos)[firstPos / 8] |= 1 << (firstPos % 8);
+  }
+
+  bool IsAligned(const void *record, std::size_t firstPos,
+                 std::size_t secondPos) const {
+    return Row(record, secondPos)[firstPos / 8] & (1 << (firstPos % 8));
+  }
+
+  //! Whether any word of the first phrase is aligned to this one.
+  bool IsAligned(const void *record, std::size_t secondPos) const;
+
+  //! Whether both records hold the same phrase pair, ignoring the alignment.
+  bool SamePhrases(const void *a, const void *b) const {
+    return !std::memcmp(Bytes(a) + m_sizesOffset, Bytes(b) + m_sizesOffset,
+                        m_alignmentOffset - m_sizesOffset);
+  }
+
+  bool SameFirst(const void *a, const void *b) const;
+
+  bool SameAlignment(const void *a, const void *b) const {
+    return !std::memcmp(Bytes(a) + m_alignmentOffset,
+                        Bytes(b) + m_alignmentOffset,
+                        m_size - m_alignmentOffset);
+  }
+
+  bool SameKey(const void *a, const void *b) const {
+    return !std::memcmp(Bytes(a) + m_sizesOffset, Bytes(b) + m_sizesOffset,
+                        m_size - m_sizesOffset);
+  }
+
+private:
+  static const uint8_t *Bytes(const void *record) {
+    return static_cast<const uint8_t*>(record);
+  }
+
+  uint8_t *Row(void *record, std::size_t secondPos) const {
+    return static_cast<uint8_t*>(record) + m_alignmentOffset + secondPos * m_rowBytes;
+  }
+
+  const uint8_t *Row(const void *record, std::size_t secondPos) const {
+    return Bytes(record) + m_alignmentOffset + secondPos * m_rowBytes;
+  }
+
+  std::size_t m_maxLength;
+  std::size_t m_rowBytes;
+  std::size_t m_sizesOffset;
+  std::size_t m_firstOffset;
+  std::size_t m_secondOffset;
+  std::size_t m_alignmentOffset;
+  std::size_t m_size;
+};
+
+// The order in which LC_ALL=C sort puts the extract file lines the records
+// stand for: "first ||| second ||| alignment".  Ids compare like the words
+// (see RankedVocabulary) and the alignment is compared as the text extract
+// writes for it, points listed by target word, " x-y" with x the position in
+// the first phrase.  In the direct extract file the second phrase is the
+// target, in the inverse one the first.
+class PhrasePairOrder
+{
+public:
+  PhrasePairOrder(const RecordLayout &layout, uint32_t firstSeparator,
+                  uint32_t secondSeparator, bool firstIsTarget)
+    : m_layout(layout)
+    , m_firstSeparator(firstSeparator)
+    , m_secondSeparator(secondSeparator)
+    , m_firstIsTarget(firstIsTarget) {}
+
+  bool operator()(const void *a, const void *b) const {
+    return Compare(a, b) < 0;
+  }
+
+  int Compare(const void *a, const void *b) const;
+
+  //! Compares the phrases only.
+  int ComparePhrases(const void *a, const void *b) const;
+
+private:
+  int CompareAlignments(const void *a, const void *b) const;
+
+  RecordLayout m_layout;
+  uint32_t m_firstSeparator;
+  uint32_t m_secondSeparator;
+  bool m_firstIsTarget;
+};
+
+// Combiner for util::stream::Sort: merges equal records by adding up their
+// counts, the first float of the header.
+class CombineCounts
+{
+public:
+  explicit CombineCounts(const RecordLayout &layout) : m_layout(layout) {}
+
+  template <class Compare> bool operator()(void *into, const void *option,
+      const Compare &) const {
+    if (!m_layout.SameKey(into, option)) {
+      return false;
+    }
+    *m_layout.Header(into) += *m_layout.Header(option);
+    return true;
+  }
+
+private:
+  RecordLayout m_layout;
+};
+
+}  // namespace ExtractScore
+}  // namespace MosesTraining
@@ -0,0 +1,95 @@
+#include "PhraseTableWriter.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace MosesTraining
+{
+namespace ExtractScore
+{
+
+namespace
+{
+
+// score writes counts with the default stream precision and consolidate
+// reads them back with atof.
+float AsPrinted(float count)
+{
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%g", count);
+  return std::atof(buffer);
+}
+
+}  // namespace
+
+void PhraseTableWriter::WriteLine(const RecordLayout &directLayout,
+                                  const void *direct, float sourceCount,
+                                  const RecordLayout &scoreLayout,
+                                  const void *scores)
+{
+  const float countF = AsPrinted(sourceCount);
+  const float countE = AsPrinted(scoreLayout.Header(scores)[0]);
+  const float countEF = AsPrinted(scoreLayout.Header(scores)[1]);
+  const float lexInverse = scoreLayout.Header(scores)[2];
+  const float lexDirect = MaybeLogLex(m_lexTable.Score(directLayout, direct));
+
+  // source and target phrases
+  WritePhrase(m_sourceVocab, directLayout.First(direct),
+              directLayout.GetFirstSize(direct));
+  m_out << " ||| ";
+  WritePhrase(m_targetVocab, directLayout.Second(direct),
+              directLayout.GetSecondSize(direct));
+  m_out << " |||";
+
+  // prob indirect
+  if (!m_options.onlyDirect) {
+    m_out << " " << MaybeLogProb(countEF/countE);
+    m_out << " " << lexInverse;
+  }
+
+  // prob direct
+  m_out << " " << MaybeLogProb(countEF/countF);
+  m_out << " " << lexDirect;
+
+  // phrase count feature
+  if (m_options.phraseCount) {
+    m_out << " " << MaybeLogProb(2.718);
+  }
+
+  // low count feature
+  if (m_options.lowCountFeature) {
+    m_out << " " << MaybeLogProb(std::exp(-1.0/countEF));
+  }
+
+  // alignment, by target word
+  m_out << " |||";
+  if (!m_options.noWordAlignment) {
+    const std::size_t sourceSize = directLayout.GetFirstSize(direct);
+    const std::size_t targetSize = directLayout.GetSecondSize(direct);
+    for (std::size_t j = 0; j < targetSize; ++j) {
+      for (std::size_t i = 0; i < sourceSize; ++i) {
+        if (directLayout.IsAligned(direct, i, j)) {
+          m_out << " " << i << "-" << j;
+        }
+      }
+    }
+  }
+
+  // counts, sparse features and properties
+  m_out << " ||| " << countE << " " << countF << " " << countEF;
+  m_out << " ||| |||\n";
+}
+
+void PhraseTableWriter::WritePhrase(const RankedVocabulary &vocab,
+                                    const uint32_t *ids, std::size_t size)
+{
+  for (std::size_t i = 0; i < size; ++i) {
+    if (i) {
+      m_out << " ";
+    }
+    m_out << vocab.GetWord(ids[i]);
+  }
+}
+
+}  // namespace ExtractScore
+}  // namespace MosesTraining
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cmath>
+#include <ostream>
+
+#include "LexicalTable.h"
+#include "Options.h"
+#include "PhrasePairRecord.h"
+#include "RankedVocabulary.h"
+
+namespace MosesTraining
+{
+namespace ExtractScore
+{
+
+// Writes the lines of the phrase table as consolidate would for the two
+// halves written by score, including the round trip of the counts through
+// their text form, so that the table is the same to the byte.
+class PhraseTableWriter
+{
+public:
+  PhraseTableWriter(const Options &options, std::ostream &out,
+                    const RankedVocabulary &sourceVocab,
+                    const RankedVocabulary &targetVocab,
+                    const LexicalTable &lexTable)
+    : m_options(options)
+    , m_out(out)
+    , m_sourceVocab(sourceVocab)
+    , m_targetVocab(targetVocab)
+    , m_lexTable(lexTable) {}
+
+  //! Writes a phrase pair given its direct record (with the best alignment),
+  //! the count of its source phrase and the matching record of scores from
+  //! the InverseScorer.
+  void WriteLine(const RecordLayout &directLayout, const void *direct,
+                 float sourceCount, const RecordLayout &scoreLayout,
+                 const void *scores);
+
+private:
+  // as score's MaybeLog
+  float MaybeLogLex(float a) const {
+    return m_options.logProb ? std::log(static_cast<double>(a)) : a;
+  }
+
+  // as consolidate's maybeLogProb
+  float MaybeLogProb(float a) const {
+    return m_options.logProb ? std::log(a) : a;
+  }
+
+  void WritePhrase(const RankedVocabulary &, const uint32_t *, std::size_t);
+
+  const Options &m_options;
+  std::ostream &m_out;
+  const RankedVocabulary &m_sourceVocab;
+  const RankedVocabulary &m_targetVocab;
+  const LexicalTable &m_lexTable;
+};
+
+}  // namespace ExtractScore
+}  // namespace MosesTraining
@@ -0,0 +1,56 @@
+#include "RankedVocabulary.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "util/exception.hh"
+
+namespace MosesTraining
+{
+namespace ExtractScore
+{
+
+const char *const RankedVocabulary::kSeparator = "|||";
+
+namespace
+{
+
+// Orders words as the byte strings "word " compare, without building them.
+struct SpaceTerminatedOrder {
+  bool operator()(const std::string &a, const std::string &b) const {
+    const std::size_t common = std::min(a.size(), b.size());
+    const int cmp = std::memcmp(a.data(), b.data(), common);
+    if (cmp != 0) {
+      return cmp < 0;
+    }
+    if (a.size() == b.size()) {
+      return false;
+    }
+    // words contain no spaces, so the bytes after the common prefix differ
+    const unsigned char nextA = a.size() > common ? a[common] : ' ';
+    const unsigned char nextB = b.size() > common ? b[common] : ' ';
+    return nextA < nextB;
+  }
+};
+
+}  // namespace
+
+void RankedVocabulary::Finalize()
+{
+  UTIL_THROW_IF2(m_finalized, "Vocabulary finalized twice");
+  m_finalized = true;
+
+  Insert(kSeparator);
+  m_words.reserve(m_ids.size());
+  for (Map::const_iterator p = m_ids.begin(); p != m_ids.end(); ++p) {
+    m_words.push_back(p->first);
+  }
+  std::sort(m_words.begin(), m_words.end(), SpaceTerminatedOrder());
+  for (std::size_t i = 0; i < m_words.size(); ++i) {
+    m_ids[m_words[i]] = i;
+  }
+  m_separator = m_ids[kSeparator];
+}
+
+}  // namespace ExtractScore
+}  // namespace MosesTraining
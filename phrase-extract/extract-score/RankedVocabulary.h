@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+#include <stdint.h>
+
+namespace MosesTraining
+{
+namespace ExtractScore
+{
+
+// A vocabulary whose ids are the ranks of the words in C locale (byte) order
+// of "word ", together with the field separator "|||".  Comparing phrases
+// id by id, with the separator standing in for the end of a phrase, then
+// gives the same order as running LC_ALL=C sort over the lines of an extract
+// file, which is what the scoring steps of the phrase table pipeline rely on.
+//
+// Words are added with Insert() and the ids assigned by Finalize(); after that
+// the vocabulary is read-only and can be shared between threads.
+class RankedVocabulary
+{
+public:
+  typedef uint32_t IdType;
+
+  static const char *const kSeparator;
+
+  RankedVocabulary() : m_finalized(false), m_separator(0) {}
+
+  void Insert(const std::string &word) {
+    m_ids.insert(std::make_pair(word, IdType(0)));
+  }
+
+  void Finalize();
+
+  bool Find(const std::string &word, IdType &id) const {
+    Map::const_iterator p = m_ids.find(word);
+    if (p == m_ids.end()) {
+      return false;
+    }
+    id = p->second;
+    return true;
+  }
+
+  const std::string &GetWord(IdType id) const {
+    return m_words[id];
+  }
+
+  IdType GetSeparator() const {
+    return m_separator;
+  }
+
+  std::size_t GetSize() const {
+    return m_words.size();
+  }
+
+private:
+  typedef boost::unordered_map<std::string, IdType> Map;
+
+  bool m_finalized;
+  Map m_ids;
+  std::vector<std::string> m_words;
+  IdType m_separator;
+};
+
+}  // namespace ExtractScore
+}  // namespace MosesTraining
@@ -0,0 +1,78 @@
+#include "RecordWriter.h"
+
+#include <cstring>
+
+#include "util/exception.hh"
+
+namespace MosesTraining
+{
+namespace ExtractScore
+{
+
+namespace
+{
+// as in lm/builder/corpus_count.cc
+const float kProbingMultiplier = 1.5;
+}
+
+RecordWriter::RecordWriter(const RecordLayout &layout,
+                           const util::stream::ChainPosition &position)
+  : m_layout(layout)
+  , m_block(position)
+  , m_invalid(util::MallocOrThrow(layout.GetSize()))
+  , m_tableBytes(Table::Size(position.GetChain().BlockSize() / layout.GetSize(),
+                             kProbingMultiplier))
+  , m_tableMemory(util::MallocOrThrow(m_tableBytes))
+  , m_table(m_tableMemory.get(), m_tableBytes,
+            static_cast<uint8_t*>(m_invalid.get()),
+            KeyHash(layout), KeyEquals(layout))
+  , m_finished(false)
+{
+  std::memset(m_invalid.get(), 0xff, layout.GetSize());
+  m_table.Clear();
+  m_current = static_cast<uint8_t*>(m_block->Get());
+  m_end = m_current + m_block->ValidSize();
+}
+
+RecordWriter::~RecordWriter()
+{
+  if (!m_finished) {
+    Finish();
+  }
+}
+
+void RecordWriter::Add(const void *record)
+{
+  std::memcpy(m_current, record, m_layout.GetSize());
+  Entry entry;
+  entry.key = m_current;
+  Table::MutableIterator found;
+  if (m_table.FindOrInsert(entry, found)) {
+    *m_layout.Header(found->key) += *m_layout.Header(record);
+    return;
+  }
+  m_current += m_layout.GetSize();
+  if (m_current == m_end) {
+    NextBlock();
+  }
+}
+
+void RecordWriter::NextBlock()
+{
+  m_block->SetValidSize(m_current - static_cast<uint8_t*>(m_block->Get()));
+  ++m_block;
+  m_table.Clear();
+  m_current = static_cast<uint8_t*>(m_block->Get());
+  m_end = m_current + m_block->ValidSize();
+}
+
+void RecordWriter::Finish()
+{
+  UTIL_THROW_IF2(m_finished, "RecordWriter finished twice");
+  m_finished = true;
+  m_block->SetValidSize(m_current - static_cast<uint8_t*>(m_block->Get()));
+  (++m_block).Poison();
+}
+
+}  // namespace ExtractScore
+}  // namespace MosesTraining
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <functional>
+
+#include "util/murmur_hash.hh"
+#include "util/probing_hash_table.hh"
+#include "util/scoped.hh"
+#include "util/stream/chain.hh"
+
+#include "PhrasePairRecord.h"
+
+namespace MosesTraining
+{
+namespace ExtractScore
+{
+
+// Fills the blocks of a chain with records.  A record that is already in the
+// current block only adds its count to the one there, so frequent phrase
+// pairs reach the sort (and its temporary files) once per block rather than
+// once per occurrence; the sort's combiner takes care of the rest.
+//
+// Not thread-safe.
+class RecordWriter
+{
+public:
+  RecordWriter(const RecordLayout &layout,
+               const util::stream::ChainPosition &position);
+
+  ~RecordWriter();
+
+  void Add(const void *record);
+
+  //! Passes on the last block and poisons the chain.
+  void Finish();
+
+private:
+  class KeyHash : public std::unary_function<const uint8_t *, std::size_t>
+  {
+  public:
+    explicit KeyHash(const RecordLayout &layout)
+      : m_offset(layout.GetKeyOffset())
+      , m_size(layout.GetSize() - layout.GetKeyOffset()) {}
+
+    std::size_t operator()(const uint8_t *record) const {
+      return util::MurmurHashNative(record + m_offset, m_size);
+    }
+
+  private:
+    std::size_t m_offset;
+    std::size_t m_size;
+  };
+
+  class KeyEquals
+    : public std::binary_function<const uint8_t *, const uint8_t *, bool>
+  {
+  public:
+    explicit KeyEquals(const RecordLayout &layout) : m_layout(layout) {}
+
+    bool operator()(const uint8_t *a, const uint8_t *b) const {
+      return m_layout.SameKey(a, b);
+    }
+
+  private:
+    RecordLayout m_layout;
+  };
+
+  struct Entry {
+    typedef uint8_t *Key;
+    Key GetKey() const {
+      return key;
+    }
+    void SetKey(Key to) {
+      key = to;
+    }
+    Key key;
+  };
+
+  typedef util::ProbingHashTable<Entry, KeyHash, KeyEquals> Table;
+
+  void NextBlock();
+
+  const RecordLayout m_layout;
+  util::stream::Link m_block;
+  uint8_t *m_current;
+  uint8_t *m_end;
+  //! a record that matches no real one: its padding is not zero
+  util::scoped_malloc m_invalid;
+  std::size_t m_tableBytes;
+  util::scoped_malloc m_tableMemory;
+  Table m_table;
+  bool m_finished;
+};
+
+}  // namespace ExtractScore
+}  // namespace MosesTraining
@@ -0,0 +1,2 @@
+#!/bin/sh
+./bjam -q -j2 link=static --max-kenlm-order=6 moses//moses
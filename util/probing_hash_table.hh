@@ -208,6 +208,14 @@ template <class EntryT, class HashT, class EqualT = std::equal_to<typename Entry
       return FindFromIdeal(key, out);
     }
 
+    // Hint that Find(key) will be called soon.  Lets callers with several
+    // independent keys have their cache misses in flight at the same time.
+    template <class Key> void Prefetch(const Key key) const {
+#ifdef __GNUC__
+      __builtin_prefetch(&*Ideal(key));
+#endif
+    }
+
     // Like Find but we're sure it must be there.
     template <class Key> ConstIterator MustFind(const Key key) const {
       for (ConstIterator i(Ideal(key));; mod_.Next(begin_, end_, i)) {
@@ -10,6 +10,8 @@
 
 namespace util { namespace stream {
 
+LineInput::LineInput(int fd) : fd_(fd) {}
+
 void LineInput::Run(const ChainPosition &position) {
   ReadCompressed reader(fd_);
   // Holding area for beginning of line to be placed in next block.